@@ -0,0 +1,133 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "batch.h"
+
+#include <stdlib.h>
+
+#include <sstream>
+
+namespace calculator_cli {
+
+bool ParseOperator(const std::string &text, Operator *op) {
+  if (text == "+") {
+    *op = Operator::kAdd;
+  } else if (text == "-") {
+    *op = Operator::kSubtract;
+  } else if (text == "*") {
+    *op = Operator::kMultiply;
+  } else if (text == "/") {
+    *op = Operator::kDivide;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+namespace {
+
+bool ParseNumber(const std::string &text, double *value) {
+  char *end = nullptr;
+  *value = strtod(text.c_str(), &end);
+  return !text.empty() && *end == '\0';
+}
+
+// Parses "a b op". On failure, describes the problem in |error|.
+bool ParseLine(const std::string &line, double *a, double *b, Operator *op, std::string *error) {
+  std::istringstream tokens(line);
+  std::string a_text, b_text, op_text, extra;
+  if (!(tokens >> a_text >> b_text >> op_text) || (tokens >> extra)) {
+    *error = "expected \"a b op\"";
+    return false;
+  }
+  if (!ParseNumber(a_text, a) || !ParseNumber(b_text, b)) {
+    *error = "couldn't parse input numbers";
+    return false;
+  }
+  if (!ParseOperator(op_text, op)) {
+    *error = "operation not supported";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+BatchRunner::BatchRunner(BatchEngine *engine, std::istream *input, std::ostream *output,
+                         size_t window)
+    : engine_(engine), input_(input), output_(output), window_(window ? window : 1) {}
+
+void BatchRunner::Run(fit::closure done) {
+  done_ = std::move(done);
+  start_ = std::chrono::steady_clock::now();
+  Fill();
+}
+
+void BatchRunner::Fill() {
+  while (in_flight_ < window_ && !input_done_) {
+    std::string line;
+    if (!std::getline(*input_, line)) {
+      input_done_ = true;
+      break;
+    }
+    line_number_++;
+    size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') {
+      continue;
+    }
+
+    uint64_t index = next_index_++;
+    pending_.emplace_back();
+    operations_++;
+    double a = 0;
+    double b = 0;
+    Operator op;
+    std::string error;
+    if (!ParseLine(line, &a, &b, &op, &error)) {
+      errors_++;
+      Complete(index, "Error: line " + std::to_string(line_number_) + ": " + error);
+      continue;
+    }
+    in_flight_++;
+    engine_->DoBinaryOp(op, a, b, [this, index](double answer, std::string error) {
+      in_flight_--;
+      std::ostringstream text;
+      if (!error.empty()) {
+        errors_++;
+        text << "Error: " << error;
+      } else {
+        text << answer;
+      }
+      Complete(index, text.str());
+      Fill();
+    });
+  }
+
+  if (input_done_ && in_flight_ == 0 && done_) {
+    end_ = std::chrono::steady_clock::now();
+    output_->flush();
+    fit::closure done = std::move(done_);
+    done();
+  }
+}
+
+void BatchRunner::Complete(uint64_t index, std::string text) {
+  Line &line = pending_[index - next_output_];
+  line.done = true;
+  line.text = std::move(text);
+  while (!pending_.empty() && pending_.front().done) {
+    *output_ << pending_.front().text << '\n';
+    pending_.pop_front();
+    next_output_++;
+  }
+}
+
+void BatchRunner::PrintSummary(std::ostream *out) const {
+  double seconds = std::chrono::duration<double>(end_ - start_).count();
+  *out << operations_ << " operations (" << errors_ << " errors) in " << seconds << " s, "
+       << (seconds > 0 ? static_cast<double>(operations_) / seconds : 0) << " ops/s"
+       << std::endl;
+}
+
+}  // namespace calculator_cli
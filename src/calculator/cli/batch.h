@@ -0,0 +1,98 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Runs a file of "a b op" operations through the engine with several in
+/// flight at once.
+
+#ifndef EXAMPLES_CALCULATOR_CLI_BATCH_H_
+#define EXAMPLES_CALCULATOR_CLI_BATCH_H_
+
+#include <lib/fit/function.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <deque>
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace calculator_cli {
+
+/// The operators a batch line may use.
+enum class Operator { kAdd, kSubtract, kMultiply, kDivide };
+
+/// Parses one of the operators + - * /.
+bool ParseOperator(const std::string &text, Operator *op);
+
+/// Where a BatchRunner sends its operations: the engine over FIDL, or a fake
+/// in tests.
+class BatchEngine {
+ public:
+  /// Called with the answer, or with a non-empty |error| if there is none.
+  using Callback = fit::function<void(double answer, std::string error)>;
+
+  virtual ~BatchEngine() = default;
+
+  /// Computes |a| |op| |b|, and calls |callback| later with the result.
+  virtual void DoBinaryOp(Operator op, double a, double b, Callback callback) = 0;
+};
+
+/// Runs many operations over one connection to the engine, so the cost of
+/// launching the engine is paid once rather than per operation.
+///
+/// Each input line holds one operation, "a b op", as on the command line.
+/// Blank lines and lines starting with '#' are skipped. Up to |window|
+/// requests are kept in flight at once. Each result is written to the output
+/// on its own line, in input order, as soon as every earlier result has been
+/// written.
+class BatchRunner {
+ public:
+  BatchRunner(BatchEngine *engine, std::istream *input, std::ostream *output, size_t window);
+
+  /// Starts sending operations. Calls |done| once every line has been read
+  /// and answered.
+  void Run(fit::closure done);
+
+  /// Writes the number of operations, errors, wall time and operations per
+  /// second to |out|.
+  void PrintSummary(std::ostream *out) const;
+
+ private:
+  BatchRunner(const BatchRunner &) = delete;
+  BatchRunner &operator=(const BatchRunner &) = delete;
+
+  struct Line {
+    bool done = false;
+    std::string text;
+  };
+
+  // Sends operations until the window is full or the input is exhausted.
+  void Fill();
+
+  // Records the output for line |index| and writes whatever is now in order.
+  void Complete(uint64_t index, std::string text);
+
+  BatchEngine *engine_;
+  std::istream *input_;
+  std::ostream *output_;
+  const size_t window_;
+  fit::closure done_;
+
+  bool input_done_ = false;
+  size_t in_flight_ = 0;
+  uint64_t line_number_ = 0;
+  // Outputs not yet written, for indices from |next_output_| on.
+  std::deque<Line> pending_;
+  uint64_t next_output_ = 0;
+  uint64_t next_index_ = 0;
+
+  uint64_t operations_ = 0;
+  uint64_t errors_ = 0;
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point end_;
+};
+
+}  // namespace calculator_cli
+
+#endif  // EXAMPLES_CALCULATOR_CLI_BATCH_H_
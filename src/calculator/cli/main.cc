@@ -7,16 +7,23 @@
 #include <fuchsia/examples/calculator/cpp/fidl.h>
 #include <lib/async-loop/cpp/loop.h>
 #include <lib/async-loop/default.h>
+#include <zircon/status.h>
 
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "batch.h"
 #include "client.h"
 
 namespace calculator = fuchsia::examples::calculator;
 
 namespace calculator_cli {
 const int kArgumentError = -1;
+const size_t kDefaultWindow = 64;
 
 /// The configuration as expressed by command-line arguments passed to this
 /// tool.
@@ -24,19 +31,129 @@ struct Configuration {
   int a;
   int b;
   calculator::BinaryOp op;
+  /// If set, the expression to evaluate instead of |a| |op| |b|.
+  std::string expression;
+  /// The value of each variable in |expression|.
+  std::map<std::string, double> variables;
+  /// Whether to read operations line by line instead, from |batch_file|, or
+  /// from stdin if it is empty or "-".
+  bool batch = false;
+  std::string batch_file;
+  /// The most batch operations in flight at once.
+  size_t window = kDefaultWindow;
+};
+
+calculator::BinaryOp ToBinaryOp(Operator op) {
+  switch (op) {
+    case Operator::kAdd:
+      return calculator::BinaryOp::ADDITION;
+    case Operator::kSubtract:
+      return calculator::BinaryOp::SUBTRACTION;
+    case Operator::kMultiply:
+      return calculator::BinaryOp::MULTIPLICATION;
+    case Operator::kDivide:
+    default:
+      return calculator::BinaryOp::DIVISION;
+  }
+}
+
+/// Parses one of the operators + - * /.
+bool ParseBinaryOp(const std::string &text, calculator::BinaryOp *op) {
+  Operator parsed;
+  if (!ParseOperator(text, &parsed)) {
+    return false;
+  }
+  *op = ToBinaryOp(parsed);
+  return true;
+}
+
+/// Sends the operations of a batch to the engine.
+class FidlBatchEngine : public BatchEngine {
+ public:
+  explicit FidlBatchEngine(calculator::CalculatorPtr *calculator) : calculator_(calculator) {}
+
+  void DoBinaryOp(Operator op, double a, double b, Callback callback) override {
+    (*calculator_)
+        ->DoBinaryOp(ToBinaryOp(op), a, b,
+                     [callback = std::move(callback)](calculator::Result result) {
+                       if (result.is_error()) {
+                         callback(0, std::move(result.error().message));
+                       } else {
+                         callback(result.number(), std::string());
+                       }
+                     });
+  }
+
+ private:
+  calculator::CalculatorPtr *calculator_;
 };
 
 /// Prints the usage information for this tool.
 void PrintUsage(char *arg0) {
   std::cerr << "Usage:" << std::endl;
   std::cerr << arg0 << " a b op" << std::endl;
+  std::cerr << arg0 << " --expr expression [name=value ...]" << std::endl;
+  std::cerr << arg0 << " --batch [--window N] [FILE|-]" << std::endl;
+}
+
+/// Parses the arguments of --expr.
+Configuration ParseExpressionArguments(int argc, char **argv) {
+  // An empty expression would leave main() to evaluate the unset |a| |op| |b|.
+  if (argc < 3 || argv[2][0] == '\0') {
+    PrintUsage(argv[0]);
+    exit(kArgumentError);
+  }
+  Configuration config;
+  config.expression = argv[2];
+  for (int i = 3; i < argc; i++) {
+    const char *equals = strchr(argv[i], '=');
+    char *value_end = nullptr;
+    double value = equals ? std::strtod(equals + 1, &value_end) : 0;
+    if (!equals || equals == argv[i] || value_end == equals + 1 || *value_end != '\0') {
+      std::cerr << "Couldn't parse variable: " << argv[i] << std::endl;
+      PrintUsage(argv[0]);
+      exit(kArgumentError);
+    }
+    config.variables[std::string(argv[i], equals)] = value;
+  }
+  return config;
+}
+
+/// Parses the arguments of --batch.
+Configuration ParseBatchArguments(int argc, char **argv) {
+  Configuration config;
+  config.batch = true;
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "--window") && i + 1 < argc) {
+      char *end = nullptr;
+      unsigned long window = strtoul(argv[++i], &end, 10);
+      if (*end != '\0' || window == 0) {
+        std::cerr << "Couldn't parse window: " << argv[i] << std::endl;
+        PrintUsage(argv[0]);
+        exit(kArgumentError);
+      }
+      config.window = window;
+    } else if (config.batch_file.empty()) {
+      config.batch_file = argv[i];
+    } else {
+      PrintUsage(argv[0]);
+      exit(kArgumentError);
+    }
+  }
+  return config;
 }
 
 /// Parses the arguments into a structured form. If parsing fails, this
 /// function prints usage information to the screen and exits the entire
 /// program.
 Configuration ParseArguments(int argc, char **argv) {
-  if (argc < 3) {
+  if (argc > 1 && !strcmp(argv[1], "--expr")) {
+    return ParseExpressionArguments(argc, argv);
+  }
+  if (argc > 1 && !strcmp(argv[1], "--batch")) {
+    return ParseBatchArguments(argc, argv);
+  }
+  if (argc < 4) {
     PrintUsage(argv[0]);
     exit(kArgumentError);
   }
@@ -51,22 +168,78 @@ Configuration ParseArguments(int argc, char **argv) {
     PrintUsage(argv[0]);
     exit(kArgumentError);
   }
-  std::string o = argv[3];
-  if (o == "+") {
-    config.op = calculator::BinaryOp::ADDITION;
-  } else if (o == "-") {
-    config.op = calculator::BinaryOp::SUBTRACTION;
-  } else if (o == "*") {
-    config.op = calculator::BinaryOp::MULTIPLICATION;
-  } else if (o == "/") {
-    config.op = calculator::BinaryOp::DIVISION;
-  } else {
+  if (!ParseBinaryOp(argv[3], &config.op)) {
     std::cerr << "Operation not supported. Acceptable operations: +, -, *, /" << std::endl;
     PrintUsage(argv[0]);
     exit(kArgumentError);
   }
   return config;
 }
+
+/// Compiles |config.expression|, then evaluates it with the variables bound.
+void EvaluateExpression(CalculatorClient *app, const Configuration &config, async::Loop *loop) {
+  auto expression = std::make_shared<calculator::ExpressionPtr>();
+  app->calculator()->CompileExpression(
+      config.expression, expression->NewRequest(),
+      [expression, variables = config.variables, loop](calculator::CompileResult compiled) {
+        if (compiled.is_error()) {
+          std::cerr << "Error: " << compiled.error().message << std::endl;
+          loop->Quit();
+          return;
+        }
+        std::vector<double> values;
+        for (const std::string &name : compiled.expression().variables) {
+          auto it = variables.find(name);
+          if (it == variables.end()) {
+            std::cerr << "Error: no value for " << name << std::endl;
+            loop->Quit();
+            return;
+          }
+          values.push_back(it->second);
+        }
+        (*expression)->Evaluate(std::move(values), [expression, loop](calculator::Result value) {
+          if (value.is_error()) {
+            std::cerr << "Error: " << value.error().message << std::endl;
+          } else {
+            std::cout << "Result: " << value.number() << std::endl;
+          }
+          loop->Quit();
+        });
+      });
+}
+
+/// Runs every operation in |config.batch_file| over the one connection, then
+/// prints a summary of the run to stderr.
+int RunBatch(CalculatorClient *app, const Configuration &config, async::Loop *loop) {
+  std::ifstream file;
+  std::istream *input = &std::cin;
+  if (!config.batch_file.empty() && config.batch_file != "-") {
+    file.open(config.batch_file);
+    if (!file) {
+      std::cerr << "Couldn't open " << config.batch_file << std::endl;
+      return kArgumentError;
+    }
+    input = &file;
+  }
+  app->calculator().set_error_handler([loop](zx_status_t status) {
+    std::cerr << "Error: lost connection to the engine: " << zx_status_get_string(status)
+              << std::endl;
+    loop->Quit();
+  });
+  FidlBatchEngine engine(&app->calculator());
+  BatchRunner runner(&engine, input, &std::cout, config.window);
+  bool finished = false;
+  runner.Run([&finished, loop] {
+    finished = true;
+    loop->Quit();
+  });
+  loop->Run();
+  if (!finished) {
+    return 1;
+  }
+  runner.PrintSummary(&std::cerr);
+  return 0;
+}
 }  // namespace calculator_cli
 
 /// Entry point for the calculator CLI.
@@ -75,6 +248,13 @@ int main(int argc, char **argv) {
   async::Loop loop(&kAsyncLoopConfigAttachToCurrentThread);
   calculator_cli::CalculatorClient app;
   app.Start(calculator_cli::kServerUrl);
+  if (args.batch) {
+    return calculator_cli::RunBatch(&app, args, &loop);
+  }
+  if (!args.expression.empty()) {
+    calculator_cli::EvaluateExpression(&app, args, &loop);
+    return loop.Run();
+  }
   app.calculator()->DoBinaryOp(args.op, args.a, args.b, [&loop](calculator::Result value) {
     if (value.is_error()) {
       std::cerr << "Error: " << value.error().message << std::endl;
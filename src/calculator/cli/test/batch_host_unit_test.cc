@@ -0,0 +1,167 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Test cases for the batch runner that run on the development host.
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "src/calculator/cli/batch.h"
+
+namespace calculator_cli {
+namespace {
+
+// Holds each operation until the test answers it.
+class FakeEngine : public BatchEngine {
+ public:
+  struct Call {
+    Operator op;
+    double a;
+    double b;
+    Callback callback;
+  };
+
+  void DoBinaryOp(Operator op, double a, double b, Callback callback) override {
+    calls.push_back({op, a, b, std::move(callback)});
+    max_in_flight = std::max(max_in_flight, calls.size());
+  }
+
+  // Answers the outstanding call at |index| with |answer|, or with |error| if
+  // it is not empty.
+  void Reply(size_t index, double answer, std::string error = std::string()) {
+    Callback callback = std::move(calls[index].callback);
+    calls.erase(calls.begin() + index);
+    callback(answer, std::move(error));
+  }
+
+  // Answers every call, including those sent in the meantime, oldest first.
+  void ReplyToAll() {
+    while (!calls.empty()) {
+      const Call &call = calls.front();
+      double answer = 0;
+      switch (call.op) {
+        case Operator::kAdd:
+          answer = call.a + call.b;
+          break;
+        case Operator::kSubtract:
+          answer = call.a - call.b;
+          break;
+        case Operator::kMultiply:
+          answer = call.a * call.b;
+          break;
+        case Operator::kDivide:
+          answer = call.a / call.b;
+          break;
+      }
+      Reply(0, answer);
+    }
+  }
+
+  std::vector<Call> calls;
+  size_t max_in_flight = 0;
+};
+
+TEST(BatchRunnerTest, WritesResultsInInputOrder) {
+  FakeEngine engine;
+  std::istringstream input("1 2 +\n# a comment\n\n6 3 /\n");
+  std::ostringstream output;
+  BatchRunner runner(&engine, &input, &output, 4);
+  bool done = false;
+  runner.Run([&done] { done = true; });
+
+  ASSERT_EQ(2u, engine.calls.size());
+  engine.Reply(1, 2);
+  EXPECT_EQ("", output.str());
+  EXPECT_FALSE(done);
+  engine.Reply(0, 3);
+  EXPECT_EQ("3\n2\n", output.str());
+  EXPECT_TRUE(done);
+}
+
+TEST(BatchRunnerTest, KeepsTheWindowFull) {
+  FakeEngine engine;
+  std::istringstream input("1 1 +\n2 2 +\n3 3 +\n4 4 +\n5 5 +\n");
+  std::ostringstream output;
+  BatchRunner runner(&engine, &input, &output, 2);
+  bool done = false;
+  runner.Run([&done] { done = true; });
+
+  EXPECT_EQ(2u, engine.calls.size());
+  engine.Reply(0, 2);
+  // The freed place is taken by the next line at once.
+  EXPECT_EQ(2u, engine.calls.size());
+  engine.ReplyToAll();
+  EXPECT_EQ(2u, engine.max_in_flight);
+  EXPECT_EQ("2\n4\n6\n8\n10\n", output.str());
+  EXPECT_TRUE(done);
+}
+
+TEST(BatchRunnerTest, ReportsMalformedLinesWithoutSendingThem) {
+  FakeEngine engine;
+  std::istringstream input("1 +\n\nx 2 +\n1 2 %\n1 2 + 3\n2 3 *\n");
+  std::ostringstream output;
+  BatchRunner runner(&engine, &input, &output, 8);
+  bool done = false;
+  runner.Run([&done] { done = true; });
+
+  ASSERT_EQ(1u, engine.calls.size());
+  EXPECT_EQ(Operator::kMultiply, engine.calls[0].op);
+  engine.ReplyToAll();
+  EXPECT_EQ(
+      "Error: line 1: expected \"a b op\"\n"
+      "Error: line 3: couldn't parse input numbers\n"
+      "Error: line 4: operation not supported\n"
+      "Error: line 5: expected \"a b op\"\n"
+      "6\n",
+      output.str());
+  EXPECT_TRUE(done);
+}
+
+TEST(BatchRunnerTest, ReportsEngineErrors) {
+  FakeEngine engine;
+  std::istringstream input("1 0 /\n1 1 +\n");
+  std::ostringstream output;
+  BatchRunner runner(&engine, &input, &output, 2);
+  runner.Run([] {});
+
+  ASSERT_EQ(2u, engine.calls.size());
+  engine.Reply(0, 0, "division by zero");
+  engine.Reply(0, 2);
+  EXPECT_EQ("Error: division by zero\n2\n", output.str());
+}
+
+TEST(BatchRunnerTest, FinishesEmptyInputAtOnce) {
+  FakeEngine engine;
+  std::istringstream input("# nothing to do\n\n");
+  std::ostringstream output;
+  BatchRunner runner(&engine, &input, &output, 4);
+  bool done = false;
+  runner.Run([&done] { done = true; });
+
+  EXPECT_TRUE(done);
+  EXPECT_TRUE(engine.calls.empty());
+  EXPECT_EQ("", output.str());
+}
+
+TEST(BatchRunnerTest, PrintSummaryCountsOperationsAndErrors) {
+  FakeEngine engine;
+  std::istringstream input("1 2 +\nnonsense\n1 0 /\n");
+  std::ostringstream output;
+  BatchRunner runner(&engine, &input, &output, 4);
+  runner.Run([] {});
+  engine.Reply(1, 0, "division by zero");
+  engine.Reply(0, 3);
+
+  std::ostringstream summary;
+  runner.PrintSummary(&summary);
+  EXPECT_EQ(0u, summary.str().find("3 operations (2 errors) in "));
+  EXPECT_NE(std::string::npos, summary.str().find(" ops/s\n"));
+}
+
+}  // namespace
+}  // namespace calculator_cli
@@ -0,0 +1,79 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "compute_pool.h"
+
+#include <algorithm>
+
+namespace calculator_engine {
+
+ComputePool::ComputePool(size_t num_threads, size_t queue_depth) : queue_depth_(queue_depth) {
+  num_threads = std::max<size_t>(num_threads, 1);
+  threads_.reserve(num_threads);
+  for (size_t i = 0; i < num_threads; i++) {
+    threads_.emplace_back(&ComputePool::Run, this);
+  }
+}
+
+ComputePool::~ComputePool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wakeup_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+bool ComputePool::TryReserve() {
+  const size_t limit = threads_.size() + queue_depth_;
+  size_t reserved = reserved_.load(std::memory_order_relaxed);
+  do {
+    if (reserved >= limit) {
+      return false;
+    }
+  } while (!reserved_.compare_exchange_weak(reserved, reserved + 1, std::memory_order_relaxed));
+  return true;
+}
+
+void ComputePool::Post(fit::closure task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  wakeup_.notify_one();
+}
+
+size_t ComputePool::queued() const {
+  // The counters are read separately, so a task reserved in between may
+  // already be counted as running.
+  size_t reserved = reserved_.load(std::memory_order_relaxed);
+  size_t running = running_.load(std::memory_order_relaxed);
+  return reserved > running ? reserved - running : 0;
+}
+
+void ComputePool::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    wakeup_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+    if (tasks_.empty()) {
+      // Stopping, and nothing left to run.
+      return;
+    }
+    fit::closure task = std::move(tasks_.front());
+    tasks_.pop_front();
+    running_.fetch_add(1, std::memory_order_relaxed);
+    lock.unlock();
+    task();
+    task = nullptr;
+    // Release the place only once the task is gone, so a caller that sees
+    // room in the pool never finds every thread still busy.
+    running_.fetch_sub(1, std::memory_order_relaxed);
+    reserved_.fetch_sub(1, std::memory_order_relaxed);
+    lock.lock();
+  }
+}
+
+}  // namespace calculator_engine
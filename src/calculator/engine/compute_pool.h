@@ -0,0 +1,76 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// A bounded pool of threads for the engine's expensive operations, so they do
+/// not hold up the thread that dispatches FIDL messages.
+
+#ifndef EXAMPLES_CALCULATOR_ENGINE_COMPUTE_POOL_H_
+#define EXAMPLES_CALCULATOR_ENGINE_COMPUTE_POOL_H_
+
+#include <lib/fit/function.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace calculator_engine {
+
+/// A fixed set of threads sharing one queue of bounded depth.
+///
+/// Posting is two-phase. TryReserve() claims a place in the queue, failing if
+/// every thread is busy and |queue_depth| tasks are already waiting; Post()
+/// then fills the place and cannot fail. This lets the caller decide what to
+/// do with a request the pool has no room for before giving the request up.
+///
+/// This class is thread-safe.
+class ComputePool {
+ public:
+  ComputePool(size_t num_threads, size_t queue_depth);
+
+  /// Runs every task that has already been posted, then joins the threads.
+  ~ComputePool();
+
+  size_t num_threads() const { return threads_.size(); }
+  size_t queue_depth() const { return queue_depth_; }
+
+  /// Reserves room for one task. Each successful call must be followed by
+  /// exactly one Post().
+  bool TryReserve();
+
+  /// Queues |task| in a place reserved by TryReserve().
+  void Post(fit::closure task);
+
+  /// The tasks reserved or queued but not yet started. Approximate while
+  /// other threads are posting or running tasks.
+  size_t queued() const;
+
+  /// The tasks running right now.
+  size_t running() const { return running_.load(std::memory_order_relaxed); }
+
+ private:
+  ComputePool(const ComputePool&) = delete;
+  ComputePool& operator=(const ComputePool&) = delete;
+
+  void Run();
+
+  const size_t queue_depth_;
+  // Reserved places, including the running tasks; at most the number of
+  // threads plus |queue_depth_|.
+  std::atomic<size_t> reserved_{0};
+  std::atomic<size_t> running_{0};
+
+  std::mutex mutex_;
+  std::condition_variable wakeup_;
+  std::deque<fit::closure> tasks_;
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace calculator_engine
+
+#endif  // EXAMPLES_CALCULATOR_ENGINE_COMPUTE_POOL_H_
@@ -10,72 +10,258 @@
 /// See https://en.wikipedia.org/wiki/Newton%27s_method.
 ///
 /// Each of these mathematical functions has been transformed so that they have
-/// a root at the desired answer.
+/// a root at the desired answer. All of them are linear in x, so their
+/// derivative is the constant 1 and the solver can take the closed-form path.
+///
+/// The batch entry points skip the solver and apply the operations directly,
+/// a vector at a time; the closed-form solve gives the same answers.
 
 #include "engine.h"
 
+#include <float.h>
+#include <string.h>
+
+#include <cmath>
+
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 namespace calculator_engine {
+namespace {
 
-const int ITERATION_COUNT = 1000000;
+// The derivative of f(x) = x + c is 1.
+double UnitSlope(double) { return 1; }
 
-double negate(double a) {
-  double x = 0;
-  // The derivative f(x) = x + c is 1.
-  double fPrime = 1;
-  for (int i = 0; i < ITERATION_COUNT; i++) {
-    // -a = x
-    double fx = x + a;
-    x = x - fx / fPrime;
+template <typename Function>
+SolverResult SolveLinear(Function function, const SolverOptions& options) {
+  return Solve(MakeRootProblem(function, UnitSlope, /*constant_derivative=*/true), options);
+}
+
+template <BinaryOperation operation>
+double ApplyScalar(double a, double b) {
+  switch (operation) {
+    case BinaryOperation::kAdd:
+      return a + b;
+    case BinaryOperation::kSubtract:
+      return a - b;
+    case BinaryOperation::kMultiply:
+      return a * b;
+    case BinaryOperation::kDivide:
+      return a / b;
   }
-  return x;
 }
 
-double add(double augend, double addend) {
-  double x = 0;
-  // The derivative f(x) = x + c is 1.
-  double fPrime = 1;
-  for (int i = 0; i < ITERATION_COUNT; i++) {
-    // augend + addend = x
-    double fx = x - augend - addend;
-    x = x - fx / fPrime;
+template <BinaryOperation operation>
+uint8_t Classify(double a, double b, double result) {
+  if (operation == BinaryOperation::kDivide && b == 0) {
+    return kElementDivisionByZero;
+  }
+  if (std::isnan(result)) {
+    return kElementInvalid;
+  }
+  if (std::isinf(result) && std::isfinite(a) && std::isfinite(b)) {
+    return kElementOverflow;
   }
-  return x;
+  return kElementOk;
 }
 
-double subtract(double minuend, double subtrahend) {
-  double x = 0;
-  // The derivative f(x) = x + c is 1.
-  double fPrime = 1;
-  for (int i = 0; i < ITERATION_COUNT; i++) {
-    // minuend - subtrahend = x
-    double fx = x - minuend + subtrahend;
-    x = x - fx / fPrime;
+template <BinaryOperation operation>
+void BatchScalar(const double* a, const double* b, size_t count, double* results,
+                 uint8_t* status) {
+  for (size_t i = 0; i < count; i++) {
+    // Read both operands before writing, since |results| may alias them.
+    double x = a[i];
+    double y = b[i];
+    double result = ApplyScalar<operation>(x, y);
+    status[i] = Classify<operation>(x, y, result);
+    results[i] = result;
   }
-  return x;
 }
 
-double multiply(double multiplicand, double multiplier) {
-  double x = 0;
-  // The derivative f(x) = x + c is 1.
-  double fPrime = 1;
-  for (int i = 0; i < ITERATION_COUNT; i++) {
-    // multiplicand * multiplier = x
-    double fx = x - multiplicand * multiplier;
-    x = x - fx / fPrime;
+#if defined(__x86_64__) || defined(__aarch64__)
+#define CALCULATOR_ENGINE_VECTOR 1
+
+#if defined(__x86_64__)
+
+using Vector = __m128d;
+
+Vector Load(const double* p) { return _mm_loadu_pd(p); }
+void Store(double* p, Vector v) { _mm_storeu_pd(p, v); }
+
+template <BinaryOperation operation>
+Vector ApplyVector(Vector a, Vector b) {
+  switch (operation) {
+    case BinaryOperation::kAdd:
+      return _mm_add_pd(a, b);
+    case BinaryOperation::kSubtract:
+      return _mm_sub_pd(a, b);
+    case BinaryOperation::kMultiply:
+      return _mm_mul_pd(a, b);
+    case BinaryOperation::kDivide:
+      return _mm_div_pd(a, b);
   }
-  return x;
+}
+
+// Returns a bit per lane of |result| that is not finite, or whose divisor is
+// zero. Only those lanes need classifying.
+template <BinaryOperation operation>
+int SpecialLanes(Vector divisor, Vector result) {
+  const Vector abs_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffff));
+  // NaN compares false, so it is caught along with the infinities.
+  int lanes = _mm_movemask_pd(_mm_cmple_pd(_mm_and_pd(result, abs_mask), _mm_set1_pd(DBL_MAX))) ^ 3;
+  if (operation == BinaryOperation::kDivide) {
+    lanes |= _mm_movemask_pd(_mm_cmpeq_pd(divisor, _mm_setzero_pd()));
+  }
+  return lanes;
+}
+
+#else
+
+using Vector = float64x2_t;
+
+Vector Load(const double* p) { return vld1q_f64(p); }
+void Store(double* p, Vector v) { vst1q_f64(p, v); }
+
+template <BinaryOperation operation>
+Vector ApplyVector(Vector a, Vector b) {
+  switch (operation) {
+    case BinaryOperation::kAdd:
+      return vaddq_f64(a, b);
+    case BinaryOperation::kSubtract:
+      return vsubq_f64(a, b);
+    case BinaryOperation::kMultiply:
+      return vmulq_f64(a, b);
+    case BinaryOperation::kDivide:
+      return vdivq_f64(a, b);
+  }
+}
+
+template <BinaryOperation operation>
+int SpecialLanes(Vector divisor, Vector result) {
+  // NaN compares false, so it is caught along with the infinities.
+  uint64x2_t finite = vcleq_f64(vabsq_f64(result), vdupq_n_f64(DBL_MAX));
+  uint64x2_t special = vreinterpretq_u64_u32(vmvnq_u32(vreinterpretq_u32_u64(finite)));
+  if (operation == BinaryOperation::kDivide) {
+    special = vorrq_u64(special, vceqq_f64(divisor, vdupq_n_f64(0)));
+  }
+  return static_cast<int>((vgetq_lane_u64(special, 0) & 1) | (vgetq_lane_u64(special, 1) & 2));
+}
+
+#endif
+
+// Processes 8 elements per iteration so the common all-ok status can be
+// written with a single store.
+template <BinaryOperation operation>
+void BatchVector(const double* a, const double* b, size_t count, double* results,
+                 uint8_t* status) {
+  constexpr size_t kBlock = 8;
+  size_t i = 0;
+  for (; i + kBlock <= count; i += kBlock) {
+    double block[kBlock];
+    int special = 0;
+    for (size_t k = 0; k < kBlock; k += 2) {
+      Vector divisor = Load(b + i + k);
+      Vector result = ApplyVector<operation>(Load(a + i + k), divisor);
+      special |= SpecialLanes<operation>(divisor, result) << k;
+      Store(block + k, result);
+    }
+    if (special == 0) {
+      memset(status + i, kElementOk, kBlock);
+    } else {
+      for (size_t k = 0; k < kBlock; k++) {
+        status[i + k] = Classify<operation>(a[i + k], b[i + k], block[k]);
+      }
+    }
+    memcpy(results + i, block, sizeof(block));
+  }
+  BatchScalar<operation>(a + i, b + i, count - i, results + i, status + i);
+}
+
+#endif
+
+template <BinaryOperation operation>
+void Batch(const double* a, const double* b, size_t count, double* results, uint8_t* status) {
+#if defined(CALCULATOR_ENGINE_VECTOR)
+  BatchVector<operation>(a, b, count, results, status);
+#else
+  BatchScalar<operation>(a, b, count, results, status);
+#endif
+}
+
+}  // namespace
+
+SolverResult negate(double a, const SolverOptions& options) {
+  // -a = x
+  return SolveLinear([a](double x) { return x + a; }, options);
+}
+
+SolverResult add(double augend, double addend, const SolverOptions& options) {
+  // augend + addend = x
+  return SolveLinear([augend, addend](double x) { return x - augend - addend; }, options);
+}
+
+SolverResult subtract(double minuend, double subtrahend, const SolverOptions& options) {
+  // minuend - subtrahend = x
+  return SolveLinear([minuend, subtrahend](double x) { return x - minuend + subtrahend; },
+                     options);
+}
+
+SolverResult multiply(double multiplicand, double multiplier, const SolverOptions& options) {
+  // multiplicand * multiplier = x
+  return SolveLinear(
+      [multiplicand, multiplier](double x) { return x - multiplicand * multiplier; }, options);
+}
+
+SolverResult divide(double dividend, double divisor, const SolverOptions& options) {
+  // dividend / divisor = x
+  return SolveLinear([dividend, divisor](double x) { return x - dividend / divisor; }, options);
+}
+
+double negate(double a) { return negate(a, SolverOptions()).root; }
+
+double add(double augend, double addend) { return add(augend, addend, SolverOptions()).root; }
+
+double subtract(double minuend, double subtrahend) {
+  return subtract(minuend, subtrahend, SolverOptions()).root;
+}
+
+double multiply(double multiplicand, double multiplier) {
+  return multiply(multiplicand, multiplier, SolverOptions()).root;
 }
 
 double divide(double dividend, double divisor) {
-  double x = 0;
-  // The derivative f(x) = x + c is 1.
-  double fPrime = 1;
-  for (int i = 0; i < ITERATION_COUNT; i++) {
-    // dividend / divisor = x
-    double fx = x - dividend / divisor;
-    x = x - fx / fPrime;
+  return divide(dividend, divisor, SolverOptions()).root;
+}
+
+void BinaryOpBatch(BinaryOperation operation, const double* a, const double* b, size_t count,
+                   double* results, uint8_t* status) {
+  switch (operation) {
+    case BinaryOperation::kAdd:
+      return Batch<BinaryOperation::kAdd>(a, b, count, results, status);
+    case BinaryOperation::kSubtract:
+      return Batch<BinaryOperation::kSubtract>(a, b, count, results, status);
+    case BinaryOperation::kMultiply:
+      return Batch<BinaryOperation::kMultiply>(a, b, count, results, status);
+    case BinaryOperation::kDivide:
+      return Batch<BinaryOperation::kDivide>(a, b, count, results, status);
+  }
+}
+
+void BinaryOpBatchScalar(BinaryOperation operation, const double* a, const double* b,
+                         size_t count, double* results, uint8_t* status) {
+  switch (operation) {
+    case BinaryOperation::kAdd:
+      return BatchScalar<BinaryOperation::kAdd>(a, b, count, results, status);
+    case BinaryOperation::kSubtract:
+      return BatchScalar<BinaryOperation::kSubtract>(a, b, count, results, status);
+    case BinaryOperation::kMultiply:
+      return BatchScalar<BinaryOperation::kMultiply>(a, b, count, results, status);
+    case BinaryOperation::kDivide:
+      return BatchScalar<BinaryOperation::kDivide>(a, b, count, results, status);
   }
-  return x;
 }
 
 }  // namespace calculator_engine
@@ -8,24 +8,74 @@
 #ifndef EXAMPLES_CALCULATOR_ENGINE_ENGINE_H_
 #define EXAMPLES_CALCULATOR_ENGINE_ENGINE_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "solver.h"
+
 namespace calculator_engine {
 
+/// Each operation has two forms. The plain form returns the answer, solved
+/// with the default SolverOptions. The other solves as |options| asks and also
+/// reports how many iterations were used.
+
 /// Calculates the negation of the operand.
 double negate(double a);
+SolverResult negate(double a, const SolverOptions& options);
 
 /// Calculates the sum of the operands.
 double add(double augend, double addend);
+SolverResult add(double augend, double addend, const SolverOptions& options);
 
 /// Calculates the difference of the operands. This is equivalent to
 /// minuend - subtrahend.
 double subtract(double minuend, double subtrahend);
+SolverResult subtract(double minuend, double subtrahend, const SolverOptions& options);
 
 /// Calculates the product of the operands.
 double multiply(double multiplicand, double multiplier);
+SolverResult multiply(double multiplicand, double multiplier, const SolverOptions& options);
 
 /// Calculates the quotient of the operands. This is equivalent to
 /// dividend / divisor.
 double divide(double dividend, double divisor);
+SolverResult divide(double dividend, double divisor, const SolverOptions& options);
+
+/// A binary operation applied element-wise by BinaryOpBatch.
+enum class BinaryOperation {
+  kAdd,
+  kSubtract,
+  kMultiply,
+  kDivide,
+};
+
+/// Why an element of a batch did not produce an ordinary number. The values
+/// match fuchsia.examples.calculator.ElementStatus.
+enum ElementStatus : uint8_t {
+  kElementOk = 0,
+  /// The divisor was zero. The result is the IEEE quotient: an infinity, or
+  /// NaN for 0 / 0.
+  kElementDivisionByZero = 1,
+  /// The result is NaN, from a NaN operand or an operation such as
+  /// infinity - infinity.
+  kElementInvalid = 2,
+  /// Finite operands produced an infinite result.
+  kElementOverflow = 3,
+};
+
+/// Applies |operation| to each pair (a[i], b[i]) for i in [0, count), writing
+/// the answer to results[i] and its ElementStatus to status[i]. The answers
+/// match the plain scalar functions above, up to the sign of zero. |results|
+/// may be the same array as |a| or |b|, but must not otherwise overlap them.
+/// Nothing is allocated.
+///
+/// Uses SSE2 on x86-64 and NEON on arm64.
+void BinaryOpBatch(BinaryOperation operation, const double* a, const double* b, size_t count,
+                   double* results, uint8_t* status);
+
+/// The element-at-a-time reference implementation of BinaryOpBatch.
+void BinaryOpBatchScalar(BinaryOperation operation, const double* a, const double* b,
+                         size_t count, double* results, uint8_t* status);
 
 }  // namespace calculator_engine
 
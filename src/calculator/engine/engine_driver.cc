@@ -6,22 +6,372 @@
 
 #include "engine_driver.h"
 
+#include <lib/async/cpp/task.h>
+#include <lib/async/default.h>
+#include <lib/fit/promise.h>
 #include <lib/sys/cpp/component_context.h>
+#include <lib/zx/vmar.h>
+#include <zircon/limits.h>
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+#include "ordered_replies.h"
 
 namespace calculator_engine {
 
 namespace calculator = ::fuchsia::examples::calculator;
 
-Engine::Engine() : Engine(sys::ComponentContext::CreateAndServeOutgoingDirectory()) {}
+namespace {
+
+// The number of compiled expressions remembered by their text.
+constexpr size_t kExpressionCacheCapacity = 256;
+
+SolverOptions ToSolverOptions(const calculator::SolverOptions& options) {
+  SolverOptions result;
+  switch (options.mode) {
+    case calculator::SolverMode::FIXED_ITERATIONS:
+      result.mode = SolverMode::kFixedIterations;
+      break;
+    case calculator::SolverMode::NEWTON:
+      result.mode = SolverMode::kNewton;
+      break;
+    case calculator::SolverMode::SECANT:
+      result.mode = SolverMode::kSecant;
+      break;
+    case calculator::SolverMode::CLOSED_FORM:
+    default:
+      result.mode = SolverMode::kClosedForm;
+      break;
+  }
+  // Negative and NaN tolerances both fail the comparison.
+  result.tolerance = options.tolerance > 0 ? options.tolerance : 0;
+  if (options.max_iterations != 0) {
+    result.max_iterations =
+        static_cast<int>(std::min<uint32_t>(options.max_iterations, ITERATION_COUNT));
+  }
+  return result;
+}
+
+bool ToBinaryOperation(calculator::BinaryOp op, BinaryOperation* operation) {
+  switch (op) {
+    case calculator::BinaryOp::ADDITION:
+      *operation = BinaryOperation::kAdd;
+      return true;
+    case calculator::BinaryOp::SUBTRACTION:
+      *operation = BinaryOperation::kSubtract;
+      return true;
+    case calculator::BinaryOp::MULTIPLICATION:
+      *operation = BinaryOperation::kMultiply;
+      return true;
+    case calculator::BinaryOp::DIVISION:
+      *operation = BinaryOperation::kDivide;
+      return true;
+    default:
+      return false;
+  }
+}
+
+static_assert(static_cast<uint8_t>(calculator::ElementStatus::OK) == kElementOk &&
+                  static_cast<uint8_t>(calculator::ElementStatus::DIVISION_BY_ZERO) ==
+                      kElementDivisionByZero &&
+                  static_cast<uint8_t>(calculator::ElementStatus::INVALID) == kElementInvalid &&
+                  static_cast<uint8_t>(calculator::ElementStatus::OVERFLOW) == kElementOverflow,
+              "element status values");
+
+// The bytes DoBinaryOpBuffer needs per element: a, b and the status.
+constexpr uint64_t kBufferBytesPerElement = 2 * sizeof(double) + sizeof(uint8_t);
+
+// Maps the arrays DoBinaryOpBuffer describes and applies |operation| to them in
+// place.
+zx_status_t BinaryOpInVmo(BinaryOperation operation, uint64_t count, const zx::vmo& vmo,
+                          uint64_t size) {
+  if (count > size / kBufferBytesPerElement) {
+    return ZX_ERR_OUT_OF_RANGE;
+  }
+  if (count == 0) {
+    return ZX_OK;
+  }
+  uint64_t needed = count * kBufferBytesPerElement;
+  uint64_t vmo_size = 0;
+  zx_status_t status = vmo.get_size(&vmo_size);
+  if (status != ZX_OK) {
+    return status;
+  }
+  if (needed > vmo_size) {
+    return ZX_ERR_OUT_OF_RANGE;
+  }
+
+  size_t mapped_size = (needed + ZX_PAGE_MASK) & ~static_cast<uint64_t>(ZX_PAGE_MASK);
+  zx_vaddr_t start = 0;
+  status = zx::vmar::root_self()->map(ZX_VM_PERM_READ | ZX_VM_PERM_WRITE, 0, vmo, 0, mapped_size,
+                                      &start);
+  if (status != ZX_OK) {
+    return status;
+  }
+  // The start is page aligned, so the doubles are aligned too.
+  double* a = reinterpret_cast<double*>(start);
+  double* b = a + count;
+  uint8_t* element_status = reinterpret_cast<uint8_t*>(b + count);
+  BinaryOpBatch(operation, a, b, count, a, element_status);
+  zx::vmar::root_self()->unmap(start, mapped_size);
+  return ZX_OK;
+}
+
+calculator::Result ErrorResult(std::string message) {
+  calculator::Error error;
+  error.message = std::move(message);
+  return calculator::Result::WithError(std::move(error));
+}
+
+calculator::Result InvalidOperation() { return ErrorResult("invalid operation"); }
+
+calculator::Result BusyResult() { return ErrorResult("engine is busy"); }
+
+// The cost of a solve, in iterations, for Engine::Admit().
+uint64_t SolverCost(const SolverOptions& options) {
+  switch (options.mode) {
+    case SolverMode::kFixedIterations:
+      return ITERATION_COUNT;
+    case SolverMode::kClosedForm:
+      // Every operation is linear.
+      return 1;
+    default:
+      return static_cast<uint64_t>(options.max_iterations);
+  }
+}
+
+bool IsError(const calculator::Result& result) { return result.is_error(); }
+
+bool IsError(const calculator::CompileResult& result) { return result.is_error(); }
+
+// The results of methods declared with "error".
+template <typename Result>
+auto IsError(const Result& result) -> decltype(result.is_err()) {
+  return result.is_err();
+}
 
-Engine::Engine(std::unique_ptr<sys::ComponentContext> context) : context_(std::move(context)) {
-  context_->outgoing()->AddPublicService(bindings_.GetHandler(this));
+// DoBinaryOpWithOptions replies with a result and a report.
+template <typename Result, typename Report>
+bool IsError(const Result& result, const Report&) {
+  return IsError(result);
+}
+
+template <typename Callback, typename Args, size_t... I>
+void InvokeWithTuple(Callback& callback, Args& args, std::index_sequence<I...>) {
+  callback(std::move(std::get<I>(args))...);
+}
+
+// Binds |args| to |callback|, to send a reply later.
+template <typename Callback, typename... Args>
+fit::closure BindReply(Callback callback, Args... args) {
+  return [callback = std::move(callback), args = std::make_tuple(std::move(args)...)]() mutable {
+    InvokeWithTuple(callback, args, std::index_sequence_for<Args...>());
+  };
+}
+
+/// Serves one compiled expression. Programs are immutable and may be shared
+/// with the cache and other connections.
+class ExpressionImpl : public calculator::Expression {
+ public:
+  ExpressionImpl(std::shared_ptr<const Program> program, std::shared_ptr<EngineMetrics> metrics)
+      : program_(std::move(program)), metrics_(std::move(metrics)) {}
+
+  void Evaluate(std::vector<double> values, EvaluateCallback callback) override {
+    zx::ticks start = metrics_->Begin();
+    if (values.size() != program_->variables().size()) {
+      callback(ErrorResult("expected " + std::to_string(program_->variables().size()) +
+                           " values"));
+      metrics_->End(EngineMetrics::kEvaluate, start, true);
+      return;
+    }
+    callback(calculator::Result::WithNumber(program_->Evaluate(values.data(), values.size())));
+    metrics_->End(EngineMetrics::kEvaluate, start, false);
+  }
+
+ private:
+  std::shared_ptr<const Program> program_;
+  const std::shared_ptr<EngineMetrics> metrics_;
+};
+
+}  // namespace
+
+/// One client's connection. Forwards each request to the Engine, and sends the
+/// replies in request order even when the requests that ran on the workers
+/// finish out of order.
+class Engine::Connection : public calculator::Calculator {
+ public:
+  explicit Connection(Engine* engine)
+      : engine_(engine), replies_(std::make_shared<OrderedReplies>()) {}
+
+  void DoUnaryOp(calculator::UnaryOp op, double a, DoUnaryOpCallback callback) override {
+    engine_->DoUnaryOp(op, a, Track(EngineMetrics::kDoUnaryOp, std::move(callback)));
+  }
+
+  void DoBinaryOp(calculator::BinaryOp op, double a, double b,
+                  DoBinaryOpCallback callback) override {
+    engine_->DoBinaryOp(op, a, b, Track(EngineMetrics::kDoBinaryOp, std::move(callback)));
+  }
+
+  void DoBinaryOpWithOptions(calculator::BinaryOp op, double a, double b,
+                             calculator::SolverOptions options,
+                             DoBinaryOpWithOptionsCallback callback) override {
+    engine_->DoBinaryOpWithOptions(
+        op, a, b, options, Track(EngineMetrics::kDoBinaryOpWithOptions, std::move(callback)));
+  }
+
+  void DoBinaryOpBatch(calculator::BinaryOp op, std::vector<double> a, std::vector<double> b,
+                       DoBinaryOpBatchCallback callback) override {
+    engine_->DoBinaryOpBatch(op, std::move(a), std::move(b),
+                             Track(EngineMetrics::kDoBinaryOpBatch, std::move(callback)));
+  }
+
+  void DoBinaryOpBuffer(calculator::BinaryOp op, uint64_t count, fuchsia::mem::Buffer buffer,
+                        DoBinaryOpBufferCallback callback) override {
+    engine_->DoBinaryOpBuffer(op, count, std::move(buffer),
+                              Track(EngineMetrics::kDoBinaryOpBuffer, std::move(callback)));
+  }
+
+  void CompileExpression(std::string text,
+                         fidl::InterfaceRequest<calculator::Expression> expression,
+                         CompileExpressionCallback callback) override {
+    engine_->CompileExpression(std::move(text), std::move(expression),
+                               Track(EngineMetrics::kCompileExpression, std::move(callback)));
+  }
+
+ private:
+  // Wraps |callback| so its reply waits for the replies to earlier requests.
+  // The common case, where nothing earlier is outstanding, replies directly.
+  template <typename Callback>
+  Callback Sequence(Callback callback) {
+    uint64_t ticket = replies_->Reserve();
+    // |replies_| is shared since replies may complete after the connection
+    // closes.
+    return [replies = replies_, ticket, callback = std::move(callback)](auto... args) mutable {
+      if (replies->is_next(ticket)) {
+        callback(std::move(args)...);
+        replies->Complete(ticket, nullptr);
+      } else {
+        replies->Complete(ticket, BindReply(std::move(callback), std::move(args)...));
+      }
+    };
+  }
+
+  // Measures the request, and sequences its reply.
+  template <typename Callback>
+  Callback Track(EngineMetrics::Method method, Callback callback) {
+    return Sequence(Measure(method, std::move(callback)));
+  }
+
+  // Wraps |callback| to record the request in the engine's metrics when the
+  // reply is sent. The reply holds a reference to the metrics, since it may be
+  // sent after the engine is destroyed.
+  template <typename Callback>
+  Callback Measure(EngineMetrics::Method method, Callback callback) {
+    std::shared_ptr<EngineMetrics> metrics = engine_->metrics_;
+    zx::ticks start = metrics->Begin();
+    return [metrics, method, start, callback = std::move(callback)](auto... args) mutable {
+      bool error = IsError(args...);
+      callback(std::move(args)...);
+      metrics->End(method, start, error);
+    };
+  }
+
+  Engine* const engine_;
+  std::shared_ptr<OrderedReplies> replies_;
+};
+
+Engine::Engine() : Engine(Options()) {}
+
+Engine::Engine(Options options)
+    : Engine(sys::ComponentContext::CreateAndServeOutgoingDirectory(), options) {}
+
+Engine::Engine(std::unique_ptr<sys::ComponentContext> context)
+    : Engine(std::move(context), Options()) {}
+
+Engine::Engine(std::unique_ptr<sys::ComponentContext> context, Options options)
+    : context_(std::move(context)),
+      options_(options),
+      dispatcher_(async_get_default_dispatcher()),
+      inspector_(context_.get()),
+      metrics_(std::make_shared<EngineMetrics>(&inspector_.root())),
+      expression_cache_(kExpressionCacheCapacity) {
+  if (options_.worker_threads > 0) {
+    pool_ = std::make_unique<ComputePool>(options_.worker_threads, options_.queue_depth);
+  }
+  if (options_.result_cache_entries > 0) {
+    result_cache_ = std::make_unique<ResultCache>(options_.result_cache_entries);
+    // Read only when the hierarchy is, so lookups update nothing but the
+    // cache's own counters.
+    result_cache_node_ = inspector_.root().CreateLazyNode("result_cache", [this] {
+      ResultCache::Stats stats = result_cache_->stats();
+      inspect::Inspector inspector;
+      inspect::Node& root = inspector.GetRoot();
+      root.CreateUint("hits", stats.hits, &inspector);
+      root.CreateUint("misses", stats.misses, &inspector);
+      root.CreateUint("evictions", stats.evictions, &inspector);
+      root.CreateUint("size", stats.size, &inspector);
+      root.CreateUint("capacity", result_cache_->capacity(), &inspector);
+      return fit::make_ok_promise(std::move(inspector));
+    });
+  }
+  connections_.set_read_budget(options_.read_budget);
+  expressions_.set_read_budget(options_.read_budget);
+  reads_node_ = inspector_.root().CreateLazyNode("reads", [this] {
+    fidl::ReadStats calculators = connections_.read_stats();
+    fidl::ReadStats expressions = expressions_.read_stats();
+    inspect::Inspector inspector;
+    inspect::Node& root = inspector.GetRoot();
+    root.CreateUint("wakeups", calculators.wakeups + expressions.wakeups, &inspector);
+    root.CreateUint("messages", calculators.messages + expressions.messages, &inspector);
+    root.CreateUint("budget_exhausted",
+                    calculators.budget_exhausted + expressions.budget_exhausted, &inspector);
+    root.CreateUint(
+        "max_messages_per_wakeup",
+        std::max(calculators.max_messages_per_wakeup, expressions.max_messages_per_wakeup),
+        &inspector);
+    return fit::make_ok_promise(std::move(inspector));
+  });
+  context_->outgoing()->AddPublicService<calculator::Calculator>(
+      [this](fidl::InterfaceRequest<calculator::Calculator> request) {
+        connections_.AddBinding(std::make_unique<Connection>(this), std::move(request));
+      });
+}
+
+Engine::Placement Engine::Admit(uint64_t cost) {
+  if (!pool_ || cost < options_.offload_threshold) {
+    return Placement::kInline;
+  }
+  if (pool_->TryReserve()) {
+    metrics_->SetQueued(pool_->queued());
+    return Placement::kWorker;
+  }
+  if (options_.saturation == Options::Saturation::kRunInline) {
+    return Placement::kInline;
+  }
+  metrics_->Rejected();
+  return Placement::kRejected;
+}
+
+void Engine::RunCompute(Placement placement, fit::function<fit::closure()> compute) {
+  if (placement != Placement::kWorker) {
+    compute()();
+    return;
+  }
+  // Destroying the engine destroys the pool, which runs the tasks already
+  // posted, so they must not use the engine itself.
+  pool_->Post([pool = pool_.get(), metrics = metrics_, dispatcher = dispatcher_,
+               compute = std::move(compute)]() {
+    metrics->SetQueued(pool->queued());
+    async::PostTask(dispatcher, compute());
+  });
 }
 
 void Engine::DoUnaryOp(calculator::UnaryOp op, double a, DoUnaryOpCallback callback) {
   switch (op) {
     case calculator::UnaryOp::NEGATION:
-      callback(calculator::Result::WithNumber(a - a - a));
+      callback(calculator::Result::WithNumber(negate(a)));
       break;
     default:
       calculator::Error error;
@@ -53,4 +403,128 @@ void Engine::DoBinaryOp(calculator::BinaryOp op, double a, double b, DoBinaryOpC
   }
 }
 
+void Engine::DoBinaryOpWithOptions(calculator::BinaryOp op, double a, double b,
+                                   calculator::SolverOptions options,
+                                   DoBinaryOpWithOptionsCallback callback) {
+  BinaryOperation operation;
+  if (!ToBinaryOperation(op, &operation)) {
+    callback(InvalidOperation(), calculator::SolverReport{});
+    return;
+  }
+  SolverOptions solver_options = ToSolverOptions(options);
+  // Closed-form solves cost less than a lookup.
+  ResultCache* cache =
+      solver_options.mode == SolverMode::kClosedForm ? nullptr : result_cache_.get();
+  SolverResult cached;
+  if (cache && cache->Lookup(operation, a, b, solver_options, &cached)) {
+    calculator::SolverReport report;
+    report.iterations = static_cast<uint32_t>(cached.iterations);
+    report.converged = cached.converged;
+    callback(calculator::Result::WithNumber(cached.root), report);
+    return;
+  }
+  Placement placement = Admit(SolverCost(solver_options));
+  if (placement == Placement::kRejected) {
+    callback(BusyResult(), calculator::SolverReport{});
+    return;
+  }
+  RunCompute(placement, [operation, a, b, solver_options, cache,
+                         callback = std::move(callback)]() mutable -> fit::closure {
+    SolverResult result;
+    switch (operation) {
+      case BinaryOperation::kAdd:
+        result = add(a, b, solver_options);
+        break;
+      case BinaryOperation::kSubtract:
+        result = subtract(a, b, solver_options);
+        break;
+      case BinaryOperation::kMultiply:
+        result = multiply(a, b, solver_options);
+        break;
+      case BinaryOperation::kDivide:
+        result = divide(a, b, solver_options);
+        break;
+    }
+    if (cache) {
+      cache->Insert(operation, a, b, solver_options, result);
+    }
+    calculator::SolverReport report;
+    report.iterations = static_cast<uint32_t>(result.iterations);
+    report.converged = result.converged;
+    return [callback = std::move(callback), root = result.root, report]() {
+      callback(calculator::Result::WithNumber(root), report);
+    };
+  });
+}
+
+void Engine::DoBinaryOpBatch(calculator::BinaryOp op, std::vector<double> a,
+                             std::vector<double> b, DoBinaryOpBatchCallback callback) {
+  BinaryOperation operation;
+  if (!ToBinaryOperation(op, &operation) || a.size() != b.size()) {
+    callback(fit::error(ZX_ERR_INVALID_ARGS));
+    return;
+  }
+  Placement placement = Admit(a.size());
+  if (placement == Placement::kRejected) {
+    callback(fit::error(ZX_ERR_SHOULD_WAIT));
+    return;
+  }
+  RunCompute(placement, [operation, a = std::move(a), b = std::move(b),
+                         callback = std::move(callback)]() mutable -> fit::closure {
+    // The results reuse the storage of |a|, so the batch allocates only the
+    // status vector.
+    std::vector<calculator::ElementStatus> status(a.size());
+    BinaryOpBatch(operation, a.data(), b.data(), a.size(), a.data(),
+                  reinterpret_cast<uint8_t*>(status.data()));
+    return [callback = std::move(callback), results = std::move(a),
+            status = std::move(status)]() mutable {
+      callback(fit::ok(std::make_tuple(std::move(results), std::move(status))));
+    };
+  });
+}
+
+void Engine::DoBinaryOpBuffer(calculator::BinaryOp op, uint64_t count,
+                              fuchsia::mem::Buffer buffer, DoBinaryOpBufferCallback callback) {
+  BinaryOperation operation;
+  if (!ToBinaryOperation(op, &operation)) {
+    callback(fit::error(ZX_ERR_INVALID_ARGS));
+    return;
+  }
+  Placement placement = Admit(count);
+  if (placement == Placement::kRejected) {
+    callback(fit::error(ZX_ERR_SHOULD_WAIT));
+    return;
+  }
+  RunCompute(placement, [operation, count, buffer = std::move(buffer),
+                         callback = std::move(callback)]() mutable -> fit::closure {
+    zx_status_t status = BinaryOpInVmo(operation, count, buffer.vmo, buffer.size);
+    return [status, buffer = std::move(buffer), callback = std::move(callback)]() mutable {
+      if (status != ZX_OK) {
+        callback(fit::error(status));
+        return;
+      }
+      callback(fit::ok(std::move(buffer)));
+    };
+  });
+}
+
+void Engine::CompileExpression(std::string text,
+                               fidl::InterfaceRequest<calculator::Expression> expression,
+                               CompileExpressionCallback callback) {
+  std::string error_message;
+  std::shared_ptr<const Program> program = expression_cache_.Compile(text, &error_message);
+  if (!program) {
+    // Dropping |expression| closes the channel.
+    calculator::Error error;
+    error.message = std::move(error_message);
+    callback(calculator::CompileResult::WithError(std::move(error)));
+    return;
+  }
+  calculator::CompiledExpression compiled;
+  compiled.variables = program->variables();
+  expressions_.AddBinding(std::make_unique<ExpressionImpl>(std::move(program), metrics_),
+                          std::move(expression));
+  callback(calculator::CompileResult::WithExpression(std::move(compiled)));
+}
+
 }  // namespace calculator_engine
@@ -9,10 +9,16 @@
 #define EXAMPLES_CALCULATOR_ENGINE_ENGINE_DRIVER_H_
 
 #include <fuchsia/examples/calculator/cpp/fidl.h>
+#include <lib/async/dispatcher.h>
 #include <lib/fidl/cpp/binding_set.h>
 #include <lib/sys/cpp/component_context.h>
+#include <lib/sys/inspect/cpp/component.h>
 
+#include "compute_pool.h"
 #include "engine.h"
+#include "engine_metrics.h"
+#include "expression.h"
+#include "result_cache.h"
 
 namespace calculator_engine {
 
@@ -23,20 +29,99 @@ namespace calculator = fuchsia::examples::calculator;
 /// in engine.h. By keeping the service separate, it's possible to test the
 /// Engine through its FIDL interface with an automated test that runs on a
 /// Fuchsia device.
+///
+/// Cheap operations run on the thread that dispatches FIDL messages. With
+/// worker threads configured, operations whose estimated cost reaches
+/// Options::offload_threshold run on a bounded ComputePool instead, and reply
+/// from the dispatch thread once done. Each connection still receives its
+/// replies in request order.
+///
+/// The engine publishes per-method counters and latency histograms, and its
+/// load, through Inspect; see EngineMetrics. It also publishes how many
+/// requests each wakeup of a connection read, under "reads".
 class Engine : public calculator::Calculator {
  public:
+  struct Options {
+    /// Threads running expensive operations. Zero runs every operation on the
+    /// dispatch thread.
+    size_t worker_threads = 0;
+    /// Operations that may wait for a worker before the pool is saturated.
+    size_t queue_depth = 64;
+    /// What happens to an expensive operation while the pool is saturated.
+    enum class Saturation {
+      /// Fail it at once with a "busy" error.
+      kReject,
+      /// Run it on the dispatch thread, which stops the engine reading more
+      /// requests until it is done.
+      kRunInline,
+    };
+    Saturation saturation = Saturation::kReject;
+    /// The smallest estimated cost, in elements or solver iterations, that is
+    /// handed to the workers.
+    uint64_t offload_threshold = 4096;
+    /// The solver results remembered, so repeated DoBinaryOpWithOptions calls
+    /// are answered without solving again. Zero disables the cache.
+    size_t result_cache_entries = 0;
+    /// How much is read from one connection each time it becomes readable
+    /// before the others get a turn.
+    fidl::ReadBudget read_budget;
+  };
+
   explicit Engine();
+  explicit Engine(Options options);
   virtual void DoUnaryOp(calculator::UnaryOp op, double a, DoUnaryOpCallback callback);
   virtual void DoBinaryOp(calculator::BinaryOp op, double a, double b, DoBinaryOpCallback callback);
+  virtual void DoBinaryOpWithOptions(calculator::BinaryOp op, double a, double b,
+                                     calculator::SolverOptions options,
+                                     DoBinaryOpWithOptionsCallback callback);
+  virtual void DoBinaryOpBatch(calculator::BinaryOp op, std::vector<double> a,
+                               std::vector<double> b, DoBinaryOpBatchCallback callback);
+  virtual void DoBinaryOpBuffer(calculator::BinaryOp op, uint64_t count,
+                                fuchsia::mem::Buffer buffer, DoBinaryOpBufferCallback callback);
+  virtual void CompileExpression(std::string text,
+                                 fidl::InterfaceRequest<calculator::Expression> expression,
+                                 CompileExpressionCallback callback);
 
  protected:
   Engine(std::unique_ptr<sys::ComponentContext> context);
+  Engine(std::unique_ptr<sys::ComponentContext> context, Options options);
+
+  inspect::Inspector* inspector() { return inspector_.inspector(); }
 
  private:
   Engine(const Engine&) = delete;
   Engine& operator=(const Engine&) = delete;
+
+  class Connection;
+
+  /// Where an operation runs.
+  enum class Placement { kInline, kWorker, kRejected };
+
+  /// Decides where an operation of the given cost runs. A kWorker result has
+  /// reserved a place in the pool, which RunCompute() must then use.
+  Placement Admit(uint64_t cost);
+
+  /// Runs |compute| as |placement| says, then the reply it returns on the
+  /// dispatch thread.
+  void RunCompute(Placement placement, fit::function<fit::closure()> compute);
+
   std::unique_ptr<sys::ComponentContext> context_;
-  fidl::BindingSet<calculator::Calculator> bindings_;
+  const Options options_;
+  async_dispatcher_t* const dispatcher_;
+  sys::ComponentInspector inspector_;
+  // Shared with the replies still to be sent, which may outlive the engine:
+  // the workers post their results to the dispatcher, where they can run after
+  // the engine is destroyed.
+  std::shared_ptr<EngineMetrics> metrics_;
+  // Null when disabled.
+  std::unique_ptr<ResultCache> result_cache_;
+  inspect::LazyNode result_cache_node_;
+  inspect::LazyNode reads_node_;
+  fidl::BindingSet<calculator::Calculator, std::unique_ptr<calculator::Calculator>> connections_;
+  ProgramCache expression_cache_;
+  fidl::BindingSet<calculator::Expression, std::unique_ptr<calculator::Expression>> expressions_;
+  // Last, so the workers are joined before anything they use is destroyed.
+  std::unique_ptr<ComputePool> pool_;
 };
 
 }  // namespace calculator_engine
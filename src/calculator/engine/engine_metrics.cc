@@ -0,0 +1,99 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "engine_metrics.h"
+
+namespace calculator_engine {
+
+constexpr uint64_t EngineMetrics::kLatencyStepNs;
+constexpr size_t EngineMetrics::kLatencyBuckets;
+
+EngineMetrics::EngineMetrics(inspect::Node* parent)
+    : ns_per_tick_(1e9 / static_cast<double>(zx::ticks::per_second().get())),
+      in_flight_(parent->CreateShardedUint("in_flight")),
+      queued_(parent->CreateUint("queued", 0)),
+      rejected_(parent->CreateUint("rejected", 0)) {
+  for (int i = 0; i < kMethodCount; i++) {
+    MethodMetrics& metrics = methods_[i];
+    metrics.node = parent->CreateChild(MethodName(static_cast<Method>(i)));
+    metrics.requests = metrics.node.CreateShardedUint("requests");
+    metrics.errors = metrics.node.CreateShardedUint("errors");
+    metrics.latency_counts = std::make_shared<LatencyCounts>();
+    metrics.latency_ns = CreateLatencyHistogram(&metrics.node, metrics.latency_counts);
+  }
+}
+
+void EngineMetrics::LatencyCounts::Insert(uint64_t latency_ns) {
+  // The bucket of the exponential histogram: the first ends at
+  // kLatencyStepNs, and each following one ends at twice the previous end.
+  size_t bucket = 0;
+  for (uint64_t end = kLatencyStepNs; latency_ns >= end && bucket < kLatencyBuckets; end *= 2) {
+    bucket++;
+  }
+  shards[inspect::internal::ThisThreadShard()].buckets[bucket].fetch_add(
+      1, std::memory_order_relaxed);
+}
+
+inspect::LazyNode EngineMetrics::CreateLatencyHistogram(inspect::Node* node,
+                                                        std::shared_ptr<LatencyCounts> counts) {
+  return node->CreateLazyValues("latency_ns", [counts = std::move(counts)] {
+    inspect::Inspector inspector(inspect::InspectSettings{.maximum_size = 4096});
+    inspect::ExponentialUintHistogram histogram =
+        inspector.GetRoot().CreateExponentialUintHistogram("latency_ns", 0, kLatencyStepNs, 2,
+                                                           kLatencyBuckets);
+    for (size_t bucket = 0; bucket <= kLatencyBuckets; bucket++) {
+      uint64_t count = 0;
+      for (const LatencyCounts::Shard& shard : counts->shards) {
+        count += shard.buckets[bucket].load(std::memory_order_relaxed);
+      }
+      if (count > 0) {
+        // Insert the lower bound of the bucket, which the histogram files in
+        // the same bucket.
+        histogram.Insert(bucket == 0 ? 0 : kLatencyStepNs << (bucket - 1), count);
+      }
+    }
+    inspector.emplace(std::move(histogram));
+    return fit::make_ok_promise(std::move(inspector));
+  });
+}
+
+const char* EngineMetrics::MethodName(Method method) {
+  switch (method) {
+    case kDoUnaryOp:
+      return "DoUnaryOp";
+    case kDoBinaryOp:
+      return "DoBinaryOp";
+    case kDoBinaryOpWithOptions:
+      return "DoBinaryOpWithOptions";
+    case kDoBinaryOpBatch:
+      return "DoBinaryOpBatch";
+    case kDoBinaryOpBuffer:
+      return "DoBinaryOpBuffer";
+    case kCompileExpression:
+      return "CompileExpression";
+    case kEvaluate:
+      return "Evaluate";
+    default:
+      return "unknown";
+  }
+}
+
+zx::ticks EngineMetrics::Begin() {
+  in_flight_.Add(1);
+  return zx::ticks::now();
+}
+
+void EngineMetrics::End(Method method, zx::ticks start, bool error) {
+  uint64_t elapsed_ns = static_cast<uint64_t>(
+      static_cast<double>((zx::ticks::now() - start).get()) * ns_per_tick_);
+  in_flight_.Subtract(1);
+  MethodMetrics& metrics = methods_[method];
+  metrics.requests.Add(1);
+  if (error) {
+    metrics.errors.Add(1);
+  }
+  metrics.latency_counts->Insert(elapsed_ns);
+}
+
+}  // namespace calculator_engine
@@ -0,0 +1,118 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Counters and latency histograms for the engine, published through Inspect.
+
+#ifndef EXAMPLES_CALCULATOR_ENGINE_ENGINE_METRICS_H_
+#define EXAMPLES_CALCULATOR_ENGINE_ENGINE_METRICS_H_
+
+#include <lib/inspect/cpp/inspect.h>
+#include <lib/zx/time.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace calculator_engine {
+
+/// Per-operation request and error counts and latency histograms, and the
+/// engine's load. Every property is created up front. The values written for
+/// every request, the in-flight, request and error counts and the latencies,
+/// are kept in per-thread cells rather than in the Inspect VMO, so recording a
+/// request takes no lock; they are summed when the hierarchy is read, through
+/// lazy nodes. Readers must open lazy nodes, as inspect::ReadFromInspector
+/// does, to see them.
+///
+/// The hierarchy, under the node given to the constructor:
+///
+///   in_flight  requests received but not yet answered
+///   queued     expensive operations waiting for a worker
+///   rejected   operations failed because the workers were saturated
+///   <method>/
+///     requests    requests answered
+///     errors      requests answered with an error
+///     latency_ns  exponential histogram of the time from receiving each
+///                 request to sending its reply
+///
+/// This class is thread-safe.
+class EngineMetrics {
+ public:
+  /// The measured methods, each with its own child node.
+  enum Method {
+    kDoUnaryOp,
+    kDoBinaryOp,
+    kDoBinaryOpWithOptions,
+    kDoBinaryOpBatch,
+    kDoBinaryOpBuffer,
+    kCompileExpression,
+    kEvaluate,
+    kMethodCount,
+  };
+
+  /// The latency buckets: the first holds latencies under kLatencyStepNs, and
+  /// each following bucket is twice as wide, up to about eight seconds.
+  static constexpr uint64_t kLatencyStepNs = 1000;
+  static constexpr size_t kLatencyBuckets = 24;
+
+  explicit EngineMetrics(inspect::Node* parent);
+
+  /// The name of the node for |method|.
+  static const char* MethodName(Method method);
+
+  /// Records the start of a request, returning the time to pass to End().
+  zx::ticks Begin();
+
+  /// Records the reply to a request of |method| that started at |start|.
+  void End(Method method, zx::ticks start, bool error);
+
+  /// Records an operation failed because the workers were saturated. Rare, so
+  /// written to the VMO directly.
+  void Rejected() { rejected_.Add(1); }
+
+  /// Sets the number of operations waiting for a worker.
+  void SetQueued(uint64_t queued) { queued_.Set(queued); }
+
+ private:
+  EngineMetrics(const EngineMetrics&) = delete;
+  EngineMetrics& operator=(const EngineMetrics&) = delete;
+
+  // The latency counts of one method, per bucket of the histogram and one
+  // for the overflow. Each thread counts in the shard Inspect's sharded
+  // properties would give it, and the shards are summed when read.
+  struct LatencyCounts {
+    struct Shard {
+      std::atomic<uint64_t> buckets[kLatencyBuckets + 1];
+      // Rounds the shard up to whole 64-byte cache lines.
+      char padding[64 - sizeof(buckets) % 64];
+    };
+
+    void Insert(uint64_t latency_ns);
+
+    Shard shards[inspect::internal::kShardCount] = {};
+  };
+
+  struct MethodMetrics {
+    inspect::Node node;
+    inspect::ShardedUintProperty requests;
+    inspect::ShardedUintProperty errors;
+    // Shared with the callback of |latency_ns|, which publishes it.
+    std::shared_ptr<LatencyCounts> latency_counts;
+    inspect::LazyNode latency_ns;
+  };
+
+  // Creates the lazy node publishing |counts| as an exponential histogram.
+  static inspect::LazyNode CreateLatencyHistogram(inspect::Node* node,
+                                                  std::shared_ptr<LatencyCounts> counts);
+
+  // Converts ticks to nanoseconds with one multiplication.
+  const double ns_per_tick_;
+  inspect::ShardedUintProperty in_flight_;
+  inspect::UintProperty queued_;
+  inspect::UintProperty rejected_;
+  MethodMetrics methods_[kMethodCount];
+};
+
+}  // namespace calculator_engine
+
+#endif  // EXAMPLES_CALCULATOR_ENGINE_ENGINE_METRICS_H_
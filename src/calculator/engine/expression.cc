@@ -0,0 +1,351 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// A recursive descent compiler for arithmetic expressions, and the stack
+/// machine that runs what it produces.
+
+#include "expression.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+
+#include <limits>
+
+namespace calculator_engine {
+namespace {
+
+// Bounds the recursion of the parser, which would otherwise be at the mercy of
+// inputs like "((((...".
+constexpr size_t kMaxNesting = 256;
+
+bool IsIdentifierStart(char c) { return isalpha(static_cast<unsigned char>(c)) || c == '_'; }
+
+bool IsIdentifierChar(char c) { return isalnum(static_cast<unsigned char>(c)) || c == '_'; }
+
+double Apply(Program::Opcode opcode, double a, double b) {
+  switch (opcode) {
+    case Program::Opcode::kAdd:
+      return a + b;
+    case Program::Opcode::kSubtract:
+      return a - b;
+    case Program::Opcode::kMultiply:
+      return a * b;
+    case Program::Opcode::kDivide:
+    default:
+      return a / b;
+  }
+}
+
+}  // namespace
+
+/// Parses the text and emits code as it goes. Folding happens at emission: an
+/// operator whose operands were just emitted as constants replaces them with
+/// its value.
+class Compiler {
+ public:
+  Compiler(const std::string& text, Program* program) : text_(text), program_(program) {}
+
+  bool Run(std::string* error) {
+    if (text_.size() > kMaxExpressionLength) {
+      Fail("expression is too long");
+    } else {
+      ParseExpression();
+      SkipSpace();
+      if (error_.empty() && pos_ != text_.size()) {
+        Fail("unexpected character");
+      }
+    }
+    if (!error_.empty()) {
+      *error = error_;
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  void SkipSpace() {
+    while (pos_ < text_.size() && isspace(static_cast<unsigned char>(text_[pos_]))) {
+      pos_++;
+    }
+  }
+
+  // Returns true and consumes |c| if it is the next non-space character.
+  bool Accept(char c) {
+    SkipSpace();
+    if (pos_ < text_.size() && text_[pos_] == c) {
+      pos_++;
+      return true;
+    }
+    return false;
+  }
+
+  // Records the first error only; later ones are usually consequences of it.
+  void Fail(const char* message) {
+    if (error_.empty()) {
+      error_ = std::string(message) + " at offset " + std::to_string(pos_);
+    }
+  }
+
+  void ParseExpression() {
+    if (++nesting_ > kMaxNesting) {
+      Fail("expression is nested too deeply");
+      return;
+    }
+    ParseTerm();
+    while (error_.empty()) {
+      if (Accept('+')) {
+        ParseTerm();
+        EmitBinary(Program::Opcode::kAdd);
+      } else if (Accept('-')) {
+        ParseTerm();
+        EmitBinary(Program::Opcode::kSubtract);
+      } else {
+        break;
+      }
+    }
+    nesting_--;
+  }
+
+  void ParseTerm() {
+    ParseUnary();
+    while (error_.empty()) {
+      if (Accept('*')) {
+        ParseUnary();
+        EmitBinary(Program::Opcode::kMultiply);
+      } else if (Accept('/')) {
+        ParseUnary();
+        EmitBinary(Program::Opcode::kDivide);
+      } else {
+        break;
+      }
+    }
+  }
+
+  void ParseUnary() {
+    if (++nesting_ > kMaxNesting) {
+      Fail("expression is nested too deeply");
+      return;
+    }
+    if (Accept('-')) {
+      ParseUnary();
+      EmitNegate();
+    } else {
+      ParsePrimary();
+    }
+    nesting_--;
+  }
+
+  void ParsePrimary() {
+    if (!error_.empty()) {
+      return;
+    }
+    if (Accept('(')) {
+      ParseExpression();
+      if (error_.empty() && !Accept(')')) {
+        Fail("expected ')'");
+      }
+      return;
+    }
+    SkipSpace();
+    if (pos_ == text_.size()) {
+      Fail("unexpected end of expression");
+      return;
+    }
+    char c = text_[pos_];
+    if (isdigit(static_cast<unsigned char>(c)) || c == '.') {
+      const char* start = text_.c_str() + pos_;
+      char* end = nullptr;
+      double value = strtod(start, &end);
+      if (end == start) {
+        Fail("invalid number");
+        return;
+      }
+      pos_ += static_cast<size_t>(end - start);
+      EmitConstant(value);
+    } else if (IsIdentifierStart(c)) {
+      size_t start = pos_;
+      while (pos_ < text_.size() && IsIdentifierChar(text_[pos_])) {
+        pos_++;
+      }
+      EmitVariable(text_.substr(start, pos_ - start));
+    } else {
+      Fail("expected a number, variable or '('");
+    }
+  }
+
+  void Emit(Program::Opcode opcode, uint32_t operand = 0) {
+    program_->code_.push_back({opcode, operand});
+  }
+
+  void Push() {
+    if (++depth_ > kMaxStackDepth) {
+      Fail("expression is too complex");
+    }
+  }
+
+  // Whether the instruction |back| places from the end pushes a constant.
+  bool IsConstant(size_t back) const {
+    const std::vector<Program::Instruction>& code = program_->code_;
+    return code.size() >= back && code[code.size() - back].opcode == Program::Opcode::kConstant;
+  }
+
+  void EmitConstant(double value) {
+    program_->constants_.push_back(value);
+    Emit(Program::Opcode::kConstant, static_cast<uint32_t>(program_->constants_.size() - 1));
+    Push();
+  }
+
+  void EmitVariable(const std::string& name) {
+    std::vector<std::string>& variables = program_->variables_;
+    size_t index = 0;
+    while (index < variables.size() && variables[index] != name) {
+      index++;
+    }
+    if (index == variables.size()) {
+      if (variables.size() == kMaxVariables) {
+        Fail("too many variables");
+        return;
+      }
+      variables.push_back(name);
+    }
+    Emit(Program::Opcode::kVariable, static_cast<uint32_t>(index));
+    Push();
+  }
+
+  void EmitNegate() {
+    if (!error_.empty()) {
+      return;
+    }
+    if (IsConstant(1)) {
+      double& value = program_->constants_.back();
+      value = -value;
+      return;
+    }
+    Emit(Program::Opcode::kNegate);
+  }
+
+  void EmitBinary(Program::Opcode opcode) {
+    if (!error_.empty()) {
+      return;
+    }
+    depth_--;
+    // An operand that is a single instruction is a constant or a variable;
+    // anything longer ends with an operator. So if the last two instructions
+    // are constants, they are the two operands. Constants are never shared,
+    // so they are also the last two entries of the pool.
+    if (IsConstant(1) && IsConstant(2)) {
+      std::vector<double>& constants = program_->constants_;
+      double b = constants.back();
+      constants.pop_back();
+      program_->code_.pop_back();
+      constants.back() = Apply(opcode, constants.back(), b);
+      return;
+    }
+    Emit(opcode);
+  }
+
+  const std::string& text_;
+  Program* program_;
+  size_t pos_ = 0;
+  size_t nesting_ = 0;
+  size_t depth_ = 0;
+  std::string error_;
+};
+
+double Program::Evaluate(const double* values, size_t count) const {
+  if (count != variables_.size()) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  double stack[kMaxStackDepth];
+  size_t top = 0;
+  for (const Instruction& instruction : code_) {
+    switch (instruction.opcode) {
+      case Opcode::kConstant:
+        stack[top++] = constants_[instruction.operand];
+        break;
+      case Opcode::kVariable:
+        stack[top++] = values[instruction.operand];
+        break;
+      case Opcode::kNegate:
+        stack[top - 1] = -stack[top - 1];
+        break;
+      case Opcode::kAdd:
+        top--;
+        stack[top - 1] = stack[top - 1] + stack[top];
+        break;
+      case Opcode::kSubtract:
+        top--;
+        stack[top - 1] = stack[top - 1] - stack[top];
+        break;
+      case Opcode::kMultiply:
+        top--;
+        stack[top - 1] = stack[top - 1] * stack[top];
+        break;
+      case Opcode::kDivide:
+        top--;
+        stack[top - 1] = stack[top - 1] / stack[top];
+        break;
+    }
+  }
+  return stack[0];
+}
+
+bool Compile(const std::string& text, Program* program, std::string* error) {
+  *program = Program();
+  return Compiler(text, program).Run(error);
+}
+
+ProgramCache::ProgramCache(size_t capacity) : capacity_(capacity) {}
+
+std::shared_ptr<const Program> ProgramCache::Compile(const std::string& text,
+                                                     std::string* error) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(text);
+    if (it != index_.end()) {
+      hits_++;
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return it->second->second;
+    }
+    misses_++;
+  }
+
+  // Compile outside the lock. Two threads may race to compile the same text;
+  // both results are correct and the second insert is dropped.
+  auto program = std::make_shared<Program>();
+  if (!calculator_engine::Compile(text, program.get(), error)) {
+    return nullptr;
+  }
+  if (capacity_ == 0) {
+    return program;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (index_.find(text) == index_.end()) {
+    if (entries_.size() == capacity_) {
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+    entries_.emplace_front(text, program);
+    index_.emplace(text, entries_.begin());
+  }
+  return program;
+}
+
+size_t ProgramCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+uint64_t ProgramCache::hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+uint64_t ProgramCache::misses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+}  // namespace calculator_engine
@@ -0,0 +1,118 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Arithmetic expressions, compiled once into a compact stack bytecode and
+/// then evaluated as often as needed with new variable values.
+///
+/// The grammar is the usual one:
+///
+///   expression := term (('+' | '-') term)*
+///   term       := unary (('*' | '/') unary)*
+///   unary      := '-' unary | primary
+///   primary    := number | variable | '(' expression ')'
+///
+/// Numbers are anything strtod() accepts that starts with a digit or '.'.
+/// Variables are identifiers, [A-Za-z_][A-Za-z0-9_]*. Subexpressions without
+/// variables are folded into constants when compiled.
+
+#ifndef EXAMPLES_CALCULATOR_ENGINE_EXPRESSION_H_
+#define EXAMPLES_CALCULATOR_ENGINE_EXPRESSION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace calculator_engine {
+
+/// The longest expression Compile() accepts, in bytes.
+constexpr size_t kMaxExpressionLength = 1024;
+
+/// The most distinct variables an expression may use.
+constexpr size_t kMaxVariables = 64;
+
+/// The deepest the evaluation stack may grow. Compile() rejects expressions
+/// that would need more, so Evaluate() never allocates.
+constexpr size_t kMaxStackDepth = 64;
+
+/// A compiled expression. Immutable, so it can be shared between threads.
+class Program {
+ public:
+  enum class Opcode : uint8_t {
+    /// Pushes constants()[operand].
+    kConstant,
+    /// Pushes the value bound to variables()[operand].
+    kVariable,
+    kNegate,
+    kAdd,
+    kSubtract,
+    kMultiply,
+    kDivide,
+  };
+
+  struct Instruction {
+    Opcode opcode;
+    uint32_t operand;
+  };
+
+  /// Evaluates the expression with |values|[i] bound to variables()[i].
+  /// |count| must equal variables().size().
+  double Evaluate(const double* values, size_t count) const;
+
+  const std::vector<Instruction>& code() const { return code_; }
+  const std::vector<double>& constants() const { return constants_; }
+
+  /// The variable names, in order of first use in the text.
+  const std::vector<std::string>& variables() const { return variables_; }
+
+ private:
+  friend class Compiler;
+
+  std::vector<Instruction> code_;
+  std::vector<double> constants_;
+  std::vector<std::string> variables_;
+};
+
+/// Compiles |text| into |program|. On failure returns false and describes the
+/// problem, with its byte offset, in |error|.
+bool Compile(const std::string& text, Program* program, std::string* error);
+
+/// Remembers the most recently used compiled programs by their text, so a
+/// formula that is compiled repeatedly is only parsed once. Thread-safe.
+class ProgramCache {
+ public:
+  explicit ProgramCache(size_t capacity);
+
+  /// Returns the program for |text|, compiling and caching it if it is not
+  /// cached. On failure returns null and fills in |error|; failures are not
+  /// cached.
+  std::shared_ptr<const Program> Compile(const std::string& text, std::string* error);
+
+  size_t size() const;
+  uint64_t hits() const;
+  uint64_t misses() const;
+
+ private:
+  ProgramCache(const ProgramCache&) = delete;
+  ProgramCache& operator=(const ProgramCache&) = delete;
+
+  using Entry = std::pair<std::string, std::shared_ptr<const Program>>;
+
+  const size_t capacity_;
+  mutable std::mutex mutex_;
+  // Most recently used first.
+  std::list<Entry> entries_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+};
+
+}  // namespace calculator_engine
+
+#endif  // EXAMPLES_CALCULATOR_ENGINE_EXPRESSION_H_
@@ -7,14 +7,52 @@
 #include <fuchsia/examples/calculator/cpp/fidl.h>
 #include <lib/async-loop/cpp/loop.h>
 #include <lib/async-loop/default.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <thread>
 
 #include "engine_driver.h"
 
 namespace calculator = fuchsia::examples::calculator;
 
-int main() {
+// Usage: engine_bin [--workers N] [--queue-depth N] [--offload-threshold N]
+//                   [--run-inline-when-busy] [--result-cache N]
+//                   [--max-messages-per-read N]
+//
+//   --workers               threads running expensive operations (default: one
+//                           per CPU; 0 runs everything on the dispatch thread)
+//   --queue-depth           operations that may wait for a worker (default 64)
+//   --offload-threshold     smallest cost, in elements or solver iterations,
+//                           handed to the workers (default 4096)
+//   --run-inline-when-busy  run operations on the dispatch thread when the
+//                           workers are saturated, rather than failing them
+//   --result-cache          solver results to remember (default 0, disabled)
+//   --max-messages-per-read requests read from one connection before the
+//                           others get a turn (default 64)
+int main(int argc, const char** argv) {
+  calculator_engine::Engine::Options options;
+  options.worker_threads = std::thread::hardware_concurrency();
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp("--run-inline-when-busy", argv[i])) {
+      options.saturation = calculator_engine::Engine::Options::Saturation::kRunInline;
+    } else if (i + 1 == argc) {
+      break;
+    } else if (!strcmp("--workers", argv[i])) {
+      options.worker_threads = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp("--queue-depth", argv[i])) {
+      options.queue_depth = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp("--offload-threshold", argv[i])) {
+      options.offload_threshold = strtoull(argv[++i], nullptr, 10);
+    } else if (!strcmp("--result-cache", argv[i])) {
+      options.result_cache_entries = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp("--max-messages-per-read", argv[i])) {
+      options.read_budget.max_messages = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+    }
+  }
+
   async::Loop loop(&kAsyncLoopConfigAttachToCurrentThread);
-  calculator_engine::Engine app;
+  calculator_engine::Engine app(options);
   fidl::BindingSet<calculator::Calculator> bindings;
   loop.Run();
 
@@ -0,0 +1,30 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ordered_replies.h"
+
+namespace calculator_engine {
+
+void OrderedReplies::Complete(uint64_t ticket, fit::closure reply) {
+  Slot& slot = pending_[pending_.size() - (next_ticket_ - ticket)];
+  slot.done = true;
+  slot.reply = std::move(reply);
+  while (!pending_.empty() && pending_.front().done) {
+    fit::closure next = std::move(pending_.front().reply);
+    pending_.pop_front();
+    if (next) {
+      next();
+    }
+  }
+}
+
+size_t OrderedReplies::held() const {
+  size_t held = 0;
+  for (const Slot& slot : pending_) {
+    held += slot.done ? 1 : 0;
+  }
+  return held;
+}
+
+}  // namespace calculator_engine
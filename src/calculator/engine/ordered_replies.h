@@ -0,0 +1,61 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Keeps the replies on one connection in request order when the requests
+/// complete out of order.
+
+#ifndef EXAMPLES_CALCULATOR_ENGINE_ORDERED_REPLIES_H_
+#define EXAMPLES_CALCULATOR_ENGINE_ORDERED_REPLIES_H_
+
+#include <lib/fit/function.h>
+#include <stdint.h>
+
+#include <deque>
+
+namespace calculator_engine {
+
+/// Each request takes a ticket when it arrives and hands its reply back with
+/// the ticket when it completes. Replies are sent in ticket order: a reply is
+/// held until every earlier one has been sent.
+///
+/// Not thread-safe; used from the thread that serves the connection.
+class OrderedReplies {
+ public:
+  OrderedReplies() = default;
+
+  /// Takes the ticket for the next request.
+  uint64_t Reserve() {
+    pending_.emplace_back();
+    return next_ticket_++;
+  }
+
+  /// Whether |ticket| is the oldest outstanding one, so its reply can be sent
+  /// at once.
+  bool is_next(uint64_t ticket) const { return ticket == next_ticket_ - pending_.size(); }
+
+  /// Sends |reply| for |ticket| as soon as every earlier reply has been sent,
+  /// which may be now. A caller that has already sent the reply itself, which
+  /// it may only do while is_next(|ticket|), passes null.
+  void Complete(uint64_t ticket, fit::closure reply);
+
+  /// The replies waiting on earlier ones.
+  size_t held() const;
+
+ private:
+  OrderedReplies(const OrderedReplies&) = delete;
+  OrderedReplies& operator=(const OrderedReplies&) = delete;
+
+  struct Slot {
+    bool done = false;
+    fit::closure reply;
+  };
+
+  // One slot per outstanding ticket, oldest first.
+  std::deque<Slot> pending_;
+  uint64_t next_ticket_ = 0;
+};
+
+}  // namespace calculator_engine
+
+#endif  // EXAMPLES_CALCULATOR_ENGINE_ORDERED_REPLIES_H_
@@ -0,0 +1,209 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "result_cache.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace calculator_engine {
+
+namespace {
+
+// The shards, a power of two.
+constexpr size_t kShards = 16;
+
+// The entries a key may occupy, starting at its home index.
+constexpr size_t kProbeWindow = 8;
+
+uint64_t Bits(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// The finalizer of MurmurHash3, to spread every input bit over the output.
+uint64_t Mix(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+  return x;
+}
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+}  // namespace
+
+struct ResultCache::Key {
+  uint64_t a;
+  uint64_t b;
+  uint64_t tolerance;
+  uint32_t max_iterations;
+  uint8_t operation;
+  uint8_t mode;
+
+  Key(BinaryOperation operation, double a, double b, const SolverOptions& options)
+      : a(Bits(a)),
+        b(Bits(b)),
+        tolerance(Bits(options.tolerance)),
+        max_iterations(static_cast<uint32_t>(options.max_iterations)),
+        operation(static_cast<uint8_t>(operation)),
+        mode(static_cast<uint8_t>(options.mode)) {}
+
+  uint64_t Hash() const {
+    uint64_t small = (static_cast<uint64_t>(max_iterations) << 16) |
+                     (static_cast<uint64_t>(operation) << 8) | mode;
+    return Mix(a ^ Mix(b ^ Mix(tolerance ^ Mix(small))));
+  }
+};
+
+// 48 bytes: the key, the result and three flags.
+struct ResultCache::Entry {
+  uint64_t a;
+  uint64_t b;
+  uint64_t tolerance;
+  double root;
+  uint32_t max_iterations;
+  uint32_t iterations;
+  uint8_t operation;
+  uint8_t mode;
+  bool occupied;
+  // Set by every hit, and cleared as the CLOCK hand passes.
+  bool referenced;
+  bool converged;
+
+  bool Matches(const Key& key) const {
+    return a == key.a && b == key.b && tolerance == key.tolerance &&
+           max_iterations == key.max_iterations && operation == key.operation && mode == key.mode;
+  }
+
+  void Store(const Key& key, const SolverResult& result) {
+    a = key.a;
+    b = key.b;
+    tolerance = key.tolerance;
+    max_iterations = key.max_iterations;
+    operation = key.operation;
+    mode = key.mode;
+    occupied = true;
+    referenced = false;
+    root = result.root;
+    iterations = static_cast<uint32_t>(result.iterations);
+    converged = result.converged;
+  }
+};
+
+// Entries are never removed, only replaced, so the entries of a key's window
+// are filled in order and a lookup can stop at the first empty one.
+struct ResultCache::Shard {
+  std::mutex mutex;
+  std::vector<Entry> entries;
+  size_t mask = 0;
+  size_t size = 0;
+  // Where the next eviction starts in its window.
+  size_t hand = 0;
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+};
+
+ResultCache::ResultCache(size_t capacity) : shards_(new Shard[kShards]) {
+  size_t per_shard =
+      std::max(kProbeWindow, RoundUpToPowerOfTwo((capacity + kShards - 1) / kShards));
+  for (size_t i = 0; i < kShards; i++) {
+    shards_[i].entries.resize(per_shard, Entry{});
+    shards_[i].mask = per_shard - 1;
+  }
+}
+
+ResultCache::~ResultCache() = default;
+
+size_t ResultCache::capacity() const { return kShards * shards_[0].entries.size(); }
+
+size_t ResultCache::entry_size() { return sizeof(Entry); }
+
+ResultCache::Shard& ResultCache::ShardFor(uint64_t hash) const {
+  // The low bits choose the home index within the shard.
+  return shards_[hash >> 60 & (kShards - 1)];
+}
+
+bool ResultCache::Lookup(BinaryOperation operation, double a, double b,
+                         const SolverOptions& options, SolverResult* result) {
+  Key key(operation, a, b, options);
+  uint64_t hash = key.Hash();
+  Shard& shard = ShardFor(hash);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  for (size_t i = 0; i < kProbeWindow; i++) {
+    Entry& entry = shard.entries[(hash + i) & shard.mask];
+    if (!entry.occupied) {
+      break;
+    }
+    if (entry.Matches(key)) {
+      entry.referenced = true;
+      result->root = entry.root;
+      result->iterations = static_cast<int>(entry.iterations);
+      result->converged = entry.converged;
+      shard.hits++;
+      return true;
+    }
+  }
+  shard.misses++;
+  return false;
+}
+
+void ResultCache::Insert(BinaryOperation operation, double a, double b,
+                         const SolverOptions& options, const SolverResult& result) {
+  Key key(operation, a, b, options);
+  uint64_t hash = key.Hash();
+  Shard& shard = ShardFor(hash);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  for (size_t i = 0; i < kProbeWindow; i++) {
+    Entry& entry = shard.entries[(hash + i) & shard.mask];
+    if (!entry.occupied) {
+      entry.Store(key, result);
+      shard.size++;
+      return;
+    }
+    if (entry.Matches(key)) {
+      // Another thread solved the same operation first.
+      return;
+    }
+  }
+  // The window is full. The hand starts somewhere new each time, so no slot is
+  // favored, and the second pass over the window is sure to find an entry
+  // whose mark the first pass cleared.
+  size_t hand = shard.hand++;
+  for (size_t i = 0; i < 2 * kProbeWindow; i++) {
+    Entry& entry = shard.entries[(hash + (hand + i) % kProbeWindow) & shard.mask];
+    if (!entry.referenced) {
+      entry.Store(key, result);
+      shard.evictions++;
+      return;
+    }
+    entry.referenced = false;
+  }
+}
+
+ResultCache::Stats ResultCache::stats() const {
+  Stats stats;
+  for (size_t i = 0; i < kShards; i++) {
+    Shard& shard = shards_[i];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    stats.hits += shard.hits;
+    stats.misses += shard.misses;
+    stats.evictions += shard.evictions;
+    stats.size += shard.size;
+  }
+  return stats;
+}
+
+}  // namespace calculator_engine
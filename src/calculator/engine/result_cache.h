@@ -0,0 +1,81 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// A bounded cache of solver results, so repeated operations are answered
+/// without solving again.
+
+#ifndef EXAMPLES_CALCULATOR_ENGINE_RESULT_CACHE_H_
+#define EXAMPLES_CALCULATOR_ENGINE_RESULT_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "engine.h"
+#include "solver.h"
+
+namespace calculator_engine {
+
+/// Maps an operation, its SolverOptions and its operands to the SolverResult
+/// of solving it. Operands and the tolerance are compared bit for bit, so 0
+/// and -0 are different keys, as are NaNs with different payloads.
+///
+/// The entries are split over a fixed number of shards, each with its own
+/// lock, so threads looking up different keys rarely contend. Each shard is
+/// a flat array probed linearly over a short window. Once a key's window is
+/// full, an entry in it is evicted by the CLOCK algorithm: every hit marks
+/// its entry referenced, and the eviction passes over the window clearing
+/// the marks until it finds an unmarked entry.
+///
+/// This class is thread-safe.
+class ResultCache {
+ public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    /// The entries held.
+    size_t size = 0;
+  };
+
+  /// Holds at least |capacity| entries. The capacity is rounded up to fill
+  /// every shard with a power of two of entries.
+  explicit ResultCache(size_t capacity);
+  ~ResultCache();
+
+  /// The entries the cache can hold.
+  size_t capacity() const;
+
+  /// The bytes each entry takes.
+  static size_t entry_size();
+
+  /// Finds the result for the key, returning whether there was one.
+  bool Lookup(BinaryOperation operation, double a, double b, const SolverOptions& options,
+              SolverResult* result);
+
+  /// Stores |result| for the key, evicting another entry if need be.
+  void Insert(BinaryOperation operation, double a, double b, const SolverOptions& options,
+              const SolverResult& result);
+
+  Stats stats() const;
+
+ private:
+  ResultCache(const ResultCache&) = delete;
+  ResultCache& operator=(const ResultCache&) = delete;
+
+  struct Key;
+  struct Entry;
+  struct Shard;
+
+  Shard& ShardFor(uint64_t hash) const;
+
+  std::unique_ptr<Shard[]> shards_;
+};
+
+}  // namespace calculator_engine
+
+#endif  // EXAMPLES_CALCULATOR_ENGINE_RESULT_CACHE_H_
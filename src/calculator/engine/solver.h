@@ -0,0 +1,170 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Generic root finders used by the engine. Each operation is phrased as a
+/// function with a root at the answer, and solved by one of the methods
+/// below. The adaptive methods stop as soon as the iterates converge, rather
+/// than after a fixed number of steps.
+
+#ifndef EXAMPLES_CALCULATOR_ENGINE_SOLVER_H_
+#define EXAMPLES_CALCULATOR_ENGINE_SOLVER_H_
+
+#include <cmath>
+#include <limits>
+
+namespace calculator_engine {
+
+/// The number of iterations run by SolverMode::kFixedIterations.
+constexpr int ITERATION_COUNT = 1000000;
+
+/// How a root is found.
+enum class SolverMode {
+  /// Runs exactly ITERATION_COUNT Newton iterations, converged or not. This is
+  /// the engine's original behavior, kept as a baseline.
+  kFixedIterations,
+  /// Newton's method, stopping once the step size falls within the
+  /// tolerance.
+  kNewton,
+  /// The secant method, which needs no derivative, with the same stopping
+  /// rule as kNewton.
+  kSecant,
+  /// Solves in one step when the derivative is known to be constant, and
+  /// falls back to kNewton otherwise.
+  kClosedForm,
+};
+
+/// Controls a solve.
+struct SolverOptions {
+  SolverMode mode = SolverMode::kClosedForm;
+  /// The iteration stops once a step is no larger than |tolerance| relative
+  /// to the magnitude of the iterate (or absolute, below a magnitude of 1).
+  /// Zero stops only at an exact fixed point.
+  double tolerance = 4 * std::numeric_limits<double>::epsilon();
+  /// The most iterations the adaptive modes run before giving up.
+  int max_iterations = 100;
+};
+
+/// The outcome of a solve.
+struct SolverResult {
+  double root = 0;
+  /// The number of iterations used. A closed-form solve counts as one.
+  int iterations = 0;
+  /// Whether the stopping rule was met. Always true for kFixedIterations.
+  bool converged = false;
+};
+
+/// A function whose root is wanted, with its derivative. If
+/// |constant_derivative| is set, |derivative| returns the same value for
+/// every x, so a single Newton step from any point lands on the root.
+template <typename Function, typename Derivative>
+struct RootProblem {
+  Function function;
+  Derivative derivative;
+  bool constant_derivative;
+  double initial_guess;
+};
+
+template <typename Function, typename Derivative>
+RootProblem<Function, Derivative> MakeRootProblem(Function function, Derivative derivative,
+                                                  bool constant_derivative,
+                                                  double initial_guess = 0) {
+  return RootProblem<Function, Derivative>{function, derivative, constant_derivative,
+                                           initial_guess};
+}
+
+namespace internal {
+
+inline bool StepConverged(double step, double x, double tolerance) {
+  return std::fabs(step) <= tolerance * std::fmax(1.0, std::fabs(x));
+}
+
+}  // namespace internal
+
+/// Newton's method from |x0|, for at most |options.max_iterations| steps.
+template <typename Function, typename Derivative>
+SolverResult SolveNewton(const Function &f, const Derivative &df, double x0,
+                         const SolverOptions &options) {
+  SolverResult result;
+  double x = x0;
+  for (int i = 0; i < options.max_iterations; i++) {
+    double fx = f(x);
+    double step = fx / df(x);
+    x = x - step;
+    result.iterations = i + 1;
+    // A non-finite step can only come from a non-finite problem; further
+    // iterations would not change the outcome.
+    if (fx == 0 || !std::isfinite(step) || internal::StepConverged(step, x, options.tolerance)) {
+      result.converged = std::isfinite(x);
+      break;
+    }
+  }
+  result.root = x;
+  return result;
+}
+
+/// The secant method from |x0| and |x1|, for at most
+/// |options.max_iterations| steps.
+template <typename Function>
+SolverResult SolveSecant(const Function &f, double x0, double x1, const SolverOptions &options) {
+  SolverResult result;
+  double f0 = f(x0);
+  for (int i = 0; i < options.max_iterations; i++) {
+    double f1 = f(x1);
+    result.iterations = i + 1;
+    if (f1 == 0 || f1 == f0) {
+      // Either exactly on the root, or the secant is flat and no further
+      // progress is possible.
+      result.converged = f1 == 0 || internal::StepConverged(x1 - x0, x1, options.tolerance);
+      break;
+    }
+    double step = f1 * (x1 - x0) / (f1 - f0);
+    x0 = x1;
+    f0 = f1;
+    x1 = x1 - step;
+    if (!std::isfinite(step) || internal::StepConverged(step, x1, options.tolerance)) {
+      result.converged = std::isfinite(x1);
+      break;
+    }
+  }
+  result.root = x1;
+  return result;
+}
+
+/// Solves |problem| as |options| asks.
+template <typename Function, typename Derivative>
+SolverResult Solve(const RootProblem<Function, Derivative> &problem,
+                   const SolverOptions &options) {
+  const double x0 = problem.initial_guess;
+  switch (options.mode) {
+    case SolverMode::kFixedIterations: {
+      double x = x0;
+      for (int i = 0; i < ITERATION_COUNT; i++) {
+        x = x - problem.function(x) / problem.derivative(x);
+      }
+      SolverResult result;
+      result.root = x;
+      result.iterations = ITERATION_COUNT;
+      result.converged = true;
+      return result;
+    }
+    case SolverMode::kSecant:
+      return SolveSecant(problem.function, x0, x0 + 1, options);
+    case SolverMode::kClosedForm:
+      if (problem.constant_derivative) {
+        SolverResult result;
+        result.root = x0 - problem.function(x0) / problem.derivative(x0);
+        result.iterations = 1;
+        result.converged = std::isfinite(result.root);
+        return result;
+      }
+      return SolveNewton(problem.function, problem.derivative, x0, options);
+    case SolverMode::kNewton:
+    default:
+      return SolveNewton(problem.function, problem.derivative, x0, options);
+  }
+}
+
+}  // namespace calculator_engine
+
+#endif  // EXAMPLES_CALCULATOR_ENGINE_SOLVER_H_
@@ -0,0 +1,101 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Host benchmark for the batch arithmetic. For each batch size, reports the
+/// elements per second of calling the scalar function once per element, of
+/// the scalar batch reference, and of BinaryOpBatch.
+///
+/// Usage: batch_benchmarks [--min-time-ms N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "src/calculator/engine/engine.h"
+
+namespace calculator_engine {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const size_t kBatchSizes[] = {1, 8, 64, 512, 4096, 32768, 262144, 1048576};
+
+struct Variant {
+  const char* name;
+  void (*run)(const double* a, const double* b, size_t count, double* results, uint8_t* status);
+};
+
+void RunPerElement(const double* a, const double* b, size_t count, double* results,
+                   uint8_t* status) {
+  for (size_t i = 0; i < count; i++) {
+    results[i] = divide(a[i], b[i]);
+    status[i] = kElementOk;
+  }
+}
+
+void RunScalarBatch(const double* a, const double* b, size_t count, double* results,
+                    uint8_t* status) {
+  BinaryOpBatchScalar(BinaryOperation::kDivide, a, b, count, results, status);
+}
+
+void RunBatch(const double* a, const double* b, size_t count, double* results,
+              uint8_t* status) {
+  BinaryOpBatch(BinaryOperation::kDivide, a, b, count, results, status);
+}
+
+const Variant kVariants[] = {
+    {"per-element", RunPerElement},
+    {"batch-scalar", RunScalarBatch},
+    {"batch", RunBatch},
+};
+
+// Runs |variant| over |count| elements repeatedly for at least |min_time| and
+// returns the elements processed per second.
+double MeasureElementsPerSecond(const Variant& variant, size_t count,
+                                std::chrono::nanoseconds min_time) {
+  std::vector<double> a(count), b(count), results(count);
+  std::vector<uint8_t> status(count);
+  for (size_t i = 0; i < count; i++) {
+    a[i] = 3.5 + static_cast<double>(i % 64);
+    b[i] = 2.5 + static_cast<double>(i % 7);
+  }
+
+  size_t elements = 0;
+  Clock::time_point start = Clock::now();
+  std::chrono::nanoseconds elapsed(0);
+  while (elapsed < min_time) {
+    variant.run(a.data(), b.data(), count, results.data(), status.data());
+    elements += count;
+    elapsed = Clock::now() - start;
+  }
+  return static_cast<double>(elements) * 1e9 / static_cast<double>(elapsed.count());
+}
+
+}  // namespace
+}  // namespace calculator_engine
+
+int main(int argc, const char** argv) {
+  using namespace calculator_engine;
+
+  long min_time_ms = 200;
+  for (int i = 1; i < argc - 1; ++i) {
+    if (!strcmp("--min-time-ms", argv[i])) {
+      min_time_ms = strtol(argv[++i], nullptr, 10);
+    }
+  }
+  std::chrono::nanoseconds min_time = std::chrono::milliseconds(min_time_ms);
+
+  printf("%-10s %-14s %16s\n", "batch", "variant", "Melements/s");
+  for (size_t count : kBatchSizes) {
+    for (const Variant& variant : kVariants) {
+      double rate = MeasureElementsPerSecond(variant, count, min_time);
+      printf("%-10zu %-14s %16.1f\n", count, variant.name, rate / 1e6);
+      fflush(stdout);
+    }
+  }
+  return 0;
+}
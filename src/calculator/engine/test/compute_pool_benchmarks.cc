@@ -0,0 +1,221 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Host benchmark for the engine's threading model. A single dispatch thread
+/// issues batch requests for many simulated connections, hands them to a
+/// ComputePool, and delivers the replies in order per connection through
+/// OrderedReplies, just as the engine does.
+///
+/// The offered load grows with the number of workers: each worker gets
+/// --connections-per-worker connections, each keeping --depth requests in
+/// flight. If the pool scales, throughput grows with the worker count while
+/// the latency of each request stays flat.
+///
+/// Usage: compute_pool_benchmarks [--max-workers N] [--connections-per-worker N]
+///                                [--depth N] [--elements N] [--duration-ms N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "src/calculator/engine/compute_pool.h"
+#include "src/calculator/engine/engine.h"
+#include "src/calculator/engine/ordered_replies.h"
+
+namespace calculator_engine {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Stands in for the async loop: a queue of tasks run by the main thread.
+class Dispatcher {
+ public:
+  void Post(fit::closure task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+    wakeup_.notify_one();
+  }
+
+  // Runs tasks until |deadline|.
+  void RunUntil(Clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      if (!wakeup_.wait_until(lock, deadline, [this] { return !tasks_.empty(); })) {
+        return;
+      }
+      fit::closure task = std::move(tasks_.front());
+      tasks_.pop_front();
+      lock.unlock();
+      task();
+      lock.lock();
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable wakeup_;
+  std::deque<fit::closure> tasks_;
+};
+
+struct Options {
+  size_t max_workers = std::max(1u, std::thread::hardware_concurrency());
+  size_t connections_per_worker = 8;
+  size_t depth = 8;
+  size_t elements = 16384;
+  long duration_ms = 1000;
+};
+
+struct Connection {
+  OrderedReplies replies;
+  // One output buffer per request in flight, indexed by ticket % depth. A
+  // ticket's buffer is reused only after its reply, so never concurrently.
+  std::vector<std::vector<double>> results;
+  std::vector<std::vector<uint8_t>> status;
+};
+
+struct Run {
+  size_t requests = 0;
+  std::vector<double> latencies_us;
+};
+
+class Benchmark {
+ public:
+  Benchmark(const Options& options, size_t workers)
+      : options_(options),
+        connections_(workers * options.connections_per_worker),
+        pool_(workers, workers * options.connections_per_worker * options.depth) {
+    a_.resize(options.elements);
+    b_.resize(options.elements);
+    for (size_t i = 0; i < options.elements; i++) {
+      a_[i] = 3.5 + static_cast<double>(i % 64);
+      b_[i] = 2.5 + static_cast<double>(i % 7);
+    }
+    for (std::unique_ptr<Connection>& connection : connections_) {
+      connection = std::make_unique<Connection>();
+      connection->results.resize(options.depth, std::vector<double>(options.elements));
+      connection->status.resize(options.depth, std::vector<uint8_t>(options.elements));
+    }
+  }
+
+  Run Measure() {
+    Clock::time_point start = Clock::now();
+    warmup_end_ = start + std::chrono::milliseconds(options_.duration_ms / 4);
+    for (std::unique_ptr<Connection>& connection : connections_) {
+      for (size_t i = 0; i < options_.depth; i++) {
+        dispatcher_.Post([this, c = connection.get()] { Issue(c); });
+      }
+    }
+    // Requests still in flight at the end are not recorded.
+    measuring_ = true;
+    dispatcher_.RunUntil(warmup_end_ + std::chrono::milliseconds(options_.duration_ms));
+    measuring_ = false;
+    stopping_ = true;
+    return std::move(run_);
+  }
+
+ private:
+  // Runs on the dispatch thread.
+  void Issue(Connection* connection) {
+    if (stopping_) {
+      return;
+    }
+    uint64_t ticket = connection->replies.Reserve();
+    Clock::time_point issued = Clock::now();
+    if (!pool_.TryReserve()) {
+      fprintf(stderr, "pool saturated\n");
+      abort();
+    }
+    pool_.Post([this, connection, ticket, issued] {
+      size_t slot = ticket % options_.depth;
+      BinaryOpBatch(BinaryOperation::kDivide, a_.data(), b_.data(), a_.size(),
+                    connection->results[slot].data(), connection->status[slot].data());
+      dispatcher_.Post([this, connection, ticket, issued] {
+        connection->replies.Complete(ticket, [this, connection, issued] {
+          Clock::time_point now = Clock::now();
+          if (measuring_ && now >= warmup_end_) {
+            run_.requests++;
+            run_.latencies_us.push_back(
+                std::chrono::duration<double, std::micro>(now - issued).count());
+          }
+          Issue(connection);
+        });
+      });
+    });
+  }
+
+  const Options options_;
+  std::vector<double> a_;
+  std::vector<double> b_;
+  Dispatcher dispatcher_;
+  std::vector<std::unique_ptr<Connection>> connections_;
+  Clock::time_point warmup_end_;
+  bool measuring_ = false;
+  bool stopping_ = false;
+  Run run_;
+  // Last, so it is destroyed first: its destructor finishes the requests
+  // still in flight, which use everything above.
+  ComputePool pool_;
+};
+
+double Percentile(std::vector<double>* values, double p) {
+  if (values->empty()) {
+    return 0;
+  }
+  size_t index = std::min(values->size() - 1, static_cast<size_t>(p * values->size()));
+  std::nth_element(values->begin(), values->begin() + index, values->end());
+  return (*values)[index];
+}
+
+}  // namespace
+}  // namespace calculator_engine
+
+int main(int argc, const char** argv) {
+  using namespace calculator_engine;
+
+  Options options;
+  for (int i = 1; i < argc - 1; ++i) {
+    if (!strcmp("--max-workers", argv[i])) {
+      options.max_workers = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (!strcmp("--connections-per-worker", argv[i])) {
+      options.connections_per_worker = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (!strcmp("--depth", argv[i])) {
+      options.depth = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (!strcmp("--elements", argv[i])) {
+      options.elements = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp("--duration-ms", argv[i])) {
+      options.duration_ms = strtol(argv[++i], nullptr, 10);
+    }
+  }
+
+  printf("%8s %10s %12s %10s %10s %10s\n", "workers", "in-flight", "requests/s", "p50 us",
+         "p99 us", "max us");
+  // Powers of two, then the maximum.
+  std::vector<size_t> worker_counts;
+  for (size_t workers = 1; workers < options.max_workers; workers *= 2) {
+    worker_counts.push_back(workers);
+  }
+  worker_counts.push_back(options.max_workers);
+
+  for (size_t workers : worker_counts) {
+    Run run = Benchmark(options, workers).Measure();
+    double seconds = static_cast<double>(options.duration_ms) / 1000;
+    size_t in_flight = workers * options.connections_per_worker * options.depth;
+    double p50 = Percentile(&run.latencies_us, 0.5);
+    double p99 = Percentile(&run.latencies_us, 0.99);
+    double max = Percentile(&run.latencies_us, 1);
+    printf("%8zu %10zu %12.0f %10.0f %10.0f %10.0f\n", workers, in_flight,
+           static_cast<double>(run.requests) / seconds, p50, p99, max);
+    fflush(stdout);
+  }
+  return 0;
+}
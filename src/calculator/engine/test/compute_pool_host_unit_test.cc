@@ -0,0 +1,171 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Test cases for the compute pool and reply ordering that run on the
+/// development host.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "src/calculator/engine/compute_pool.h"
+#include "src/calculator/engine/ordered_replies.h"
+
+namespace calculator_engine {
+namespace {
+
+// Blocks tasks until released, so a test can hold the pool's threads busy.
+class Gate {
+ public:
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiting_++;
+    changed_.notify_all();
+    changed_.wait(lock, [this] { return open_; });
+  }
+
+  void WaitForWaiters(int count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this, count] { return waiting_ >= count; });
+  }
+
+  void Open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_ = true;
+    changed_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  int waiting_ = 0;
+  bool open_ = false;
+};
+
+TEST(ComputePoolTest, RunsEveryTask) {
+  std::atomic<int> ran{0};
+  {
+    ComputePool pool(4, 1000);
+    for (int i = 0; i < 1000; i++) {
+      ASSERT_TRUE(pool.TryReserve());
+      pool.Post([&ran] { ran++; });
+    }
+  }
+  EXPECT_EQ(1000, ran.load());
+}
+
+// Once every thread is busy and the queue is full, reservations fail until a
+// task finishes.
+TEST(ComputePoolTest, SaturatesAtQueueDepth) {
+  Gate gate;
+  ComputePool pool(2, 3);
+  for (int i = 0; i < 5; i++) {
+    ASSERT_TRUE(pool.TryReserve()) << i;
+    pool.Post([&gate] { gate.Wait(); });
+  }
+  gate.WaitForWaiters(2);
+  EXPECT_EQ(2u, pool.running());
+  EXPECT_EQ(3u, pool.queued());
+  EXPECT_FALSE(pool.TryReserve());
+
+  gate.Open();
+  // Places free up as the tasks finish.
+  bool reserved = false;
+  for (int i = 0; i < 1000 && !reserved; i++) {
+    reserved = pool.TryReserve();
+    if (!reserved) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  ASSERT_TRUE(reserved);
+  pool.Post([] {});
+}
+
+TEST(ComputePoolTest, ReservationsAreExact) {
+  ComputePool pool(1, 100);
+  Gate gate;
+  ASSERT_TRUE(pool.TryReserve());
+  pool.Post([&gate] { gate.Wait(); });
+  gate.WaitForWaiters(1);
+
+  // Many threads racing for the remaining places get exactly that many.
+  std::atomic<int> granted{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&pool, &granted] {
+      for (int i = 0; i < 50; i++) {
+        if (pool.TryReserve()) {
+          granted++;
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(100, granted.load());
+  for (int i = 0; i < granted.load(); i++) {
+    pool.Post([] {});
+  }
+  gate.Open();
+}
+
+TEST(OrderedRepliesTest, InOrderCompletionsSendAtOnce) {
+  OrderedReplies replies;
+  std::vector<int> sent;
+  uint64_t first = replies.Reserve();
+  uint64_t second = replies.Reserve();
+  EXPECT_TRUE(replies.is_next(first));
+  EXPECT_FALSE(replies.is_next(second));
+  replies.Complete(first, [&sent] { sent.push_back(1); });
+  EXPECT_EQ(std::vector<int>({1}), sent);
+  EXPECT_TRUE(replies.is_next(second));
+  // A caller may send the next reply itself.
+  sent.push_back(2);
+  replies.Complete(second, nullptr);
+  EXPECT_EQ(std::vector<int>({1, 2}), sent);
+  EXPECT_EQ(0u, replies.held());
+}
+
+TEST(OrderedRepliesTest, LaterCompletionsWait) {
+  OrderedReplies replies;
+  std::vector<int> sent;
+  uint64_t tickets[4];
+  for (uint64_t& ticket : tickets) {
+    ticket = replies.Reserve();
+  }
+  replies.Complete(tickets[3], [&sent] { sent.push_back(3); });
+  replies.Complete(tickets[1], [&sent] { sent.push_back(1); });
+  EXPECT_TRUE(sent.empty());
+  EXPECT_EQ(2u, replies.held());
+
+  replies.Complete(tickets[0], [&sent] { sent.push_back(0); });
+  EXPECT_EQ(std::vector<int>({0, 1}), sent);
+  replies.Complete(tickets[2], [&sent] { sent.push_back(2); });
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3}), sent);
+  EXPECT_EQ(0u, replies.held());
+}
+
+// Replies may start new requests while the held replies are being flushed.
+TEST(OrderedRepliesTest, ReplyMayReserve) {
+  OrderedReplies replies;
+  std::vector<uint64_t> later;
+  uint64_t first = replies.Reserve();
+  uint64_t second = replies.Reserve();
+  replies.Complete(second, [&] { later.push_back(replies.Reserve()); });
+  replies.Complete(first, [&] { later.push_back(replies.Reserve()); });
+  ASSERT_EQ(2u, later.size());
+  EXPECT_TRUE(replies.is_next(later[0]));
+  replies.Complete(later[1], nullptr);
+  replies.Complete(later[0], nullptr);
+  EXPECT_EQ(0u, replies.held());
+}
+
+}  // namespace
+}  // namespace calculator_engine
@@ -5,7 +5,9 @@
 // Test cases for the math engine that run on a Fuchsia device.
 
 #include <fuchsia/examples/calculator/cpp/fidl.h>
+#include <lib/fit/single_threaded_executor.h>
 #include <lib/gtest/test_loop_fixture.h>
+#include <lib/inspect/cpp/reader.h>
 #include <lib/sys/cpp/testing/component_context_provider.h>
 
 #include <gtest/gtest.h>
@@ -21,6 +23,8 @@ class EngineForTest : public Engine {
   // Expose injecting constructor so we can pass an instrumented Context
   explicit EngineForTest(std::unique_ptr<sys::ComponentContext> context)
       : Engine(std::move(context)){};
+
+  using Engine::inspector;
 };
 
 // The fixture for testing the Engine class.
@@ -43,6 +47,16 @@ class EngineDeviceUnitTest : public gtest::TestLoopFixture {
     return engine;
   }
 
+  // Reads back the metrics the engine has published.
+  // Reads the metrics, opening the lazy nodes that publish the per-request
+  // values.
+  inspect::Hierarchy ReadMetrics() {
+    fit::result<inspect::Hierarchy> result =
+        fit::run_single_threaded(inspect::ReadFromInspector(*mathEngine_->inspector()));
+    EXPECT_TRUE(result.is_ok());
+    return result.take_value();
+  }
+
  private:
   std::unique_ptr<EngineForTest> mathEngine_;
   sys::testing::ComponentContextProvider provider_;
@@ -133,4 +147,213 @@ TEST_F(EngineDeviceUnitTest, Division) {
   EXPECT_DOUBLE_EQ(1.4, recorder.result.number());
 }
 
+TEST_F(EngineDeviceUnitTest, DivisionWithOptions) {
+  calculator::CalculatorPtr engine = mathEngine();
+
+  for (calculator::SolverMode mode : {calculator::SolverMode::NEWTON, calculator::SolverMode::SECANT,
+                                      calculator::SolverMode::CLOSED_FORM}) {
+    calculator::SolverOptions options;
+    options.mode = mode;
+    options.tolerance = 1e-12;
+    options.max_iterations = 10;
+
+    bool callbackCalled = false;
+    calculator::Result result;
+    calculator::SolverReport report;
+    engine->DoBinaryOpWithOptions(
+        calculator::BinaryOp::DIVISION, 3.5, 2.5, options,
+        [&](calculator::Result r, calculator::SolverReport rep) {
+          callbackCalled = true;
+          result = std::move(r);
+          report = rep;
+        });
+    RunLoopUntilIdle();
+
+    EXPECT_TRUE(callbackCalled);
+    EXPECT_TRUE(result.is_number());
+    EXPECT_DOUBLE_EQ(1.4, result.number());
+    EXPECT_TRUE(report.converged);
+    EXPECT_GE(report.iterations, 1u);
+    EXPECT_LE(report.iterations, 10u);
+  }
+}
+
+TEST_F(EngineDeviceUnitTest, DivisionBatch) {
+  calculator::CalculatorPtr engine = mathEngine();
+
+  bool callbackCalled = false;
+  calculator::Calculator_DoBinaryOpBatch_Result result;
+  engine->DoBinaryOpBatch(calculator::BinaryOp::DIVISION, {3.5, 1., 9.}, {2.5, 0., 3.},
+                          [&](calculator::Calculator_DoBinaryOpBatch_Result r) {
+                            callbackCalled = true;
+                            result = std::move(r);
+                          });
+  RunLoopUntilIdle();
+
+  EXPECT_TRUE(callbackCalled);
+  ASSERT_TRUE(result.is_response());
+  const std::vector<double>& results = result.response().results;
+  const std::vector<calculator::ElementStatus>& status = result.response().status;
+  ASSERT_EQ(3u, results.size());
+  ASSERT_EQ(3u, status.size());
+  EXPECT_DOUBLE_EQ(1.4, results[0]);
+  EXPECT_EQ(calculator::ElementStatus::OK, status[0]);
+  EXPECT_EQ(calculator::ElementStatus::DIVISION_BY_ZERO, status[1]);
+  EXPECT_DOUBLE_EQ(3., results[2]);
+  EXPECT_EQ(calculator::ElementStatus::OK, status[2]);
+}
+
+TEST_F(EngineDeviceUnitTest, BatchLengthMismatch) {
+  calculator::CalculatorPtr engine = mathEngine();
+
+  bool callbackCalled = false;
+  calculator::Calculator_DoBinaryOpBatch_Result result;
+  engine->DoBinaryOpBatch(calculator::BinaryOp::ADDITION, {1., 2.}, {1.},
+                          [&](calculator::Calculator_DoBinaryOpBatch_Result r) {
+                            callbackCalled = true;
+                            result = std::move(r);
+                          });
+  RunLoopUntilIdle();
+
+  EXPECT_TRUE(callbackCalled);
+  ASSERT_TRUE(result.is_err());
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, result.err());
+}
+
+TEST_F(EngineDeviceUnitTest, AdditionBuffer) {
+  calculator::CalculatorPtr engine = mathEngine();
+
+  const uint64_t kCount = 1000;
+  const size_t kSize = kCount * (2 * sizeof(double) + 1);
+  std::vector<double> operands(2 * kCount);
+  for (uint64_t i = 0; i < kCount; i++) {
+    operands[i] = static_cast<double>(i);
+    operands[kCount + i] = 0.5;
+  }
+  fuchsia::mem::Buffer buffer;
+  ASSERT_EQ(ZX_OK, zx::vmo::create(kSize, 0, &buffer.vmo));
+  ASSERT_EQ(ZX_OK, buffer.vmo.write(operands.data(), 0, operands.size() * sizeof(double)));
+  buffer.size = kSize;
+
+  bool callbackCalled = false;
+  calculator::Calculator_DoBinaryOpBuffer_Result result;
+  engine->DoBinaryOpBuffer(calculator::BinaryOp::ADDITION, kCount, std::move(buffer),
+                           [&](calculator::Calculator_DoBinaryOpBuffer_Result r) {
+                             callbackCalled = true;
+                             result = std::move(r);
+                           });
+  RunLoopUntilIdle();
+
+  EXPECT_TRUE(callbackCalled);
+  ASSERT_TRUE(result.is_response());
+  std::vector<double> results(kCount);
+  std::vector<uint8_t> status(kCount, 0xff);
+  const zx::vmo& vmo = result.response().response.vmo;
+  ASSERT_EQ(ZX_OK, vmo.read(results.data(), 0, kCount * sizeof(double)));
+  ASSERT_EQ(ZX_OK, vmo.read(status.data(), 2 * kCount * sizeof(double), kCount));
+  for (uint64_t i = 0; i < kCount; i++) {
+    EXPECT_DOUBLE_EQ(static_cast<double>(i) + 0.5, results[i]);
+    EXPECT_EQ(0u, status[i]);
+  }
+}
+
+TEST_F(EngineDeviceUnitTest, CompiledExpression) {
+  calculator::CalculatorPtr engine = mathEngine();
+
+  calculator::ExpressionPtr expression;
+  bool compiled = false;
+  calculator::CompileResult compile_result;
+  engine->CompileExpression("(a + b) * c / d", expression.NewRequest(),
+                            [&](calculator::CompileResult r) {
+                              compiled = true;
+                              compile_result = std::move(r);
+                            });
+
+  // Evaluations may be pipelined behind the compilation.
+  std::vector<calculator::Result> results;
+  expression->Evaluate({1., 2., 3., 4.},
+                       [&](calculator::Result r) { results.push_back(std::move(r)); });
+  expression->Evaluate({3.5, 2.5, 2., .5},
+                       [&](calculator::Result r) { results.push_back(std::move(r)); });
+  expression->Evaluate({1.}, [&](calculator::Result r) { results.push_back(std::move(r)); });
+  RunLoopUntilIdle();
+
+  EXPECT_TRUE(compiled);
+  ASSERT_TRUE(compile_result.is_expression());
+  EXPECT_EQ(std::vector<std::string>({"a", "b", "c", "d"}),
+            compile_result.expression().variables);
+  ASSERT_EQ(3u, results.size());
+  ASSERT_TRUE(results[0].is_number());
+  EXPECT_DOUBLE_EQ(2.25, results[0].number());
+  ASSERT_TRUE(results[1].is_number());
+  EXPECT_DOUBLE_EQ(24., results[1].number());
+  EXPECT_TRUE(results[2].is_error());
+}
+
+TEST_F(EngineDeviceUnitTest, InvalidExpression) {
+  calculator::CalculatorPtr engine = mathEngine();
+
+  calculator::ExpressionPtr expression;
+  bool closed = false;
+  expression.set_error_handler([&](zx_status_t) { closed = true; });
+  bool compiled = false;
+  calculator::CompileResult compile_result;
+  engine->CompileExpression("(a + ", expression.NewRequest(), [&](calculator::CompileResult r) {
+    compiled = true;
+    compile_result = std::move(r);
+  });
+  RunLoopUntilIdle();
+
+  EXPECT_TRUE(compiled);
+  EXPECT_TRUE(compile_result.is_error());
+  EXPECT_TRUE(closed);
+}
+
+// Each answered request is counted and timed under its method's node.
+TEST_F(EngineDeviceUnitTest, Metrics) {
+  calculator::CalculatorPtr engine = mathEngine();
+
+  int replies = 0;
+  engine->DoBinaryOp(calculator::BinaryOp::ADDITION, 1., 2.,
+                     [&](calculator::Result) { replies++; });
+  engine->DoBinaryOp(calculator::BinaryOp::DIVISION, 1., 2.,
+                     [&](calculator::Result) { replies++; });
+  calculator::ExpressionPtr expression;
+  engine->CompileExpression("(a + ", expression.NewRequest(),
+                            [&](calculator::CompileResult) { replies++; });
+  RunLoopUntilIdle();
+  ASSERT_EQ(3, replies);
+
+  inspect::Hierarchy hierarchy = ReadMetrics();
+  auto in_flight = hierarchy.node().get_property<inspect::UintPropertyValue>("in_flight");
+  ASSERT_TRUE(in_flight);
+  EXPECT_EQ(0u, in_flight->value());
+
+  const inspect::Hierarchy* binary_op = hierarchy.GetByPath({"DoBinaryOp"});
+  ASSERT_TRUE(binary_op);
+  auto requests = binary_op->node().get_property<inspect::UintPropertyValue>("requests");
+  auto errors = binary_op->node().get_property<inspect::UintPropertyValue>("errors");
+  auto latency = binary_op->node().get_property<inspect::UintArrayValue>("latency_ns");
+  ASSERT_TRUE(requests && errors && latency);
+  EXPECT_EQ(2u, requests->value());
+  EXPECT_EQ(0u, errors->value());
+  uint64_t timed = 0;
+  for (const auto& bucket : latency->GetBuckets()) {
+    timed += bucket.count;
+  }
+  EXPECT_EQ(2u, timed);
+
+  const inspect::Hierarchy* compile = hierarchy.GetByPath({"CompileExpression"});
+  ASSERT_TRUE(compile);
+  errors = compile->node().get_property<inspect::UintPropertyValue>("errors");
+  ASSERT_TRUE(errors);
+  EXPECT_EQ(1u, errors->value());
+
+  const inspect::Hierarchy* unary_op = hierarchy.GetByPath({"DoUnaryOp"});
+  ASSERT_TRUE(unary_op);
+  requests = unary_op->node().get_property<inspect::UintPropertyValue>("requests");
+  ASSERT_TRUE(requests);
+  EXPECT_EQ(0u, requests->value());
+}
+
 }  // namespace calculator_engine
@@ -4,9 +4,14 @@
 
 /// Test cases for the math engine that run on the development host.
 
+#include <cmath>
+#include <limits>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "src/calculator/engine/engine.h"
+#include "src/calculator/engine/solver.h"
 
 namespace calculator_engine {
 
@@ -41,4 +46,143 @@ TEST_F(EngineHostUnitTest, Divide) {
   EXPECT_DOUBLE_EQ(1.4, result);
 }
 
+TEST_F(EngineHostUnitTest, EveryModeAgrees) {
+  const SolverMode kModes[] = {SolverMode::kFixedIterations, SolverMode::kNewton,
+                               SolverMode::kSecant, SolverMode::kClosedForm};
+  for (SolverMode mode : kModes) {
+    SolverOptions options;
+    options.mode = mode;
+    EXPECT_DOUBLE_EQ(-3.5, negate(3.5, options).root);
+    EXPECT_DOUBLE_EQ(6., add(3.5, 2.5, options).root);
+    EXPECT_DOUBLE_EQ(1., subtract(3.5, 2.5, options).root);
+    EXPECT_DOUBLE_EQ(8.75, multiply(3.5, 2.5, options).root);
+    EXPECT_DOUBLE_EQ(1.4, divide(3.5, 2.5, options).root);
+  }
+}
+
+TEST_F(EngineHostUnitTest, IterationsReported) {
+  SolverOptions options;
+  options.mode = SolverMode::kClosedForm;
+  SolverResult result = multiply(3.5, 2.5, options);
+  EXPECT_TRUE(result.converged);
+  EXPECT_EQ(1, result.iterations);
+
+  // The operations are linear, so Newton lands on the root in one step and
+  // confirms it with the next.
+  options.mode = SolverMode::kNewton;
+  result = multiply(3.5, 2.5, options);
+  EXPECT_TRUE(result.converged);
+  EXPECT_LE(result.iterations, 2);
+
+  options.mode = SolverMode::kFixedIterations;
+  EXPECT_EQ(ITERATION_COUNT, multiply(3.5, 2.5, options).iterations);
+}
+
+// The solvers are generic: square root of 2 as the positive root of x^2 - 2.
+TEST_F(EngineHostUnitTest, NonlinearRoot) {
+  auto problem = MakeRootProblem([](double x) { return x * x - 2; },
+                                 [](double x) { return 2 * x; },
+                                 /*constant_derivative=*/false, /*initial_guess=*/1);
+  for (SolverMode mode : {SolverMode::kNewton, SolverMode::kSecant, SolverMode::kClosedForm}) {
+    SolverOptions options;
+    options.mode = mode;
+    SolverResult result = Solve(problem, options);
+    EXPECT_TRUE(result.converged);
+    EXPECT_DOUBLE_EQ(std::sqrt(2.), result.root);
+    EXPECT_LT(result.iterations, 10);
+  }
+}
+
+// Without a root, the adaptive modes stop at the iteration cap.
+TEST_F(EngineHostUnitTest, IterationCap) {
+  auto problem = MakeRootProblem([](double x) { return x * x + 1; },
+                                 [](double x) { return 2 * x; },
+                                 /*constant_derivative=*/false, /*initial_guess=*/0.5);
+  SolverOptions options;
+  options.mode = SolverMode::kNewton;
+  options.max_iterations = 20;
+  SolverResult result = Solve(problem, options);
+  EXPECT_FALSE(result.converged);
+  EXPECT_EQ(20, result.iterations);
+}
+
+const BinaryOperation kBinaryOperations[] = {BinaryOperation::kAdd, BinaryOperation::kSubtract,
+                                             BinaryOperation::kMultiply,
+                                             BinaryOperation::kDivide};
+
+// The batch answers match the scalar functions, for every length around the
+// vector block size.
+TEST_F(EngineHostUnitTest, BatchMatchesScalar) {
+  double (*const kScalar[])(double, double) = {add, subtract, multiply, divide};
+  for (size_t count = 0; count < 40; count++) {
+    std::vector<double> a(count), b(count);
+    for (size_t i = 0; i < count; i++) {
+      a[i] = 1.5 * static_cast<double>(i) - 7;
+      b[i] = 0.25 * static_cast<double>(i) + 0.5;
+    }
+    for (int op = 0; op < 4; op++) {
+      std::vector<double> results(count, -1);
+      std::vector<uint8_t> status(count, 0xff);
+      BinaryOpBatch(kBinaryOperations[op], a.data(), b.data(), count, results.data(),
+                    status.data());
+      for (size_t i = 0; i < count; i++) {
+        EXPECT_DOUBLE_EQ(kScalar[op](a[i], b[i]), results[i]) << "op " << op << " at " << i;
+        EXPECT_EQ(kElementOk, status[i]) << "op " << op << " at " << i;
+      }
+    }
+  }
+}
+
+// Each special element is reported wherever it falls in a batch, without
+// disturbing its neighbors.
+TEST_F(EngineHostUnitTest, BatchElementStatus) {
+  const double kInf = std::numeric_limits<double>::infinity();
+  const double kNaN = std::numeric_limits<double>::quiet_NaN();
+  const double kMax = std::numeric_limits<double>::max();
+  struct Case {
+    BinaryOperation operation;
+    double a;
+    double b;
+    uint8_t status;
+  } const kCases[] = {
+      {BinaryOperation::kDivide, 1, 0, kElementDivisionByZero},
+      {BinaryOperation::kDivide, 0, 0, kElementDivisionByZero},
+      {BinaryOperation::kDivide, kInf, 2, kElementOk},
+      {BinaryOperation::kAdd, kNaN, 1, kElementInvalid},
+      {BinaryOperation::kSubtract, kInf, kInf, kElementInvalid},
+      {BinaryOperation::kMultiply, kMax, 2, kElementOverflow},
+      {BinaryOperation::kAdd, kMax, kMax, kElementOverflow},
+      {BinaryOperation::kAdd, kInf, 1, kElementOk},
+  };
+  const size_t kCount = 19;
+  for (const Case& c : kCases) {
+    for (size_t position = 0; position < kCount; position++) {
+      std::vector<double> a(kCount, 3.5), b(kCount, 2.5);
+      a[position] = c.a;
+      b[position] = c.b;
+      std::vector<double> results(kCount);
+      std::vector<uint8_t> status(kCount), scalar_status(kCount);
+      BinaryOpBatch(c.operation, a.data(), b.data(), kCount, results.data(), status.data());
+      BinaryOpBatchScalar(c.operation, a.data(), b.data(), kCount, results.data(),
+                          scalar_status.data());
+      for (size_t i = 0; i < kCount; i++) {
+        uint8_t expected = i == position ? c.status : uint8_t{kElementOk};
+        EXPECT_EQ(expected, status[i]) << "at " << i;
+      }
+      EXPECT_EQ(scalar_status, status);
+    }
+  }
+}
+
+// Results may overwrite an operand array.
+TEST_F(EngineHostUnitTest, BatchInPlace) {
+  std::vector<double> a = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+  std::vector<double> b(a.size(), 4);
+  std::vector<uint8_t> status(a.size());
+  BinaryOpBatch(BinaryOperation::kDivide, a.data(), b.data(), a.size(), a.data(), status.data());
+  for (size_t i = 0; i < a.size(); i++) {
+    EXPECT_DOUBLE_EQ(static_cast<double>(i + 1) / 4, a[i]);
+  }
+}
+
 }  // namespace calculator_engine
@@ -0,0 +1,98 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Host benchmark for the expression compiler. For each formula, reports the
+/// time to compile it, to fetch it from a warm ProgramCache, and to evaluate
+/// it, alongside the instruction count after constant folding.
+///
+/// Usage: expression_benchmarks [--min-time-ms N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "src/calculator/engine/expression.h"
+
+namespace calculator_engine {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* const kFormulas[] = {
+    "a + b",
+    "(a + b) * c / d",
+    "(x - 32) * 5 / 9",
+    "p * (1 + r / 12) * (1 + r / 12) * (1 + r / 12) - p",
+    "(1 + 2 * 3 - 4 / 5) * x + (6 - 7) * (8 + 9) / (10 * 11)",
+};
+
+// Calls |body| repeatedly for at least |min_time| and returns the mean time
+// per call in nanoseconds.
+template <typename Body>
+double MeasureNsPerCall(std::chrono::nanoseconds min_time, Body body) {
+  size_t calls = 0;
+  Clock::time_point start = Clock::now();
+  std::chrono::nanoseconds elapsed(0);
+  while (elapsed < min_time) {
+    body(calls);
+    calls++;
+    elapsed = Clock::now() - start;
+  }
+  return static_cast<double>(elapsed.count()) / static_cast<double>(calls);
+}
+
+}  // namespace
+}  // namespace calculator_engine
+
+int main(int argc, const char** argv) {
+  using namespace calculator_engine;
+
+  long min_time_ms = 200;
+  for (int i = 1; i < argc - 1; ++i) {
+    if (!strcmp("--min-time-ms", argv[i])) {
+      min_time_ms = strtol(argv[++i], nullptr, 10);
+    }
+  }
+  std::chrono::nanoseconds min_time = std::chrono::milliseconds(min_time_ms);
+
+  printf("%-6s %12s %12s %12s  %s\n", "instrs", "compile ns", "cached ns", "evaluate ns",
+         "formula");
+  for (const char* formula : kFormulas) {
+    const std::string text = formula;
+    std::string error;
+    Program program;
+    if (!Compile(text, &program, &error)) {
+      fprintf(stderr, "%s: %s\n", formula, error.c_str());
+      return 1;
+    }
+
+    double compile_ns = MeasureNsPerCall(min_time, [&](size_t) {
+      Program compiled;
+      Compile(text, &compiled, &error);
+    });
+
+    ProgramCache cache(16);
+    cache.Compile(text, &error);
+    double cached_ns = MeasureNsPerCall(min_time, [&](size_t) { cache.Compile(text, &error); });
+
+    std::vector<double> values(program.variables().size());
+    // Accumulate into a volatile so the evaluations cannot be optimized away.
+    volatile double sink = 0;
+    double evaluate_ns = MeasureNsPerCall(min_time, [&](size_t call) {
+      for (size_t i = 0; i < values.size(); i++) {
+        values[i] = static_cast<double>((call + i) % 64) + 0.5;
+      }
+      sink = sink + program.Evaluate(values.data(), values.size());
+    });
+
+    printf("%-6zu %12.1f %12.1f %12.1f  %s\n", program.code().size(), compile_ns, cached_ns,
+           evaluate_ns, formula);
+    fflush(stdout);
+  }
+  return 0;
+}
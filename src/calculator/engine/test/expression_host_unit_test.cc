@@ -0,0 +1,157 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Test cases for the expression compiler that run on the development host.
+
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "src/calculator/engine/expression.h"
+
+namespace calculator_engine {
+namespace {
+
+double EvaluateText(const std::string& text, const std::vector<double>& values = {}) {
+  Program program;
+  std::string error;
+  EXPECT_TRUE(Compile(text, &program, &error)) << text << ": " << error;
+  return program.Evaluate(values.data(), values.size());
+}
+
+TEST(ExpressionTest, Precedence) {
+  EXPECT_DOUBLE_EQ(7., EvaluateText("1 + 2 * 3"));
+  EXPECT_DOUBLE_EQ(9., EvaluateText("(1 + 2) * 3"));
+  EXPECT_DOUBLE_EQ(2., EvaluateText("8 / 2 / 2"));
+  EXPECT_DOUBLE_EQ(-4., EvaluateText("1 - 2 - 3"));
+  EXPECT_DOUBLE_EQ(-6., EvaluateText("-2 * 3"));
+  EXPECT_DOUBLE_EQ(2., EvaluateText("--2"));
+  EXPECT_DOUBLE_EQ(0.125, EvaluateText(".5 * 2.5e-1"));
+}
+
+TEST(ExpressionTest, Variables) {
+  Program program;
+  std::string error;
+  ASSERT_TRUE(Compile("(a + b) * c / d - a", &program, &error)) << error;
+  ASSERT_EQ(4u, program.variables().size());
+  EXPECT_EQ("a", program.variables()[0]);
+  EXPECT_EQ("b", program.variables()[1]);
+  EXPECT_EQ("c", program.variables()[2]);
+  EXPECT_EQ("d", program.variables()[3]);
+
+  const double values[] = {1, 2, 3, 4};
+  EXPECT_DOUBLE_EQ(1.25, program.Evaluate(values, 4));
+  const double more_values[] = {3.5, 2.5, 2, 0.5};
+  EXPECT_DOUBLE_EQ(20.5, program.Evaluate(more_values, 4));
+
+  // A mismatched binding count is NaN rather than a read out of bounds.
+  EXPECT_TRUE(std::isnan(program.Evaluate(values, 3)));
+}
+
+// Variable-free subexpressions compile to a single constant.
+TEST(ExpressionTest, ConstantFolding) {
+  Program program;
+  std::string error;
+  ASSERT_TRUE(Compile("x * (2 + 3 * -(4 - 1)) / 7", &program, &error)) << error;
+  // x, the folded constant, *, 7, /
+  ASSERT_EQ(5u, program.code().size());
+  EXPECT_EQ(Program::Opcode::kVariable, program.code()[0].opcode);
+  EXPECT_EQ(Program::Opcode::kConstant, program.code()[1].opcode);
+  EXPECT_EQ(2u, program.constants().size());
+  EXPECT_DOUBLE_EQ(-7., program.constants()[0]);
+  const double x = 3;
+  EXPECT_DOUBLE_EQ(-3., program.Evaluate(&x, 1));
+
+  ASSERT_TRUE(Compile("(1 + 2) * (3 + 4)", &program, &error)) << error;
+  EXPECT_EQ(1u, program.code().size());
+  EXPECT_DOUBLE_EQ(21., program.Evaluate(nullptr, 0));
+}
+
+TEST(ExpressionTest, Errors) {
+  const char* const kInvalid[] = {
+      "", "1 +", "(1", "1)", "* 2", "1 2", "a $ b", "()",
+  };
+  for (const char* text : kInvalid) {
+    Program program;
+    std::string error;
+    EXPECT_FALSE(Compile(text, &program, &error)) << text;
+    EXPECT_NE(std::string::npos, error.find("offset")) << text << ": " << error;
+  }
+}
+
+TEST(ExpressionTest, Limits) {
+  Program program;
+  std::string error;
+
+  // Deep nesting is refused rather than overflowing the parser's stack.
+  std::string deep = std::string(1000, '(') + "1" + std::string(1000, ')');
+  EXPECT_FALSE(Compile(deep, &program, &error));
+  EXPECT_FALSE(Compile(std::string(kMaxExpressionLength, '-') + "1", &program, &error));
+
+  // Right-nested operators need a deep evaluation stack.
+  std::string wide = "a";
+  for (size_t i = 0; i < kMaxStackDepth; i++) {
+    wide = "a + (a * " + wide + ")";
+  }
+  EXPECT_FALSE(Compile(wide, &program, &error));
+
+  std::string many;
+  for (size_t i = 0; i <= kMaxVariables; i++) {
+    many += (i ? " + v" : "v") + std::to_string(i);
+  }
+  EXPECT_FALSE(Compile(many, &program, &error));
+}
+
+TEST(ExpressionTest, CacheReusesPrograms) {
+  ProgramCache cache(2);
+  std::string error;
+  auto first = cache.Compile("a + 1", &error);
+  ASSERT_TRUE(first);
+  EXPECT_EQ(first, cache.Compile("a + 1", &error));
+  EXPECT_EQ(1u, cache.hits());
+  EXPECT_EQ(1u, cache.misses());
+
+  // Failures are reported but not cached.
+  EXPECT_FALSE(cache.Compile("a +", &error));
+  EXPECT_EQ(1u, cache.size());
+
+  // The least recently used entry is evicted.
+  ASSERT_TRUE(cache.Compile("b + 1", &error));
+  ASSERT_TRUE(cache.Compile("a + 1", &error));
+  ASSERT_TRUE(cache.Compile("c + 1", &error));
+  EXPECT_EQ(2u, cache.size());
+  uint64_t misses = cache.misses();
+  ASSERT_TRUE(cache.Compile("a + 1", &error));
+  EXPECT_EQ(misses, cache.misses());
+  ASSERT_TRUE(cache.Compile("b + 1", &error));
+  EXPECT_EQ(misses + 1, cache.misses());
+}
+
+TEST(ExpressionTest, CacheIsThreadSafe) {
+  ProgramCache cache(8);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&cache, t]() {
+      for (int i = 0; i < 1000; i++) {
+        std::string error;
+        std::string text = "x * " + std::to_string((i + t) % 16);
+        auto program = cache.Compile(text, &error);
+        ASSERT_TRUE(program);
+        const double x = 2;
+        EXPECT_DOUBLE_EQ(2. * ((i + t) % 16), program->Evaluate(&x, 1));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(4000u, cache.hits() + cache.misses());
+  EXPECT_LE(cache.size(), 8u);
+}
+
+}  // namespace
+}  // namespace calculator_engine
@@ -0,0 +1,133 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Host benchmark for the solver result cache. Reports the memory taken by
+/// each entry, the time per hit, miss and insertion, and the time per solve
+/// the cache saves, with one thread and with several sharing the cache.
+///
+/// Usage: result_cache_benchmarks [--entries N] [--threads N] [--min-time-ms N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "src/calculator/engine/engine.h"
+#include "src/calculator/engine/result_cache.h"
+
+namespace calculator_engine {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Calls |body| repeatedly for at least |min_time| and returns the mean time
+// per call in nanoseconds.
+template <typename Body>
+double MeasureNsPerCall(std::chrono::nanoseconds min_time, Body body) {
+  size_t calls = 0;
+  Clock::time_point start = Clock::now();
+  std::chrono::nanoseconds elapsed(0);
+  while (elapsed < min_time) {
+    body(calls);
+    calls++;
+    elapsed = Clock::now() - start;
+  }
+  return static_cast<double>(elapsed.count()) / static_cast<double>(calls);
+}
+
+}  // namespace
+}  // namespace calculator_engine
+
+int main(int argc, const char** argv) {
+  using namespace calculator_engine;
+
+  size_t entries = 4096;
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  long min_time_ms = 200;
+  for (int i = 1; i < argc - 1; ++i) {
+    if (!strcmp("--entries", argv[i])) {
+      entries = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (!strcmp("--threads", argv[i])) {
+      threads = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (!strcmp("--min-time-ms", argv[i])) {
+      min_time_ms = strtol(argv[++i], nullptr, 10);
+    }
+  }
+  std::chrono::nanoseconds min_time = std::chrono::milliseconds(min_time_ms);
+
+  ResultCache cache(entries);
+  printf("capacity %zu entries, %zu bytes each\n", cache.capacity(), ResultCache::entry_size());
+
+  SolverOptions options;
+  options.mode = SolverMode::kFixedIterations;
+  // Fill half the cache, so lookups of the other half miss.
+  const size_t keys = cache.capacity() / 2;
+  for (size_t i = 0; i < keys; i++) {
+    double a = static_cast<double>(i);
+    cache.Insert(BinaryOperation::kDivide, a, 2.5, options, divide(a, 2.5, options));
+  }
+
+  volatile double sink = 0;
+  SolverResult result;
+  double hit_ns = MeasureNsPerCall(min_time, [&](size_t call) {
+    cache.Lookup(BinaryOperation::kDivide, static_cast<double>(call % keys), 2.5, options,
+                 &result);
+    sink = sink + result.root;
+  });
+  double miss_ns = MeasureNsPerCall(min_time, [&](size_t call) {
+    cache.Lookup(BinaryOperation::kDivide, static_cast<double>(keys + call % keys), 2.5, options,
+                 &result);
+  });
+  // Replaces entries once the cache is full, so this includes evictions.
+  double insert_ns = MeasureNsPerCall(min_time, [&](size_t call) {
+    cache.Insert(BinaryOperation::kMultiply, static_cast<double>(call), 2.5, options, result);
+  });
+  double solve_ns = MeasureNsPerCall(min_time, [&](size_t call) {
+    sink = sink + divide(static_cast<double>(call % keys), 2.5, options).root;
+  });
+
+  printf("%-28s %12s\n", "", "ns/call");
+  printf("%-28s %12.1f\n", "hit", hit_ns);
+  printf("%-28s %12.1f\n", "miss", miss_ns);
+  printf("%-28s %12.1f\n", "insert", insert_ns);
+  printf("%-28s %12.1f\n", "solve (fixed iterations)", solve_ns);
+
+  // Every thread hits keys spread over all the shards.
+  for (size_t i = 0; i < keys; i++) {
+    double a = static_cast<double>(i);
+    cache.Insert(BinaryOperation::kDivide, a, 2.5, options, divide(a, 2.5, options));
+  }
+  std::atomic<uint64_t> lookups{0};
+  std::vector<std::thread> workers;
+  Clock::time_point deadline = Clock::now() + min_time;
+  for (size_t t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      SolverResult found;
+      uint64_t count = 0;
+      for (size_t call = t; Clock::now() < deadline; call += 7) {
+        cache.Lookup(BinaryOperation::kDivide, static_cast<double>(call % keys), 2.5, options,
+                     &found);
+        count++;
+      }
+      lookups += count;
+    });
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  double seconds = std::chrono::duration<double>(min_time).count();
+  printf("%zu threads: %.1f M lookups/s\n", threads,
+         static_cast<double>(lookups.load()) / seconds / 1e6);
+  ResultCache::Stats stats = cache.stats();
+  printf("hits %llu, misses %llu, evictions %llu, size %zu\n",
+         static_cast<unsigned long long>(stats.hits),
+         static_cast<unsigned long long>(stats.misses),
+         static_cast<unsigned long long>(stats.evictions), stats.size);
+  return 0;
+}
@@ -0,0 +1,112 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Test cases for the solver result cache that run on the development host.
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "src/calculator/engine/result_cache.h"
+
+namespace calculator_engine {
+namespace {
+
+SolverResult MakeResult(double root, int iterations) {
+  SolverResult result;
+  result.root = root;
+  result.iterations = iterations;
+  result.converged = true;
+  return result;
+}
+
+TEST(ResultCacheTest, HitReturnsStoredResult) {
+  ResultCache cache(64);
+  SolverOptions options;
+  SolverResult result;
+  EXPECT_FALSE(cache.Lookup(BinaryOperation::kDivide, 3.5, 2.5, options, &result));
+  cache.Insert(BinaryOperation::kDivide, 3.5, 2.5, options, MakeResult(1.4, 7));
+  ASSERT_TRUE(cache.Lookup(BinaryOperation::kDivide, 3.5, 2.5, options, &result));
+  EXPECT_EQ(1.4, result.root);
+  EXPECT_EQ(7, result.iterations);
+  EXPECT_TRUE(result.converged);
+
+  ResultCache::Stats stats = cache.stats();
+  EXPECT_EQ(1u, stats.hits);
+  EXPECT_EQ(1u, stats.misses);
+  EXPECT_EQ(1u, stats.size);
+}
+
+// Every part of the key must match.
+TEST(ResultCacheTest, KeysAreExact) {
+  ResultCache cache(64);
+  SolverOptions options;
+  cache.Insert(BinaryOperation::kAdd, 0., 1., options, MakeResult(1., 1));
+
+  SolverResult result;
+  EXPECT_FALSE(cache.Lookup(BinaryOperation::kSubtract, 0., 1., options, &result));
+  EXPECT_FALSE(cache.Lookup(BinaryOperation::kAdd, -0., 1., options, &result));
+  EXPECT_FALSE(cache.Lookup(BinaryOperation::kAdd, 1., 0., options, &result));
+  SolverOptions other = options;
+  other.mode = SolverMode::kSecant;
+  EXPECT_FALSE(cache.Lookup(BinaryOperation::kAdd, 0., 1., other, &result));
+  other = options;
+  other.tolerance = 1e-3;
+  EXPECT_FALSE(cache.Lookup(BinaryOperation::kAdd, 0., 1., other, &result));
+  other = options;
+  other.max_iterations = 5;
+  EXPECT_FALSE(cache.Lookup(BinaryOperation::kAdd, 0., 1., other, &result));
+  EXPECT_TRUE(cache.Lookup(BinaryOperation::kAdd, 0., 1., options, &result));
+}
+
+// Once full, the cache evicts, and entries that are being hit survive.
+TEST(ResultCacheTest, EvictsUnreferencedEntries) {
+  ResultCache cache(128);
+  const size_t capacity = cache.capacity();
+  SolverOptions options;
+  SolverResult result;
+  cache.Insert(BinaryOperation::kMultiply, -1., -1., options, MakeResult(1., 1));
+  for (size_t i = 0; i < 8 * capacity; i++) {
+    ASSERT_TRUE(cache.Lookup(BinaryOperation::kMultiply, -1., -1., options, &result)) << i;
+    double a = static_cast<double>(i);
+    cache.Insert(BinaryOperation::kMultiply, a, 2., options, MakeResult(2 * a, 1));
+  }
+
+  ResultCache::Stats stats = cache.stats();
+  EXPECT_GT(stats.evictions, 0u);
+  EXPECT_LE(stats.size, capacity);
+}
+
+TEST(ResultCacheTest, ConcurrentUse) {
+  ResultCache cache(1024);
+  SolverOptions options;
+  std::atomic<int> wrong{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&cache, &options, &wrong] {
+      for (int i = 0; i < 20000; i++) {
+        double a = static_cast<double>(i % 3000);
+        SolverResult result;
+        if (cache.Lookup(BinaryOperation::kAdd, a, 1., options, &result)) {
+          if (result.root != a + 1) {
+            wrong++;
+          }
+        } else {
+          cache.Insert(BinaryOperation::kAdd, a, 1., options, MakeResult(a + 1, 1));
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, wrong.load());
+  ResultCache::Stats stats = cache.stats();
+  EXPECT_EQ(80000u, stats.hits + stats.misses);
+}
+
+}  // namespace
+}  // namespace calculator_engine
@@ -0,0 +1,103 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Host benchmark comparing the solver modes. For each operation, reports the
+/// time per call and the iterations used in every mode, and the speedup of
+/// each adaptive mode over the fixed-iteration baseline.
+///
+/// Usage: solver_benchmarks [--min-time-ms N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "src/calculator/engine/engine.h"
+
+namespace calculator_engine {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Operation {
+  const char* name;
+  SolverResult (*run)(double a, double b, const SolverOptions& options);
+};
+
+SolverResult RunNegate(double a, double, const SolverOptions& options) {
+  return negate(a, options);
+}
+
+const Operation kOperations[] = {
+    {"negate", RunNegate}, {"add", add}, {"subtract", subtract},
+    {"multiply", multiply}, {"divide", divide},
+};
+
+struct Mode {
+  const char* name;
+  SolverMode mode;
+};
+
+const Mode kModes[] = {
+    {"fixed", SolverMode::kFixedIterations},
+    {"newton", SolverMode::kNewton},
+    {"secant", SolverMode::kSecant},
+    {"closed-form", SolverMode::kClosedForm},
+};
+
+// Calls |operation| with varying operands for at least |min_time| and returns
+// the mean time per call in nanoseconds. |iterations| receives the iterations
+// reported by the last call.
+double MeasureNsPerCall(const Operation& operation, const SolverOptions& options,
+                        std::chrono::nanoseconds min_time, int* iterations) {
+  // Accumulate into a volatile so the calls cannot be optimized away.
+  volatile double sink = 0;
+  size_t calls = 0;
+  Clock::time_point start = Clock::now();
+  std::chrono::nanoseconds elapsed(0);
+  while (elapsed < min_time) {
+    double a = 3.5 + static_cast<double>(calls % 64);
+    SolverResult result = operation.run(a, 2.5, options);
+    sink = sink + result.root;
+    *iterations = result.iterations;
+    calls++;
+    elapsed = Clock::now() - start;
+  }
+  return static_cast<double>(elapsed.count()) / static_cast<double>(calls);
+}
+
+}  // namespace
+}  // namespace calculator_engine
+
+int main(int argc, const char** argv) {
+  using namespace calculator_engine;
+
+  long min_time_ms = 200;
+  for (int i = 1; i < argc - 1; ++i) {
+    if (!strcmp("--min-time-ms", argv[i])) {
+      min_time_ms = strtol(argv[++i], nullptr, 10);
+    }
+  }
+  std::chrono::nanoseconds min_time = std::chrono::milliseconds(min_time_ms);
+
+  printf("%-10s %-12s %14s %12s %10s\n", "operation", "mode", "ns/call", "iterations",
+         "speedup");
+  for (const Operation& operation : kOperations) {
+    double baseline = 0;
+    for (const Mode& mode : kModes) {
+      SolverOptions options;
+      options.mode = mode.mode;
+      int iterations = 0;
+      double ns = MeasureNsPerCall(operation, options, min_time, &iterations);
+      if (mode.mode == SolverMode::kFixedIterations) {
+        baseline = ns;
+      }
+      printf("%-10s %-12s %14.1f %12d %9.0fx\n", operation.name, mode.name, ns, iterations,
+             baseline / ns);
+      fflush(stdout);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,160 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Host benchmark for the storage behind thread-safe binding sets. Each thread
+/// stands in for a dispatcher serving short-lived connections: it keeps
+/// --live connections open and, for each new one it adds, removes its oldest.
+///
+/// "single-lock" is the layout of DeprecatedBrokenBindingSet: one vector under
+/// one mutex, with a linear search on removal. "sharded" is the
+/// ShardedSlotMap behind ThreadSafeBindingSet, with a shard per thread. If the
+/// sharded map scales, its throughput grows with the thread count.
+///
+/// Usage: binding_set_benchmarks [--max-threads N] [--live N] [--duration-ms N]
+
+#include <lib/fidl/cpp/internal/sharded_slot_map.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Stands in for a binding: a heap object owned by the set.
+struct Connection {
+  explicit Connection(uint64_t id) : id(id) {}
+  uint64_t id;
+};
+
+struct Options {
+  size_t max_threads = 64;
+  size_t live = 256;
+  long duration_ms = 500;
+};
+
+// One vector under one mutex.
+class SingleLockSet {
+ public:
+  using Handle = Connection*;
+
+  explicit SingleLockSet(size_t) {}
+
+  Handle Add(size_t, uint64_t id) {
+    auto connection = std::make_unique<Connection>(id);
+    Handle handle = connection.get();
+    std::lock_guard<std::mutex> guard(lock_);
+    connections_.push_back(std::move(connection));
+    return handle;
+  }
+
+  void Remove(Handle handle) {
+    std::unique_ptr<Connection> removed;
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = std::find_if(
+        connections_.begin(), connections_.end(),
+        [handle](const std::unique_ptr<Connection>& c) { return c.get() == handle; });
+    removed = std::move(*it);
+    connections_.erase(it);
+  }
+
+ private:
+  std::mutex lock_;
+  std::vector<std::unique_ptr<Connection>> connections_;
+};
+
+// A shard per thread.
+class ShardedSet {
+ public:
+  using Handle = fidl::internal::SlotKey;
+
+  explicit ShardedSet(size_t threads) : connections_(threads) {}
+
+  Handle Add(size_t thread, uint64_t id) {
+    return connections_.Insert(thread, std::make_unique<Connection>(id));
+  }
+
+  void Remove(Handle handle) {
+    std::unique_ptr<Connection> removed;
+    connections_.Remove(handle, &removed);
+  }
+
+ private:
+  fidl::internal::ShardedSlotMap<std::unique_ptr<Connection>> connections_;
+};
+
+// Runs |threads| threads adding and removing connections for the duration,
+// and returns the adds and removes per second.
+template <typename Set>
+double Measure(const Options& options, size_t threads) {
+  Set set(threads);
+  std::atomic<bool> start{false};
+  std::atomic<bool> stop{false};
+  std::vector<uint64_t> operations(threads);
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      std::vector<typename Set::Handle> live;
+      for (uint64_t id = 0; id < options.live; id++) {
+        live.push_back(set.Add(t, id));
+      }
+      while (!start.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      uint64_t count = 0;
+      size_t oldest = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        set.Remove(live[oldest]);
+        live[oldest] = set.Add(t, count);
+        oldest = (oldest + 1) % live.size();
+        count += 2;
+      }
+      operations[t] = count;
+      for (typename Set::Handle& handle : live) {
+        set.Remove(handle);
+      }
+    });
+  }
+  start.store(true, std::memory_order_release);
+  std::this_thread::sleep_for(std::chrono::milliseconds(options.duration_ms));
+  stop.store(true, std::memory_order_relaxed);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  uint64_t total = 0;
+  for (uint64_t count : operations) {
+    total += count;
+  }
+  return static_cast<double>(total) * 1000 / static_cast<double>(options.duration_ms);
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  Options options;
+  for (int i = 1; i < argc - 1; ++i) {
+    if (!strcmp("--max-threads", argv[i])) {
+      options.max_threads = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (!strcmp("--live", argv[i])) {
+      options.live = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (!strcmp("--duration-ms", argv[i])) {
+      options.duration_ms = std::max(1l, strtol(argv[++i], nullptr, 10));
+    }
+  }
+
+  printf("%8s %16s %16s\n", "threads", "single-lock op/s", "sharded op/s");
+  for (size_t threads = 1; threads <= options.max_threads; threads *= 2) {
+    double single_lock = Measure<SingleLockSet>(options, threads);
+    double sharded = Measure<ShardedSet>(options, threads);
+    printf("%8zu %16.0f %16.0f\n", threads, single_lock, sharded);
+    fflush(stdout);
+  }
+  return 0;
+}
@@ -0,0 +1,444 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Host benchmark for the FIDL wire format. For each payload, measures
+///
+///   validate    fidl_validate on the encoded bytes
+///   decode      fidl_decode, in place
+///   encode      fidl_encode, in place, of what decode produced
+///   cpp-encode  fidl::EncodeObject, from a C++ object to bytes
+///   cpp-decode  fidl::DecodeObject, from bytes to a C++ object
+///   round-trip  cpp-encode then cpp-decode
+///
+/// For the rot13 strings, it also measures a server echoing the string back
+/// rot13-encrypted: decoding the request, encrypting and encoding the reply,
+///
+///   echo-owning  through a std::string, as the generated stubs decode it
+///   echo-view    through a fidl::StringView into the request, copied once
+///                into the reply and encrypted there, as a fidl::ViewHandlers
+///                handler can
+///
+/// and reports the time and the heap allocations per operation, and the
+/// throughput in bytes of the encoded payload. The payloads are the messages
+/// of the calculator and rot13 examples, large byte vectors, and tables and
+/// flexible unions nested four deep; see fidl/benchmarks.fidl.
+///
+/// With --output, also writes the results to FILE as a JSON array of
+/// {"label", "test_suite", "unit", "values"} objects, one per operation and
+/// unit, for regression tracking.
+///
+/// Usage: coding_benchmarks [--min-time-ms N] [--output FILE]
+
+#include <fuchsia/examples/benchmarks/cpp/fidl.h>
+#include <lib/fidl/coding.h>
+#include <lib/fidl/cpp/comparison.h>
+#include <lib/fidl/cpp/decoder.h>
+#include <lib/fidl/cpp/encoder.h>
+#include <lib/fidl/cpp/object_coding.h>
+#include <lib/fidl/cpp/wire_view.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "coding_tables.h"
+#include "src/testing/allocation_counter.h"
+
+namespace {
+
+namespace benchmarks = fuchsia::examples::benchmarks;
+
+using Clock = std::chrono::steady_clock;
+
+const char kTestSuite[] = "fuchsia.examples.fidl_benchmarks";
+
+// The most copies of a payload one batch works on, and the most bytes.
+constexpr size_t kMaxBatch = 64;
+constexpr size_t kMaxBatchBytes = 4 << 20;
+
+struct Result {
+  std::string label;
+  size_t bytes;
+  double ns_per_op;
+  double allocations_per_op;
+};
+
+// Where the operations report to.
+class Report {
+ public:
+  explicit Report(std::chrono::nanoseconds min_time) : min_time_(min_time) {
+    printf("%-28s %9s %12s %12s %10s\n", "payload/operation", "bytes", "ns/op", "MB/s",
+           "allocs/op");
+  }
+
+  std::chrono::nanoseconds min_time() const { return min_time_; }
+
+  void Add(Result result) {
+    printf("%-28s %9zu %12.1f %12.1f %10.2f\n", result.label.c_str(), result.bytes,
+           result.ns_per_op, static_cast<double>(result.bytes) / result.ns_per_op * 1e3,
+           result.allocations_per_op);
+    fflush(stdout);
+    results_.push_back(std::move(result));
+  }
+
+  // Writes the results as JSON to |path|.
+  bool Write(const char* path) const {
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+      return false;
+    }
+    fprintf(file, "[");
+    const char* separator = "\n";
+    for (const Result& result : results_) {
+      double values[] = {
+          result.ns_per_op,
+          static_cast<double>(result.bytes) / result.ns_per_op * 1e9,
+          result.allocations_per_op,
+      };
+      const char* units[] = {"nanoseconds", "bytes/second", "count"};
+      const char* suffixes[] = {"", "/throughput", "/allocations"};
+      for (size_t i = 0; i < 3; i++) {
+        fprintf(file,
+                "%s  {\"label\": \"%s%s\", \"test_suite\": \"%s\", \"unit\": \"%s\", "
+                "\"values\": [%.3f]}",
+                separator, result.label.c_str(), suffixes[i], kTestSuite, units[i], values[i]);
+        separator = ",\n";
+      }
+    }
+    fprintf(file, "\n]\n");
+    return fclose(file) == 0;
+  }
+
+ private:
+  const std::chrono::nanoseconds min_time_;
+  std::vector<Result> results_;
+};
+
+void Check(zx_status_t status, const char* error, const std::string& label) {
+  if (status != ZX_OK) {
+    fprintf(stderr, "%s failed: %s\n", label.c_str(), error ? error : "?");
+    exit(1);
+  }
+}
+
+// Measures |body| for at least |min_time|, applied to each of |batch| copies
+// of a payload in turn. |setup| prepares the copies before each pass and is
+// not measured.
+template <typename Setup, typename Body>
+Result Measure(const std::string& label, size_t bytes, size_t batch,
+               std::chrono::nanoseconds min_time, Setup setup, Body body) {
+  size_t ops = 0;
+  size_t allocations = 0;
+  std::chrono::nanoseconds elapsed(0);
+  while (elapsed < min_time) {
+    setup();
+    size_t allocations_before = testing_support::AllocationCount();
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < batch; i++) {
+      const char* error = nullptr;
+      Check(body(i, &error), error, label);
+    }
+    elapsed += Clock::now() - start;
+    allocations += testing_support::AllocationCount() - allocations_before;
+    ops += batch;
+  }
+  return Result{label, bytes, static_cast<double>(elapsed.count()) / static_cast<double>(ops),
+                static_cast<double>(allocations) / static_cast<double>(ops)};
+}
+
+size_t BatchSize(size_t bytes) {
+  return std::max<size_t>(1, std::min(kMaxBatch, kMaxBatchBytes / bytes));
+}
+
+// Measures the C coding functions on |encoded|, as |type|.
+void RunCoding(const std::string& name, const fidl_type_t* type,
+               const std::vector<uint8_t>& encoded, Report* report) {
+  const uint32_t size = static_cast<uint32_t>(encoded.size());
+  const size_t batch = BatchSize(size);
+  std::vector<std::vector<uint8_t>> buffers(batch, encoded);
+  auto copy = [&] {
+    for (std::vector<uint8_t>& buffer : buffers) {
+      memcpy(buffer.data(), encoded.data(), size);
+    }
+  };
+
+  report->Add(Measure(
+      name + "/validate", size, batch, report->min_time(), [] {},
+      [&](size_t i, const char** error) {
+        return fidl_validate(type, buffers[i].data(), size, 0, error);
+      }));
+
+  report->Add(Measure(name + "/decode", size, batch, report->min_time(), copy,
+                      [&](size_t i, const char** error) {
+                        return fidl_decode(type, buffers[i].data(), size, nullptr, 0, error);
+                      }));
+
+  auto decode = [&] {
+    copy();
+    for (std::vector<uint8_t>& buffer : buffers) {
+      const char* error = nullptr;
+      Check(fidl_decode(type, buffer.data(), size, nullptr, 0, &error), error, name);
+    }
+  };
+  report->Add(Measure(name + "/encode", size, batch, report->min_time(), decode,
+                      [&](size_t i, const char** error) {
+                        uint32_t actual_handles = 0;
+                        return fidl_encode(type, buffers[i].data(), size, nullptr, 0,
+                                           &actual_handles, error);
+                      }));
+}
+
+// Measures the C++ bindings on |value|, and the C coding functions on its
+// encoding.
+template <typename T>
+void Run(const std::string& name, const T& value, Report* report) {
+  std::vector<T> objects(kMaxBatch);
+  for (T& object : objects) {
+    fidl::Clone(value, &object);
+  }
+  std::vector<uint8_t> encoded;
+  const char* error = nullptr;
+  Check(fidl::EncodeObject(&objects[0], &encoded, &error), error, name);
+  std::vector<uint8_t> copy = encoded;
+  T decoded;
+  Check(fidl::DecodeObject(copy.data(), copy.size(), &decoded, &error), error, name);
+  if (!fidl::Equals(value, decoded)) {
+    fprintf(stderr, "%s does not survive a round trip\n", name.c_str());
+    exit(1);
+  }
+
+  RunCoding(name, T::FidlType, encoded, report);
+
+  const size_t size = encoded.size();
+  const size_t batch = BatchSize(size);
+  std::vector<std::vector<uint8_t>> buffers(batch);
+  std::vector<T> results(batch);
+  auto reset = [&] {
+    for (size_t i = 0; i < batch; i++) {
+      buffers[i] = std::vector<uint8_t>();
+      results[i] = T();
+    }
+  };
+
+  report->Add(Measure(name + "/cpp-encode", size, batch, report->min_time(), reset,
+                      [&](size_t i, const char** error) {
+                        return fidl::EncodeObject(&objects[i], &buffers[i], error);
+                      }));
+
+  auto copy_encoded = [&] {
+    reset();
+    for (std::vector<uint8_t>& buffer : buffers) {
+      buffer = encoded;
+    }
+  };
+  report->Add(Measure(name + "/cpp-decode", size, batch, report->min_time(), copy_encoded,
+                      [&](size_t i, const char** error) {
+                        return fidl::DecodeObject(buffers[i].data(), size, &results[i], error);
+                      }));
+
+  report->Add(Measure(name + "/round-trip", size, batch, report->min_time(), reset,
+                      [&](size_t i, const char** error) {
+                        zx_status_t status = fidl::EncodeObject(&objects[i], &buffers[i], error);
+                        if (status != ZX_OK) {
+                          return status;
+                        }
+                        return fidl::DecodeObject(buffers[i].data(), size, &results[i], error);
+                      }));
+}
+
+void Rot13InPlace(char* data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    char c = data[i];
+    if (c >= 'a' && c <= 'z') {
+      data[i] = static_cast<char>('a' + (c - 'a' + 13) % 26);
+    } else if (c >= 'A' && c <= 'Z') {
+      data[i] = static_cast<char>('A' + (c - 'A' + 13) % 26);
+    }
+  }
+}
+
+// Decodes the request in |bytes| in place, for |Echo|.
+zx_status_t DecodeRequest(uint8_t* bytes, uint32_t size, const char** error) {
+  return fidl_decode(benchmarks::StringMessage::FidlType, bytes, size, nullptr, 0, error);
+}
+
+// Validates the encoded reply, as the binding would before sending it.
+zx_status_t ValidateReply(fidl::Encoder* encoder, const char** error) {
+  fidl::Message reply = encoder->GetMessage();
+  return fidl_validate(benchmarks::StringMessage::FidlType, reply.bytes().data(),
+                       reply.bytes().actual(), 0, error);
+}
+
+// Echoes the request in |bytes| as the generated stub would: the string is
+// copied into a std::string, encrypted there, and copied into the reply.
+zx_status_t EchoOwning(uint8_t* bytes, uint32_t size, const char** error) {
+  zx_status_t status = DecodeRequest(bytes, size, error);
+  if (status != ZX_OK) {
+    return status;
+  }
+  fidl::Decoder decoder(fidl::Message(fidl::BytePart(bytes, size, size), fidl::HandlePart()));
+  std::string value = fidl::DecodeAs<std::string>(&decoder, 0);
+  Rot13InPlace(&value[0], value.size());
+  fidl::Encoder encoder(fidl::Encoder::NO_HEADER);
+  encoder.Alloc(sizeof(fidl_string_t));
+  fidl::Encode(&encoder, &value, 0);
+  return ValidateReply(&encoder, error);
+}
+
+// Echoes the request in |bytes| through a view: the string is copied once,
+// straight into the reply, and encrypted there, where it is already in cache.
+zx_status_t EchoView(uint8_t* bytes, uint32_t size, const char** error) {
+  zx_status_t status = DecodeRequest(bytes, size, error);
+  if (status != ZX_OK) {
+    return status;
+  }
+  fidl::Decoder decoder(fidl::Message(fidl::BytePart(bytes, size, size), fidl::HandlePart()));
+  fidl::StringView value = fidl::DecodeAs<fidl::StringView>(&decoder, 0);
+  fidl::Encoder encoder(fidl::Encoder::NO_HEADER);
+  encoder.Alloc(sizeof(fidl_string_t));
+  fidl::Encode(&encoder, &value, 0);
+  Rot13InPlace(encoder.GetPtr<char>(sizeof(fidl_string_t)), value.size());
+  return ValidateReply(&encoder, error);
+}
+
+// Measures echoing the string in |message|, with and without copying it out
+// of the request.
+void RunEcho(const std::string& name, const benchmarks::StringMessage& message, Report* report) {
+  benchmarks::StringMessage object;
+  fidl::Clone(message, &object);
+  std::vector<uint8_t> encoded;
+  const char* error = nullptr;
+  Check(fidl::EncodeObject(&object, &encoded, &error), error, name);
+
+  const uint32_t size = static_cast<uint32_t>(encoded.size());
+  const size_t batch = BatchSize(size);
+  std::vector<std::vector<uint8_t>> buffers(batch, encoded);
+  auto copy = [&] {
+    for (std::vector<uint8_t>& buffer : buffers) {
+      memcpy(buffer.data(), encoded.data(), size);
+    }
+  };
+  report->Add(Measure(name + "/echo-owning", size, batch, report->min_time(), copy,
+                      [&](size_t i, const char** error) {
+                        return EchoOwning(buffers[i].data(), size, error);
+                      }));
+  report->Add(Measure(name + "/echo-view", size, batch, report->min_time(), copy,
+                      [&](size_t i, const char** error) {
+                        return EchoView(buffers[i].data(), size, error);
+                      }));
+}
+
+benchmarks::Leaf MakeLeaf(uint64_t id) {
+  benchmarks::Leaf leaf;
+  leaf.set_id(id);
+  leaf.set_name("leaf-" + std::to_string(id));
+  std::vector<uint32_t> values(16);
+  for (size_t i = 0; i < values.size(); i++) {
+    values[i] = static_cast<uint32_t>(id * 16 + i);
+  }
+  leaf.set_values(std::move(values));
+  return leaf;
+}
+
+benchmarks::Level1 MakeLevel1(uint64_t id) {
+  benchmarks::Level2 level2;
+  level2.set_id(id);
+  level2.set_name("level2-" + std::to_string(id));
+  level2.set_child(benchmarks::Level3::WithLeaf(MakeLeaf(id)));
+  benchmarks::Level3 sibling;
+  sibling.set_name("sibling-" + std::to_string(id));
+  level2.set_sibling(std::move(sibling));
+  return benchmarks::Level1::WithTable(std::move(level2));
+}
+
+benchmarks::NestedMessage MakeNested(size_t children) {
+  benchmarks::NestedMessage message;
+  message.root.set_id(0);
+  message.root.set_name("root");
+  message.root.set_child(MakeLevel1(0));
+  std::vector<benchmarks::Level1> list;
+  for (size_t i = 1; i <= children; i++) {
+    list.push_back(MakeLevel1(i));
+  }
+  message.root.set_children(std::move(list));
+  return message;
+}
+
+benchmarks::ResultMessage MakeResult(double number) {
+  benchmarks::ResultMessage message;
+  message.result.set_number(number);
+  return message;
+}
+
+benchmarks::ResultMessage MakeError(std::string text) {
+  benchmarks::ResultMessage message;
+  benchmarks::Error error;
+  error.message = std::move(text);
+  message.result.set_error(std::move(error));
+  return message;
+}
+
+benchmarks::StringMessage MakeString(size_t size) {
+  benchmarks::StringMessage message;
+  for (size_t i = 0; i < size; i++) {
+    message.value.push_back(static_cast<char>('a' + i % 26));
+  }
+  return message;
+}
+
+benchmarks::BytesMessage MakeBytes(size_t size) {
+  benchmarks::BytesMessage message;
+  message.value.resize(size);
+  for (size_t i = 0; i < size; i++) {
+    message.value[i] = static_cast<uint8_t>(i * 7);
+  }
+  return message;
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  long min_time_ms = 200;
+  const char* output = nullptr;
+  for (int i = 1; i < argc - 1; ++i) {
+    if (!strcmp("--min-time-ms", argv[i])) {
+      min_time_ms = strtol(argv[++i], nullptr, 10);
+    } else if (!strcmp("--output", argv[i])) {
+      output = argv[++i];
+    }
+  }
+  Report report{std::chrono::milliseconds(min_time_ms)};
+
+  benchmarks::BinaryOpRequest binary_op{benchmarks::BinaryOp::DIVISION, 3.5, 2.5};
+  Run("binary-op", binary_op, &report);
+  // The same bytes through the walker, for comparison with the flat struct
+  // fast path the generated table takes.
+  std::vector<uint8_t> binary_op_bytes;
+  const char* error = nullptr;
+  Check(fidl::EncodeObject(&binary_op, &binary_op_bytes, &error), error, "binary-op");
+  RunCoding("binary-op-walked",
+            reinterpret_cast<const fidl_type_t*>(&benchmark_BinaryOpRequestWalkedTable),
+            binary_op_bytes, &report);
+
+  Run("result-number", MakeResult(1.4), &report);
+  Run("result-error", MakeError("division by zero"), &report);
+  Run("rot13-128", MakeString(128), &report);
+  RunEcho("rot13-128", MakeString(128), &report);
+  Run("rot13-32k", MakeString(32768), &report);
+  RunEcho("rot13-32k", MakeString(32768), &report);
+  Run("bytes-64k", MakeBytes(64 << 10), &report);
+  Run("bytes-1m", MakeBytes(1 << 20), &report);
+  Run("nested-1", MakeNested(1), &report);
+  Run("nested-16", MakeNested(16), &report);
+
+  if (output != nullptr && !report.Write(output)) {
+    fprintf(stderr, "cannot write %s\n", output);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,22 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Coding tables must be C so they are constant initialized.
+
+#include "coding_tables.h"
+
+extern const struct FidlCodedStruct fuchsia_examples_benchmarks_BinaryOpRequestTable;
+
+static const struct FidlStructField BinaryOpRequestWalkedFields[] = {
+    {.type = (const fidl_type_t*)&fuchsia_examples_benchmarks_BinaryOpRequestTable,
+     .offset = 0,
+     .padding = 0},
+};
+
+const struct FidlCodedStruct benchmark_BinaryOpRequestWalkedTable = {
+    .tag = kFidlTypeStruct,
+    .field_count = 1,
+    .size = 24,
+    .fields = BinaryOpRequestWalkedFields,
+    .name = "benchmark/BinaryOpRequestWalked"};
@@ -0,0 +1,23 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Coding tables that fidlc does not generate, for comparison with the ones it
+// does.
+
+#ifndef SRC_FIDL_BENCHMARKS_CODING_TABLES_H_
+#define SRC_FIDL_BENCHMARKS_CODING_TABLES_H_
+
+#include <lib/fidl/internal.h>
+
+__BEGIN_CDECLS
+
+// fuchsia.examples.benchmarks/BinaryOpRequest as a field of a struct. fidlc
+// flattens nested structs whose fields are all inline, so the coding
+// functions take their flat struct fast path for its tables. This one keeps
+// the nesting, so the walker codes it: same bytes, the other path.
+extern const struct FidlCodedStruct benchmark_BinaryOpRequestWalkedTable;
+
+__END_CDECLS
+
+#endif  // SRC_FIDL_BENCHMARKS_CODING_TABLES_H_
@@ -0,0 +1,227 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Checks that the flat struct fast paths of fidl_validate, fidl_decode,
+// fidl_encode and fidl_linearize_and_encode behave as the walker does: each
+// message is coded with a flat table and with an equivalent walked one, and
+// both must return the same status, error and bytes.
+
+#include <lib/fidl/coding.h>
+#include <lib/fidl/walker.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "flat_struct_tables.h"
+
+namespace {
+
+const fidl_type_t* const kFlat = reinterpret_cast<const fidl_type_t*>(&test_FlatStructTable);
+const fidl_type_t* const kWalked =
+    reinterpret_cast<const fidl_type_t*>(&test_FlatStructWalkedTable);
+
+// A message laid out as described in flat_struct_tables.h, with room for
+// trailing bytes.
+struct Message {
+  alignas(FIDL_ALIGNMENT) uint8_t bytes[32] = {};
+  uint32_t num_bytes = 16;
+  uint32_t num_handles = 0;
+
+  Message() {
+    bytes[0] = 1;
+    SetUint32(4, 2);
+    SetUint32(8, 0x5);
+  }
+
+  void SetUint32(size_t offset, uint32_t value) { memcpy(bytes + offset, &value, sizeof(value)); }
+};
+
+// The result of one coding function.
+struct Outcome {
+  zx_status_t status = ZX_OK;
+  std::string error;
+  std::vector<uint8_t> bytes;
+  uint32_t actual_handles = 0;
+};
+
+void ExpectSame(const Outcome& flat, const Outcome& walked) {
+  EXPECT_EQ(walked.status, flat.status);
+  EXPECT_EQ(walked.error, flat.error);
+  EXPECT_EQ(walked.bytes, flat.bytes);
+  EXPECT_EQ(walked.actual_handles, flat.actual_handles);
+}
+
+std::string ToString(const char* error) { return error ? error : ""; }
+
+Outcome Validate(const fidl_type_t* type, Message message) {
+  Outcome outcome;
+  const char* error = nullptr;
+  outcome.status =
+      fidl_validate(type, message.bytes, message.num_bytes, message.num_handles, &error);
+  outcome.error = ToString(error);
+  return outcome;
+}
+
+Outcome Decode(const fidl_type_t* type, Message message) {
+  Outcome outcome;
+  const zx_handle_t handles[] = {1};
+  const char* error = nullptr;
+  outcome.status =
+      fidl_decode(type, message.bytes, message.num_bytes, handles, message.num_handles, &error);
+  outcome.error = ToString(error);
+  outcome.bytes.assign(message.bytes, message.bytes + message.num_bytes);
+  return outcome;
+}
+
+Outcome Encode(const fidl_type_t* type, Message message) {
+  Outcome outcome;
+  zx_handle_t handles[1] = {};
+  const char* error = nullptr;
+  outcome.status = fidl_encode(type, message.bytes, message.num_bytes, handles,
+                               message.num_handles, &outcome.actual_handles, &error);
+  outcome.error = ToString(error);
+  outcome.bytes.assign(message.bytes, message.bytes + message.num_bytes);
+  return outcome;
+}
+
+Outcome LinearizeAndEncode(const fidl_type_t* type, Message message) {
+  Outcome outcome;
+  alignas(FIDL_ALIGNMENT) uint8_t out_bytes[sizeof(message.bytes)];
+  memset(out_bytes, 0xaa, sizeof(out_bytes));
+  zx_handle_t handles[1] = {};
+  uint32_t actual_bytes = 0;
+  const char* error = nullptr;
+  outcome.status =
+      fidl_linearize_and_encode(type, message.bytes, out_bytes, message.num_bytes, handles,
+                                message.num_handles, &actual_bytes, &outcome.actual_handles, &error);
+  outcome.error = ToString(error);
+  if (outcome.status == ZX_OK) {
+    outcome.bytes.assign(out_bytes, out_bytes + actual_bytes);
+  }
+  return outcome;
+}
+
+// Codes |message| with both tables through each of the coding functions,
+// expects the same outcome from both, and returns the outcomes of the flat
+// table.
+struct Outcomes {
+  Outcome validate;
+  Outcome decode;
+  Outcome encode;
+  Outcome linearize;
+};
+
+Outcomes CodeBoth(const Message& message) {
+  Outcomes flat{Validate(kFlat, message), Decode(kFlat, message), Encode(kFlat, message),
+                LinearizeAndEncode(kFlat, message)};
+  {
+    SCOPED_TRACE("fidl_validate");
+    ExpectSame(flat.validate, Validate(kWalked, message));
+  }
+  {
+    SCOPED_TRACE("fidl_decode");
+    ExpectSame(flat.decode, Decode(kWalked, message));
+  }
+  {
+    SCOPED_TRACE("fidl_encode");
+    ExpectSame(flat.encode, Encode(kWalked, message));
+  }
+  {
+    SCOPED_TRACE("fidl_linearize_and_encode");
+    ExpectSame(flat.linearize, LinearizeAndEncode(kWalked, message));
+  }
+  return flat;
+}
+
+TEST(FlatStructCodingTest, TablesTakeTheirPaths) {
+  EXPECT_TRUE(fidl::IsFlatStruct(kFlat));
+  EXPECT_FALSE(fidl::IsFlatStruct(kWalked));
+}
+
+TEST(FlatStructCodingTest, ValidMessage) {
+  Outcomes flat = CodeBoth(Message());
+  EXPECT_EQ(ZX_OK, flat.validate.status);
+  EXPECT_EQ(ZX_OK, flat.decode.status);
+  EXPECT_EQ(ZX_OK, flat.encode.status);
+  EXPECT_EQ(ZX_OK, flat.linearize.status);
+}
+
+TEST(FlatStructCodingTest, NonZeroPadding) {
+  for (size_t offset : {1, 3, 12, 15}) {
+    SCOPED_TRACE(offset);
+    Message message;
+    message.bytes[offset] = 0xff;
+    Outcomes flat = CodeBoth(message);
+    EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.validate.status);
+    EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.decode.status);
+    // Encoding zeroes the padding.
+    EXPECT_EQ(ZX_OK, flat.encode.status);
+    EXPECT_EQ(0, flat.encode.bytes[offset]);
+    EXPECT_EQ(ZX_OK, flat.linearize.status);
+    EXPECT_EQ(0, flat.linearize.bytes[offset]);
+  }
+}
+
+TEST(FlatStructCodingTest, OutOfRangeEnum) {
+  Message message;
+  message.SetUint32(4, 4);
+  Outcomes flat = CodeBoth(message);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.validate.status);
+  EXPECT_EQ("not a valid enum member", flat.validate.error);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.decode.status);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.encode.status);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.linearize.status);
+}
+
+TEST(FlatStructCodingTest, UnknownBits) {
+  Message message;
+  message.SetUint32(8, 0x8);
+  Outcomes flat = CodeBoth(message);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.validate.status);
+  EXPECT_EQ("not a valid bits member", flat.validate.error);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.decode.status);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.encode.status);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.linearize.status);
+}
+
+TEST(FlatStructCodingTest, InvalidBool) {
+  Message message;
+  message.bytes[0] = 2;
+  Outcomes flat = CodeBoth(message);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.validate.status);
+  EXPECT_EQ("not a valid bool value", flat.validate.error);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.decode.status);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.encode.status);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.linearize.status);
+}
+
+TEST(FlatStructCodingTest, TrailingBytes) {
+  Message message;
+  message.num_bytes = 24;
+  Outcomes flat = CodeBoth(message);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.validate.status);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.decode.status);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.encode.status);
+  // For linearizing, |num_bytes| is only the capacity of the output.
+  EXPECT_EQ(ZX_OK, flat.linearize.status);
+  EXPECT_EQ(16u, flat.linearize.bytes.size());
+}
+
+TEST(FlatStructCodingTest, ExtraHandles) {
+  Message message;
+  message.num_handles = 1;
+  Outcomes flat = CodeBoth(message);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.validate.status);
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, flat.decode.status);
+  // For encoding, the handles are only the capacity of the output.
+  EXPECT_EQ(ZX_OK, flat.encode.status);
+  EXPECT_EQ(0u, flat.encode.actual_handles);
+  EXPECT_EQ(ZX_OK, flat.linearize.status);
+  EXPECT_EQ(0u, flat.linearize.actual_handles);
+}
+
+}  // namespace
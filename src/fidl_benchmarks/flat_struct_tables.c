@@ -0,0 +1,41 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Coding tables must be C so they are constant initialized.
+
+#include "flat_struct_tables.h"
+
+static bool ValidateEnum(uint64_t v) { return v <= 3; }
+
+static const struct FidlCodedEnum EnumTable = {.tag = kFidlTypeEnum,
+                                               .underlying_type = kFidlCodedPrimitiveSubtype_Uint32,
+                                               .validate = &ValidateEnum,
+                                               .name = "test/Enum"};
+
+static const struct FidlCodedBits BitsTable = {.tag = kFidlTypeBits,
+                                               .underlying_type = kFidlCodedPrimitiveSubtype_Uint32,
+                                               .mask = 0x7,
+                                               .name = "test/Bits"};
+
+static const struct FidlStructField FlatStructFields[] = {
+    {.type = (const fidl_type_t*)&fidl_internal_kBoolTable, .offset = 0, .padding = 3},
+    {.type = (const fidl_type_t*)&EnumTable, .offset = 4, .padding = 0},
+    {.type = (const fidl_type_t*)&BitsTable, .offset = 8, .padding = 4},
+};
+
+const struct FidlCodedStruct test_FlatStructTable = {.tag = kFidlTypeStruct,
+                                                     .field_count = 3,
+                                                     .size = 16,
+                                                     .fields = FlatStructFields,
+                                                     .name = "test/FlatStruct"};
+
+static const struct FidlStructField FlatStructWalkedFields[] = {
+    {.type = (const fidl_type_t*)&test_FlatStructTable, .offset = 0, .padding = 0},
+};
+
+const struct FidlCodedStruct test_FlatStructWalkedTable = {.tag = kFidlTypeStruct,
+                                                           .field_count = 1,
+                                                           .size = 16,
+                                                           .fields = FlatStructWalkedFields,
+                                                           .name = "test/FlatStructWalked"};
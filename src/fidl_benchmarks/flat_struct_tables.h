@@ -0,0 +1,31 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Coding tables for a struct that holds each kind of field the flat struct
+// fast path checks, laid out as
+//
+//   offset  0  bool     flag, followed by 3 bytes of padding
+//   offset  4  uint32   enum with members 0 to 3
+//   offset  8  uint32   bits with mask 0x7, followed by 4 bytes of padding
+//
+// for 16 bytes in all.
+
+#ifndef SRC_FIDL_BENCHMARKS_FLAT_STRUCT_TABLES_H_
+#define SRC_FIDL_BENCHMARKS_FLAT_STRUCT_TABLES_H_
+
+#include <lib/fidl/internal.h>
+
+__BEGIN_CDECLS
+
+// The struct itself, which the coding functions take the flat struct fast
+// path for.
+extern const struct FidlCodedStruct test_FlatStructTable;
+
+// The same struct as the only field of another, so the walker codes it: same
+// bytes, the other path.
+extern const struct FidlCodedStruct test_FlatStructWalkedTable;
+
+__END_CDECLS
+
+#endif  // SRC_FIDL_BENCHMARKS_FLAT_STRUCT_TABLES_H_
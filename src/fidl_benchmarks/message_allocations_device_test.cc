@@ -0,0 +1,77 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Checks that the FIDL bindings reuse their message buffers, so that sending
+// and receiving messages allocates nothing once warmed up. Runs on a Fuchsia
+// device.
+
+#include <fuchsia/examples/benchmarks/messages/cpp/fidl.h>
+#include <lib/async-loop/cpp/loop.h>
+#include <lib/async-loop/default.h>
+#include <lib/fidl/cpp/binding.h>
+
+#include <gtest/gtest.h>
+
+#include "src/testing/allocation_counter.h"
+
+namespace {
+
+namespace messages = fuchsia::examples::benchmarks::messages;
+
+constexpr uint64_t kWarmupMessages = 1000;
+constexpr uint64_t kMessages = 100000;
+
+// Answers every Ping with an OnPong event.
+class PingerImpl : public messages::Pinger {
+ public:
+  PingerImpl() : binding_(this) {}
+
+  fidl::Binding<messages::Pinger>* binding() { return &binding_; }
+
+  void Ping(uint64_t sequence, double a, double b) override {
+    binding_.events().OnPong(sequence, a / b);
+  }
+
+ private:
+  fidl::Binding<messages::Pinger> binding_;
+};
+
+// Sends kMessages pings after the warmup, each once the previous pong is back,
+// so every message goes through a channel read on each side.
+TEST(MessageAllocationsTest, SteadyStateMessagingDoesNotAllocate) {
+  async::Loop loop(&kAsyncLoopConfigAttachToCurrentThread);
+  PingerImpl pinger;
+  messages::PingerPtr proxy;
+  ASSERT_EQ(ZX_OK, pinger.binding()->Bind(proxy.NewRequest()));
+
+  uint64_t received = 0;
+  size_t allocations_at_warmup = 0;
+  size_t allocations_at_end = 0;
+  proxy.events().OnPong = [&](uint64_t sequence, double result) {
+    EXPECT_EQ(received, sequence);
+    EXPECT_EQ(1.4, result);
+    received++;
+    if (received == kWarmupMessages) {
+      allocations_at_warmup = testing_support::AllocationCount();
+    }
+    if (received == kWarmupMessages + kMessages) {
+      allocations_at_end = testing_support::AllocationCount();
+      loop.Quit();
+      return;
+    }
+    proxy->Ping(received, 3.5, 2.5);
+  };
+  proxy.set_error_handler([&loop](zx_status_t status) {
+    ADD_FAILURE() << "channel closed: " << status;
+    loop.Quit();
+  });
+
+  proxy->Ping(0, 3.5, 2.5);
+  loop.Run();
+
+  EXPECT_EQ(kWarmupMessages + kMessages, received);
+  EXPECT_EQ(0u, allocations_at_end - allocations_at_warmup);
+}
+
+}  // namespace
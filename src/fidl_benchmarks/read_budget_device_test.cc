@@ -0,0 +1,135 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Checks that bindings read at most their budget of messages per wakeup, so a
+// busy channel cannot starve the others on the same dispatcher. Runs on a
+// Fuchsia device.
+
+#include <fuchsia/examples/benchmarks/messages/cpp/fidl.h>
+#include <lib/async-loop/cpp/loop.h>
+#include <lib/async-loop/default.h>
+#include <lib/fidl/cpp/binding.h>
+#include <lib/fidl/cpp/binding_set.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+namespace messages = fuchsia::examples::benchmarks::messages;
+
+fidl::ReadBudget MessageBudget(uint32_t max_messages) {
+  fidl::ReadBudget budget;
+  budget.max_messages = max_messages;
+  return budget;
+}
+
+// Records which pinger each Ping reached, in order.
+class RecordingPinger : public messages::Pinger {
+ public:
+  RecordingPinger(int id, std::vector<int>* log) : id_(id), log_(log) {}
+
+  void Ping(uint64_t sequence, double a, double b) override { log_->push_back(id_); }
+
+ private:
+  const int id_;
+  std::vector<int>* const log_;
+};
+
+// Sends itself the next Ping from each Ping, until |count| have arrived.
+class ChainingPinger : public messages::Pinger {
+ public:
+  explicit ChainingPinger(uint64_t count) : count_(count) {}
+
+  messages::PingerPtr* proxy() { return &proxy_; }
+
+  void Ping(uint64_t sequence, double a, double b) override {
+    if (sequence + 1 < count_) {
+      proxy_->Ping(sequence + 1, a, b);
+    }
+  }
+
+ private:
+  const uint64_t count_;
+  messages::PingerPtr proxy_;
+};
+
+TEST(ReadBudgetTest, ReadsAtMostTheBudgetPerWakeup) {
+  async::Loop loop(&kAsyncLoopConfigAttachToCurrentThread);
+  std::vector<int> log;
+  RecordingPinger impl(0, &log);
+  fidl::Binding<messages::Pinger> binding(&impl);
+  messages::PingerPtr proxy;
+  ASSERT_EQ(ZX_OK, binding.Bind(proxy.NewRequest()));
+  binding.set_read_budget(MessageBudget(4));
+
+  for (uint64_t i = 0; i < 10; i++) {
+    proxy->Ping(i, 3.5, 2.5);
+  }
+  loop.RunUntilIdle();
+
+  EXPECT_EQ(10u, log.size());
+  const fidl::ReadStats& stats = binding.read_stats();
+  EXPECT_EQ(10u, stats.messages);
+  EXPECT_EQ(3u, stats.wakeups);
+  EXPECT_EQ(2u, stats.budget_exhausted);
+  EXPECT_EQ(4u, stats.max_messages_per_wakeup);
+}
+
+TEST(ReadBudgetTest, DrainsMessagesArrivingDuringTheWakeup) {
+  async::Loop loop(&kAsyncLoopConfigAttachToCurrentThread);
+  ChainingPinger impl(8);
+  fidl::Binding<messages::Pinger> binding(&impl);
+  ASSERT_EQ(ZX_OK, binding.Bind(impl.proxy()->NewRequest()));
+
+  // The channel holds a single message each time it is signalled, yet one
+  // wakeup reads all of them.
+  (*impl.proxy())->Ping(0, 3.5, 2.5);
+  loop.RunUntilIdle();
+
+  const fidl::ReadStats& stats = binding.read_stats();
+  EXPECT_EQ(8u, stats.messages);
+  EXPECT_EQ(1u, stats.wakeups);
+  EXPECT_EQ(0u, stats.budget_exhausted);
+}
+
+TEST(ReadBudgetTest, BindingSetSharesTheDispatcherFairly) {
+  async::Loop loop(&kAsyncLoopConfigAttachToCurrentThread);
+  std::vector<int> log;
+  RecordingPinger first(0, &log);
+  RecordingPinger second(1, &log);
+  fidl::BindingSet<messages::Pinger> bindings;
+  bindings.set_read_budget(MessageBudget(4));
+  messages::PingerPtr first_proxy;
+  messages::PingerPtr second_proxy;
+  bindings.AddBinding(&first, first_proxy.NewRequest());
+  bindings.AddBinding(&second, second_proxy.NewRequest());
+
+  for (uint64_t i = 0; i < 64; i++) {
+    first_proxy->Ping(i, 3.5, 2.5);
+  }
+  for (uint64_t i = 0; i < 64; i++) {
+    second_proxy->Ping(i, 3.5, 2.5);
+  }
+  loop.RunUntilIdle();
+
+  ASSERT_EQ(128u, log.size());
+  // The second channel is read long before the first is drained.
+  std::vector<int> head(log.begin(), log.begin() + 8);
+  EXPECT_EQ(4, std::count(head.begin(), head.end(), 0));
+  EXPECT_EQ(4, std::count(head.begin(), head.end(), 1));
+
+  fidl::ReadStats stats = bindings.read_stats();
+  EXPECT_EQ(128u, stats.messages);
+  EXPECT_EQ(32u, stats.wakeups);
+  EXPECT_EQ(4u, stats.max_messages_per_wakeup);
+
+  // Counts survive the bindings leaving the set.
+  bindings.CloseAll();
+  EXPECT_EQ(128u, bindings.read_stats().messages);
+}
+
+}  // namespace
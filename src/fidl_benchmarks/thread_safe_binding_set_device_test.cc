@@ -0,0 +1,155 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Checks adding and removing bindings in a ThreadSafeBindingSet, that stale
+// ids do not reach bindings added later in the same slot, and that bindings
+// are destroyed on their own dispatcher. Runs on a Fuchsia device.
+
+#include <fuchsia/examples/benchmarks/messages/cpp/fidl.h>
+#include <lib/async-loop/cpp/loop.h>
+#include <lib/async-loop/default.h>
+#include <lib/async/cpp/task.h>
+#include <lib/fidl/cpp/thread_safe_binding_set.h>
+
+#include <future>
+#include <memory>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+namespace messages = fuchsia::examples::benchmarks::messages;
+
+class NullPinger : public messages::Pinger {
+ public:
+  void Ping(uint64_t sequence, double a, double b) override {}
+};
+
+// Reports the thread it is destroyed on.
+class DestroyedPinger : public messages::Pinger {
+ public:
+  explicit DestroyedPinger(std::promise<std::thread::id>* destroyed) : destroyed_(destroyed) {}
+  ~DestroyedPinger() override { destroyed_->set_value(std::this_thread::get_id()); }
+
+  void Ping(uint64_t sequence, double a, double b) override {}
+
+ private:
+  std::promise<std::thread::id>* const destroyed_;
+};
+
+TEST(ThreadSafeBindingSetTest, AddsAndRemovesBindings) {
+  async::Loop loop(&kAsyncLoopConfigAttachToCurrentThread);
+  NullPinger impl;
+  fidl::ThreadSafeBindingSet<messages::Pinger> bindings;
+  messages::PingerPtr first;
+  messages::PingerPtr second;
+  bool first_closed = false;
+  first.set_error_handler([&first_closed](zx_status_t) { first_closed = true; });
+
+  auto first_id = bindings.AddBinding(&impl, first.NewRequest(), loop.dispatcher());
+  auto second_id = bindings.AddBinding(&impl, second.NewRequest(), loop.dispatcher());
+  ASSERT_TRUE(first_id);
+  ASSERT_TRUE(second_id);
+  EXPECT_NE(first_id, second_id);
+  EXPECT_EQ(2u, bindings.size());
+
+  EXPECT_TRUE(bindings.RemoveBinding(first_id));
+  EXPECT_FALSE(bindings.RemoveBinding(first_id));
+  EXPECT_EQ(1u, bindings.size());
+  loop.RunUntilIdle();
+  EXPECT_TRUE(first_closed);
+  EXPECT_TRUE(second.is_bound());
+}
+
+TEST(ThreadSafeBindingSetTest, StaleIdsDoNotRemoveLaterBindings) {
+  async::Loop loop(&kAsyncLoopConfigAttachToCurrentThread);
+  NullPinger impl;
+  // A single dispatcher, so both bindings go in the same shard.
+  fidl::ThreadSafeBindingSet<messages::Pinger> bindings({loop.dispatcher()});
+  messages::PingerPtr first;
+  messages::PingerPtr second;
+
+  auto stale = bindings.AddBinding(&impl, first.NewRequest());
+  ASSERT_TRUE(bindings.RemoveBinding(stale));
+  // Reuses the slot freed by the removal.
+  auto current = bindings.AddBinding(&impl, second.NewRequest());
+  EXPECT_EQ(stale.shard, current.shard);
+  EXPECT_EQ(stale.slot, current.slot);
+  EXPECT_NE(stale, current);
+
+  EXPECT_FALSE(bindings.RemoveBinding(stale));
+  EXPECT_EQ(1u, bindings.size());
+  loop.RunUntilIdle();
+  EXPECT_TRUE(second.is_bound());
+}
+
+TEST(ThreadSafeBindingSetTest, RemovesBindingsOnError) {
+  async::Loop loop(&kAsyncLoopConfigAttachToCurrentThread);
+  NullPinger impl;
+  fidl::ThreadSafeBindingSet<messages::Pinger> bindings({loop.dispatcher()});
+  messages::PingerPtr proxy;
+  auto id = bindings.AddBinding(&impl, proxy.NewRequest());
+  ASSERT_TRUE(id);
+
+  proxy.Unbind();
+  loop.RunUntilIdle();
+  EXPECT_EQ(0u, bindings.size());
+  EXPECT_FALSE(bindings.RemoveBinding(id));
+}
+
+TEST(ThreadSafeBindingSetTest, CloseAllClosesEveryChannel) {
+  async::Loop loop(&kAsyncLoopConfigAttachToCurrentThread);
+  NullPinger impl;
+  fidl::ThreadSafeBindingSet<messages::Pinger> bindings({loop.dispatcher()});
+  messages::PingerPtr proxies[3];
+  size_t closed = 0;
+  for (messages::PingerPtr& proxy : proxies) {
+    proxy.set_error_handler([&closed](zx_status_t) { closed++; });
+    ASSERT_TRUE(bindings.AddBinding(&impl, proxy.NewRequest()));
+  }
+
+  bindings.CloseAll();
+  EXPECT_EQ(0u, bindings.size());
+  loop.RunUntilIdle();
+  EXPECT_EQ(3u, closed);
+}
+
+TEST(ThreadSafeBindingSetTest, DestroysBindingsOnTheirDispatcher) {
+  async::Loop loop(&kAsyncLoopConfigNoAttachToCurrentThread);
+  ASSERT_EQ(ZX_OK, loop.StartThread());
+  std::promise<std::thread::id> loop_thread;
+  async::PostTask(loop.dispatcher(),
+                  [&loop_thread] { loop_thread.set_value(std::this_thread::get_id()); });
+  const std::thread::id loop_thread_id = loop_thread.get_future().get();
+  EXPECT_NE(std::this_thread::get_id(), loop_thread_id);
+
+  std::promise<std::thread::id> destroyed;
+  fidl::ThreadSafeBindingSet<messages::Pinger, std::unique_ptr<messages::Pinger>> bindings(
+      {loop.dispatcher()});
+  // No dispatcher on this thread to bind a proxy to.
+  fidl::InterfaceHandle<messages::Pinger> handle;
+  auto id =
+      bindings.AddBinding(std::make_unique<DestroyedPinger>(&destroyed), handle.NewRequest());
+  ASSERT_TRUE(id);
+
+  // Removed on this thread, destroyed on the loop's.
+  ASSERT_TRUE(bindings.RemoveBinding(id));
+  EXPECT_EQ(loop_thread_id, destroyed.get_future().get());
+  loop.Shutdown();
+}
+
+TEST(ThreadSafeBindingSetTest, ReturnsAnInvalidIdIfBindingFails) {
+  async::Loop loop(&kAsyncLoopConfigAttachToCurrentThread);
+  NullPinger impl;
+  fidl::ThreadSafeBindingSet<messages::Pinger> bindings;
+  loop.Shutdown();
+
+  fidl::InterfaceHandle<messages::Pinger> handle;
+  auto id = bindings.AddBinding(&impl, handle.NewRequest(), loop.dispatcher());
+  EXPECT_FALSE(id);
+  EXPECT_EQ(0u, bindings.size());
+}
+
+}  // namespace
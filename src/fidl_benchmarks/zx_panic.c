@@ -0,0 +1,19 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// The host has no Zircon libc, so the FIDL coding library's assertions need
+// their panic handler defined here.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <zircon/assert.h>
+
+void __zx_panic(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+  abort();
+}
@@ -0,0 +1,151 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Host benchmark for promise fan-out and fan-in. Each round, a promise
+/// schedules --width leaf tasks that each spin through --work iterations of
+/// arithmetic and complete a bridge, then joins the bridges' promises and sums
+/// their results before starting the next round. The leaves complete their
+/// bridges on whichever thread runs them, so the joining task is resumed from
+/// other threads.
+///
+/// Reports the leaf tasks run per second by fit::single_threaded_executor,
+/// then by fit::work_stealing_executor from 1 to --max-threads threads, and
+/// the speedup of each over the single-threaded executor. Exits with an error
+/// if any run sums to the wrong result.
+///
+/// Usage: executor_benchmarks [--max-threads N] [--width N] [--rounds N]
+///                            [--work N]
+
+#include <lib/fit/bridge.h>
+#include <lib/fit/promise.h>
+#include <lib/fit/single_threaded_executor.h>
+#include <lib/fit/work_stealing_executor.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+  size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t width = 256;
+  size_t rounds = 64;
+  size_t work = 2000;
+};
+
+// The leaf tasks' work: a linear congruential generator.
+uint64_t Work(uint64_t seed, size_t iterations) {
+  uint64_t x = seed;
+  for (size_t i = 0; i < iterations; i++) {
+    x = x * 6364136223846793005u + 1442695040888963407u;
+  }
+  return x >> 32;
+}
+
+uint64_t Expected(const Options& options) {
+  uint64_t sum = 0;
+  for (size_t round = 0; round < options.rounds; round++) {
+    for (size_t leaf = 0; leaf < options.width; leaf++) {
+      sum += Work(round * options.width + leaf, options.work);
+    }
+  }
+  return sum;
+}
+
+// Fans out the leaves of |round| and sums their results.
+fit::promise<uint64_t> FanOut(const Options& options, size_t round) {
+  return fit::make_promise([&options, round](fit::context& context) {
+    std::vector<fit::promise<uint64_t>> leaves;
+    leaves.reserve(options.width);
+    for (size_t leaf = 0; leaf < options.width; leaf++) {
+      fit::bridge<uint64_t> bridge;
+      context.executor()->schedule_task(fit::make_promise(
+          [&options, seed = round * options.width + leaf,
+           completer = std::move(bridge.completer)]() mutable {
+            completer.complete_ok(Work(seed, options.work));
+          }));
+      leaves.push_back(bridge.consumer.promise());
+    }
+    return fit::join_promise_vector(std::move(leaves))
+        .and_then([](std::vector<fit::result<uint64_t>>& results) {
+          uint64_t sum = 0;
+          for (fit::result<uint64_t>& result : results) {
+            sum += result.value();
+          }
+          return fit::ok(sum);
+        });
+  });
+}
+
+// Runs the rounds from |round| on, one after another.
+fit::promise<uint64_t> Rounds(const Options& options, size_t round, uint64_t sum) {
+  if (round == options.rounds) {
+    return fit::make_result_promise<uint64_t>(fit::ok(sum));
+  }
+  return FanOut(options, round).and_then([&options, round, sum](const uint64_t& round_sum) {
+    return Rounds(options, round + 1, sum + round_sum);
+  });
+}
+
+// Runs all of the rounds on |executor| and returns the leaf tasks per second,
+// or a negative number if the sum is wrong.
+template <typename Executor>
+double Measure(const Options& options, Executor& executor, uint64_t expected) {
+  uint64_t sum = 0;
+  executor.schedule_task(Rounds(options, 0, 0).and_then([&sum](const uint64_t& result) {
+    sum = result;
+  }));
+  auto start = std::chrono::steady_clock::now();
+  executor.run();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  if (sum != expected) {
+    return -1;
+  }
+  return static_cast<double>(options.rounds * options.width) / elapsed.count();
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  Options options;
+  for (int i = 1; i < argc - 1; ++i) {
+    if (!strcmp("--max-threads", argv[i])) {
+      options.max_threads = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (!strcmp("--width", argv[i])) {
+      options.width = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (!strcmp("--rounds", argv[i])) {
+      options.rounds = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (!strcmp("--work", argv[i])) {
+      options.work = strtoul(argv[++i], nullptr, 10);
+    }
+  }
+
+  const uint64_t expected = Expected(options);
+  fit::single_threaded_executor single_threaded;
+  const double baseline = Measure(options, single_threaded, expected);
+  if (baseline < 0) {
+    fprintf(stderr, "single-threaded: wrong sum\n");
+    return 1;
+  }
+
+  printf("%-16s %8s %12s %8s\n", "executor", "threads", "tasks/s", "speedup");
+  printf("%-16s %8d %12.0f %8.2f\n", "single-threaded", 1, baseline, 1.0);
+  fflush(stdout);
+  for (size_t threads = 1; threads <= options.max_threads; threads *= 2) {
+    fit::work_stealing_executor work_stealing(threads);
+    const double rate = Measure(options, work_stealing, expected);
+    if (rate < 0) {
+      fprintf(stderr, "work-stealing with %zu threads: wrong sum\n", threads);
+      return 1;
+    }
+    printf("%-16s %8zu %12.0f %8.2f\n", "work-stealing", threads, rate, rate / baseline);
+    fflush(stdout);
+  }
+  return 0;
+}
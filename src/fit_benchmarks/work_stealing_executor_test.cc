@@ -0,0 +1,112 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <lib/fit/bridge.h>
+#include <lib/fit/defer.h>
+#include <lib/fit/work_stealing_executor.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+TEST(WorkStealingExecutorTest, RunsTasksScheduledByTasks) {
+  fit::work_stealing_executor executor(4);
+  std::atomic<size_t> runs{0};
+  for (size_t i = 0; i < 16; i++) {
+    executor.schedule_task(fit::make_promise([&runs](fit::context& context) {
+      runs++;
+      for (size_t j = 0; j < 16; j++) {
+        context.executor()->schedule_task(fit::make_promise([&runs] { runs++; }));
+      }
+    }));
+  }
+  executor.run();
+  EXPECT_EQ(16u * 17u, runs.load());
+}
+
+TEST(WorkStealingExecutorTest, ResumesTasksFromOtherThreads) {
+  fit::work_stealing_executor executor(2);
+  std::vector<fit::bridge<int>> bridges(8);
+  std::vector<fit::promise<int>> consumers;
+  for (fit::bridge<int>& bridge : bridges) {
+    consumers.push_back(bridge.consumer.promise());
+  }
+  std::thread completer([&bridges] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    for (size_t i = 0; i < bridges.size(); i++) {
+      bridges[i].completer.complete_ok(static_cast<int>(i));
+    }
+  });
+
+  int sum = 0;
+  executor.schedule_task(fit::join_promise_vector(std::move(consumers))
+                             .and_then([&sum](std::vector<fit::result<int>>& results) {
+                               for (fit::result<int>& result : results) {
+                                 sum += result.value();
+                               }
+                             }));
+  executor.run();
+  completer.join();
+  EXPECT_EQ(28, sum);
+}
+
+TEST(WorkStealingExecutorTest, ReturnsThePromiseResult) {
+  auto result = fit::run_work_stealing(
+      fit::make_promise([]() -> fit::result<int, const char*> { return fit::ok(42); }), 3);
+  ASSERT_TRUE(result.is_ok());
+  EXPECT_EQ(42, result.value());
+}
+
+TEST(WorkStealingExecutorTest, AbandonsTasksWithoutTickets) {
+  fit::work_stealing_executor executor(2);
+  bool destroyed = false;
+  executor.schedule_task(fit::make_promise(
+      [guard = fit::defer([&destroyed] { destroyed = true; })](fit::context& context) {
+        // Drop the ticket, so nothing can resume the task.
+        context.suspend_task();
+        return fit::pending();
+      }));
+  executor.run();
+  EXPECT_TRUE(destroyed);
+}
+
+TEST(WorkStealingExecutorTest, ReturnsWhileTicketsOutliveTheirTask) {
+  fit::suspended_task saved;
+  {
+    fit::work_stealing_executor executor(2);
+    bool resumed = false;
+    executor.schedule_task(fit::make_promise([&](fit::context& context) -> fit::result<> {
+      if (resumed) {
+        return fit::ok();
+      }
+      resumed = true;
+      saved = context.suspend_task();
+      fit::suspended_task copy = saved;
+      copy.resume_task();
+      return fit::pending();
+    }));
+    executor.run();
+    EXPECT_TRUE(resumed);
+  }
+  // Resolving the ticket after the executor is gone is harmless.
+  saved.resume_task();
+}
+
+TEST(WorkStealingExecutorTest, DestroysQueuedTasksWithTheExecutor) {
+  bool destroyed = false;
+  {
+    fit::work_stealing_executor executor(2);
+    executor.schedule_task(
+        fit::make_promise([guard = fit::defer([&destroyed] { destroyed = true; })] {}));
+    EXPECT_FALSE(destroyed);
+  }
+  EXPECT_TRUE(destroyed);
+}
+
+}  // namespace
@@ -0,0 +1,99 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Benchmark for Inspect counters bumped from many threads at once. Each
+/// thread adds to the same counter in a loop, and the benchmark reports the
+/// total adds per second for
+///
+///   locked   inspect::UintProperty::Add, which takes the lock of the State
+///            and bumps the generation count of the VMO
+///   sharded  inspect::ShardedUintProperty::Add, a relaxed atomic add to the
+///            calling thread's cell
+///
+/// If the sharded counter scales, its throughput grows with the thread count.
+///
+/// Usage: counter_benchmarks [--max-threads N] [--adds N]
+
+#include <lib/inspect/cpp/inspect.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  size_t max_threads = 16;
+  size_t adds = 1 << 20;
+};
+
+// Runs |threads| threads that each call |add| |adds| times, and returns the
+// adds per second. The threads start together.
+template <typename Add>
+double Measure(size_t threads, size_t adds, Add add) {
+  std::atomic<size_t> ready{0};
+  std::atomic<bool> go{false};
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < threads; i++) {
+    workers.emplace_back([&] {
+      ready.fetch_add(1);
+      while (!go.load()) {
+        std::this_thread::yield();
+      }
+      for (size_t j = 0; j < adds; j++) {
+        add();
+      }
+    });
+  }
+  while (ready.load() != threads) {
+    std::this_thread::yield();
+  }
+  const Clock::time_point start = Clock::now();
+  go.store(true);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  return static_cast<double>(threads * adds) / seconds;
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  Options options;
+  for (int i = 1; i < argc - 1; ++i) {
+    if (!strcmp("--max-threads", argv[i])) {
+      options.max_threads = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (!strcmp("--adds", argv[i])) {
+      options.adds = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    }
+  }
+
+  inspect::Inspector inspector;
+  inspect::UintProperty locked = inspector.GetRoot().CreateUint("locked", 0);
+  inspect::ShardedUintProperty sharded = inspector.GetRoot().CreateShardedUint("sharded");
+
+  uint64_t expected = 0;
+  printf("%8s %16s %16s\n", "threads", "locked add/s", "sharded add/s");
+  for (size_t threads = 1; threads <= options.max_threads; threads *= 2) {
+    const double locked_rate = Measure(threads, options.adds, [&] { locked.Add(1); });
+    const double sharded_rate = Measure(threads, options.adds, [&] { sharded.Add(1); });
+    expected += threads * options.adds;
+    printf("%8zu %16.0f %16.0f\n", threads, locked_rate, sharded_rate);
+    fflush(stdout);
+  }
+
+  if (sharded.Get() != expected) {
+    fprintf(stderr, "sharded counter lost adds\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,166 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Benchmark for scraping a mostly idle Inspect VMO at a high rate. Fills a
+/// 4 MiB Inspector with a synthetic tree of nodes, each with a counter, then
+/// repeatedly updates a few of the counters and scrapes the VMO with
+///
+///   snapshot  inspect::Snapshot::Create, copying the whole VMO
+///   delta     inspect::DeltaSnapshot::Update, listing the changed properties
+///
+/// and reports the thread CPU time and the bytes copied per scrape.
+///
+/// Usage: delta_snapshot_benchmarks [--mib N] [--scrapes N]
+
+#include <lib/inspect/cpp/delta_snapshot.h>
+#include <lib/inspect/cpp/inspect.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+  size_t mib = 4;
+  size_t scrapes = 1000;
+};
+
+// Per-scrape writes to measure, from an idle VMO to a busy one.
+constexpr size_t kWritesPerScrape[] = {0, 1, 16, 256};
+
+// The CPU time used by this thread, in nanoseconds.
+uint64_t ThreadCpuNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// An Inspector filled with nodes, each counting requests.
+class Fixture {
+ public:
+  explicit Fixture(size_t size) : inspector_(inspect::InspectSettings{size}) {
+    nodes_.push_back(inspector_.GetRoot().CreateChild("connections"));
+    while (inspector_.GetStats().size < inspector_.GetStats().maximum_size) {
+      for (size_t i = 0; i < 64; i++) {
+        const size_t id = nodes_.size();
+        nodes_.push_back(nodes_[id / 8].CreateChild("connection-" + std::to_string(id)));
+        counters_.push_back(nodes_.back().CreateUint("requests", 0));
+        inspector_.emplace(nodes_.back().CreateString("state", "idle"));
+      }
+    }
+  }
+
+  zx::vmo DuplicateVmo() const { return inspector_.DuplicateVmo(); }
+
+  size_t node_count() const { return nodes_.size(); }
+
+  // Bumps |count| counters spread over the tree.
+  void Write(size_t count) {
+    for (size_t i = 0; i < count; i++) {
+      seed_ = seed_ * 6364136223846793005u + 1442695040888963407u;
+      counters_[static_cast<size_t>(seed_ >> 33) % counters_.size()].Add(1);
+    }
+  }
+
+ private:
+  inspect::Inspector inspector_;
+  std::vector<inspect::Node> nodes_;
+  std::vector<inspect::UintProperty> counters_;
+  uint64_t seed_ = 1;
+};
+
+struct Measurement {
+  double us_per_scrape;
+  double kib_copied_per_scrape;
+  double changes_per_scrape;
+};
+
+void Print(const char* label, size_t writes, const Measurement& measurement) {
+  printf("%-10s %8zu %14.1f %16.1f %16.1f\n", label, writes, measurement.us_per_scrape,
+         measurement.kib_copied_per_scrape, measurement.changes_per_scrape);
+  fflush(stdout);
+}
+
+// Scrapes with a full snapshot each time, which copies the whole VMO.
+Measurement MeasureSnapshot(const Options& options, Fixture* fixture, size_t writes) {
+  zx::vmo vmo = fixture->DuplicateVmo();
+  uint64_t cpu = 0;
+  uint64_t copied = 0;
+  for (size_t i = 0; i < options.scrapes; i++) {
+    fixture->Write(writes);
+    const uint64_t start = ThreadCpuNanos();
+    inspect::Snapshot snapshot;
+    if (inspect::Snapshot::Create(vmo, &snapshot) != ZX_OK) {
+      fprintf(stderr, "failed to snapshot the VMO\n");
+      exit(1);
+    }
+    cpu += ThreadCpuNanos() - start;
+    copied += snapshot.size();
+  }
+  Measurement measurement;
+  measurement.us_per_scrape = static_cast<double>(cpu) / 1000.0 / options.scrapes;
+  measurement.kib_copied_per_scrape = static_cast<double>(copied) / 1024.0 / options.scrapes;
+  measurement.changes_per_scrape = 0;
+  return measurement;
+}
+
+// Scrapes with a DeltaSnapshot, which copies only the changed pages.
+Measurement MeasureDelta(const Options& options, Fixture* fixture, size_t writes) {
+  zx::vmo vmo = fixture->DuplicateVmo();
+  inspect::DeltaSnapshot delta;
+  std::vector<inspect::PropertyChange> changes;
+  // Take the baseline outside of the measurement.
+  if (delta.Update(vmo, &changes) != ZX_OK) {
+    fprintf(stderr, "failed to snapshot the VMO\n");
+    exit(1);
+  }
+  const uint64_t copied_before = delta.stats().bytes_copied;
+  uint64_t cpu = 0;
+  uint64_t change_count = 0;
+  for (size_t i = 0; i < options.scrapes; i++) {
+    fixture->Write(writes);
+    const uint64_t start = ThreadCpuNanos();
+    if (delta.Update(vmo, &changes) != ZX_OK) {
+      fprintf(stderr, "failed to snapshot the VMO\n");
+      exit(1);
+    }
+    cpu += ThreadCpuNanos() - start;
+    change_count += changes.size();
+  }
+  Measurement measurement;
+  measurement.us_per_scrape = static_cast<double>(cpu) / 1000.0 / options.scrapes;
+  measurement.kib_copied_per_scrape =
+      static_cast<double>(delta.stats().bytes_copied - copied_before) / 1024.0 / options.scrapes;
+  measurement.changes_per_scrape = static_cast<double>(change_count) / options.scrapes;
+  return measurement;
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  Options options;
+  for (int i = 1; i < argc - 1; ++i) {
+    if (!strcmp("--mib", argv[i])) {
+      options.mib = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (!strcmp("--scrapes", argv[i])) {
+      options.scrapes = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    }
+  }
+
+  Fixture fixture(options.mib << 20);
+  printf("%zu MiB VMO, %zu nodes, %zu scrapes\n", options.mib, fixture.node_count(),
+         options.scrapes);
+  printf("%-10s %8s %14s %16s %16s\n", "scraper", "writes", "cpu us/scrape", "KiB copied/scrape",
+         "changes/scrape");
+  for (size_t writes : kWritesPerScrape) {
+    Print("snapshot", writes, MeasureSnapshot(options, &fixture, writes));
+    Print("delta", writes, MeasureDelta(options, &fixture, writes));
+  }
+  return 0;
+}
@@ -0,0 +1,207 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <lib/inspect/cpp/delta_snapshot.h>
+#include <lib/inspect/cpp/inspect.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using inspect::PropertyChange;
+
+std::string ToString(fit::string_view view) { return std::string(view.data(), view.size()); }
+
+// Returns the int properties in |snapshot| by name.
+std::map<std::string, int64_t> IntValues(inspect::Snapshot snapshot) {
+  std::map<std::string, int64_t> values;
+  auto result = inspect::ReadFlatFromSnapshot(std::move(snapshot));
+  if (result.is_error()) {
+    return values;
+  }
+  const inspect::FlatHierarchy hierarchy = result.take_value();
+  for (size_t i = 0; i < hierarchy.property_count(); i++) {
+    const auto& property = hierarchy.property(i);
+    if (property.format == inspect::PropertyFormat::kInt) {
+      values[ToString(property.name)] = property.int_value();
+    }
+  }
+  return values;
+}
+
+TEST(DeltaSnapshotDeviceTest, FirstUpdateReportsNoChanges) {
+  inspect::Inspector inspector;
+  inspect::IntProperty count = inspector.GetRoot().CreateInt("count", 1);
+
+  inspect::DeltaSnapshot delta;
+  std::vector<PropertyChange> changes;
+  ASSERT_EQ(ZX_OK, delta.Update(inspector.DuplicateVmo(), &changes));
+  EXPECT_TRUE(changes.empty());
+  EXPECT_TRUE(delta.snapshot());
+  EXPECT_EQ(1u, delta.stats().scrapes);
+}
+
+TEST(DeltaSnapshotDeviceTest, IdleScrapeReadsOnlyTheHeader) {
+  inspect::Inspector inspector;
+  inspect::IntProperty count = inspector.GetRoot().CreateInt("count", 1);
+  zx::vmo vmo = inspector.DuplicateVmo();
+
+  inspect::DeltaSnapshot delta;
+  std::vector<PropertyChange> changes;
+  ASSERT_EQ(ZX_OK, delta.Update(vmo, &changes));
+  const inspect::DeltaSnapshot::Stats before = delta.stats();
+  ASSERT_EQ(ZX_OK, delta.Update(vmo, &changes));
+  EXPECT_TRUE(changes.empty());
+  EXPECT_EQ(1u, delta.stats().unchanged_scrapes);
+  EXPECT_EQ(before.bytes_copied, delta.stats().bytes_copied);
+  EXPECT_EQ(before.bytes_read + sizeof(inspect::internal::Block), delta.stats().bytes_read);
+}
+
+TEST(DeltaSnapshotDeviceTest, ReportsAddedUpdatedAndRemovedProperties) {
+  inspect::Inspector inspector;
+  inspect::Node child = inspector.GetRoot().CreateChild("child");
+  inspect::IntProperty count = child.CreateInt("count", 1);
+  inspect::IntProperty old = child.CreateInt("old", 2);
+  zx::vmo vmo = inspector.DuplicateVmo();
+
+  inspect::DeltaSnapshot delta;
+  std::vector<PropertyChange> changes;
+  ASSERT_EQ(ZX_OK, delta.Update(vmo, &changes));
+
+  count.Set(5);
+  ASSERT_EQ(ZX_OK, delta.Update(vmo, &changes));
+  ASSERT_EQ(1u, changes.size());
+  EXPECT_EQ(PropertyChange::Kind::kUpdated, changes[0].kind);
+  EXPECT_EQ("count", ToString(changes[0].property.name));
+  EXPECT_EQ(5, changes[0].property.int_value());
+
+  // Add before removing, so that the new property does not reuse the block.
+  inspect::UintProperty fresh = child.CreateUint("fresh", 3);
+  old = inspect::IntProperty();
+  ASSERT_EQ(ZX_OK, delta.Update(vmo, &changes));
+  size_t added = 0;
+  size_t removed = 0;
+  for (const PropertyChange& change : changes) {
+    if (change.kind == PropertyChange::Kind::kAdded) {
+      added++;
+      EXPECT_EQ("fresh", ToString(change.property.name));
+      EXPECT_EQ(3u, change.property.uint_value());
+    } else if (change.kind == PropertyChange::Kind::kRemoved) {
+      removed++;
+    }
+  }
+  EXPECT_EQ(1u, added);
+  EXPECT_EQ(1u, removed);
+}
+
+TEST(DeltaSnapshotDeviceTest, ReportsStringsChangedInTheirExtents) {
+  inspect::Inspector inspector;
+  inspect::StringProperty state = inspector.GetRoot().CreateString("state", std::string(100, 'a'));
+  zx::vmo vmo = inspector.DuplicateVmo();
+
+  inspect::DeltaSnapshot delta;
+  std::vector<PropertyChange> changes;
+  ASSERT_EQ(ZX_OK, delta.Update(vmo, &changes));
+
+  const std::string value = std::string(99, 'a') + "b";
+  state.Set(value);
+  ASSERT_EQ(ZX_OK, delta.Update(vmo, &changes));
+  ASSERT_EQ(1u, changes.size());
+  EXPECT_EQ(PropertyChange::Kind::kUpdated, changes[0].kind);
+  std::string scratch;
+  EXPECT_EQ(value, ToString(delta.ReadBuffer(changes[0].property, &scratch)));
+}
+
+TEST(DeltaSnapshotDeviceTest, LeavesHeldSnapshotsUnchanged) {
+  inspect::Inspector inspector;
+  inspect::IntProperty count = inspector.GetRoot().CreateInt("count", 1);
+  zx::vmo vmo = inspector.DuplicateVmo();
+
+  inspect::DeltaSnapshot delta;
+  std::vector<PropertyChange> changes;
+  ASSERT_EQ(ZX_OK, delta.Update(vmo, &changes));
+  inspect::Snapshot held = delta.snapshot();
+  std::vector<uint8_t> bytes(held.data(), held.data() + held.size());
+
+  count.Set(2);
+  ASSERT_EQ(ZX_OK, delta.Update(vmo, &changes));
+  ASSERT_EQ(1u, changes.size());
+  EXPECT_EQ(bytes, std::vector<uint8_t>(held.data(), held.data() + held.size()));
+  EXPECT_NE(held.data(), delta.snapshot().data());
+}
+
+TEST(DeltaSnapshotDeviceTest, ReportsChangesMadeBeforeAFailedScrape) {
+  inspect::Inspector inspector;
+  std::vector<inspect::IntProperty> properties;
+  for (int i = 0; i < 1000; i++) {
+    properties.push_back(inspector.GetRoot().CreateInt("value-" + std::to_string(i), i));
+  }
+  zx::vmo vmo = inspector.DuplicateVmo();
+
+  // With a single read attempt, a scrape fails once it sees a concurrent
+  // write, possibly after reading some of the pages that changed.
+  inspect::DeltaSnapshot delta(inspect::DeltaSnapshot::Options{.read_attempts = 1});
+  std::vector<PropertyChange> changes;
+  ASSERT_EQ(ZX_OK, delta.Update(vmo, &changes));
+
+  std::atomic<bool> started{false};
+  std::atomic<bool> stop{false};
+  std::thread writer([&] {
+    for (int64_t value = 0; !stop.load(); value++) {
+      properties[value % properties.size()].Set(-value);
+      started.store(true);
+    }
+  });
+  while (!started.load()) {
+    std::this_thread::yield();
+  }
+  inspect::Snapshot before;
+  bool failed = false;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!failed && std::chrono::steady_clock::now() < deadline) {
+    before = delta.snapshot();
+    failed = delta.Update(vmo, &changes) != ZX_OK;
+  }
+  stop.store(true);
+  writer.join();
+  ASSERT_TRUE(failed);
+  EXPECT_TRUE(changes.empty());
+  EXPECT_EQ(before.data(), delta.snapshot().data());
+
+  // The next scrape reports everything written since the last scrape that
+  // succeeded, including what the failed one read.
+  ASSERT_EQ(ZX_OK, delta.Update(vmo, &changes));
+  inspect::Snapshot expected;
+  ASSERT_EQ(ZX_OK, inspect::Snapshot::Create(vmo, &expected));
+  EXPECT_EQ(std::vector<uint8_t>(expected.data(), expected.data() + expected.size()),
+            std::vector<uint8_t>(delta.snapshot().data(),
+                                 delta.snapshot().data() + delta.snapshot().size()));
+
+  const std::map<std::string, int64_t> old_values = IntValues(before);
+  const std::map<std::string, int64_t> new_values = IntValues(expected);
+  ASSERT_EQ(properties.size(), new_values.size());
+  std::set<std::string> changed;
+  for (const auto& entry : new_values) {
+    if (old_values.at(entry.first) != entry.second) {
+      changed.insert(entry.first);
+    }
+  }
+  EXPECT_FALSE(changed.empty());
+  std::set<std::string> reported;
+  for (const auto& change : changes) {
+    EXPECT_EQ(PropertyChange::Kind::kUpdated, change.kind);
+    reported.insert(ToString(change.property.name));
+  }
+  EXPECT_EQ(changed, reported);
+}
+
+}  // namespace
@@ -0,0 +1,144 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <lib/inspect/cpp/flat_hierarchy.h>
+#include <lib/inspect/cpp/inspect.h>
+#include <lib/inspect/cpp/reader.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using inspect::FlatHierarchy;
+
+std::string ToString(fit::string_view view) { return std::string(view.data(), view.size()); }
+
+// Expects |a| and |b| to hold the same nodes and properties. Both must be
+// sorted.
+void ExpectSameHierarchy(const inspect::Hierarchy& a, const inspect::Hierarchy& b) {
+  EXPECT_EQ(a.name(), b.name());
+  ASSERT_EQ(a.node().properties().size(), b.node().properties().size()) << a.name();
+  for (size_t i = 0; i < a.node().properties().size(); i++) {
+    const inspect::PropertyValue& pa = a.node().properties()[i];
+    const inspect::PropertyValue& pb = b.node().properties()[i];
+    EXPECT_EQ(pa.name(), pb.name());
+    EXPECT_EQ(pa.format(), pb.format()) << pa.name();
+    if (pa.Contains<inspect::IntPropertyValue>()) {
+      EXPECT_EQ(pa.Get<inspect::IntPropertyValue>().value(),
+                pb.Get<inspect::IntPropertyValue>().value());
+    } else if (pa.Contains<inspect::StringPropertyValue>()) {
+      EXPECT_EQ(pa.Get<inspect::StringPropertyValue>().value(),
+                pb.Get<inspect::StringPropertyValue>().value());
+    } else if (pa.Contains<inspect::ByteVectorPropertyValue>()) {
+      EXPECT_EQ(pa.Get<inspect::ByteVectorPropertyValue>().value(),
+                pb.Get<inspect::ByteVectorPropertyValue>().value());
+    } else if (pa.Contains<inspect::UintArrayValue>()) {
+      EXPECT_EQ(pa.Get<inspect::UintArrayValue>().value(),
+                pb.Get<inspect::UintArrayValue>().value());
+    }
+  }
+  ASSERT_EQ(a.children().size(), b.children().size()) << a.name();
+  for (size_t i = 0; i < a.children().size(); i++) {
+    ExpectSameHierarchy(a.children()[i], b.children()[i]);
+  }
+}
+
+TEST(FlatHierarchyDeviceTest, ReadsNodesAndProperties) {
+  inspect::Inspector inspector;
+  inspect::Node& root = inspector.GetRoot();
+  inspect::Node child = root.CreateChild("child");
+  inspect::Node grandchild = child.CreateChild("grandchild");
+  inspect::IntProperty count = child.CreateInt("count", -3);
+  inspect::StringProperty state = grandchild.CreateString("state", "idle");
+  inspect::UintProperty bytes = root.CreateUint("bytes", 42);
+
+  auto result = inspect::ReadFlatFromBuffer(inspector.CopyBytes());
+  ASSERT_TRUE(result.is_ok());
+  const FlatHierarchy& flat = result.value();
+
+  ASSERT_EQ(3u, flat.node_count());
+  EXPECT_EQ("root", ToString(flat.node(FlatHierarchy::kRoot).name));
+  ASSERT_EQ(1u, flat.node(FlatHierarchy::kRoot).properties.size());
+  const FlatHierarchy::Property& root_bytes =
+      flat.property(flat.node(FlatHierarchy::kRoot).properties.begin);
+  EXPECT_EQ("bytes", ToString(root_bytes.name));
+  EXPECT_EQ(inspect::PropertyFormat::kUint, root_bytes.format);
+  EXPECT_EQ(42u, root_bytes.uint_value());
+
+  FlatHierarchy::Index child_index = flat.FindChild(FlatHierarchy::kRoot, "child");
+  ASSERT_LT(child_index, flat.node_count());
+  EXPECT_EQ(FlatHierarchy::kRoot, flat.node(child_index).parent);
+  ASSERT_EQ(1u, flat.node(child_index).properties.size());
+  EXPECT_EQ(-3, flat.property(flat.node(child_index).properties.begin).int_value());
+
+  FlatHierarchy::Index grandchild_index = flat.FindChild(child_index, "grandchild");
+  ASSERT_LT(grandchild_index, flat.node_count());
+  EXPECT_EQ(child_index, flat.node(grandchild_index).parent);
+  const FlatHierarchy::Property& grandchild_state =
+      flat.property(flat.node(grandchild_index).properties.begin);
+  EXPECT_EQ(inspect::PropertyFormat::kString, grandchild_state.format);
+  std::string scratch;
+  EXPECT_EQ("idle", ToString(flat.ReadBuffer(grandchild_state, &scratch)));
+
+  EXPECT_EQ(flat.node_count(), flat.FindChild(FlatHierarchy::kRoot, "missing"));
+}
+
+TEST(FlatHierarchyDeviceTest, ReadsValuesSpanningExtents) {
+  inspect::Inspector inspector;
+  const std::string long_value(3000, 'x');
+  inspect::StringProperty state = inspector.GetRoot().CreateString("state", long_value);
+
+  auto result = inspect::ReadFlatFromBuffer(inspector.CopyBytes());
+  ASSERT_TRUE(result.is_ok());
+  const FlatHierarchy& flat = result.value();
+  ASSERT_EQ(1u, flat.property_count());
+  std::string scratch;
+  fit::string_view value = flat.ReadBuffer(flat.property(0), &scratch);
+  EXPECT_EQ(long_value, ToString(value));
+  EXPECT_EQ(scratch.data(), value.data());
+}
+
+TEST(FlatHierarchyDeviceTest, MatchesReadFromBuffer) {
+  inspect::Inspector inspector;
+  std::vector<inspect::Node> nodes;
+  nodes.push_back(inspector.GetRoot().CreateChild("n0"));
+  for (size_t i = 1; i < 200; i++) {
+    nodes.push_back(nodes[(i * 7) % nodes.size()].CreateChild("n" + std::to_string(i)));
+    inspect::Node& node = nodes.back();
+    inspector.emplace(node.CreateInt("id", static_cast<int64_t>(i)));
+    if (i % 3 == 0) {
+      inspector.emplace(node.CreateString("name", std::string(i, 'a')));
+    }
+    if (i % 5 == 0) {
+      inspector.emplace(node.CreateByteVector("raw", std::vector<uint8_t>(i % 40, 7)));
+    }
+    if (i % 7 == 0) {
+      auto array = node.CreateUintArray("hist", 4);
+      array.Set(2, i);
+      inspector.emplace(std::move(array));
+    }
+  }
+
+  std::vector<uint8_t> bytes = inspector.CopyBytes();
+  auto expected = inspect::ReadFromBuffer(bytes);
+  auto flat = inspect::ReadFlatFromBuffer(bytes);
+  ASSERT_TRUE(expected.is_ok());
+  ASSERT_TRUE(flat.is_ok());
+  EXPECT_EQ(201u, flat.value().node_count());
+
+  inspect::Hierarchy a = expected.take_value();
+  inspect::Hierarchy b = flat.value().ToHierarchy();
+  a.Sort();
+  b.Sort();
+  ExpectSameHierarchy(a, b);
+}
+
+TEST(FlatHierarchyDeviceTest, RejectsInvalidBuffer) {
+  EXPECT_TRUE(inspect::ReadFlatFromBuffer(std::vector<uint8_t>(4096, 0)).is_error());
+}
+
+}  // namespace
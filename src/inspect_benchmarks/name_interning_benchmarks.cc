@@ -0,0 +1,121 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Benchmark for the VMO space saved by interning names. Fills an Inspector
+/// with children that each have the properties "count", "latency_ns" and
+/// "status", then scans its VMO and reports
+///
+///   vmo KiB     the bytes of the VMO in use
+///   names KiB   the bytes of the name blocks stored, each name once
+///   unshared    the bytes the name blocks would take with a copy per value
+///   saved       the difference
+///
+/// The children are all named "child" for "repeated", and "child-N" for
+/// "unique", where only the property names repeat.
+///
+/// Usage: name_interning_benchmarks [--children N]
+
+#include <lib/inspect/cpp/inspect.h>
+#include <lib/inspect/cpp/vmo/scanner.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using inspect::internal::Block;
+using inspect::internal::BlockIndex;
+using inspect::internal::BlockType;
+
+struct Options {
+  size_t children = 10000;
+};
+
+struct Usage {
+  size_t vmo_bytes = 0;
+  size_t name_bytes = 0;
+  size_t unshared_name_bytes = 0;
+};
+
+// Scans the VMO of |inspector|, counting each name block once as stored, and
+// once per value referring to it as it would be stored without sharing.
+Usage Measure(const inspect::Inspector& inspector) {
+  std::vector<uint8_t> bytes = inspector.CopyBytes();
+  std::unordered_map<BlockIndex, size_t> name_sizes;
+  std::vector<BlockIndex> references;
+  inspect::internal::ScanBlocks(
+      bytes.data(), bytes.size(), [&](BlockIndex index, const Block* block) {
+        switch (inspect::internal::GetType(block)) {
+          case BlockType::kName:
+            name_sizes[index] = inspect::internal::OrderToSize(inspect::internal::GetOrder(block));
+            break;
+          case BlockType::kNodeValue:
+          case BlockType::kTombstone:
+          case BlockType::kIntValue:
+          case BlockType::kUintValue:
+          case BlockType::kDoubleValue:
+          case BlockType::kBoolValue:
+          case BlockType::kArrayValue:
+          case BlockType::kBufferValue:
+          case BlockType::kLinkValue:
+            references.push_back(
+                inspect::internal::ValueBlockFields::NameIndex::Get<BlockIndex>(block->header));
+            break;
+          default:
+            break;
+        }
+        return true;
+      });
+
+  Usage usage;
+  usage.vmo_bytes = inspector.GetStats().size;
+  for (const auto& name : name_sizes) {
+    usage.name_bytes += name.second;
+  }
+  for (BlockIndex reference : references) {
+    usage.unshared_name_bytes += name_sizes[reference];
+  }
+  return usage;
+}
+
+void Run(const char* label, const Options& options, bool unique_children) {
+  inspect::Inspector inspector(inspect::InspectSettings{64 << 20});
+  std::vector<inspect::Node> children;
+  for (size_t i = 0; i < options.children; i++) {
+    children.push_back(inspector.GetRoot().CreateChild(
+        unique_children ? "child-" + std::to_string(i) : std::string("child")));
+    inspect::Node& child = children.back();
+    inspector.emplace(child.CreateUint("count", i));
+    inspector.emplace(child.CreateUint("latency_ns", i * 1000));
+    inspector.emplace(child.CreateString("status", "ok"));
+  }
+
+  const Usage usage = Measure(inspector);
+  printf("%-10s %9zu %9.1f %10.1f %10.1f %10.1f\n", label, options.children,
+         usage.vmo_bytes / 1024.0, usage.name_bytes / 1024.0, usage.unshared_name_bytes / 1024.0,
+         (usage.unshared_name_bytes - usage.name_bytes) / 1024.0);
+  fflush(stdout);
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  Options options;
+  for (int i = 1; i < argc - 1; ++i) {
+    if (!strcmp("--children", argv[i])) {
+      options.children = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    }
+  }
+
+  printf("%-10s %9s %9s %10s %10s %10s\n", "children", "count", "vmo KiB", "names KiB",
+         "unshared", "saved");
+  Run("repeated", options, false);
+  Run("unique", options, true);
+  return 0;
+}
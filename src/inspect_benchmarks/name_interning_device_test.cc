@@ -0,0 +1,85 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <lib/inspect/cpp/inspect.h>
+#include <lib/inspect/cpp/reader.h>
+#include <lib/inspect/cpp/vmo/scanner.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using inspect::internal::Block;
+using inspect::internal::BlockIndex;
+using inspect::internal::BlockType;
+
+// Returns the number of name blocks in the Inspector's VMO.
+size_t CountNames(const inspect::Inspector& inspector) {
+  std::vector<uint8_t> bytes = inspector.CopyBytes();
+  size_t names = 0;
+  inspect::internal::ScanBlocks(bytes.data(), bytes.size(), [&](BlockIndex, const Block* block) {
+    if (inspect::internal::GetType(block) == BlockType::kName) {
+      names++;
+    }
+    return true;
+  });
+  return names;
+}
+
+TEST(NameInterningDeviceTest, SharesRepeatedNames) {
+  inspect::Inspector inspector;
+  std::vector<inspect::Node> children;
+  for (size_t i = 0; i < 100; i++) {
+    children.push_back(inspector.GetRoot().CreateChild("child"));
+    inspector.emplace(children.back().CreateUint("count", i));
+    inspector.emplace(children.back().CreateString("status", "ok"));
+  }
+  EXPECT_EQ(3u, CountNames(inspector));
+
+  auto result = inspect::ReadFromVmo(inspector.DuplicateVmo());
+  ASSERT_TRUE(result.is_ok());
+  const inspect::Hierarchy& root = result.value();
+  ASSERT_EQ(100u, root.children().size());
+  for (const inspect::Hierarchy& child : root.children()) {
+    EXPECT_EQ("child", child.name());
+    EXPECT_NE(nullptr, child.node().get_property<inspect::UintPropertyValue>("count"));
+    EXPECT_NE(nullptr, child.node().get_property<inspect::StringPropertyValue>("status"));
+  }
+}
+
+TEST(NameInterningDeviceTest, FreesNamesWithTheirLastReference) {
+  inspect::Inspector inspector;
+  inspect::IntProperty a = inspector.GetRoot().CreateInt("count", 1);
+  inspect::IntProperty b = inspector.GetRoot().CreateInt("count", 2);
+  EXPECT_EQ(1u, CountNames(inspector));
+
+  a = inspect::IntProperty();
+  EXPECT_EQ(1u, CountNames(inspector));
+
+  b = inspect::IntProperty();
+  EXPECT_EQ(0u, CountNames(inspector));
+
+  // The name can be stored again once freed.
+  inspect::IntProperty c = inspector.GetRoot().CreateInt("count", 3);
+  EXPECT_EQ(1u, CountNames(inspector));
+}
+
+TEST(NameInterningDeviceTest, KeepsNamesOfTombstones) {
+  inspect::Inspector inspector;
+  inspect::Node parent = inspector.GetRoot().CreateChild("parent");
+  inspect::IntProperty value = parent.CreateInt("parent", 1);
+  EXPECT_EQ(1u, CountNames(inspector));
+
+  // The node becomes a tombstone still referenced by its property.
+  parent = inspect::Node();
+  EXPECT_EQ(1u, CountNames(inspector));
+
+  value = inspect::IntProperty();
+  EXPECT_EQ(0u, CountNames(inspector));
+}
+
+}  // namespace
@@ -0,0 +1,137 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Benchmark for reading large Inspect snapshots. For each snapshot size,
+/// fills an Inspector with a synthetic tree of nodes, each with a few
+/// properties, copies out its bytes, and measures
+///
+///   hierarchy       inspect::ReadFromBuffer, building a Hierarchy
+///   flat            inspect::ReadFlatFromBuffer, building a FlatHierarchy
+///   flat+hierarchy  ReadFlatFromBuffer, then FlatHierarchy::ToHierarchy
+///
+/// and reports the time and the heap allocations per read.
+///
+/// Usage: reader_benchmarks [--max-mib N] [--min-time-ms N]
+
+#include <lib/inspect/cpp/flat_hierarchy.h>
+#include <lib/inspect/cpp/inspect.h>
+#include <lib/inspect/cpp/reader.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "src/testing/allocation_counter.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  size_t max_mib = 64;
+  std::chrono::milliseconds min_time{1000};
+};
+
+// Fills an Inspector of |size| bytes and returns a copy of its bytes, and
+// the number of nodes in |node_count|.
+//
+// Each node hangs off an earlier one picked pseudo-randomly, so the tree is
+// both wide and deep, and has an int, a uint and, for one in four, a string.
+std::vector<uint8_t> MakeSnapshot(size_t size, size_t* node_count) {
+  inspect::Inspector inspector(inspect::InspectSettings{size});
+  std::vector<inspect::Node> nodes;
+  nodes.push_back(inspector.GetRoot().CreateChild("connections"));
+  uint64_t seed = 1;
+  while (inspector.GetStats().size < inspector.GetStats().maximum_size) {
+    for (size_t i = 0; i < 64; i++) {
+      seed = seed * 6364136223846793005u + 1442695040888963407u;
+      size_t parent = static_cast<size_t>(seed >> 33) % nodes.size();
+      const size_t id = nodes.size();
+      nodes.push_back(nodes[parent].CreateChild("connection-" + std::to_string(id)));
+      inspect::Node& node = nodes.back();
+      inspector.emplace(node.CreateInt("requests", static_cast<int64_t>(id)));
+      inspector.emplace(node.CreateUint("bytes", id * 4096));
+      if (id % 4 == 0) {
+        inspector.emplace(node.CreateString("state", id % 8 == 0 ? "idle" : "waiting for reply"));
+      }
+    }
+  }
+  *node_count = nodes.size();
+  return inspector.CopyBytes();
+}
+
+struct Measurement {
+  double ms_per_read;
+  double allocations_per_read;
+};
+
+// Runs |read| on fresh copies of |bytes| for at least the minimum time. Only
+// the read is timed; copying the input and destroying the result are not.
+template <typename Read>
+Measurement Measure(const Options& options, const std::vector<uint8_t>& bytes, Read read) {
+  Clock::duration elapsed{};
+  size_t allocations = 0;
+  size_t reads = 0;
+  while (elapsed < options.min_time || reads < 3) {
+    std::vector<uint8_t> copy = bytes;
+    const size_t allocations_before = testing_support::AllocationCount();
+    const Clock::time_point start = Clock::now();
+    auto result = read(std::move(copy));
+    elapsed += Clock::now() - start;
+    allocations += testing_support::AllocationCount() - allocations_before;
+    reads++;
+    if (result.is_error()) {
+      fprintf(stderr, "failed to read the snapshot\n");
+      exit(1);
+    }
+  }
+  Measurement measurement;
+  measurement.ms_per_read =
+      std::chrono::duration<double, std::milli>(elapsed).count() / static_cast<double>(reads);
+  measurement.allocations_per_read = static_cast<double>(allocations) / static_cast<double>(reads);
+  return measurement;
+}
+
+void Print(const char* label, size_t mib, size_t nodes, const Measurement& measurement) {
+  printf("%-16s %6zu %9zu %12.2f %14.0f\n", label, mib, nodes, measurement.ms_per_read,
+         measurement.allocations_per_read);
+  fflush(stdout);
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  Options options;
+  for (int i = 1; i < argc - 1; ++i) {
+    if (!strcmp("--max-mib", argv[i])) {
+      options.max_mib = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (!strcmp("--min-time-ms", argv[i])) {
+      options.min_time = std::chrono::milliseconds(std::max(1l, strtol(argv[++i], nullptr, 10)));
+    }
+  }
+
+  printf("%-16s %6s %9s %12s %14s\n", "reader", "MiB", "nodes", "ms/read", "allocs/read");
+  for (size_t mib = 1; mib <= options.max_mib; mib *= 4) {
+    size_t nodes = 0;
+    std::vector<uint8_t> bytes = MakeSnapshot(mib << 20, &nodes);
+    Print("hierarchy", mib, nodes, Measure(options, bytes, [](std::vector<uint8_t> buffer) {
+            return inspect::ReadFromBuffer(std::move(buffer));
+          }));
+    Print("flat", mib, nodes, Measure(options, bytes, [](std::vector<uint8_t> buffer) {
+            return inspect::ReadFlatFromBuffer(std::move(buffer));
+          }));
+    Print("flat+hierarchy", mib, nodes, Measure(options, bytes, [](std::vector<uint8_t> buffer) {
+            auto flat = inspect::ReadFlatFromBuffer(std::move(buffer));
+            if (flat.is_error()) {
+              return fit::result<inspect::Hierarchy>(fit::error());
+            }
+            return fit::result<inspect::Hierarchy>(fit::ok(flat.value().ToHierarchy()));
+          }));
+  }
+  return 0;
+}
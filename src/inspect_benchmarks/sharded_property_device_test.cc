@@ -0,0 +1,61 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <lib/fit/single_threaded_executor.h>
+#include <lib/inspect/cpp/inspect.h>
+#include <lib/inspect/cpp/reader.h>
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+TEST(ShardedPropertyDeviceTest, SumsAddsFromManyThreads) {
+  inspect::Inspector inspector;
+  inspect::ShardedUintProperty count = inspector.GetRoot().CreateShardedUint("count");
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < 32; i++) {
+    threads.emplace_back([&] {
+      for (size_t j = 0; j < 1000; j++) {
+        count.Add(2);
+      }
+      count.Subtract(1);
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(32u * 1999u, count.Get());
+}
+
+TEST(ShardedPropertyDeviceTest, PublishesTheSumToReaders) {
+  inspect::Inspector inspector;
+  inspect::Node child = inspector.GetRoot().CreateChild("child");
+  inspect::ShardedIntProperty count = child.CreateShardedInt("count");
+  count.Add(5);
+  count.Subtract(7);
+
+  auto result = fit::run_single_threaded(inspect::ReadFromInspector(inspector));
+  ASSERT_TRUE(result.is_ok());
+  const inspect::Hierarchy* node = result.value().GetByPath({"child"});
+  ASSERT_NE(nullptr, node);
+  const auto* value = node->node().get_property<inspect::IntPropertyValue>("count");
+  ASSERT_NE(nullptr, value);
+  EXPECT_EQ(-2, value->value());
+}
+
+TEST(ShardedPropertyDeviceTest, DefaultIsANoOp) {
+  inspect::ShardedIntProperty count;
+  count.Add(1);
+  EXPECT_FALSE(count);
+  EXPECT_EQ(0, count.Get());
+
+  inspect::Node node;
+  EXPECT_FALSE(node.CreateShardedUint("count"));
+}
+
+}  // namespace
@@ -0,0 +1,337 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "load_generator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace rot13 {
+namespace {
+
+constexpr int kSubBucketBits = 6;
+constexpr uint64_t kSubBuckets = 1u << kSubBucketBits;
+constexpr int kMaxValueBits = 40;
+constexpr uint64_t kMaxValue = (uint64_t(1) << kMaxValueBits) - 1;
+constexpr size_t kNumBuckets = (kMaxValueBits - kSubBucketBits + 1) * kSubBuckets;
+
+const double kReportedPercentiles[] = {0.5, 0.9, 0.99, 0.999};
+const char *const kReportedPercentileNames[] = {"p50", "p90", "p99", "p999"};
+
+// Parses a whole decimal number from [begin, end). Returns false if the range
+// is empty or contains anything else.
+bool ParseSize(const char *begin, const char *end, size_t *out) {
+  if (begin == end) {
+    return false;
+  }
+  size_t value = 0;
+  for (const char *p = begin; p != end; p++) {
+    if (*p < '0' || *p > '9') {
+      return false;
+    }
+    value = value * 10 + static_cast<size_t>(*p - '0');
+  }
+  *out = value;
+  return true;
+}
+
+}  // namespace
+
+LatencyHistogram::LatencyHistogram() : buckets_(kNumBuckets, 0) {}
+
+size_t LatencyHistogram::BucketFor(uint64_t nanos) {
+  nanos = std::min(nanos, kMaxValue);
+  if (nanos < kSubBuckets) {
+    return static_cast<size_t>(nanos);
+  }
+  int msb = 63 - __builtin_clzll(nanos);
+  int shift = msb - kSubBucketBits;
+  return static_cast<size_t>((shift + 1) * kSubBuckets + ((nanos >> shift) & (kSubBuckets - 1)));
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t bucket) {
+  if (bucket < kSubBuckets) {
+    return bucket;
+  }
+  int shift = static_cast<int>(bucket / kSubBuckets) - 1;
+  uint64_t sub = bucket % kSubBuckets;
+  return ((kSubBuckets + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t nanos) {
+  buckets_[BucketFor(nanos)]++;
+  count_++;
+  min_ = std::min(min_, nanos);
+  max_ = std::max(max_, nanos);
+  sum_ += static_cast<double>(nanos);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram &other) {
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    buckets_[i] += other.buckets_[i];
+  }
+  count_ += other.count_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  sum_ += other.sum_;
+}
+
+double LatencyHistogram::mean() const {
+  return count_ ? sum_ / static_cast<double>(count_) : 0;
+}
+
+uint64_t LatencyHistogram::Percentile(double quantile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  quantile = std::min(std::max(quantile, 0.0), 1.0);
+  uint64_t rank = std::max<uint64_t>(
+      static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(count_))), 1);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return std::min(BucketUpperBound(i), max_);
+    }
+  }
+  return max_;
+}
+
+SizeDistribution::SizeDistribution() : entries_{{64, 64, 1}}, total_weight_(1), spec_("64") {}
+
+bool SizeDistribution::Parse(const std::string &spec, SizeDistribution *out) {
+  SizeDistribution parsed;
+  parsed.entries_.clear();
+  parsed.total_weight_ = 0;
+  parsed.spec_ = spec;
+
+  const char *p = spec.c_str();
+  const char *end = p + spec.size();
+  while (true) {
+    const char *entry_end = std::find(p, end, ',');
+    const char *weight_sep = std::find(p, entry_end, ':');
+    const char *range_sep = std::find(p, weight_sep, '-');
+
+    Entry entry = {0, 0, 1};
+    if (!ParseSize(p, range_sep, &entry.min)) {
+      return false;
+    }
+    entry.max = entry.min;
+    if (range_sep != weight_sep &&
+        (!ParseSize(range_sep + 1, weight_sep, &entry.max) || entry.max < entry.min)) {
+      return false;
+    }
+    if (weight_sep != entry_end) {
+      size_t weight = 0;
+      if (!ParseSize(weight_sep + 1, entry_end, &weight) || weight == 0 || weight > 1000000) {
+        return false;
+      }
+      entry.weight = static_cast<uint32_t>(weight);
+    }
+    parsed.entries_.push_back(entry);
+    parsed.total_weight_ += entry.weight;
+    if (entry_end == end) {
+      break;
+    }
+    p = entry_end + 1;
+  }
+  *out = std::move(parsed);
+  return true;
+}
+
+size_t SizeDistribution::Sample(std::mt19937 *rng) const {
+  const Entry *entry = &entries_.front();
+  if (entries_.size() > 1) {
+    uint32_t pick = std::uniform_int_distribution<uint32_t>(0, total_weight_ - 1)(*rng);
+    for (const Entry &candidate : entries_) {
+      if (pick < candidate.weight) {
+        entry = &candidate;
+        break;
+      }
+      pick -= candidate.weight;
+    }
+  }
+  if (entry->min == entry->max) {
+    return entry->min;
+  }
+  return std::uniform_int_distribution<size_t>(entry->min, entry->max)(*rng);
+}
+
+size_t SizeDistribution::max_size() const {
+  size_t max = 0;
+  for (const Entry &entry : entries_) {
+    max = std::max(max, entry.max);
+  }
+  return max;
+}
+
+bool ParseLoadOptions(int argc, const char **argv, LoadOptions *options, std::string *json_path) {
+  for (int i = 1; i < argc - 1; ++i) {
+    if (!strcmp("--connections", argv[i])) {
+      options->connections = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp("--depth", argv[i])) {
+      options->depth = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp("--sizes", argv[i])) {
+      const char *spec = argv[++i];
+      if (!SizeDistribution::Parse(spec, &options->sizes)) {
+        fprintf(stderr, "invalid --sizes '%s'; expected SIZE[-MAX][:WEIGHT],...\n", spec);
+        return false;
+      }
+    } else if (!strcmp("--warmup-ms", argv[i])) {
+      options->warmup = std::chrono::milliseconds(strtoul(argv[++i], nullptr, 10));
+    } else if (!strcmp("--duration-ms", argv[i])) {
+      options->duration = std::chrono::milliseconds(strtoul(argv[++i], nullptr, 10));
+    } else if (!strcmp("--json", argv[i])) {
+      *json_path = argv[++i];
+    }
+  }
+  if (options->connections == 0 || options->depth == 0) {
+    fprintf(stderr, "--connections and --depth must be at least 1\n");
+    return false;
+  }
+  return true;
+}
+
+void LoadReport::Print(FILE *out) const {
+  fprintf(out, "%zu connections x %zu in flight, sizes %s, %.1f s\n", connections, depth,
+          sizes.c_str(), seconds);
+  fprintf(out, "%14s %10s %8s", "requests/s", "MB/s", "errors");
+  for (const char *name : kReportedPercentileNames) {
+    fprintf(out, " %10s", name);
+  }
+  fprintf(out, " %10s   (latency in us)\n", "max");
+  fprintf(out, "%14.0f %10.2f %8llu", requests_per_second(), megabytes_per_second(),
+          static_cast<unsigned long long>(errors));
+  for (double quantile : kReportedPercentiles) {
+    fprintf(out, " %10.1f", static_cast<double>(latency.Percentile(quantile)) / 1e3);
+  }
+  fprintf(out, " %10.1f\n", static_cast<double>(latency.max()) / 1e3);
+}
+
+bool LoadReport::WriteJson(const char *path) const {
+  FILE *out = fopen(path, "w");
+  if (!out) {
+    return false;
+  }
+  fprintf(out, "{\n");
+  fprintf(out, "  \"connections\": %zu,\n", connections);
+  fprintf(out, "  \"depth\": %zu,\n", depth);
+  // The size spec only contains digits and separators, so it needs no escaping.
+  fprintf(out, "  \"sizes\": \"%s\",\n", sizes.c_str());
+  fprintf(out, "  \"seconds\": %.6f,\n", seconds);
+  fprintf(out, "  \"requests\": %llu,\n", static_cast<unsigned long long>(requests));
+  fprintf(out, "  \"bytes\": %llu,\n", static_cast<unsigned long long>(bytes));
+  fprintf(out, "  \"errors\": %llu,\n", static_cast<unsigned long long>(errors));
+  fprintf(out, "  \"requests_per_second\": %.3f,\n", requests_per_second());
+  fprintf(out, "  \"megabytes_per_second\": %.3f,\n", megabytes_per_second());
+  fprintf(out, "  \"latency_ns\": {\n");
+  fprintf(out, "    \"min\": %llu,\n", static_cast<unsigned long long>(latency.min()));
+  fprintf(out, "    \"mean\": %.1f,\n", latency.mean());
+  for (size_t i = 0; i < sizeof(kReportedPercentiles) / sizeof(kReportedPercentiles[0]); i++) {
+    fprintf(out, "    \"%s\": %llu,\n", kReportedPercentileNames[i],
+            static_cast<unsigned long long>(latency.Percentile(kReportedPercentiles[i])));
+  }
+  fprintf(out, "    \"max\": %llu\n", static_cast<unsigned long long>(latency.max()));
+  fprintf(out, "  }\n}\n");
+  return fclose(out) == 0;
+}
+
+LoadGenerator::LoadGenerator(LoadTarget *target, LoadOptions options)
+    : target_(target), options_(std::move(options)) {
+  payload_.resize(options_.sizes.max_size());
+  for (size_t i = 0; i < payload_.size(); i++) {
+    // Printable ASCII, mostly letters, so the server does real work.
+    payload_[i] = static_cast<char>(' ' + (i * 7) % 95);
+  }
+  for (size_t i = 0; i < options_.connections; i++) {
+    auto connection = std::make_unique<Connection>();
+    connection->rng.seed(options_.seed + static_cast<uint32_t>(i));
+    connections_.push_back(std::move(connection));
+  }
+}
+
+LoadGenerator::~LoadGenerator() = default;
+
+void LoadGenerator::Start(fit::closure on_done) {
+  on_done_ = std::move(on_done);
+  measure_start_ = Clock::now() + options_.warmup;
+  measure_end_ = measure_start_ + options_.duration;
+  active_connections_ = connections_.size();
+
+  for (size_t index = 0; index < connections_.size(); index++) {
+    Connection &connection = *connections_[index];
+    std::vector<size_t> sizes;
+    {
+      // Count the whole window as outstanding before sending any of it, so an
+      // early reply cannot retire the connection.
+      std::lock_guard<std::mutex> lock(connection.mutex);
+      connection.outstanding = options_.depth;
+      for (size_t i = 0; i < options_.depth; i++) {
+        sizes.push_back(options_.sizes.Sample(&connection.rng));
+      }
+    }
+    for (size_t size : sizes) {
+      Send(index, size);
+    }
+  }
+}
+
+void LoadGenerator::Send(size_t index, size_t size) {
+  Clock::time_point sent = Clock::now();
+  target_->Encrypt(index, std::string(payload_.data(), size),
+                   [this, index, size, sent](std::string reply) {
+                     OnReply(index, size, sent, reply);
+                   });
+}
+
+void LoadGenerator::OnReply(size_t index, size_t size, Clock::time_point sent,
+                            const std::string &reply) {
+  Clock::time_point now = Clock::now();
+  Connection &connection = *connections_[index];
+  bool send_next = now < measure_end_;
+  bool retired = false;
+  size_t next_size = 0;
+  {
+    std::lock_guard<std::mutex> lock(connection.mutex);
+    if (now >= measure_start_ && now < measure_end_) {
+      connection.requests++;
+      connection.bytes += size;
+      if (reply.size() != size) {
+        connection.errors++;
+      }
+      connection.latency.Record(
+          static_cast<uint64_t>(std::chrono::nanoseconds(now - sent).count()));
+    }
+    if (send_next) {
+      next_size = options_.sizes.Sample(&connection.rng);
+    } else {
+      retired = --connection.outstanding == 0;
+    }
+  }
+  if (send_next) {
+    Send(index, next_size);
+  } else if (retired && --active_connections_ == 0) {
+    on_done_();
+  }
+}
+
+LoadReport LoadGenerator::Report() const {
+  LoadReport report;
+  report.connections = options_.connections;
+  report.depth = options_.depth;
+  report.sizes = options_.sizes.spec();
+  report.seconds = std::chrono::duration<double>(options_.duration).count();
+  for (const std::unique_ptr<Connection> &connection : connections_) {
+    report.requests += connection->requests;
+    report.bytes += connection->bytes;
+    report.errors += connection->errors;
+    report.latency.Merge(connection->latency);
+  }
+  return report;
+}
+
+}  // namespace rot13
@@ -0,0 +1,190 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FUCHSIA_ROT13_CLIENT_LOAD_GENERATOR_H
+#define FUCHSIA_ROT13_CLIENT_LOAD_GENERATOR_H
+
+#include <lib/fit/function.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace rot13 {
+
+// Records latencies in log-linear buckets. Each power of two is split into 64
+// linear buckets, so every recorded value is reported to within about 1.6%.
+// Values from one nanosecond up to about 18 minutes are kept; larger ones are
+// clamped.
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+
+  void Record(uint64_t nanos);
+  void Merge(const LatencyHistogram &other);
+
+  uint64_t count() const { return count_; }
+  uint64_t min() const { return count_ ? min_ : 0; }
+  uint64_t max() const { return max_; }
+  double mean() const;
+
+  // Returns a value that at least |quantile| of the recorded values are at or
+  // below: the upper bound of the bucket that holds that rank, capped at
+  // max(). |quantile| is in [0, 1].
+  uint64_t Percentile(double quantile) const;
+
+ private:
+  static size_t BucketFor(uint64_t nanos);
+  static uint64_t BucketUpperBound(size_t bucket);
+
+  std::vector<uint64_t> buckets_;
+  uint64_t count_ = 0;
+  uint64_t min_ = UINT64_MAX;
+  uint64_t max_ = 0;
+  double sum_ = 0;
+};
+
+// A weighted mix of message sizes, parsed from a comma separated list of
+// |SIZE[-MAX][:WEIGHT]| entries. A range picks a size uniformly from
+// [SIZE, MAX]; the weight (default 1) is relative to the other entries. For
+// example, "64" always sends 64 bytes and "16-128:9,65536:1" sends a small
+// message nine times out of ten.
+class SizeDistribution {
+ public:
+  // A fixed size of 64 bytes.
+  SizeDistribution();
+
+  // Returns false, leaving |out| unchanged, if |spec| is malformed.
+  static bool Parse(const std::string &spec, SizeDistribution *out);
+
+  size_t Sample(std::mt19937 *rng) const;
+  size_t max_size() const;
+  const std::string &spec() const { return spec_; }
+
+ private:
+  struct Entry {
+    size_t min;
+    size_t max;
+    uint32_t weight;
+  };
+
+  std::vector<Entry> entries_;
+  uint32_t total_weight_ = 0;
+  std::string spec_;
+};
+
+struct LoadOptions {
+  // The number of connections to the target, each with its own window of
+  // requests in flight.
+  size_t connections = 1;
+  // The number of requests each connection keeps outstanding.
+  size_t depth = 1;
+  SizeDistribution sizes;
+  // Requests that complete during the warmup are not measured.
+  std::chrono::nanoseconds warmup = std::chrono::seconds(1);
+  std::chrono::nanoseconds duration = std::chrono::seconds(5);
+  uint32_t seed = 1;
+};
+
+// Parses the load options shared by the load generator binaries from the
+// command line:
+//
+//   --connections N   connections to open (default 1)
+//   --depth N         requests in flight per connection (default 1)
+//   --sizes SPEC      message sizes; see SizeDistribution (default 64)
+//   --warmup-ms N     warmup before measuring (default 1000)
+//   --duration-ms N   measured duration (default 5000)
+//   --json PATH       also write the report to PATH as JSON
+//
+// Unknown arguments are ignored. Returns false and prints a message on
+// malformed values.
+bool ParseLoadOptions(int argc, const char **argv, LoadOptions *options, std::string *json_path);
+
+// The service under load. Implementations call |done| with the reply exactly
+// once per request, on any thread, but never from within Encrypt() itself:
+// the generator sends the next request from |done|.
+class LoadTarget {
+ public:
+  virtual ~LoadTarget() = default;
+
+  virtual void Encrypt(size_t connection, std::string message,
+                       fit::function<void(std::string reply)> done) = 0;
+};
+
+struct LoadReport {
+  size_t connections = 0;
+  size_t depth = 0;
+  std::string sizes;
+  double seconds = 0;
+  uint64_t requests = 0;
+  uint64_t bytes = 0;
+  // Replies whose length did not match the request.
+  uint64_t errors = 0;
+  LatencyHistogram latency;
+
+  double requests_per_second() const { return seconds > 0 ? requests / seconds : 0; }
+  double megabytes_per_second() const { return seconds > 0 ? bytes / seconds / 1e6 : 0; }
+
+  void Print(FILE *out) const;
+  // Returns false if |path| could not be written.
+  bool WriteJson(const char *path) const;
+};
+
+// Drives a LoadTarget closed-loop: every connection keeps |depth| requests
+// outstanding and sends a new one as each reply arrives, until the warmup and
+// the measured duration have both elapsed.
+class LoadGenerator {
+ public:
+  // |target| must outlive the generator.
+  LoadGenerator(LoadTarget *target, LoadOptions options);
+  ~LoadGenerator();
+
+  // Fills every connection's window and returns. |on_done| is called once the
+  // duration has elapsed and every outstanding request has completed, on the
+  // thread that delivered the last reply. Must be called only once.
+  void Start(fit::closure on_done);
+
+  // Merges the measurements of every connection. Only valid after |on_done|
+  // has been called.
+  LoadReport Report() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Connection {
+    std::mutex mutex;
+    std::mt19937 rng;
+    size_t outstanding = 0;
+    uint64_t requests = 0;
+    uint64_t bytes = 0;
+    uint64_t errors = 0;
+    LatencyHistogram latency;
+  };
+
+  LoadGenerator(const LoadGenerator &) = delete;
+  LoadGenerator &operator=(const LoadGenerator &) = delete;
+
+  void Send(size_t index, size_t size);
+  void OnReply(size_t index, size_t size, Clock::time_point sent, const std::string &reply);
+
+  LoadTarget *const target_;
+  const LoadOptions options_;
+  // Request payloads are prefixes of this string.
+  std::string payload_;
+  std::vector<std::unique_ptr<Connection>> connections_;
+  Clock::time_point measure_start_;
+  Clock::time_point measure_end_;
+  std::atomic<size_t> active_connections_{0};
+  fit::closure on_done_;
+};
+
+}  // namespace rot13
+
+#endif  // FUCHSIA_ROT13_CLIENT_LOAD_GENERATOR_H
@@ -0,0 +1,142 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "load_generator.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace rot13 {
+namespace testing {
+
+TEST(LatencyHistogramTest, PercentilesOfUniformValues) {
+  LatencyHistogram histogram;
+  for (uint64_t i = 1; i <= 100000; i++) {
+    histogram.Record(i * 1000);
+  }
+  EXPECT_EQ(100000u, histogram.count());
+  EXPECT_EQ(1000u, histogram.min());
+  EXPECT_EQ(100000000u, histogram.max());
+
+  const struct {
+    double quantile;
+    double expected;
+  } kCases[] = {{0.5, 50e6}, {0.9, 90e6}, {0.99, 99e6}, {0.999, 99.9e6}};
+  for (const auto &c : kCases) {
+    double value = static_cast<double>(histogram.Percentile(c.quantile));
+    // Never below the true value, and within one bucket above it.
+    EXPECT_GE(value, c.expected) << c.quantile;
+    EXPECT_LE(value, c.expected * 1.02) << c.quantile;
+  }
+  EXPECT_EQ(histogram.max(), histogram.Percentile(1.0));
+}
+
+TEST(LatencyHistogramTest, SmallValuesAreExact) {
+  LatencyHistogram histogram;
+  for (uint64_t i = 0; i < 64; i++) {
+    histogram.Record(i);
+  }
+  EXPECT_EQ(31u, histogram.Percentile(0.5));
+  EXPECT_EQ(63u, histogram.Percentile(1.0));
+}
+
+TEST(LatencyHistogramTest, MergeCombinesCounts) {
+  LatencyHistogram a;
+  LatencyHistogram b;
+  a.Record(10);
+  b.Record(1000000);
+  b.Record(2000000);
+  a.Merge(b);
+  EXPECT_EQ(3u, a.count());
+  EXPECT_EQ(10u, a.min());
+  EXPECT_EQ(2000000u, a.max());
+}
+
+TEST(SizeDistributionTest, ParsesEntries) {
+  SizeDistribution sizes;
+  ASSERT_TRUE(SizeDistribution::Parse("16-128:9,65536:1", &sizes));
+  EXPECT_EQ(65536u, sizes.max_size());
+
+  std::mt19937 rng(1);
+  size_t large = 0;
+  for (int i = 0; i < 10000; i++) {
+    size_t size = sizes.Sample(&rng);
+    if (size == 65536) {
+      large++;
+    } else {
+      EXPECT_GE(size, 16u);
+      EXPECT_LE(size, 128u);
+    }
+  }
+  // One in ten, give or take.
+  EXPECT_GT(large, 800u);
+  EXPECT_LT(large, 1200u);
+}
+
+TEST(SizeDistributionTest, RejectsMalformedSpecs) {
+  SizeDistribution sizes;
+  for (const char *spec : {"", "abc", "128-16", "64:0", "64,", "-5", "16-"}) {
+    EXPECT_FALSE(SizeDistribution::Parse(spec, &sizes)) << spec;
+  }
+  // Failed parses leave the distribution alone.
+  EXPECT_EQ("64", sizes.spec());
+}
+
+// Echoes each message back once the test drains the queued replies.
+class EchoTarget : public LoadTarget {
+ public:
+  void Encrypt(size_t connection, std::string message,
+               fit::function<void(std::string reply)> done) override {
+    calls_per_connection.resize(std::max(calls_per_connection.size(), connection + 1));
+    calls_per_connection[connection]++;
+    pending.push_back([message = std::move(message), done = std::move(done)]() mutable {
+      done(std::move(message));
+    });
+  }
+
+  // Delivers replies in the order the requests were sent until none are left.
+  void Drain() {
+    while (!pending.empty()) {
+      fit::closure reply = std::move(pending.front());
+      pending.erase(pending.begin());
+      reply();
+    }
+  }
+
+  std::vector<fit::closure> pending;
+  std::vector<size_t> calls_per_connection;
+};
+
+TEST(LoadGeneratorTest, KeepsEveryConnectionBusyUntilTheDeadline) {
+  EchoTarget target;
+  LoadOptions options;
+  options.connections = 3;
+  options.depth = 4;
+  options.warmup = std::chrono::milliseconds(0);
+  options.duration = std::chrono::milliseconds(20);
+  LoadGenerator generator(&target, options);
+
+  bool done = false;
+  generator.Start([&done] { done = true; });
+  EXPECT_EQ(12u, target.pending.size());
+  target.Drain();
+  EXPECT_TRUE(done);
+
+  LoadReport report = generator.Report();
+  EXPECT_EQ(0u, report.errors);
+  EXPECT_GT(report.requests, 0u);
+  EXPECT_EQ(report.requests, report.latency.count());
+  EXPECT_EQ(report.requests * 64, report.bytes);
+  ASSERT_EQ(3u, target.calls_per_connection.size());
+  for (size_t calls : target.calls_per_connection) {
+    EXPECT_GE(calls, 4u);
+  }
+}
+
+}  // namespace testing
+}  // namespace rot13
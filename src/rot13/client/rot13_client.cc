@@ -5,22 +5,182 @@
 #include <fuchsia/examples/rot13/cpp/fidl.h>
 #include <lib/async-loop/cpp/loop.h>
 #include <lib/async-loop/default.h>
+#include <lib/async/cpp/task.h>
+#include <lib/zx/clock.h>
+#include <lib/zx/vmo.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <string>
+#include <vector>
 
+#include "load_generator.h"
 #include "rot13_client_app.h"
 
+namespace {
+
+// The bound on the strings that Encrypt accepts.
+constexpr size_t kMaxEncryptSize = 128;
+
+// Sends load over its own set of connections to the server. Messages that fit
+// in Encrypt are sent that way; larger ones go through EncryptBuffer in a
+// freshly created VMO, as a real client would.
+class FidlLoadTarget : public rot13::LoadTarget {
+ public:
+  FidlLoadTarget(async_dispatcher_t *dispatcher, rot13::Rot13ClientApp &app, size_t connections,
+                 fit::closure on_error)
+      : dispatcher_(dispatcher), connections_(connections), on_error_(std::move(on_error)) {
+    for (fuchsia::examples::rot13::Rot13Ptr &connection : connections_) {
+      app.Connect(connection.NewRequest());
+      connection.set_error_handler([this](zx_status_t status) {
+        fprintf(stderr, "Connection closed during the benchmark: %d\n", status);
+        on_error_();
+      });
+    }
+  }
+
+  void Encrypt(size_t connection, std::string message,
+               fit::function<void(std::string reply)> done) override {
+    fuchsia::examples::rot13::Rot13Ptr &rot13 = connections_[connection];
+    if (message.size() <= kMaxEncryptSize) {
+      rot13->Encrypt(std::move(message), [done = std::move(done)](fidl::StringPtr reply) {
+        done(reply.value_or(""));
+      });
+      return;
+    }
+
+    fuchsia::mem::Buffer buffer;
+    buffer.size = message.size();
+    if (zx::vmo::create(buffer.size, 0, &buffer.vmo) != ZX_OK ||
+        buffer.vmo.write(message.data(), 0, buffer.size) != ZX_OK) {
+      // Fail from the loop rather than from here, so that a run of failures
+      // does not nest the generator's sends ever deeper.
+      async::PostTask(dispatcher_, [done = std::move(done)] { done(""); });
+      return;
+    }
+    rot13->EncryptBuffer(
+        std::move(buffer),
+        [done = std::move(done)](fuchsia::examples::rot13::Rot13_EncryptBuffer_Result result) {
+          std::string reply;
+          if (result.is_response()) {
+            const fuchsia::mem::Buffer &encrypted = result.response().response;
+            reply.resize(encrypted.size);
+            if (encrypted.vmo.read(&reply[0], 0, encrypted.size) != ZX_OK) {
+              reply.clear();
+            }
+          }
+          done(std::move(reply));
+        });
+  }
+
+ private:
+  async_dispatcher_t *const dispatcher_;
+  std::vector<fuchsia::examples::rot13::Rot13Ptr> connections_;
+  fit::closure on_error_;
+};
+
+// Runs the load generator against the server for the configured warmup and
+// duration, then prints the report and optionally writes it as JSON.
+int Bench(async::Loop &loop, rot13::Rot13ClientApp &app, int argc, const char **argv) {
+  rot13::LoadOptions options;
+  std::string json_path;
+  if (!rot13::ParseLoadOptions(argc, argv, &options, &json_path)) {
+    return 1;
+  }
+
+  bool failed = false;
+  FidlLoadTarget target(loop.dispatcher(), app, options.connections, [&loop, &failed] {
+    failed = true;
+    loop.Quit();
+  });
+  rot13::LoadGenerator generator(&target, options);
+  generator.Start([&loop] { loop.Quit(); });
+  loop.Run();
+  loop.ResetQuit();
+  if (failed) {
+    return 1;
+  }
+
+  rot13::LoadReport report = generator.Report();
+  report.Print(stdout);
+  if (!json_path.empty() && !report.WriteJson(json_path.c_str())) {
+    fprintf(stderr, "failed to write %s\n", json_path.c_str());
+    return 1;
+  }
+  return report.errors == 0 ? 0 : 1;
+}
+
+// Encrypts |count| copies of |msg| with each request strategy in turn and
+// prints the per-item cost. The serial strategy is the one-call-per-string
+// path: it waits for every reply before sending the next request.
+int MeasureEncrypt(async::Loop &loop, rot13::Rot13ClientApp &app, const std::string &msg,
+                   size_t count) {
+  struct Strategy {
+    const char *name;
+    size_t batch_size;
+    size_t max_in_flight;
+  };
+  const Strategy kStrategies[] = {
+      {"serial", 0, 1},
+      {"pipelined x16", 0, 16},
+      {"batched x256", fuchsia::examples::rot13::MAX_BATCH_SIZE, 1},
+      {"batched x256 pipelined x4", fuchsia::examples::rot13::MAX_BATCH_SIZE, 4},
+  };
+
+  printf("%-28s %12s\n", "strategy", "ns/item");
+  for (const Strategy &strategy : kStrategies) {
+    std::vector<std::string> messages(count, msg);
+    size_t received = 0;
+    auto done = [&](std::vector<std::string> results) {
+      received = results.size();
+      loop.Quit();
+    };
+    zx::time start = zx::clock::get_monotonic();
+    if (strategy.batch_size == 0) {
+      app.EncryptPipelined(std::move(messages), strategy.max_in_flight, std::move(done));
+    } else {
+      app.EncryptBatched(std::move(messages), strategy.batch_size, strategy.max_in_flight,
+                         std::move(done));
+    }
+    zx_status_t status = loop.Run();
+    zx::duration elapsed = zx::clock::get_monotonic() - start;
+    loop.ResetQuit();
+    if (status != ZX_ERR_CANCELED || received != count) {
+      fprintf(stderr, "%s: failed after %zu of %zu items\n", strategy.name, received, count);
+      return 1;
+    }
+    printf("%-28s %12.1f\n", strategy.name,
+           static_cast<double>(elapsed.to_nsecs()) / static_cast<double>(count));
+  }
+  return 0;
+}
+
+}  // namespace
+
 int main(int argc, const char **argv) {
   std::string msg = "hello world";
   std::string server_url = "fuchsia-pkg://fuchsia.com/rot13_server#meta/rot13_server.cmx";
+  size_t measure_count = 0;
+  bool bench = false;
+  fuchsia::examples::rot13::ChecksumMode checksum_mode =
+      fuchsia::examples::rot13::ChecksumMode::SUM;
 
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp("--bench", argv[i])) {
+      bench = true;
+    }
+  }
   for (int i = 1; i < argc - 1; ++i) {
     if (!strcmp("--server", argv[i])) {
       server_url = argv[++i];
     } else if (!strcmp("-m", argv[i])) {
       msg = argv[++i];
+    } else if (!strcmp("--measure", argv[i])) {
+      measure_count = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp("--checksum", argv[i])) {
+      if (!strcmp("crc32c", argv[++i])) {
+        checksum_mode = fuchsia::examples::rot13::ChecksumMode::CRC32C;
+      }
     }
   }
   async::Loop loop(&kAsyncLoopConfigAttachToCurrentThread);
@@ -33,10 +193,17 @@ int main(int argc, const char **argv) {
     loop.Quit();
   });
 
+  if (bench) {
+    return Bench(loop, app, argc, argv);
+  }
+  if (measure_count > 0) {
+    return MeasureEncrypt(loop, app, msg, measure_count);
+  }
+
   // wait for both calls
   uint32_t checksum = 0;
   std::string rotated;
-  app.rot13()->Checksum(msg, [msg, &checksum](uint32_t value) {
+  app.rot13()->Checksum(msg, checksum_mode, [msg, &checksum](uint32_t value) {
     printf("***** Message: %s has checksum of %u\n", msg.c_str(), value);
     checksum = value;
   });
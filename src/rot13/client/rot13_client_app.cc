@@ -4,7 +4,57 @@
 
 #include "rot13_client_app.h"
 
+#include <algorithm>
+#include <memory>
+
 namespace rot13 {
+namespace {
+
+// Tracks a sequence of |count| asynchronous calls of which at most
+// |max_in_flight| may be outstanding at once.
+struct Pipeline {
+  size_t count = 0;
+  size_t max_in_flight = 1;
+  size_t next = 0;
+  size_t outstanding = 0;
+  // Starts call |index| and invokes the closure when it completes.
+  fit::function<void(size_t index, fit::closure done)> issue;
+  fit::closure on_complete;
+};
+
+// Issues calls until the window is full or every call has been sent. Each
+// completion refills the window.
+void Pump(std::shared_ptr<Pipeline> pipeline) {
+  if (pipeline->count == 0) {
+    pipeline->on_complete();
+    return;
+  }
+  while (pipeline->outstanding < pipeline->max_in_flight && pipeline->next < pipeline->count) {
+    size_t index = pipeline->next++;
+    pipeline->outstanding++;
+    pipeline->issue(index, [pipeline] {
+      pipeline->outstanding--;
+      if (pipeline->next == pipeline->count && pipeline->outstanding == 0) {
+        pipeline->on_complete();
+      } else {
+        Pump(pipeline);
+      }
+    });
+  }
+}
+
+void RunPipelined(size_t count, size_t max_in_flight,
+                  fit::function<void(size_t index, fit::closure done)> issue,
+                  fit::closure on_complete) {
+  auto pipeline = std::make_shared<Pipeline>();
+  pipeline->count = count;
+  pipeline->max_in_flight = std::max<size_t>(max_in_flight, 1);
+  pipeline->issue = std::move(issue);
+  pipeline->on_complete = std::move(on_complete);
+  Pump(std::move(pipeline));
+}
+
+}  // namespace
 
 Rot13ClientApp::Rot13ClientApp()
     : Rot13ClientApp(sys::ComponentContext::CreateAndServeOutgoingDirectory()) {}
@@ -22,7 +72,51 @@ void Rot13ClientApp::Start(std::string server_url) {
   fuchsia::sys::LauncherPtr launcher;
   context_->svc()->Connect(launcher.NewRequest());
   launcher->CreateComponent(std::move(launch_info), controller_.NewRequest());
-  sys::ServiceDirectory rot13_provider(std::move(directory));
-  rot13_provider.Connect(rot13_.NewRequest());
+  rot13_provider_ = std::make_unique<sys::ServiceDirectory>(std::move(directory));
+  rot13_provider_->Connect(rot13_.NewRequest());
+}
+
+void Rot13ClientApp::Connect(fidl::InterfaceRequest<fuchsia::examples::rot13::Rot13> request) {
+  rot13_provider_->Connect(std::move(request));
+}
+
+void Rot13ClientApp::EncryptPipelined(std::vector<std::string> messages, size_t max_in_flight,
+                                      fit::function<void(std::vector<std::string>)> callback) {
+  auto results = std::make_shared<std::vector<std::string>>(std::move(messages));
+  size_t count = results->size();
+  RunPipelined(
+      count, max_in_flight,
+      [this, results](size_t index, fit::closure done) {
+        rot13_->Encrypt(std::move((*results)[index]),
+                        [results, index, done = std::move(done)](fidl::StringPtr value) {
+                          (*results)[index] = value.value_or("");
+                          done();
+                        });
+      },
+      [results, callback = std::move(callback)]() { callback(std::move(*results)); });
+}
+
+void Rot13ClientApp::EncryptBatched(std::vector<std::string> messages, size_t batch_size,
+                                    size_t max_in_flight,
+                                    fit::function<void(std::vector<std::string>)> callback) {
+  batch_size = std::min<size_t>(std::max<size_t>(batch_size, 1),
+                                fuchsia::examples::rot13::MAX_BATCH_SIZE);
+  auto results = std::make_shared<std::vector<std::string>>(std::move(messages));
+  size_t batches = (results->size() + batch_size - 1) / batch_size;
+  RunPipelined(
+      batches, max_in_flight,
+      [this, results, batch_size](size_t index, fit::closure done) {
+        size_t begin = index * batch_size;
+        size_t end = std::min(begin + batch_size, results->size());
+        std::vector<std::string> batch(std::make_move_iterator(results->begin() + begin),
+                                       std::make_move_iterator(results->begin() + end));
+        rot13_->EncryptBatch(std::move(batch), [results, begin, end, done = std::move(done)](
+                                                   std::vector<std::string> encrypted) {
+          size_t count = std::min(encrypted.size(), end - begin);
+          std::move(encrypted.begin(), encrypted.begin() + count, results->begin() + begin);
+          done();
+        });
+      },
+      [results, callback = std::move(callback)]() { callback(std::move(*results)); });
 }
 }  // namespace rot13
@@ -7,8 +7,12 @@
 
 #include <fuchsia/examples/rot13/cpp/fidl.h>
 #include <fuchsia/sys/cpp/fidl.h>
+#include <lib/fit/function.h>
 #include <lib/sys/cpp/component_context.h>
 
+#include <string>
+#include <vector>
+
 namespace rot13 {
 class Rot13ClientApp {
  public:
@@ -19,12 +23,31 @@ class Rot13ClientApp {
 
   void Start(std::string server_url);
 
+  // Opens another connection to the server launched by Start. Used to spread
+  // load across several channels.
+  void Connect(fidl::InterfaceRequest<fuchsia::examples::rot13::Rot13> request);
+
+  // Encrypts |messages| with one Encrypt call per message, keeping up to
+  // |max_in_flight| calls outstanding instead of waiting for each reply before
+  // sending the next request. |callback| receives the results in the same
+  // order as |messages| once every call has completed. A |max_in_flight| of 1
+  // sends one request at a time.
+  void EncryptPipelined(std::vector<std::string> messages, size_t max_in_flight,
+                        fit::function<void(std::vector<std::string>)> callback);
+
+  // Like EncryptPipelined, but packs up to |batch_size| messages into each
+  // EncryptBatch call, so that message headers, dispatch and callbacks are
+  // amortized over the batch. |batch_size| is clamped to MAX_BATCH_SIZE.
+  void EncryptBatched(std::vector<std::string> messages, size_t batch_size, size_t max_in_flight,
+                      fit::function<void(std::vector<std::string>)> callback);
+
  private:
   Rot13ClientApp(const Rot13ClientApp &) = delete;
   Rot13ClientApp &operator=(const Rot13ClientApp &) = delete;
 
   std::unique_ptr<sys::ComponentContext> context_;
   fuchsia::sys::ComponentControllerPtr controller_;
+  std::unique_ptr<sys::ServiceDirectory> rot13_provider_;
   fuchsia::examples::rot13::Rot13Ptr rot13_;
 };
 
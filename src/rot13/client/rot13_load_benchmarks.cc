@@ -0,0 +1,86 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Host version of `rot13_client --bench`. Runs the same load generator
+/// against an in-process stand-in for Rot13ServerApp, so the harness and the
+/// server's hot path can be tracked for regressions without a device.
+///
+/// The stand-in mirrors the server's threading: each connection is pinned to
+/// one of --threads dispatch threads, which encrypts the request with the
+/// same kernels as the server and replies on that thread.
+///
+/// Usage: rot13_load_benchmarks [--threads N] [load options]
+///
+/// See ParseLoadOptions in load_generator.h for the load options.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+#include "src/rot13/client/load_generator.h"
+#include "src/rot13/server/rot13.h"
+#include "src/rot13/server/worker_pool.h"
+
+namespace {
+
+class InProcessTarget : public rot13::LoadTarget {
+ public:
+  explicit InProcessTarget(size_t threads) : pool_(threads) {}
+
+  void Encrypt(size_t connection, std::string message,
+               fit::function<void(std::string reply)> done) override {
+    pool_.Post(connection, [message = std::move(message), done = std::move(done)]() mutable {
+      rot13::Rot13InPlace(&message[0], message.size());
+      done(std::move(message));
+    });
+  }
+
+ private:
+  rot13::WorkerPool pool_;
+};
+
+}  // namespace
+
+int main(int argc, const char **argv) {
+  size_t threads = 1;
+  for (int i = 1; i < argc - 1; ++i) {
+    if (!strcmp("--threads", argv[i])) {
+      threads = std::max<size_t>(strtoul(argv[++i], nullptr, 10), 1);
+    }
+  }
+  rot13::LoadOptions options;
+  std::string json_path;
+  if (!rot13::ParseLoadOptions(argc, argv, &options, &json_path)) {
+    return 1;
+  }
+
+  InProcessTarget target(threads);
+  rot13::LoadGenerator generator(&target, options);
+  std::mutex mutex;
+  std::condition_variable finished;
+  bool done = false;
+  generator.Start([&] {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+    finished.notify_one();
+  });
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&done] { return done; });
+  }
+
+  rot13::LoadReport report = generator.Report();
+  printf("in-process target, %zu threads\n", threads);
+  report.Print(stdout);
+  if (!json_path.empty() && !report.WriteJson(json_path.c_str())) {
+    fprintf(stderr, "failed to write %s\n", json_path.c_str());
+    return 1;
+  }
+  return report.errors == 0 ? 0 : 1;
+}
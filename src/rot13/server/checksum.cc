@@ -0,0 +1,171 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "checksum.h"
+
+#include <string.h>
+
+#include "cpu_features.h"
+#include "rot13_kernels.h"
+
+namespace rot13 {
+namespace internal {
+
+uint32_t SumScalar(uint32_t sum, const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    // Plain char, as the original DoChecksum() summed: signed on x86-64,
+    // unsigned on arm64.
+    sum += static_cast<char>(data[i]);
+  }
+  return sum;
+}
+
+namespace {
+
+// The reflected CRC-32C polynomial.
+constexpr uint32_t kCrc32cPolynomial = 0x82f63b78;
+
+// Tables for the slicing-by-8 algorithm: tables[k][b] is the CRC of byte b
+// followed by k zero bytes.
+struct Crc32cTables {
+  uint32_t tables[8][256];
+
+  Crc32cTables() {
+    for (uint32_t b = 0; b < 256; b++) {
+      uint32_t crc = b;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ ((crc & 1) ? kCrc32cPolynomial : 0);
+      }
+      tables[0][b] = crc;
+    }
+    for (uint32_t b = 0; b < 256; b++) {
+      for (int k = 1; k < 8; k++) {
+        tables[k][b] = (tables[k - 1][b] >> 8) ^ tables[0][tables[k - 1][b] & 0xff];
+      }
+    }
+  }
+};
+
+const Crc32cTables &GetCrc32cTables() {
+  static const Crc32cTables tables;
+  return tables;
+}
+
+}  // namespace
+
+uint32_t Crc32cTable(uint32_t crc, const uint8_t *data, size_t len) {
+  const uint32_t(&t)[8][256] = GetCrc32cTables().tables;
+  size_t i = 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(word));
+    word ^= crc;
+    crc = t[7][word & 0xff] ^ t[6][(word >> 8) & 0xff] ^ t[5][(word >> 16) & 0xff] ^
+          t[4][(word >> 24) & 0xff] ^ t[3][(word >> 32) & 0xff] ^ t[2][(word >> 40) & 0xff] ^
+          t[1][(word >> 48) & 0xff] ^ t[0][word >> 56];
+  }
+#endif
+  for (; i < len; i++) {
+    crc = (crc >> 8) ^ t[0][(crc ^ data[i]) & 0xff];
+  }
+  return crc;
+}
+
+}  // namespace internal
+
+namespace {
+
+using Mode = StreamingChecksum::Mode;
+
+const ChecksumKernel kSumScalarKernel = {"sum-scalar", Mode::kSum, internal::SumScalar};
+const ChecksumKernel kCrc32cTableKernel = {"crc32c-table", Mode::kCrc32c, internal::Crc32cTable};
+
+#if defined(__x86_64__)
+const ChecksumKernel kSumSse2Kernel = {"sum-sse2", Mode::kSum, internal::SumSse2};
+const ChecksumKernel kSumAvx2Kernel = {"sum-avx2", Mode::kSum, internal::SumAvx2};
+const ChecksumKernel kCrc32cSse42Kernel = {"crc32c-sse4.2", Mode::kCrc32c, internal::Crc32cSse42};
+#endif
+
+#if defined(__aarch64__)
+const ChecksumKernel kSumNeonKernel = {"sum-neon", Mode::kSum, internal::SumNeon};
+const ChecksumKernel kCrc32cArmKernel = {"crc32c-armv8", Mode::kCrc32c, internal::Crc32cArm};
+#endif
+
+const ChecksumKernel &SelectSumKernel() {
+#if defined(__x86_64__)
+  if (GetCpuFeatures().avx2) {
+    return kSumAvx2Kernel;
+  }
+  return kSumSse2Kernel;
+#elif defined(__aarch64__)
+  return kSumNeonKernel;
+#else
+  return kSumScalarKernel;
+#endif
+}
+
+const ChecksumKernel &SelectCrc32cKernel() {
+#if defined(__x86_64__)
+  if (GetCpuFeatures().sse42) {
+    return kCrc32cSse42Kernel;
+  }
+#elif defined(__aarch64__)
+  if (GetCpuFeatures().arm_crc32) {
+    return kCrc32cArmKernel;
+  }
+#endif
+  return kCrc32cTableKernel;
+}
+
+// The CRC register starts as all ones and is inverted on output.
+uint32_t InitialState(Mode mode) { return mode == Mode::kCrc32c ? 0xffffffff : 0; }
+
+}  // namespace
+
+StreamingChecksum::StreamingChecksum(Mode mode) : mode_(mode), state_(InitialState(mode)) {}
+
+void StreamingChecksum::Reset() { state_ = InitialState(mode_); }
+
+void StreamingChecksum::Update(const void *data, size_t len) {
+  state_ = SelectedChecksumKernel(mode_).update(state_, static_cast<const uint8_t *>(data), len);
+}
+
+uint32_t StreamingChecksum::Finalize() const {
+  return mode_ == Mode::kCrc32c ? ~state_ : state_;
+}
+
+uint32_t DoChecksum(const char *data, size_t len, StreamingChecksum::Mode mode) {
+  StreamingChecksum checksum(mode);
+  checksum.Update(data, len);
+  return checksum.Finalize();
+}
+
+const ChecksumKernel &SelectedChecksumKernel(StreamingChecksum::Mode mode) {
+  static const ChecksumKernel &sum_kernel = SelectSumKernel();
+  static const ChecksumKernel &crc32c_kernel = SelectCrc32cKernel();
+  return mode == Mode::kCrc32c ? crc32c_kernel : sum_kernel;
+}
+
+std::vector<ChecksumKernel> AvailableChecksumKernels() {
+  std::vector<ChecksumKernel> kernels = {kSumScalarKernel, kCrc32cTableKernel};
+#if defined(__x86_64__)
+  kernels.push_back(kSumSse2Kernel);
+  if (GetCpuFeatures().avx2) {
+    kernels.push_back(kSumAvx2Kernel);
+  }
+  if (GetCpuFeatures().sse42) {
+    kernels.push_back(kCrc32cSse42Kernel);
+  }
+#endif
+#if defined(__aarch64__)
+  kernels.push_back(kSumNeonKernel);
+  if (GetCpuFeatures().arm_crc32) {
+    kernels.push_back(kCrc32cArmKernel);
+  }
+#endif
+  return kernels;
+}
+
+}  // namespace rot13
@@ -0,0 +1,73 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef EXAMPLES_ROT13_SERVER_CHECKSUM_H_
+#define EXAMPLES_ROT13_SERVER_CHECKSUM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace rot13 {
+
+// An incremental checksum. Feeding a stream through any number of Update()
+// calls gives the same result as a single call over the whole stream, so
+// payloads can be checksummed chunk by chunk as they arrive.
+//
+//   StreamingChecksum checksum(StreamingChecksum::Mode::kCrc32c);
+//   checksum.Update(first_chunk, first_len);
+//   checksum.Update(second_chunk, second_len);
+//   uint32_t value = checksum.Finalize();
+class StreamingChecksum {
+ public:
+  enum class Mode {
+    // The sum of the bytes taken as plain chars, modulo 2^32, so bytes >= 0x80
+    // count as negative where char is signed (x86-64) and positive where it
+    // is unsigned (arm64). Bit-compatible with DoChecksum() on each platform.
+    kSum,
+    // CRC-32C (Castagnoli), as used by iSCSI and ext4.
+    kCrc32c,
+  };
+
+  explicit StreamingChecksum(Mode mode = Mode::kSum);
+
+  // Starts a new stream in the same mode.
+  void Reset();
+
+  // Adds |len| bytes at |data| to the stream.
+  void Update(const void *data, size_t len);
+
+  // Returns the checksum of everything passed to Update() since construction
+  // or the last Reset(). Does not end the stream; more data may follow.
+  uint32_t Finalize() const;
+
+  Mode mode() const { return mode_; }
+
+ private:
+  Mode mode_;
+  uint32_t state_;
+};
+
+// Returns the checksum of the |len| bytes at |data|.
+uint32_t DoChecksum(const char *data, size_t len, StreamingChecksum::Mode mode);
+
+// A checksum kernel for one mode and instruction set. |update| advances the
+// raw running state: the plain sum for kSum, and the un-inverted CRC register
+// for kCrc32c.
+struct ChecksumKernel {
+  const char *name;
+  StreamingChecksum::Mode mode;
+  uint32_t (*update)(uint32_t state, const uint8_t *data, size_t len);
+};
+
+// Returns the kernel StreamingChecksum uses for |mode| on this CPU.
+const ChecksumKernel &SelectedChecksumKernel(StreamingChecksum::Mode mode);
+
+// Returns every kernel that can run on this CPU, for tests and benchmarks.
+std::vector<ChecksumKernel> AvailableChecksumKernels();
+
+}  // namespace rot13
+
+#endif  // EXAMPLES_ROT13_SERVER_CHECKSUM_H_
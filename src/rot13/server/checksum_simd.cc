@@ -0,0 +1,128 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Vectorized checksum kernels.
+///
+/// The sum kernels add the bytes as plain chars, like the scalar reference.
+/// Where char is signed, they flip the sign bit of every byte, which maps a
+/// char c to the unsigned value c + 128; unsigned horizontal adds then do the
+/// heavy lifting, and 128 per byte is subtracted at the end. Where char is
+/// unsigned, the bias is zero and the bytes are added as they are. All
+/// arithmetic is modulo 2^32, so intermediate overflow is harmless.
+///
+/// The CRC-32C kernels use the dedicated instructions, eight bytes at a time.
+
+#include <limits.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#include <arm_acle.h>
+#include <arm_neon.h>
+#endif
+
+#include "rot13_kernels.h"
+
+namespace rot13 {
+namespace internal {
+namespace {
+
+// Added to each byte, modulo 256, to make its value as a plain char
+// non-negative.
+constexpr uint8_t kCharBias = CHAR_MIN < 0 ? 0x80 : 0;
+
+}  // namespace
+
+#if defined(__x86_64__)
+
+uint32_t SumSse2(uint32_t sum, const uint8_t *data, size_t len) {
+  const __m128i bias = _mm_set1_epi8(static_cast<char>(kCharBias));
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc = _mm_setzero_si128();
+
+  size_t i = 0;
+  for (; i + sizeof(__m128i) <= len; i += sizeof(__m128i)) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    // Two 64-bit lanes, each the sum of eight biased bytes.
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_xor_si128(v, bias), zero));
+  }
+  uint64_t lanes[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), acc);
+  sum += static_cast<uint32_t>(lanes[0] + lanes[1] - kCharBias * static_cast<uint64_t>(i));
+  return SumScalar(sum, data + i, len - i);
+}
+
+__attribute__((target("avx2"))) uint32_t SumAvx2(uint32_t sum, const uint8_t *data, size_t len) {
+  const __m256i bias = _mm256_set1_epi8(static_cast<char>(kCharBias));
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i acc = _mm256_setzero_si256();
+
+  size_t i = 0;
+  for (; i + sizeof(__m256i) <= len; i += sizeof(__m256i)) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_xor_si256(v, bias), zero));
+  }
+  uint64_t lanes[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), acc);
+  sum += static_cast<uint32_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3] -
+                               kCharBias * static_cast<uint64_t>(i));
+  // SumSse2 is legacy SSE code; clear the upper YMM state before it.
+  _mm256_zeroupper();
+  return SumSse2(sum, data + i, len - i);
+}
+
+__attribute__((target("sse4.2"))) uint32_t Crc32cSse42(uint32_t crc, const uint8_t *data,
+                                                       size_t len) {
+  uint64_t crc64 = crc;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = static_cast<uint32_t>(crc64);
+  for (; i < len; i++) {
+    crc = _mm_crc32_u8(crc, data[i]);
+  }
+  return crc;
+}
+
+#endif  // defined(__x86_64__)
+
+#if defined(__aarch64__)
+
+uint32_t SumNeon(uint32_t sum, const uint8_t *data, size_t len) {
+  const uint8x16_t bias = vdupq_n_u8(kCharBias);
+  uint32x4_t acc = vdupq_n_u32(0);
+
+  size_t i = 0;
+  for (; i + sizeof(uint8x16_t) <= len; i += sizeof(uint8x16_t)) {
+    uint8x16_t v = veorq_u8(vld1q_u8(data + i), bias);
+    acc = vpadalq_u16(acc, vpaddlq_u8(v));
+  }
+  sum += vaddvq_u32(acc) - static_cast<uint32_t>(kCharBias * i);
+  return SumScalar(sum, data + i, len - i);
+}
+
+__attribute__((target("crc"))) uint32_t Crc32cArm(uint32_t crc, const uint8_t *data,
+                                                  size_t len) {
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(word));
+    crc = __crc32cd(crc, word);
+  }
+  for (; i < len; i++) {
+    crc = __crc32cb(crc, data[i]);
+  }
+  return crc;
+}
+
+#endif  // defined(__aarch64__)
+
+}  // namespace internal
+}  // namespace rot13
@@ -0,0 +1,48 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "cpu_features.h"
+
+#if defined(__aarch64__)
+#if defined(__Fuchsia__)
+#include <zircon/features.h>
+#include <zircon/syscalls.h>
+#else
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+#endif
+
+namespace rot13 {
+namespace {
+
+CpuFeatures DetectCpuFeatures() {
+  CpuFeatures features;
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  features.avx2 = __builtin_cpu_supports("avx2");
+  features.ssse3 = __builtin_cpu_supports("ssse3");
+  features.sse42 = __builtin_cpu_supports("sse4.2");
+#endif
+#if defined(__aarch64__)
+#if defined(__Fuchsia__)
+  uint32_t cpu_features = 0;
+  if (zx_system_get_features(ZX_FEATURE_KIND_CPU, &cpu_features) == ZX_OK) {
+    features.arm_crc32 = (cpu_features & ZX_ARM64_FEATURE_ISA_CRC32) != 0;
+  }
+#else
+  features.arm_crc32 = (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#endif
+#endif
+  return features;
+}
+
+}  // namespace
+
+const CpuFeatures &GetCpuFeatures() {
+  static const CpuFeatures features = DetectCpuFeatures();
+  return features;
+}
+
+}  // namespace rot13
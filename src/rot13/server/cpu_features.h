@@ -0,0 +1,29 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef EXAMPLES_ROT13_SERVER_CPU_FEATURES_H_
+#define EXAMPLES_ROT13_SERVER_CPU_FEATURES_H_
+
+namespace rot13 {
+
+// Runtime CPU feature queries used to pick vectorized kernels. Baseline
+// features of the target architecture (SSE2 on x86-64, NEON on arm64) are
+// assumed and have no query.
+struct CpuFeatures {
+  bool avx2 = false;
+  // SSSE3, for byte shuffles.
+  bool ssse3 = false;
+  // SSE4.2, for the CRC32 instruction.
+  bool sse42 = false;
+  // The ARMv8 CRC32 extension.
+  bool arm_crc32 = false;
+};
+
+// Returns the features of the CPU this process is running on. The result is
+// computed once and cached.
+const CpuFeatures &GetCpuFeatures();
+
+}  // namespace rot13
+
+#endif  // EXAMPLES_ROT13_SERVER_CPU_FEATURES_H_
@@ -4,40 +4,98 @@
 
 #include "rot13.h"
 
+#include <ctype.h>
+#include <string.h>
+
+#include "checksum.h"
+#include "cpu_features.h"
+#include "rot13_kernels.h"
+
 namespace rot13 {
-std::string DoRot13(const char *str) {
-  std::string ret;
+namespace {
+
+const Rot13Kernel kScalarKernel = {"scalar", Rot13Scalar};
 
-  const char *ptr = str;
-  if (!ptr) {
+#if defined(__x86_64__)
+const Rot13Kernel kSse2Kernel = {"sse2", internal::Rot13Sse2};
+const Rot13Kernel kAvx2Kernel = {"avx2", internal::Rot13Avx2};
+#endif
+
+#if defined(__aarch64__)
+const Rot13Kernel kNeonKernel = {"neon", internal::Rot13Neon};
+#endif
+
+const Rot13Kernel &SelectKernel() {
+#if defined(__x86_64__)
+  if (GetCpuFeatures().avx2) {
+    return kAvx2Kernel;
+  }
+  return kSse2Kernel;
+#elif defined(__aarch64__)
+  return kNeonKernel;
+#else
+  return kScalarKernel;
+#endif
+}
+
+}  // namespace
+
+std::string DoRot13(const char *str) {
+  if (!str) {
     return "";
   }
-  do {
-    if (isalpha(*ptr)) {
+  return DoRot13(str, strlen(str));
+}
+
+std::string DoRot13(const char *str, size_t len) {
+  std::string ret(len, '\0');
+  if (len > 0) {
+    Rot13(str, len, &ret[0]);
+  }
+  return ret;
+}
+
+void Rot13(const char *src, size_t len, char *dst) { SelectedRot13Kernel().apply(src, len, dst); }
+
+void Rot13Scalar(const char *src, size_t len, char *dst) {
+  for (size_t i = 0; i < len; i++) {
+    char c = src[i];
+    if (isalpha(static_cast<unsigned char>(c))) {
       // add 13 if a - m.
-      if (tolower(*ptr) - 'a' < 13) {
-        ret.append(1, *ptr + 13);
+      if (tolower(static_cast<unsigned char>(c)) - 'a' < 13) {
+        dst[i] = static_cast<char>(c + 13);
       } else {
-        ret.append(1, *ptr - 13);
+        dst[i] = static_cast<char>(c - 13);
       }
     } else {
-      ret.append(1, *ptr);
+      dst[i] = c;
     }
-  } while (*(ptr++));
+  }
+}
 
-  return ret;
+const Rot13Kernel &SelectedRot13Kernel() {
+  static const Rot13Kernel &kernel = SelectKernel();
+  return kernel;
+}
+
+std::vector<Rot13Kernel> AvailableRot13Kernels() {
+  std::vector<Rot13Kernel> kernels = {kScalarKernel};
+#if defined(__x86_64__)
+  kernels.push_back(kSse2Kernel);
+  if (GetCpuFeatures().avx2) {
+    kernels.push_back(kAvx2Kernel);
+  }
+#endif
+#if defined(__aarch64__)
+  kernels.push_back(kNeonKernel);
+#endif
+  return kernels;
 }
 
 uint32_t DoChecksum(const char *str) {
-  uint32_t ret = 0;
-  const char *ptr = str;
-  if (!ptr) {
+  if (!str) {
     return 0;
   }
-  do {
-    ret += *ptr;
-  } while (*(ptr++));
-
-  return ret;
+  return DoChecksum(str, strlen(str), StreamingChecksum::Mode::kSum);
 }
 }  // namespace rot13
@@ -2,8 +2,48 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#ifndef EXAMPLES_ROT13_SERVER_ROT13_H_
+#define EXAMPLES_ROT13_SERVER_ROT13_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
 #include <string>
+#include <vector>
+
 namespace rot13 {
 std::string DoRot13(const char *str);
 uint32_t DoChecksum(const char *str);
+
+// Returns the rot13 encoding of the |len| bytes at |str|. Unlike the
+// NUL-terminated overload, |str| may contain embedded NULs and is only read
+// once.
+std::string DoRot13(const char *str, size_t len);
+
+// Writes the rot13 encoding of |src|[0, |len|) to |dst|. |src| and |dst| may
+// be the same buffer, but must not otherwise overlap.
+void Rot13(const char *src, size_t len, char *dst);
+
+// Applies rot13 to |buf|[0, |len|) in place.
+inline void Rot13InPlace(char *buf, size_t len) { Rot13(buf, len, buf); }
+
+// The byte-at-a-time reference implementation. The vectorized kernels must
+// produce exactly the same output.
+void Rot13Scalar(const char *src, size_t len, char *dst);
+
+// A rot13 kernel for a particular instruction set.
+struct Rot13Kernel {
+  const char *name;
+  void (*apply)(const char *src, size_t len, char *dst);
+};
+
+// Returns the kernel that Rot13() dispatches to on this CPU. The choice is
+// made once, on first use.
+const Rot13Kernel &SelectedRot13Kernel();
+
+// Returns every kernel that can run on this CPU, including the scalar
+// reference. Used by tests and benchmarks to cover each one explicitly.
+std::vector<Rot13Kernel> AvailableRot13Kernels();
 }  // namespace rot13
+
+#endif  // EXAMPLES_ROT13_SERVER_ROT13_H_
@@ -0,0 +1,63 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef EXAMPLES_ROT13_SERVER_ROT13_KERNELS_H_
+#define EXAMPLES_ROT13_SERVER_ROT13_KERNELS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Vectorized rot13, substitution and checksum kernels. Each kernel processes whole vectors
+// and finishes the tail with a scalar loop, so all of them accept any |len|.
+// Only the kernels for the target architecture are declared; callers must
+// check GetCpuFeatures() before using anything beyond the baseline.
+namespace rot13 {
+namespace internal {
+
+// A 256-entry substitution table split into 16 rows of 16 bytes, the width of
+// one byte shuffle. deltas[h][l] is the substitute for byte 16 * h + l, minus
+// that byte, so rows the substitution leaves alone are all zero and can be
+// skipped: bit h of |active_rows| is set if row h has any nonzero delta.
+struct LookupTable {
+  alignas(32) uint8_t deltas[16][16];
+  uint16_t active_rows;
+  // The substitute for each byte, for the scalar loop and NEON.
+  uint8_t bytes[256];
+};
+
+// Rotates ASCII letters by |shift|, which must be in [1, 25].
+void CaesarScalar(const char *src, size_t len, char *dst, int shift);
+void LookupScalar(const LookupTable &table, const char *src, size_t len, char *dst);
+
+// The checksum kernels take and return the raw running state described in
+// checksum.h.
+uint32_t SumScalar(uint32_t sum, const uint8_t *data, size_t len);
+uint32_t Crc32cTable(uint32_t crc, const uint8_t *data, size_t len);
+
+#if defined(__x86_64__)
+void Rot13Sse2(const char *src, size_t len, char *dst);
+void Rot13Avx2(const char *src, size_t len, char *dst);
+void CaesarSse2(const char *src, size_t len, char *dst, int shift);
+void CaesarAvx2(const char *src, size_t len, char *dst, int shift);
+void LookupSsse3(const LookupTable &table, const char *src, size_t len, char *dst);
+void LookupAvx2(const LookupTable &table, const char *src, size_t len, char *dst);
+
+uint32_t SumSse2(uint32_t sum, const uint8_t *data, size_t len);
+uint32_t SumAvx2(uint32_t sum, const uint8_t *data, size_t len);
+uint32_t Crc32cSse42(uint32_t crc, const uint8_t *data, size_t len);
+#endif
+
+#if defined(__aarch64__)
+void Rot13Neon(const char *src, size_t len, char *dst);
+void CaesarNeon(const char *src, size_t len, char *dst, int shift);
+void LookupNeon(const LookupTable &table, const char *src, size_t len, char *dst);
+
+uint32_t SumNeon(uint32_t sum, const uint8_t *data, size_t len);
+uint32_t Crc32cArm(uint32_t crc, const uint8_t *data, size_t len);
+#endif
+
+}  // namespace internal
+}  // namespace rot13
+
+#endif  // EXAMPLES_ROT13_SERVER_ROT13_KERNELS_H_
@@ -4,15 +4,34 @@
 
 #include <lib/async-loop/cpp/loop.h>
 #include <lib/async-loop/default.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <string>
 
 #include "rot13_server_app.h"
 
+// Usage: rot13_server [--threads N] [--workers N] [--offload-threshold BYTES]
+//
+//   --threads            number of threads dispatching FIDL messages (default 1)
+//   --workers            number of threads running bulk transforms (default 0,
+//                        meaning transforms run on the dispatch threads)
+//   --offload-threshold  smallest bulk request handed to the workers
 int main(int argc, const char** argv) {
+  rot13::Rot13ServerApp::Options options;
+  for (int i = 1; i < argc - 1; ++i) {
+    if (!strcmp("--threads", argv[i])) {
+      options.dispatch_threads = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp("--workers", argv[i])) {
+      options.worker_threads = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp("--offload-threshold", argv[i])) {
+      options.offload_threshold = strtoul(argv[++i], nullptr, 10);
+    }
+  }
+
   async::Loop loop(&kAsyncLoopConfigAttachToCurrentThread);
 
-  rot13::Rot13ServerApp app;
+  rot13::Rot13ServerApp app(options);
 
   int ret = loop.Run();
 
@@ -4,32 +4,363 @@
 
 #include "rot13_server_app.h"
 
+#include <lib/async-loop/default.h>
+#include <lib/async/cpp/task.h>
+#include <lib/async/default.h>
+
+#include <string.h>
+
 #include <cctype>
+#include <string>
 
+#include "checksum.h"
 #include "rot13.h"
+#include "vmo_mapping.h"
+
+// The coding tables generated for the protocol, which the bindings do not
+// declare in their header.
+extern "C" const fidl_type_t fuchsia_examples_rot13_Rot13EncryptRequestTable;
+extern "C" const fidl_type_t fuchsia_examples_rot13_Rot13EncryptResponseTable;
+extern "C" const fidl_type_t fuchsia_examples_rot13_Rot13ChecksumRequestTable;
+extern "C" const fidl_type_t fuchsia_examples_rot13_Rot13ChecksumResponseTable;
 
 namespace rot13 {
+namespace {
+
+namespace rot13_fidl = fuchsia::examples::rot13;
+
+StreamingChecksum::Mode ToChecksumMode(fuchsia::examples::rot13::ChecksumMode mode) {
+  switch (mode) {
+    case fuchsia::examples::rot13::ChecksumMode::CRC32C:
+      return StreamingChecksum::Mode::kCrc32c;
+    case fuchsia::examples::rot13::ChecksumMode::SUM:
+    default:
+      return StreamingChecksum::Mode::kSum;
+  }
+}
+
+// Maps |buffer| read-write and applies |apply| to its contents in place.
+// Returns the closure that sends the reply: |buffer| itself, or the mapping
+// error.
+template <typename Apply, typename Callback>
+fit::closure TransformMappedBuffer(fuchsia::mem::Buffer buffer, Apply apply, Callback callback) {
+  VmoMapping mapping;
+  zx_status_t status = mapping.Map(buffer.vmo, buffer.size, ZX_VM_PERM_READ | ZX_VM_PERM_WRITE);
+  if (status == ZX_OK) {
+    apply(mapping.data(), mapping.size());
+    mapping.Unmap();
+  }
+  return [status, buffer = std::move(buffer), callback = std::move(callback)]() mutable {
+    if (status != ZX_OK) {
+      callback(fit::error(status));
+      return;
+    }
+    callback(fit::ok(std::move(buffer)));
+  };
+}
+
+}  // namespace
+
+class Rot13ServerApp::Connection : public fuchsia::examples::rot13::Rot13 {
+ public:
+  explicit Connection(Rot13ServerApp* app)
+      : app_(app), queue_(std::make_shared<TransformQueue>()) {
+    queue_->key = app->next_queue_key_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void Encrypt(::fidl::StringPtr value, EncryptCallback callback) override {
+    app_->Encrypt(std::move(value), std::move(callback));
+  }
+
+  void Checksum(::fidl::StringPtr value, fuchsia::examples::rot13::ChecksumMode mode,
+                ChecksumCallback callback) override {
+    app_->Checksum(std::move(value), mode, std::move(callback));
+  }
+
+  void EncryptBatch(std::vector<std::string> values, EncryptBatchCallback callback) override {
+    app_->EncryptBatch(std::move(values), std::move(callback));
+  }
+
+  void ChecksumBatch(std::vector<std::string> values, fuchsia::examples::rot13::ChecksumMode mode,
+                     ChecksumBatchCallback callback) override {
+    app_->ChecksumBatch(std::move(values), mode, std::move(callback));
+  }
+
+  void EncryptBuffer(fuchsia::mem::Buffer buffer, EncryptBufferCallback callback) override {
+    app_->EncryptBuffer(queue_, std::move(buffer), std::move(callback));
+  }
+
+  void ChecksumBuffer(fuchsia::mem::Buffer buffer, fuchsia::examples::rot13::ChecksumMode mode,
+                      ChecksumBufferCallback callback) override {
+    app_->ChecksumBuffer(queue_, std::move(buffer), mode, std::move(callback));
+  }
+
+  void RegisterTable(std::array<uint8_t, 256> table, RegisterTableCallback callback) override {
+    app_->RegisterTable(table, std::move(callback));
+  }
+
+  void Transform(uint32_t table_id, std::vector<uint8_t> value,
+                 TransformCallback callback) override {
+    app_->Transform(table_id, std::move(value), std::move(callback));
+  }
+
+  void TransformBuffer(uint32_t table_id, fuchsia::mem::Buffer buffer,
+                       TransformBufferCallback callback) override {
+    app_->TransformBuffer(queue_, table_id, std::move(buffer), std::move(callback));
+  }
+
+ private:
+  Rot13ServerApp* const app_;
+  const std::shared_ptr<TransformQueue> queue_;
+};
+
 Rot13ServerApp::Rot13ServerApp()
     : Rot13ServerApp(sys::ComponentContext::CreateAndServeOutgoingDirectory()) {}
 
+Rot13ServerApp::Rot13ServerApp(Options options)
+    : Rot13ServerApp(sys::ComponentContext::CreateAndServeOutgoingDirectory(), options) {}
+
 Rot13ServerApp::Rot13ServerApp(std::unique_ptr<sys::ComponentContext> context)
-    : context_(std::move(context)) {
-  context_->outgoing()->AddPublicService(bindings_.GetHandler(this));
+    : Rot13ServerApp(std::move(context), Options()) {}
+
+Rot13ServerApp::Rot13ServerApp(std::unique_ptr<sys::ComponentContext> context, Options options)
+    : context_(std::move(context)), options_(options) {
+  // The presets take the ids in the FIDL library, in order.
+  tables_.push_back(std::make_unique<Substitution>(kRot13Table));
+  tables_.push_back(std::make_unique<Substitution>(kRot47Table));
+  static_assert(fuchsia::examples::rot13::ROT13_TABLE_ID == 0 &&
+                    fuchsia::examples::rot13::ROT47_TABLE_ID == 1,
+                "preset table ids");
+
+  if (options_.worker_threads > 0) {
+    worker_pool_ = std::make_unique<WorkerPool>(options_.worker_threads);
+  }
+  AddViewHandlers();
+  if (options_.dispatch_threads <= 1) {
+    bindings_.set_view_handlers(&view_handlers_);
+    context_->outgoing()->AddPublicService<Rot13>([this](fidl::InterfaceRequest<Rot13> request) {
+      bindings_.AddBinding(std::make_unique<Connection>(this), std::move(request));
+    });
+    return;
+  }
+
+  for (size_t i = 0; i < options_.dispatch_threads; i++) {
+    auto shard = std::make_unique<DispatchShard>();
+    shard->bindings.set_view_handlers(&view_handlers_);
+    std::string name = "rot13-dispatch-" + std::to_string(i);
+    shard->loop.StartThread(name.c_str());
+    shards_.push_back(std::move(shard));
+  }
+  context_->outgoing()->AddPublicService<Rot13>(
+      [this](fidl::InterfaceRequest<Rot13> request) { BindToShard(std::move(request)); });
 }
 
-Rot13ServerApp::~Rot13ServerApp() {}
+Rot13ServerApp::~Rot13ServerApp() {
+  // Finish in-flight transforms first: their replies are posted to the
+  // dispatch loops, which must still be running to receive them.
+  worker_pool_.reset();
+  for (const std::unique_ptr<DispatchShard>& shard : shards_) {
+    shard->loop.Shutdown();
+  }
+}
+
+Rot13ServerApp::DispatchShard::DispatchShard() : loop(&kAsyncLoopConfigNoAttachToCurrentThread) {}
+
+void Rot13ServerApp::BindToShard(fidl::InterfaceRequest<fuchsia::examples::rot13::Rot13> request) {
+  DispatchShard* shard =
+      shards_[next_shard_.fetch_add(1, std::memory_order_relaxed) % shards_.size()].get();
+  // The binding set belongs to the shard's thread, so add the binding there.
+  async::PostTask(shard->loop.dispatcher(), [this, shard, request = std::move(request)]() mutable {
+    shard->bindings.AddBinding(std::make_unique<Connection>(this), std::move(request),
+                               shard->loop.dispatcher());
+  });
+}
+
+void Rot13ServerApp::AddViewHandlers() {
+  // The offsets are those of the generated request and response encoders.
+  view_handlers_.Add(
+      rot13_fidl::internal::kRot13_Encrypt_Ordinal,
+      &fuchsia_examples_rot13_Rot13EncryptRequestTable,
+      [](fidl::Decoder* request, fidl::ViewResponder responder) {
+        // Copy the string once, into the reply, and encrypt it there.
+        fidl::StringView value = fidl::DecodeAs<fidl::StringView>(request, 16);
+        if (value.is_null()) {
+          // Like Encrypt(), answer a null string with an empty one.
+          static char empty;
+          value = fidl::StringView(&empty, 0);
+        }
+        fidl::Encoder encoder(rot13_fidl::internal::kRot13_Encrypt_Ordinal);
+        encoder.Alloc(32 - sizeof(fidl_message_header_t));
+        fidl::Encode(&encoder, &value, 16);
+        Rot13InPlace(encoder.GetPtr<char>(32), value.size());
+        responder.Send(&fuchsia_examples_rot13_Rot13EncryptResponseTable, encoder.GetMessage());
+      });
+  view_handlers_.Add(
+      rot13_fidl::internal::kRot13_Checksum_Ordinal,
+      &fuchsia_examples_rot13_Rot13ChecksumRequestTable,
+      [](fidl::Decoder* request, fidl::ViewResponder responder) {
+        fidl::StringView value = fidl::DecodeAs<fidl::StringView>(request, 16);
+        auto mode = fidl::DecodeAs<rot13_fidl::ChecksumMode>(request, 32);
+        uint32_t checksum = DoChecksum(value.data(), value.size(), ToChecksumMode(mode));
+        fidl::Encoder encoder(rot13_fidl::internal::kRot13_Checksum_Ordinal);
+        encoder.Alloc(24 - sizeof(fidl_message_header_t));
+        fidl::Encode(&encoder, &checksum, 16);
+        responder.Send(&fuchsia_examples_rot13_Rot13ChecksumResponseTable, encoder.GetMessage());
+      });
+}
+
+void Rot13ServerApp::RunTransform(const std::shared_ptr<TransformQueue>& queue, size_t size,
+                                  fit::function<fit::closure()> transform) {
+  if (!worker_pool_ || (size < options_.offload_threshold && queue->in_flight == 0)) {
+    transform()();
+    return;
+  }
+  // The pool runs the transforms posted with one key in order, on one thread,
+  // so their replies reach the dispatcher in order too.
+  queue->in_flight++;
+  async_dispatcher_t* dispatcher = async_get_default_dispatcher();
+  worker_pool_->Post(queue->key, [queue, dispatcher, transform = std::move(transform)]() {
+    async::PostTask(dispatcher, [queue, reply = transform()]() {
+      queue->in_flight--;
+      reply();
+    });
+  });
+}
 
 void Rot13ServerApp::Encrypt(
     ::fidl::StringPtr value,
     fuchsia::examples::rot13::Rot13::EncryptCallback callback) {
-  std::string encrypted = DoRot13(value->data());
-  callback(encrypted);
+  // Take ownership of the decoded string and encrypt it in place rather than
+  // building a second copy.
+  std::string encrypted = std::move(value).value_or("");
+  Rot13InPlace(&encrypted[0], encrypted.size());
+  callback(std::move(encrypted));
 }
 void Rot13ServerApp::Checksum(
-    ::fidl::StringPtr value,
+    ::fidl::StringPtr value, fuchsia::examples::rot13::ChecksumMode mode,
     fuchsia::examples::rot13::Rot13::ChecksumCallback callback) {
-  uint32_t cksum = DoChecksum(value->data());
+  std::string str = std::move(value).value_or("");
+  uint32_t cksum = DoChecksum(str.data(), str.size(), ToChecksumMode(mode));
   callback(cksum);
 }
 
+void Rot13ServerApp::EncryptBatch(
+    std::vector<std::string> values,
+    fuchsia::examples::rot13::Rot13::EncryptBatchCallback callback) {
+  for (std::string& value : values) {
+    Rot13InPlace(&value[0], value.size());
+  }
+  callback(std::move(values));
+}
+
+void Rot13ServerApp::ChecksumBatch(
+    std::vector<std::string> values, fuchsia::examples::rot13::ChecksumMode mode,
+    fuchsia::examples::rot13::Rot13::ChecksumBatchCallback callback) {
+  StreamingChecksum checksum(ToChecksumMode(mode));
+  std::vector<uint32_t> checksums;
+  checksums.reserve(values.size());
+  for (const std::string& value : values) {
+    checksum.Reset();
+    checksum.Update(value.data(), value.size());
+    checksums.push_back(checksum.Finalize());
+  }
+  callback(std::move(checksums));
+}
+
+void Rot13ServerApp::EncryptBuffer(
+    const std::shared_ptr<TransformQueue>& queue, fuchsia::mem::Buffer buffer,
+    fuchsia::examples::rot13::Rot13::EncryptBufferCallback callback) {
+  size_t size = buffer.size;
+  RunTransform(queue, size,
+               [buffer = std::move(buffer), callback = std::move(callback)]() mutable {
+                 return TransformMappedBuffer(std::move(buffer), Rot13InPlace,
+                                              std::move(callback));
+               });
+}
+
+void Rot13ServerApp::ChecksumBuffer(
+    const std::shared_ptr<TransformQueue>& queue, fuchsia::mem::Buffer buffer,
+    fuchsia::examples::rot13::ChecksumMode mode,
+    fuchsia::examples::rot13::Rot13::ChecksumBufferCallback callback) {
+  size_t size = buffer.size;
+  RunTransform(queue, size, [buffer = std::move(buffer), mode,
+                             callback = std::move(callback)]() mutable {
+    VmoMapping mapping;
+    zx_status_t status = mapping.Map(buffer.vmo, buffer.size, ZX_VM_PERM_READ);
+    uint32_t checksum = 0;
+    if (status == ZX_OK) {
+      checksum = DoChecksum(mapping.data(), mapping.size(), ToChecksumMode(mode));
+    }
+    return fit::closure([status, checksum, callback = std::move(callback)]() {
+      if (status != ZX_OK) {
+        callback(fit::error(status));
+        return;
+      }
+      callback(fit::ok(checksum));
+    });
+  });
+}
+
+void Rot13ServerApp::RegisterTable(
+    std::array<uint8_t, 256> table,
+    fuchsia::examples::rot13::Rot13::RegisterTableCallback callback) {
+  SubstitutionTable entry;
+  memcpy(entry.bytes, table.data(), sizeof(entry.bytes));
+  zx_status_t status = ZX_OK;
+  uint32_t id = 0;
+  {
+    std::lock_guard<std::mutex> lock(tables_mutex_);
+    while (id < tables_.size() &&
+           memcmp(tables_[id]->table().bytes, entry.bytes, sizeof(entry.bytes)) != 0) {
+      id++;
+    }
+    if (id == tables_.size()) {
+      if (tables_.size() < fuchsia::examples::rot13::MAX_TABLES) {
+        tables_.push_back(std::make_unique<Substitution>(entry));
+      } else {
+        status = ZX_ERR_NO_RESOURCES;
+      }
+    }
+  }
+  if (status != ZX_OK) {
+    callback(fit::error(status));
+    return;
+  }
+  callback(fit::ok(id));
+}
+
+void Rot13ServerApp::Transform(uint32_t table_id, std::vector<uint8_t> value,
+                               fuchsia::examples::rot13::Rot13::TransformCallback callback) {
+  const Substitution* substitution = FindTable(table_id);
+  if (!substitution) {
+    callback(fit::error(ZX_ERR_NOT_FOUND));
+    return;
+  }
+  substitution->ApplyInPlace(reinterpret_cast<char*>(value.data()), value.size());
+  callback(fit::ok(std::move(value)));
+}
+
+void Rot13ServerApp::TransformBuffer(
+    const std::shared_ptr<TransformQueue>& queue, uint32_t table_id, fuchsia::mem::Buffer buffer,
+    fuchsia::examples::rot13::Rot13::TransformBufferCallback callback) {
+  const Substitution* substitution = FindTable(table_id);
+  if (!substitution) {
+    callback(fit::error(ZX_ERR_NOT_FOUND));
+    return;
+  }
+  size_t size = buffer.size;
+  RunTransform(queue, size, [substitution, buffer = std::move(buffer),
+                             callback = std::move(callback)]() mutable {
+    return TransformMappedBuffer(
+        std::move(buffer),
+        [substitution](char* data, size_t len) { substitution->ApplyInPlace(data, len); },
+        std::move(callback));
+  });
+}
+
+const Substitution* Rot13ServerApp::FindTable(uint32_t id) {
+  std::lock_guard<std::mutex> lock(tables_mutex_);
+  return id < tables_.size() ? tables_[id].get() : nullptr;
+}
+
 }  // namespace rot13
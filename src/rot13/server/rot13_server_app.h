@@ -7,26 +7,128 @@
 
 #include <fuchsia/examples/rot13/cpp/fidl.h>
 #include <lib/fidl/cpp/binding_set.h>
+#include <lib/fidl/cpp/view_handlers.h>
+#include <lib/async-loop/cpp/loop.h>
 #include <lib/sys/cpp/component_context.h>
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "substitution.h"
+#include "worker_pool.h"
+
 namespace rot13
 {
-class Rot13ServerApp : public fuchsia::examples::rot13::Rot13
+class Rot13ServerApp
 {
 public:
+  struct Options {
+    // The number of threads that dispatch FIDL messages. With more than one,
+    // each new connection is bound to one of them in turn, so a connection's
+    // messages are still dispatched in order while different connections run
+    // in parallel. With one, connections are served on the thread that
+    // creates the app.
+    size_t dispatch_threads = 1;
+
+    // The number of threads that run bulk transforms (EncryptBuffer and
+    // ChecksumBuffer) of at least |offload_threshold| bytes, so that one large
+    // request does not stall the other connections on its dispatch thread.
+    // Zero runs every transform on the dispatch thread. A connection's
+    // transforms all run on the same worker, and while any is there the
+    // smaller ones follow it rather than running inline, so their replies
+    // still go out in request order.
+    size_t worker_threads = 0;
+    size_t offload_threshold = 256 * 1024;
+  };
+
   explicit Rot13ServerApp();
-  ~Rot13ServerApp() override;
-  void Encrypt(::fidl::StringPtr value, EncryptCallback callback) override;
-  void Checksum(::fidl::StringPtr value, ChecksumCallback callback) override;
+  explicit Rot13ServerApp(Options options);
+  ~Rot13ServerApp();
 
 protected:
   Rot13ServerApp(std::unique_ptr<sys::ComponentContext> context);
+  Rot13ServerApp(std::unique_ptr<sys::ComponentContext> context, Options options);
 
 private:
+  using Rot13 = fuchsia::examples::rot13::Rot13;
+
+  // Serves one connection, forwarding its requests to the app.
+  class Connection;
+
+  // The transforms of one connection. Only touched on the connection's
+  // dispatch thread, but shared with the replies still to be sent, which may
+  // outlive the connection.
+  struct TransformQueue {
+    // The key the connection's transforms are posted to the pool with.
+    size_t key = 0;
+    // The transforms on the pool whose replies have yet to be sent.
+    size_t in_flight = 0;
+  };
+
+  // A dispatch thread and the connections bound to it. |bindings| is only
+  // touched from |loop|'s thread.
+  struct DispatchShard {
+    DispatchShard();
+    async::Loop loop;
+    fidl::BindingSet<Rot13, std::unique_ptr<Rot13>> bindings;
+  };
+
   Rot13ServerApp(const Rot13ServerApp &) = delete;
   Rot13ServerApp &operator=(const Rot13ServerApp &) = delete;
+
+  void BindToShard(fidl::InterfaceRequest<Rot13> request);
+
+  void Encrypt(::fidl::StringPtr value, Rot13::EncryptCallback callback);
+  void Checksum(::fidl::StringPtr value, fuchsia::examples::rot13::ChecksumMode mode,
+                Rot13::ChecksumCallback callback);
+  void EncryptBatch(std::vector<std::string> values, Rot13::EncryptBatchCallback callback);
+  void ChecksumBatch(std::vector<std::string> values, fuchsia::examples::rot13::ChecksumMode mode,
+                     Rot13::ChecksumBatchCallback callback);
+  void EncryptBuffer(const std::shared_ptr<TransformQueue> &queue, fuchsia::mem::Buffer buffer,
+                     Rot13::EncryptBufferCallback callback);
+  void ChecksumBuffer(const std::shared_ptr<TransformQueue> &queue, fuchsia::mem::Buffer buffer,
+                      fuchsia::examples::rot13::ChecksumMode mode,
+                      Rot13::ChecksumBufferCallback callback);
+  void RegisterTable(std::array<uint8_t, 256> table, Rot13::RegisterTableCallback callback);
+  void Transform(uint32_t table_id, std::vector<uint8_t> value,
+                 Rot13::TransformCallback callback);
+  void TransformBuffer(const std::shared_ptr<TransformQueue> &queue, uint32_t table_id,
+                       fuchsia::mem::Buffer buffer, Rot13::TransformBufferCallback callback);
+
+  // Serves Encrypt and Checksum straight from the request messages, so the
+  // strings are never copied out of them. The other methods, and the ones
+  // above, are reached through the generated stub and Connection as usual.
+  void AddViewHandlers();
+
+  // Runs |transform| on the worker pool if |size| is large enough to be worth
+  // it, or if |queue| already has transforms there, otherwise inline.
+  // |transform| must be safe to run on any thread; its completion runs back
+  // on the calling dispatcher, after those of the earlier transforms in
+  // |queue|.
+  void RunTransform(const std::shared_ptr<TransformQueue> &queue, size_t size,
+                    fit::function<fit::closure()> transform);
+
+  // Returns the registered table with |id|, or null. Tables are never
+  // removed, so the result is valid for the life of the app.
+  const Substitution* FindTable(uint32_t id);
+
   std::unique_ptr<sys::ComponentContext> context_;
-  fidl::BindingSet<Rot13> bindings_;
+  Options options_;
+  // Before the bindings, which use it.
+  fidl::ViewHandlers view_handlers_;
+  fidl::BindingSet<Rot13, std::unique_ptr<Rot13>> bindings_;
+  std::vector<std::unique_ptr<DispatchShard>> shards_;
+  std::atomic<size_t> next_shard_{0};
+  // Spreads the connections' transforms across the workers.
+  std::atomic<size_t> next_queue_key_{0};
+  std::unique_ptr<WorkerPool> worker_pool_;
+
+  std::mutex tables_mutex_;
+  // Indexed by table id. Guarded by |tables_mutex_|.
+  std::vector<std::unique_ptr<Substitution>> tables_;
 };
 } // namespace rot13
 
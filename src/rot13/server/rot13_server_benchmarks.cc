@@ -0,0 +1,184 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Host benchmark for the multi-threaded server dispatch model. Many simulated
+/// connections each keep a few requests in flight. Every request is dispatched
+/// to the thread that owns its connection, exactly as Rot13ServerApp pins
+/// connections to dispatch threads, and is handled by encrypting and
+/// checksumming its payload. Reports throughput for 1 to N threads, and checks
+/// that each connection's requests were handled in order.
+///
+/// Usage: rot13_server_benchmarks [--clients N] [--depth N] [--requests N]
+///                                [--max-threads N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "checksum.h"
+#include "rot13.h"
+#include "worker_pool.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Config {
+  size_t clients = 256;
+  size_t depth = 4;
+  size_t requests_per_client = 2000;
+  size_t payload_size = 128;
+};
+
+// A simulated connection. After setup, all fields are only touched by the
+// worker that owns the connection.
+struct Client {
+  size_t id = 0;
+  std::string request;
+  std::string response;
+  size_t sent = 0;
+  size_t completed = 0;
+  size_t next_expected = 0;
+  size_t out_of_order = 0;
+  uint32_t checksum = 0;
+};
+
+class Run {
+ public:
+  Run(const Config &config, size_t threads) : config_(config), pool_(threads) {
+    clients_.resize(config.clients);
+    for (size_t i = 0; i < clients_.size(); i++) {
+      Client &client = clients_[i];
+      client.id = i;
+      client.request.assign(config.payload_size, static_cast<char>('a' + i % 26));
+      client.response.assign(config.payload_size, '\0');
+    }
+    remaining_clients_ = clients_.size();
+  }
+
+  // Returns the elapsed time, or zero if any connection saw a request out of
+  // order.
+  std::chrono::nanoseconds Execute() {
+    Clock::time_point start = Clock::now();
+    for (Client &client : clients_) {
+      // Fill the initial window from the connection's own thread, so the
+      // requests its first replies trigger are queued after the window.
+      pool_.Post(client.id, [this, client = &client] {
+        size_t initial = std::min(config_.depth, config_.requests_per_client);
+        for (; client->sent < initial; client->sent++) {
+          Issue(client, client->sent);
+        }
+      });
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_.wait(lock, [this] { return remaining_clients_ == 0; });
+    }
+    std::chrono::nanoseconds elapsed = Clock::now() - start;
+    for (const Client &client : clients_) {
+      if (client.out_of_order != 0) {
+        return std::chrono::nanoseconds(0);
+      }
+    }
+    return elapsed;
+  }
+
+ private:
+  void Issue(Client *client, size_t seq) {
+    pool_.Post(client->id, [this, client, seq] { Handle(client, seq); });
+  }
+
+  void Handle(Client *client, size_t seq) {
+    if (seq != client->next_expected) {
+      client->out_of_order++;
+    }
+    client->next_expected = seq + 1;
+
+    rot13::Rot13(client->request.data(), client->request.size(), &client->response[0]);
+    client->checksum = rot13::DoChecksum(client->response.data(), client->response.size(),
+                                         rot13::StreamingChecksum::Mode::kCrc32c);
+
+    client->completed++;
+    if (client->sent < config_.requests_per_client) {
+      Issue(client, client->sent++);
+    } else if (client->completed == config_.requests_per_client) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--remaining_clients_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+
+  const Config config_;
+  std::vector<Client> clients_;
+  std::mutex mutex_;
+  std::condition_variable done_;
+  size_t remaining_clients_ = 0;
+  // Declared last so the threads stop before the clients are destroyed.
+  rot13::WorkerPool pool_;
+};
+
+}  // namespace
+
+int main(int argc, const char **argv) {
+  Config config;
+  size_t max_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  for (int i = 1; i < argc - 1; ++i) {
+    if (!strcmp("--clients", argv[i])) {
+      config.clients = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp("--depth", argv[i])) {
+      config.depth = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp("--requests", argv[i])) {
+      config.requests_per_client = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp("--max-threads", argv[i])) {
+      max_threads = strtoul(argv[++i], nullptr, 10);
+    }
+  }
+
+  printf("%zu clients, %zu requests each, %zu in flight per client\n", config.clients,
+         config.requests_per_client, config.depth);
+  printf("%-10s %8s %14s %10s %9s\n", "payload", "threads", "requests/s", "GB/s", "speedup");
+
+  for (size_t payload_size : {128, 64 * 1024}) {
+    config.payload_size = payload_size;
+    // Keep the total work per run roughly constant across payload sizes.
+    Config run_config = config;
+    if (payload_size > 128) {
+      run_config.requests_per_client = std::max<size_t>(config.requests_per_client / 64, 1);
+    }
+    double baseline = 0;
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+      Run run(run_config, threads);
+      std::chrono::nanoseconds elapsed = run.Execute();
+      if (elapsed.count() == 0) {
+        fprintf(stderr, "requests were handled out of order with %zu threads\n", threads);
+        return 1;
+      }
+      double requests = static_cast<double>(run_config.clients * run_config.requests_per_client);
+      double seconds = static_cast<double>(elapsed.count()) / 1e9;
+      double rate = requests / seconds;
+      if (threads == 1) {
+        baseline = rate;
+      }
+      printf("%-10zu %8zu %14.0f %10.3f %8.2fx\n", payload_size, threads, rate,
+             rate * static_cast<double>(payload_size) / 1e9, rate / baseline);
+      fflush(stdout);
+      if (threads < max_threads && threads * 2 > max_threads) {
+        // Always include the full thread count.
+        threads = max_threads / 2;
+      }
+    }
+  }
+  return 0;
+}
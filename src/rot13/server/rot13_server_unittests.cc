@@ -3,13 +3,23 @@
 // found in the LICENSE file.
 
 #ifdef __FUCHSIA__
+#include <lib/async-loop/cpp/loop.h>
+#include <lib/async-loop/default.h>
 #include <lib/gtest/test_loop_fixture.h>
 #include <lib/sys/cpp/testing/component_context_provider.h>
 #endif
 
+#include <lib/zx/vmo.h>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "rot13_server_app.h"
+#include "substitution.h"
 
 namespace rot13 {
 namespace testing {
@@ -21,6 +31,8 @@ class Rot13ServerAppForTest : public Rot13ServerApp {
   // Expose injecting constructor so we can pass an instrumented Context
   Rot13ServerAppForTest(std::unique_ptr<sys::ComponentContext> context)
       : Rot13ServerApp(std::move(context)) {}
+  Rot13ServerAppForTest(std::unique_ptr<sys::ComponentContext> context, Options options)
+      : Rot13ServerApp(std::move(context), options) {}
 };
 
 class Rot13ServerAppTest : public gtest::TestLoopFixture {
@@ -80,10 +92,20 @@ TEST_F(Rot13ServerAppTest, Encrypt_Empty) {
   EXPECT_STREQ("", message->data());
 }
 
+// Answer a null string with ""
+TEST_F(Rot13ServerAppTest, Encrypt_Null) {
+  Rot13Ptr rot13_ = rot13();
+  fidl::StringPtr message = "bogus";
+  rot13_->Encrypt(fidl::StringPtr(), [&](::fidl::StringPtr retval) { message = retval; });
+  RunLoopUntilIdle();
+  ASSERT_TRUE(message.has_value());
+  EXPECT_STREQ("", message->data());
+}
+
 TEST_F(Rot13ServerAppTest, Checksum_Empty) {
   Rot13Ptr rot13_ = rot13();
   uint32_t value = -1;
-  rot13_->Checksum("", [&](uint32_t retval) { value = retval; });
+  rot13_->Checksum("", ChecksumMode::SUM, [&](uint32_t retval) { value = retval; });
   RunLoopUntilIdle();
   EXPECT_EQ(static_cast<uint32_t>(0), value);
 }
@@ -91,10 +113,252 @@ TEST_F(Rot13ServerAppTest, Checksum_Empty) {
 TEST_F(Rot13ServerAppTest, Checksum_HelloWorld) {
   Rot13Ptr rot13_ = rot13();
   uint32_t value = -1;
-  rot13_->Checksum("Hello World!", [&](uint32_t retval) { value = retval; });
+  rot13_->Checksum("Hello World!", ChecksumMode::SUM,
+                   [&](uint32_t retval) { value = retval; });
   RunLoopUntilIdle();
   EXPECT_EQ(static_cast<uint32_t>(1085), value);
 }
 
+// CRC-32C check value from RFC 3720.
+TEST_F(Rot13ServerAppTest, Checksum_Crc32c) {
+  Rot13Ptr rot13_ = rot13();
+  uint32_t value = 0;
+  rot13_->Checksum("123456789", ChecksumMode::CRC32C, [&](uint32_t retval) { value = retval; });
+  RunLoopUntilIdle();
+  EXPECT_EQ(0xe3069283u, value);
+}
+
+TEST_F(Rot13ServerAppTest, EncryptBatch_PreservesOrder) {
+  Rot13Ptr rot13_ = rot13();
+  std::vector<std::string> responses;
+  rot13_->EncryptBatch({"Hello World!", "", "aa is AA not ZZ zz!"},
+                       [&](std::vector<std::string> retval) { responses = std::move(retval); });
+  RunLoopUntilIdle();
+  ASSERT_EQ(3u, responses.size());
+  EXPECT_EQ("Uryyb Jbeyq!", responses[0]);
+  EXPECT_EQ("", responses[1]);
+  EXPECT_EQ("nn vf NN abg MM mm!", responses[2]);
+}
+
+TEST_F(Rot13ServerAppTest, ChecksumBatch_HelloWorld) {
+  Rot13Ptr rot13_ = rot13();
+  std::vector<uint32_t> responses;
+  rot13_->ChecksumBatch({"", "Hello World!"}, ChecksumMode::SUM,
+                        [&](std::vector<uint32_t> retval) { responses = std::move(retval); });
+  RunLoopUntilIdle();
+  ASSERT_EQ(2u, responses.size());
+  EXPECT_EQ(0u, responses[0]);
+  EXPECT_EQ(1085u, responses[1]);
+}
+
+TEST_F(Rot13ServerAppTest, EncryptBuffer_HelloWorld) {
+  Rot13Ptr rot13_ = rot13();
+  const char kMessage[] = "Hello World!";
+  zx::vmo vmo;
+  ASSERT_EQ(ZX_OK, zx::vmo::create(sizeof(kMessage), 0, &vmo));
+  ASSERT_EQ(ZX_OK, vmo.write(kMessage, 0, sizeof(kMessage)));
+  fuchsia::mem::Buffer buffer;
+  buffer.vmo = std::move(vmo);
+  buffer.size = sizeof(kMessage) - 1;
+
+  bool called = false;
+  rot13_->EncryptBuffer(std::move(buffer), [&](Rot13_EncryptBuffer_Result result) {
+    called = true;
+    ASSERT_TRUE(result.is_response());
+    fuchsia::mem::Buffer& response = result.response().response;
+    EXPECT_EQ(sizeof(kMessage) - 1, response.size);
+    char encrypted[sizeof(kMessage)] = {};
+    ASSERT_EQ(ZX_OK, response.vmo.read(encrypted, 0, sizeof(kMessage)));
+    EXPECT_STREQ("Uryyb Jbeyq!", encrypted);
+  });
+  RunLoopUntilIdle();
+  EXPECT_TRUE(called);
+}
+
+TEST_F(Rot13ServerAppTest, ChecksumBuffer_HelloWorld) {
+  Rot13Ptr rot13_ = rot13();
+  const char kMessage[] = "Hello World!";
+  zx::vmo vmo;
+  ASSERT_EQ(ZX_OK, zx::vmo::create(sizeof(kMessage), 0, &vmo));
+  ASSERT_EQ(ZX_OK, vmo.write(kMessage, 0, sizeof(kMessage)));
+  fuchsia::mem::Buffer buffer;
+  buffer.vmo = std::move(vmo);
+  buffer.size = sizeof(kMessage) - 1;
+
+  bool called = false;
+  rot13_->ChecksumBuffer(std::move(buffer), ChecksumMode::SUM,
+                         [&](Rot13_ChecksumBuffer_Result result) {
+                           called = true;
+                           ASSERT_TRUE(result.is_response());
+                           EXPECT_EQ(1085u, result.response().response);
+                         });
+  RunLoopUntilIdle();
+  EXPECT_TRUE(called);
+}
+
+TEST_F(Rot13ServerAppTest, EncryptBuffer_SizeLargerThanVmo) {
+  Rot13Ptr rot13_ = rot13();
+  zx::vmo vmo;
+  ASSERT_EQ(ZX_OK, zx::vmo::create(ZX_PAGE_SIZE, 0, &vmo));
+  fuchsia::mem::Buffer buffer;
+  buffer.vmo = std::move(vmo);
+  buffer.size = 2 * ZX_PAGE_SIZE;
+
+  bool called = false;
+  rot13_->EncryptBuffer(std::move(buffer), [&](Rot13_EncryptBuffer_Result result) {
+    called = true;
+    ASSERT_TRUE(result.is_err());
+    EXPECT_EQ(ZX_ERR_OUT_OF_RANGE, result.err());
+  });
+  RunLoopUntilIdle();
+  EXPECT_TRUE(called);
+}
+
+std::vector<uint8_t> Bytes(const std::string& str) {
+  return std::vector<uint8_t>(str.begin(), str.end());
+}
+
+std::array<uint8_t, 256> ToArray(const SubstitutionTable& table) {
+  std::array<uint8_t, 256> bytes;
+  std::copy(table.bytes, table.bytes + 256, bytes.begin());
+  return bytes;
+}
+
+TEST_F(Rot13ServerAppTest, Transform_Presets) {
+  Rot13Ptr rot13_ = rot13();
+  std::vector<uint8_t> rotated13;
+  std::vector<uint8_t> rotated47;
+  rot13_->Transform(ROT13_TABLE_ID, Bytes("Hello World!"), [&](Rot13_Transform_Result result) {
+    ASSERT_TRUE(result.is_response());
+    rotated13 = std::move(result.response().response);
+  });
+  rot13_->Transform(ROT47_TABLE_ID, Bytes("Hello, World!"), [&](Rot13_Transform_Result result) {
+    ASSERT_TRUE(result.is_response());
+    rotated47 = std::move(result.response().response);
+  });
+  RunLoopUntilIdle();
+  EXPECT_EQ(Bytes("Uryyb Jbeyq!"), rotated13);
+  EXPECT_EQ(Bytes("w6==@[ (@C=5P"), rotated47);
+}
+
+TEST_F(Rot13ServerAppTest, RegisterTable_ReturnsExistingIds) {
+  Rot13Ptr rot13_ = rot13();
+  std::vector<uint32_t> ids;
+  auto record = [&](Rot13_RegisterTable_Result result) {
+    ASSERT_TRUE(result.is_response());
+    ids.push_back(result.response().id);
+  };
+  rot13_->RegisterTable(ToArray(kRot13Table), record);
+  rot13_->RegisterTable(ToArray(CaesarTable(3)), record);
+  rot13_->RegisterTable(ToArray(CaesarTable(3)), record);
+  RunLoopUntilIdle();
+  ASSERT_EQ(3u, ids.size());
+  EXPECT_EQ(ROT13_TABLE_ID, ids[0]);
+  EXPECT_NE(ROT13_TABLE_ID, ids[1]);
+  EXPECT_NE(ROT47_TABLE_ID, ids[1]);
+  EXPECT_EQ(ids[1], ids[2]);
+
+  // The table is visible to other connections.
+  Rot13Ptr other = rot13();
+  std::vector<uint8_t> response;
+  other->Transform(ids[1], Bytes("xyz"), [&](Rot13_Transform_Result result) {
+    ASSERT_TRUE(result.is_response());
+    response = std::move(result.response().response);
+  });
+  RunLoopUntilIdle();
+  EXPECT_EQ(Bytes("abc"), response);
+}
+
+TEST_F(Rot13ServerAppTest, RegisterTable_Full) {
+  Rot13Ptr rot13_ = rot13();
+  size_t registered = 0;
+  zx_status_t error = ZX_OK;
+  for (uint32_t i = 0; i < MAX_TABLES; i++) {
+    SubstitutionTable table = IdentityTable();
+    table.bytes[0] = static_cast<uint8_t>(i);
+    table.bytes[1] = static_cast<uint8_t>(i >> 8) + 1;
+    rot13_->RegisterTable(ToArray(table), [&](Rot13_RegisterTable_Result result) {
+      if (result.is_response()) {
+        registered++;
+      } else {
+        error = result.err();
+      }
+    });
+  }
+  RunLoopUntilIdle();
+  // Two slots are taken by the presets.
+  EXPECT_EQ(MAX_TABLES - 2, registered);
+  EXPECT_EQ(ZX_ERR_NO_RESOURCES, error);
+}
+
+TEST_F(Rot13ServerAppTest, Transform_UnknownTable) {
+  Rot13Ptr rot13_ = rot13();
+  bool called = false;
+  rot13_->Transform(MAX_TABLES, Bytes("abc"), [&](Rot13_Transform_Result result) {
+    called = true;
+    ASSERT_TRUE(result.is_err());
+    EXPECT_EQ(ZX_ERR_NOT_FOUND, result.err());
+  });
+  RunLoopUntilIdle();
+  EXPECT_TRUE(called);
+}
+
+TEST_F(Rot13ServerAppTest, TransformBuffer_Rot47) {
+  Rot13Ptr rot13_ = rot13();
+  const char kMessage[] = "Hello, World!";
+  zx::vmo vmo;
+  ASSERT_EQ(ZX_OK, zx::vmo::create(sizeof(kMessage), 0, &vmo));
+  ASSERT_EQ(ZX_OK, vmo.write(kMessage, 0, sizeof(kMessage)));
+  fuchsia::mem::Buffer buffer;
+  buffer.vmo = std::move(vmo);
+  buffer.size = sizeof(kMessage) - 1;
+
+  bool called = false;
+  rot13_->TransformBuffer(ROT47_TABLE_ID, std::move(buffer),
+                          [&](Rot13_TransformBuffer_Result result) {
+                            called = true;
+                            ASSERT_TRUE(result.is_response());
+                            char transformed[sizeof(kMessage)] = {};
+                            ASSERT_EQ(ZX_OK, result.response().response.vmo.read(
+                                                 transformed, 0, sizeof(kMessage)));
+                            EXPECT_STREQ("w6==@[ (@C=5P", transformed);
+                          });
+  RunLoopUntilIdle();
+  EXPECT_TRUE(called);
+}
+
+// The large request runs on a worker while the small one would run inline, but
+// the small one's reply still comes second. Uses a real loop, since the worker
+// posts the large reply back from its own thread.
+TEST(Rot13ServerAppWorkersTest, EncryptBuffer_RepliesInOrder) {
+  async::Loop loop(&kAsyncLoopConfigAttachToCurrentThread);
+  sys::testing::ComponentContextProvider provider(loop.dispatcher());
+  Rot13ServerApp::Options options;
+  options.worker_threads = 2;
+  options.offload_threshold = ZX_PAGE_SIZE;
+  Rot13ServerAppForTest app(provider.TakeContext(), options);
+  Rot13Ptr rot13_;
+  provider.ConnectToPublicService(rot13_.NewRequest());
+
+  const size_t sizes[] = {64 * ZX_PAGE_SIZE, 1};
+  std::vector<uint64_t> replies;
+  for (size_t size : sizes) {
+    zx::vmo vmo;
+    ASSERT_EQ(ZX_OK, zx::vmo::create(size, 0, &vmo));
+    fuchsia::mem::Buffer buffer;
+    buffer.vmo = std::move(vmo);
+    buffer.size = size;
+    rot13_->EncryptBuffer(std::move(buffer), [&](Rot13_EncryptBuffer_Result result) {
+      EXPECT_TRUE(result.is_response());
+      replies.push_back(result.is_response() ? result.response().response.size : 0);
+      if (replies.size() == 2) {
+        loop.Quit();
+      }
+    });
+  }
+  loop.Run();
+  EXPECT_EQ(std::vector<uint64_t>(sizes, sizes + 2), replies);
+}
+
 }  // namespace testing
 }  // namespace rot13
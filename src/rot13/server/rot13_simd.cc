@@ -0,0 +1,134 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Vectorized rot13 kernels, generalized to any Caesar rotation.
+///
+/// Every kernel uses the same branch-free formulation. Setting bit 0x20 folds
+/// upper case letters onto lower case ones, so a single range check per part
+/// of the alphabet is enough. For a rotation by |shift|:
+///
+///   folded = c | 0x20
+///   delta  = ('a' <= folded <= 'z' - shift)       ? +shift
+///          : ('z' - shift < folded <= 'z')        ? shift - 26
+///          : 0
+///   out    = c + delta
+///
+/// Bytes that are not ASCII letters, including bytes >= 0x80, get a delta of
+/// zero, which matches the scalar reference in the "C" locale. The rot13
+/// kernels are the rotation by 13; the shift only affects the constants
+/// loaded before the loop, so they cost nothing extra.
+
+#include "rot13_kernels.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace rot13 {
+namespace internal {
+
+void CaesarScalar(const char *src, size_t len, char *dst, int shift) {
+  const int last_unwrapped = 'z' - shift;
+  for (size_t i = 0; i < len; i++) {
+    int c = static_cast<unsigned char>(src[i]);
+    int folded = c | 0x20;
+    if (folded >= 'a' && folded <= 'z') {
+      c += folded <= last_unwrapped ? shift : shift - 26;
+    }
+    dst[i] = static_cast<char>(c);
+  }
+}
+
+#if defined(__x86_64__)
+
+// SSE2 only has signed byte compares. Bytes >= 0x80 compare as negative,
+// which places them below 'a' and so correctly outside both ranges.
+void CaesarSse2(const char *src, size_t len, char *dst, int shift) {
+  const __m128i case_bit = _mm_set1_epi8(0x20);
+  const __m128i before_a = _mm_set1_epi8('a' - 1);
+  const __m128i after_unwrapped = _mm_set1_epi8(static_cast<char>('z' - shift + 1));
+  const __m128i after_z = _mm_set1_epi8('z' + 1);
+  const __m128i forward = _mm_set1_epi8(static_cast<char>(shift));
+  const __m128i backward = _mm_set1_epi8(static_cast<char>(shift - 26));
+
+  size_t i = 0;
+  for (; i + sizeof(__m128i) <= len; i += sizeof(__m128i)) {
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m128i folded = _mm_or_si128(c, case_bit);
+    __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(folded, before_a),
+                                   _mm_cmpgt_epi8(after_z, folded));
+    __m128i unwrapped = _mm_cmpgt_epi8(after_unwrapped, folded);
+    __m128i delta = _mm_and_si128(letter, _mm_or_si128(_mm_and_si128(unwrapped, forward),
+                                                       _mm_andnot_si128(unwrapped, backward)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_add_epi8(c, delta));
+  }
+  CaesarScalar(src + i, len - i, dst + i, shift);
+}
+
+__attribute__((target("avx2"))) void CaesarAvx2(const char *src, size_t len, char *dst,
+                                                int shift) {
+  const __m256i case_bit = _mm256_set1_epi8(0x20);
+  const __m256i before_a = _mm256_set1_epi8('a' - 1);
+  const __m256i after_unwrapped = _mm256_set1_epi8(static_cast<char>('z' - shift + 1));
+  const __m256i after_z = _mm256_set1_epi8('z' + 1);
+  const __m256i forward = _mm256_set1_epi8(static_cast<char>(shift));
+  const __m256i backward = _mm256_set1_epi8(static_cast<char>(shift - 26));
+
+  size_t i = 0;
+  for (; i + sizeof(__m256i) <= len; i += sizeof(__m256i)) {
+    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    __m256i folded = _mm256_or_si256(c, case_bit);
+    __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(folded, before_a),
+                                      _mm256_cmpgt_epi8(after_z, folded));
+    __m256i unwrapped = _mm256_cmpgt_epi8(after_unwrapped, folded);
+    __m256i delta = _mm256_and_si256(letter, _mm256_blendv_epi8(backward, forward, unwrapped));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_add_epi8(c, delta));
+  }
+  // Finish with the SSE2 kernel so at most 15 bytes go through the scalar
+  // loop. Clear the upper halves of the YMM registers first: legacy SSE code
+  // running while they are dirty pays a state transition that costs more
+  // than the whole of a short message.
+  _mm256_zeroupper();
+  CaesarSse2(src + i, len - i, dst + i, shift);
+}
+
+void Rot13Sse2(const char *src, size_t len, char *dst) { CaesarSse2(src, len, dst, 13); }
+
+void Rot13Avx2(const char *src, size_t len, char *dst) { CaesarAvx2(src, len, dst, 13); }
+
+#endif  // defined(__x86_64__)
+
+#if defined(__aarch64__)
+
+void CaesarNeon(const char *src, size_t len, char *dst, int shift) {
+  const uint8x16_t case_bit = vdupq_n_u8(0x20);
+  const uint8x16_t lower_a = vdupq_n_u8('a');
+  const uint8x16_t last_unwrapped = vdupq_n_u8(static_cast<uint8_t>('z' - shift));
+  const uint8x16_t lower_z = vdupq_n_u8('z');
+  const int8x16_t forward = vdupq_n_s8(static_cast<int8_t>(shift));
+  const int8x16_t backward = vdupq_n_s8(static_cast<int8_t>(shift - 26));
+
+  size_t i = 0;
+  for (; i + sizeof(uint8x16_t) <= len; i += sizeof(uint8x16_t)) {
+    uint8x16_t c = vld1q_u8(reinterpret_cast<const uint8_t *>(src + i));
+    uint8x16_t folded = vorrq_u8(c, case_bit);
+    uint8x16_t letter = vandq_u8(vcgeq_u8(folded, lower_a), vcleq_u8(folded, lower_z));
+    uint8x16_t unwrapped = vcleq_u8(folded, last_unwrapped);
+    int8x16_t delta = vbslq_s8(unwrapped, forward, backward);
+    delta = vandq_s8(delta, vreinterpretq_s8_u8(letter));
+    vst1q_u8(reinterpret_cast<uint8_t *>(dst + i), vaddq_u8(c, vreinterpretq_u8_s8(delta)));
+  }
+  CaesarScalar(src + i, len - i, dst + i, shift);
+}
+
+void Rot13Neon(const char *src, size_t len, char *dst) { CaesarNeon(src, len, dst, 13); }
+
+#endif  // defined(__aarch64__)
+
+}  // namespace internal
+}  // namespace rot13
@@ -2,9 +2,18 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <limits.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <random>
+
 #include <gtest/gtest.h>
 
+#include "checksum.h"
 #include "rot13.h"
+#include "substitution.h"
 
 namespace rot13 {
 namespace testing {
@@ -36,6 +45,74 @@ TEST(Rot13Test, Encrypt_Empty) {
   EXPECT_STREQ("", message.c_str());
 }
 
+// Embedded NULs are encrypted like any other non-letter byte.
+TEST(Rot13Test, Encrypt_WithLength) {
+  const char input[] = "ab\0YZ";
+  std::string message = DoRot13(input, sizeof(input) - 1);
+  EXPECT_EQ(std::string("no\0LM", 5), message);
+}
+
+TEST(Rot13Test, Encrypt_InPlace) {
+  std::string message = "Hello World!";
+  Rot13InPlace(&message[0], message.size());
+  EXPECT_EQ("Uryyb Jbeyq!", message);
+}
+
+// Every kernel must agree with the scalar reference for every byte value, for
+// lengths that exercise both the vector loop and the tail, and at unaligned
+// offsets.
+TEST(Rot13Test, Kernels_MatchScalar) {
+  std::string input;
+  for (int i = 0; i < 3; i++) {
+    for (int c = 0; c < 256; c++) {
+      input.push_back(static_cast<char>(c));
+    }
+  }
+
+  for (const Rot13Kernel &kernel : AvailableRot13Kernels()) {
+    for (size_t offset = 0; offset < 32; offset++) {
+      for (size_t len = 0; len + offset <= input.size(); len += 7) {
+        std::string expected(len, '\0');
+        std::string actual(len, '\0');
+        Rot13Scalar(input.data() + offset, len, &expected[0]);
+        kernel.apply(input.data() + offset, len, &actual[0]);
+        ASSERT_EQ(expected, actual) << kernel.name << " offset " << offset << " len " << len;
+      }
+    }
+  }
+}
+
+TEST(Rot13Test, Kernels_RoundTrip) {
+  std::string input;
+  for (int c = 0; c < 256; c++) {
+    input.push_back(static_cast<char>(c));
+  }
+  for (const Rot13Kernel &kernel : AvailableRot13Kernels()) {
+    std::string buffer = input;
+    kernel.apply(buffer.data(), buffer.size(), &buffer[0]);
+    kernel.apply(buffer.data(), buffer.size(), &buffer[0]);
+    EXPECT_EQ(input, buffer) << kernel.name;
+  }
+}
+
+// The bulk path maps the request VMO and transforms it in place. Exercise the
+// same code on an anonymous mapping spanning several pages.
+TEST(Rot13Test, Encrypt_MappedRegion) {
+  const size_t kSize = 3 * 4096 + 123;
+  void *addr = mmap(nullptr, kSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  ASSERT_NE(MAP_FAILED, addr);
+  char *region = static_cast<char *>(addr);
+  std::string expected(kSize, '\0');
+  for (size_t i = 0; i < kSize; i++) {
+    region[i] = static_cast<char>('A' + i % 58);
+  }
+  Rot13Scalar(region, kSize, &expected[0]);
+
+  Rot13InPlace(region, kSize);
+  EXPECT_EQ(expected, std::string(region, kSize));
+  munmap(addr, kSize);
+}
+
 TEST(Rot13Test, Checksum_Empty) {
   uint32_t value = -1;
   value = DoChecksum("");
@@ -48,5 +125,208 @@ TEST(Rot13Test, Checksum_HelloWorld) {
   EXPECT_EQ(static_cast<uint32_t>(1085), value);
 }
 
+// Bytes >= 0x80 count as plain chars, as in the original checksum: negative
+// where char is signed, as on x86-64, and positive on arm64.
+TEST(Rot13Test, Checksum_HighBytes) {
+  const char kInput[] = "\x80\xff\x01";
+  const uint32_t expected = CHAR_MIN < 0 ? static_cast<uint32_t>(-128 - 1 + 1) : 128 + 255 + 1;
+  EXPECT_EQ(expected, DoChecksum(kInput, sizeof(kInput) - 1, StreamingChecksum::Mode::kSum));
+  for (const ChecksumKernel &kernel : AvailableChecksumKernels()) {
+    if (kernel.mode == StreamingChecksum::Mode::kSum) {
+      std::vector<uint8_t> high(100, 0xff);
+      const uint32_t expected_high = CHAR_MIN < 0 ? static_cast<uint32_t>(-100) : 255 * 100;
+      EXPECT_EQ(expected_high, kernel.update(0, high.data(), high.size())) << kernel.name;
+    }
+  }
+}
+
+// Check values from RFC 3720, appendix B.4.
+TEST(Rot13Test, Checksum_Crc32cKnownValues) {
+  const StreamingChecksum::Mode kCrc32c = StreamingChecksum::Mode::kCrc32c;
+  EXPECT_EQ(0u, DoChecksum("", 0, kCrc32c));
+  EXPECT_EQ(0xe3069283u, DoChecksum("123456789", 9, kCrc32c));
+  std::string zeros(32, '\0');
+  EXPECT_EQ(0x8a9136aau, DoChecksum(zeros.data(), zeros.size(), kCrc32c));
+  std::string ones(32, '\xff');
+  EXPECT_EQ(0x62a8ab43u, DoChecksum(ones.data(), ones.size(), kCrc32c));
+}
+
+TEST(Rot13Test, Checksum_MatchesLegacySum) {
+  EXPECT_EQ(DoChecksum("Hello World!"),
+            DoChecksum("Hello World!", 12, StreamingChecksum::Mode::kSum));
+}
+
+// Splitting the input across Update() calls must not change the result.
+TEST(Rot13Test, Checksum_Streaming) {
+  std::string input;
+  for (int i = 0; i < 1000; i++) {
+    input.push_back(static_cast<char>(i * 31));
+  }
+  for (StreamingChecksum::Mode mode :
+       {StreamingChecksum::Mode::kSum, StreamingChecksum::Mode::kCrc32c}) {
+    uint32_t expected = DoChecksum(input.data(), input.size(), mode);
+    for (size_t chunk : {1, 3, 7, 16, 33, 100, 999}) {
+      StreamingChecksum checksum(mode);
+      for (size_t i = 0; i < input.size(); i += chunk) {
+        checksum.Update(input.data() + i, std::min(chunk, input.size() - i));
+      }
+      EXPECT_EQ(expected, checksum.Finalize()) << "chunk " << chunk;
+    }
+  }
+}
+
+// A bit-at-a-time CRC-32C, independent of the table used by the kernels.
+uint32_t Crc32cBitwise(uint32_t crc, const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ ((crc & 1) ? 0x82f63b78 : 0);
+    }
+  }
+  return crc;
+}
+
+// Every checksum kernel must agree with the scalar reference for its mode.
+TEST(Rot13Test, ChecksumKernels_MatchReference) {
+  std::string input;
+  for (int i = 0; i < 3; i++) {
+    for (int c = 0; c < 256; c++) {
+      input.push_back(static_cast<char>(c * (i + 1)));
+    }
+  }
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(input.data());
+
+  for (const ChecksumKernel &kernel : AvailableChecksumKernels()) {
+    for (size_t offset = 0; offset < 32; offset++) {
+      for (size_t len = 0; len + offset <= input.size(); len += 7) {
+        uint32_t expected = 0;
+        uint32_t actual = 0;
+        if (kernel.mode == StreamingChecksum::Mode::kSum) {
+          for (size_t i = 0; i < len; i++) {
+            expected += input[offset + i];
+          }
+          actual = kernel.update(0, data + offset, len);
+        } else {
+          expected = Crc32cBitwise(0xffffffff, data + offset, len);
+          actual = kernel.update(0xffffffff, data + offset, len);
+        }
+        ASSERT_EQ(expected, actual) << kernel.name << " offset " << offset << " len " << len;
+      }
+    }
+  }
+}
+
+// The presets are built at compile time.
+static_assert(kRot13Table.bytes['a'] == 'n' && kRot13Table.bytes['Z'] == 'M', "rot13 preset");
+static_assert(kRot47Table.bytes['!'] == 'P' && kRot47Table.bytes['~'] == 'O', "rot47 preset");
+
+TEST(SubstitutionTest, Rot13PresetMatchesRot13) {
+  Substitution rot13(kRot13Table);
+  EXPECT_EQ(13, rot13.caesar_shift());
+  EXPECT_STREQ(SelectedRot13Kernel().name, rot13.kernel_name() + strlen("caesar-"));
+
+  std::string input;
+  for (int c = 0; c < 256; c++) {
+    input.push_back(static_cast<char>(c));
+  }
+  std::string expected(input.size(), '\0');
+  std::string actual(input.size(), '\0');
+  Rot13Scalar(input.data(), input.size(), &expected[0]);
+  rot13.Apply(input.data(), input.size(), &actual[0]);
+  EXPECT_EQ(expected, actual);
+}
+
+TEST(SubstitutionTest, Rot47) {
+  Substitution rot47(kRot47Table);
+  EXPECT_EQ(0, rot47.caesar_shift());
+  std::string message = "Hello, World!";
+  rot47.ApplyInPlace(&message[0], message.size());
+  EXPECT_EQ("w6==@[ (@C=5P", message);
+  rot47.ApplyInPlace(&message[0], message.size());
+  EXPECT_EQ("Hello, World!", message);
+}
+
+TEST(SubstitutionTest, Caesar) {
+  Substitution rot3(CaesarTable(3));
+  EXPECT_EQ(3, rot3.caesar_shift());
+  std::string message = "xyz ABC";
+  rot3.ApplyInPlace(&message[0], message.size());
+  EXPECT_EQ("abc DEF", message);
+
+  Substitution back(CaesarTable(-3));
+  EXPECT_EQ(23, back.caesar_shift());
+  back.ApplyInPlace(&message[0], message.size());
+  EXPECT_EQ("xyz ABC", message);
+}
+
+TEST(SubstitutionTest, IdentityCopies) {
+  Substitution identity(IdentityTable());
+  EXPECT_STREQ("copy", identity.kernel_name());
+  EXPECT_STREQ(identity.kernel_name(), Substitution(CaesarTable(26)).kernel_name());
+  std::string output(5, '\0');
+  identity.Apply("ab\0YZ", 5, &output[0]);
+  EXPECT_EQ(std::string("ab\0YZ", 5), output);
+}
+
+// Every kernel must agree with the scalar reference on every table it
+// supports, for every byte value, at every alignment and for lengths that
+// exercise both the vector loop and the tail.
+TEST(SubstitutionTest, Kernels_MatchScalar) {
+  std::vector<SubstitutionTable> tables = {IdentityTable(), CaesarTable(1), kRot13Table,
+                                           CaesarTable(25), kRot47Table};
+  // A random permutation touches every row of the lookup.
+  SubstitutionTable permutation = IdentityTable();
+  std::shuffle(permutation.bytes, permutation.bytes + 256, std::mt19937(42));
+  tables.push_back(permutation);
+  // A single changed byte, in the last row.
+  SubstitutionTable sparse = IdentityTable();
+  sparse.bytes[0xfe] = 0x01;
+  tables.push_back(sparse);
+  // Not a bijection.
+  SubstitutionTable zeros = {};
+  tables.push_back(zeros);
+
+  std::string input;
+  for (int i = 0; i < 3; i++) {
+    for (int c = 0; c < 256; c++) {
+      input.push_back(static_cast<char>(c * (2 * i + 1)));
+    }
+  }
+
+  for (size_t t = 0; t < tables.size(); t++) {
+    Substitution substitution(tables[t]);
+    for (const SubstitutionKernel &kernel : AvailableSubstitutionKernels()) {
+      if (kernel.caesar_only && substitution.caesar_shift() == 0) {
+        continue;
+      }
+      for (size_t offset = 0; offset < 32; offset++) {
+        for (size_t len = 0; len + offset <= input.size(); len += 7) {
+          std::string expected(len, '\0');
+          std::string actual(len, '\0');
+          SubstituteScalar(tables[t], input.data() + offset, len, &expected[0]);
+          kernel.apply(substitution, input.data() + offset, len, &actual[0]);
+          ASSERT_EQ(expected, actual)
+              << kernel.name << " table " << t << " offset " << offset << " len " << len;
+        }
+      }
+    }
+  }
+}
+
+// The dispatched kernel, in place.
+TEST(SubstitutionTest, ApplyInPlace_MatchesScalar) {
+  SubstitutionTable permutation = IdentityTable();
+  std::shuffle(permutation.bytes, permutation.bytes + 256, std::mt19937(7));
+  Substitution substitution(permutation);
+  std::string buffer;
+  for (int i = 0; i < 1000; i++) {
+    buffer.push_back(static_cast<char>(i * 13));
+  }
+  std::string expected(buffer.size(), '\0');
+  SubstituteScalar(permutation, buffer.data(), buffer.size(), &expected[0]);
+  substitution.ApplyInPlace(&buffer[0], buffer.size());
+  EXPECT_EQ(expected, buffer) << substitution.kernel_name();
+}
+
 }  // namespace testing
 }  // namespace rot13
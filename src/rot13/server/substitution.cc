@@ -0,0 +1,153 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "substitution.h"
+
+#include <string.h>
+
+#include "cpu_features.h"
+
+namespace rot13 {
+namespace {
+
+void CopyBytes(const char *src, size_t len, char *dst) {
+  if (src != dst) {
+    memmove(dst, src, len);
+  }
+}
+
+// Returns the rotation if |table| is CaesarTable(shift) for some shift in
+// [1, 25], otherwise zero.
+int FindCaesarShift(const SubstitutionTable &table) {
+  int shift = table.bytes['a'] - 'a';
+  if (shift <= 0 || shift >= 26) {
+    return 0;
+  }
+  const SubstitutionTable caesar = CaesarTable(shift);
+  return memcmp(caesar.bytes, table.bytes, sizeof(table.bytes)) == 0 ? shift : 0;
+}
+
+void ApplyCaesar(const Substitution &substitution, const char *src, size_t len, char *dst,
+                 void (*kernel)(const char *, size_t, char *, int)) {
+  kernel(src, len, dst, substitution.caesar_shift());
+}
+
+}  // namespace
+
+void SubstituteScalar(const SubstitutionTable &table, const char *src, size_t len, char *dst) {
+  for (size_t i = 0; i < len; i++) {
+    dst[i] = static_cast<char>(table.bytes[static_cast<unsigned char>(src[i])]);
+  }
+}
+
+Substitution::Substitution(const SubstitutionTable &table) : table_(table) {
+  memcpy(lookup_.bytes, table.bytes, sizeof(lookup_.bytes));
+  lookup_.active_rows = 0;
+  for (int b = 0; b < 256; b++) {
+    uint8_t delta = static_cast<uint8_t>(table.bytes[b] - b);
+    lookup_.deltas[b / 16][b % 16] = delta;
+    if (delta != 0) {
+      lookup_.active_rows |= static_cast<uint16_t>(1u << (b / 16));
+    }
+  }
+  caesar_shift_ = FindCaesarShift(table);
+
+  if (lookup_.active_rows == 0) {
+    kernel_name_ = "copy";
+  } else if (caesar_shift_ != 0) {
+#if defined(__x86_64__)
+    if (GetCpuFeatures().avx2) {
+      caesar_kernel_ = internal::CaesarAvx2;
+      kernel_name_ = "caesar-avx2";
+    } else {
+      caesar_kernel_ = internal::CaesarSse2;
+      kernel_name_ = "caesar-sse2";
+    }
+#elif defined(__aarch64__)
+    caesar_kernel_ = internal::CaesarNeon;
+    kernel_name_ = "caesar-neon";
+#else
+    caesar_kernel_ = internal::CaesarScalar;
+    kernel_name_ = "caesar-scalar";
+#endif
+  } else {
+    lookup_kernel_ = internal::LookupScalar;
+    kernel_name_ = "lookup-scalar";
+#if defined(__x86_64__)
+    if (GetCpuFeatures().avx2) {
+      lookup_kernel_ = internal::LookupAvx2;
+      kernel_name_ = "lookup-avx2";
+    } else if (GetCpuFeatures().ssse3) {
+      lookup_kernel_ = internal::LookupSsse3;
+      kernel_name_ = "lookup-ssse3";
+    }
+#elif defined(__aarch64__)
+    lookup_kernel_ = internal::LookupNeon;
+    kernel_name_ = "lookup-neon";
+#endif
+  }
+}
+
+void Substitution::Apply(const char *src, size_t len, char *dst) const {
+  if (caesar_kernel_) {
+    caesar_kernel_(src, len, dst, caesar_shift_);
+  } else if (lookup_kernel_) {
+    lookup_kernel_(lookup_, src, len, dst);
+  } else {
+    CopyBytes(src, len, dst);
+  }
+}
+
+std::vector<SubstitutionKernel> AvailableSubstitutionKernels() {
+  std::vector<SubstitutionKernel> kernels = {
+      {"scalar", false,
+       [](const Substitution &s, const char *src, size_t len, char *dst) {
+         SubstituteScalar(s.table(), src, len, dst);
+       }},
+      {"caesar-scalar", true,
+       [](const Substitution &s, const char *src, size_t len, char *dst) {
+         ApplyCaesar(s, src, len, dst, internal::CaesarScalar);
+       }},
+      {"lookup-scalar", false,
+       [](const Substitution &s, const char *src, size_t len, char *dst) {
+         internal::LookupScalar(s.lookup_table(), src, len, dst);
+       }},
+  };
+#if defined(__x86_64__)
+  const CpuFeatures &features = GetCpuFeatures();
+  kernels.push_back({"caesar-sse2", true,
+                     [](const Substitution &s, const char *src, size_t len, char *dst) {
+                       ApplyCaesar(s, src, len, dst, internal::CaesarSse2);
+                     }});
+  if (features.ssse3) {
+    kernels.push_back({"lookup-ssse3", false,
+                       [](const Substitution &s, const char *src, size_t len, char *dst) {
+                         internal::LookupSsse3(s.lookup_table(), src, len, dst);
+                       }});
+  }
+  if (features.avx2) {
+    kernels.push_back({"caesar-avx2", true,
+                       [](const Substitution &s, const char *src, size_t len, char *dst) {
+                         ApplyCaesar(s, src, len, dst, internal::CaesarAvx2);
+                       }});
+    kernels.push_back({"lookup-avx2", false,
+                       [](const Substitution &s, const char *src, size_t len, char *dst) {
+                         internal::LookupAvx2(s.lookup_table(), src, len, dst);
+                       }});
+  }
+#endif
+#if defined(__aarch64__)
+  kernels.push_back({"caesar-neon", true,
+                     [](const Substitution &s, const char *src, size_t len, char *dst) {
+                       ApplyCaesar(s, src, len, dst, internal::CaesarNeon);
+                     }});
+  kernels.push_back({"lookup-neon", false,
+                     [](const Substitution &s, const char *src, size_t len, char *dst) {
+                       internal::LookupNeon(s.lookup_table(), src, len, dst);
+                     }});
+#endif
+  return kernels;
+}
+
+}  // namespace rot13
@@ -0,0 +1,113 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef EXAMPLES_ROT13_SERVER_SUBSTITUTION_H_
+#define EXAMPLES_ROT13_SERVER_SUBSTITUTION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "rot13_kernels.h"
+
+namespace rot13 {
+
+// A byte substitution cipher: byte b is replaced by bytes[b].
+struct SubstitutionTable {
+  uint8_t bytes[256];
+};
+
+// Maps every byte to itself.
+constexpr SubstitutionTable IdentityTable() {
+  SubstitutionTable table = {};
+  for (int b = 0; b < 256; b++) {
+    table.bytes[b] = static_cast<uint8_t>(b);
+  }
+  return table;
+}
+
+// Rotates ASCII letters |shift| places through the alphabet, preserving case.
+// All other bytes are unchanged. CaesarTable(13) is rot13.
+constexpr SubstitutionTable CaesarTable(int shift) {
+  SubstitutionTable table = IdentityTable();
+  shift = (shift % 26 + 26) % 26;
+  for (int i = 0; i < 26; i++) {
+    table.bytes['a' + i] = static_cast<uint8_t>('a' + (i + shift) % 26);
+    table.bytes['A' + i] = static_cast<uint8_t>('A' + (i + shift) % 26);
+  }
+  return table;
+}
+
+// Rotates the 94 printable ASCII characters from '!' to '~' by 47 places.
+// Like rot13, it is its own inverse.
+constexpr SubstitutionTable Rot47Table() {
+  SubstitutionTable table = IdentityTable();
+  for (int i = 0; i < 94; i++) {
+    table.bytes['!' + i] = static_cast<uint8_t>('!' + (i + 47) % 94);
+  }
+  return table;
+}
+
+constexpr SubstitutionTable kRot13Table = CaesarTable(13);
+constexpr SubstitutionTable kRot47Table = Rot47Table();
+
+// The byte-at-a-time reference implementation.
+void SubstituteScalar(const SubstitutionTable &table, const char *src, size_t len, char *dst);
+
+// A substitution table prepared for repeated use. The constructor inspects the
+// table and picks the fastest kernel that implements it exactly:
+//
+//  - the identity is a copy;
+//  - a Caesar table runs the branch-free arithmetic kernel behind Rot13(), so
+//    the rot13 preset is exactly as fast as the dedicated entry point;
+//  - anything else runs a vector table lookup that only visits the 16-byte
+//    rows of the table that differ from the identity.
+//
+// Thread-safe once constructed.
+class Substitution {
+ public:
+  explicit Substitution(const SubstitutionTable &table);
+
+  // Writes the substitution of |src|[0, |len|) to |dst|. |src| and |dst| may
+  // be the same buffer, but must not otherwise overlap.
+  void Apply(const char *src, size_t len, char *dst) const;
+  void ApplyInPlace(char *buf, size_t len) const { Apply(buf, len, buf); }
+
+  const SubstitutionTable &table() const { return table_; }
+
+  // The name of the kernel Apply() uses, for benchmarks and diagnostics.
+  const char *kernel_name() const { return kernel_name_; }
+
+  // The letter rotation if this is a Caesar table, otherwise zero.
+  int caesar_shift() const { return caesar_shift_; }
+
+  // The table in the form the lookup kernels take.
+  const internal::LookupTable &lookup_table() const { return lookup_; }
+
+ private:
+  SubstitutionTable table_;
+  int caesar_shift_ = 0;
+  internal::LookupTable lookup_;
+  void (*caesar_kernel_)(const char *src, size_t len, char *dst, int shift) = nullptr;
+  void (*lookup_kernel_)(const internal::LookupTable &table, const char *src, size_t len,
+                         char *dst) = nullptr;
+  const char *kernel_name_ = nullptr;
+};
+
+// One way of applying a Substitution. Caesar kernels only support tables with
+// a nonzero caesar_shift(); lookup kernels support every table.
+struct SubstitutionKernel {
+  const char *name;
+  bool caesar_only;
+  void (*apply)(const Substitution &substitution, const char *src, size_t len, char *dst);
+};
+
+// Returns every kernel that can run on this CPU, including the scalar
+// reference. Used by tests and benchmarks to cover each one explicitly.
+std::vector<SubstitutionKernel> AvailableSubstitutionKernels();
+
+}  // namespace rot13
+
+#endif  // EXAMPLES_ROT13_SERVER_SUBSTITUTION_H_
@@ -0,0 +1,137 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// Vectorized lookup kernels for arbitrary substitution tables.
+///
+/// x86 has no 256-entry byte lookup short of AVX-512 VBMI, but a byte shuffle
+/// is a 16-entry one. The table is split by the high nibble of the input into
+/// 16 rows, and each row is looked up with a shuffle indexed by the low
+/// nibble. Shuffles return zero for indices with the top bit set, so each row
+/// only contributes to the bytes in its own range:
+///
+///   index = saturating_add(c - 16 * row, 0x70)
+///
+/// leaves the low nibble intact for bytes in the row and sets the top bit for
+/// every other byte. Rows hold deltas rather than substitutes, so rows the
+/// table leaves alone are zero and skipped entirely: a Caesar table or ROT47
+/// visits 2 to 6 rows, not 16.
+///
+/// arm64 has a real 64-entry lookup, so NEON looks up the full table in four
+/// steps instead.
+
+#include "rot13_kernels.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace rot13 {
+namespace internal {
+
+void LookupScalar(const LookupTable &table, const char *src, size_t len, char *dst) {
+  for (size_t i = 0; i < len; i++) {
+    dst[i] = static_cast<char>(table.bytes[static_cast<unsigned char>(src[i])]);
+  }
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("ssse3"))) void LookupSsse3(const LookupTable &table, const char *src,
+                                                  size_t len, char *dst) {
+  __m128i rows[16];
+  __m128i bases[16];
+  int num_rows = 0;
+  for (int row = 0; row < 16; row++) {
+    if (table.active_rows & (1u << row)) {
+      rows[num_rows] = _mm_load_si128(reinterpret_cast<const __m128i *>(table.deltas[row]));
+      bases[num_rows] = _mm_set1_epi8(static_cast<char>(row * 16));
+      num_rows++;
+    }
+  }
+  const __m128i bias = _mm_set1_epi8(0x70);
+
+  size_t i = 0;
+  for (; i + sizeof(__m128i) <= len; i += sizeof(__m128i)) {
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m128i delta = _mm_setzero_si128();
+    for (int row = 0; row < num_rows; row++) {
+      __m128i index = _mm_adds_epu8(_mm_sub_epi8(c, bases[row]), bias);
+      delta = _mm_or_si128(delta, _mm_shuffle_epi8(rows[row], index));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_add_epi8(c, delta));
+  }
+  LookupScalar(table, src + i, len - i, dst + i);
+}
+
+// The AVX2 shuffle works within each 128-bit lane, so every row is repeated
+// in both lanes.
+__attribute__((target("avx2"))) void LookupAvx2(const LookupTable &table, const char *src,
+                                                size_t len, char *dst) {
+  __m256i rows[16];
+  __m256i bases[16];
+  int num_rows = 0;
+  for (int row = 0; row < 16; row++) {
+    if (table.active_rows & (1u << row)) {
+      rows[num_rows] = _mm256_broadcastsi128_si256(
+          _mm_load_si128(reinterpret_cast<const __m128i *>(table.deltas[row])));
+      bases[num_rows] = _mm256_set1_epi8(static_cast<char>(row * 16));
+      num_rows++;
+    }
+  }
+  const __m256i bias = _mm256_set1_epi8(0x70);
+
+  size_t i = 0;
+  for (; i + sizeof(__m256i) <= len; i += sizeof(__m256i)) {
+    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    __m256i delta = _mm256_setzero_si256();
+    for (int row = 0; row < num_rows; row++) {
+      __m256i index = _mm256_adds_epu8(_mm256_sub_epi8(c, bases[row]), bias);
+      delta = _mm256_or_si256(delta, _mm256_shuffle_epi8(rows[row], index));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_add_epi8(c, delta));
+  }
+  // The SSSE3 tail is legacy SSE code, so clear the upper YMM state before
+  // it rather than pay the transition penalty on every call.
+  _mm256_zeroupper();
+  LookupSsse3(table, src + i, len - i, dst + i);
+}
+
+#endif  // defined(__x86_64__)
+
+#if defined(__aarch64__)
+
+// TBL returns zero for out of range indices and TBX leaves the destination
+// alone, so each quarter of the table only fills in the bytes in its range.
+void LookupNeon(const LookupTable &table, const char *src, size_t len, char *dst) {
+  uint8x16x4_t quarters[4];
+  for (int q = 0; q < 4; q++) {
+    for (int k = 0; k < 4; k++) {
+      quarters[q].val[k] = vld1q_u8(table.bytes + 64 * q + 16 * k);
+    }
+  }
+  const uint8x16_t step = vdupq_n_u8(64);
+
+  size_t i = 0;
+  for (; i + sizeof(uint8x16_t) <= len; i += sizeof(uint8x16_t)) {
+    uint8x16_t c = vld1q_u8(reinterpret_cast<const uint8_t *>(src + i));
+    uint8x16_t out = vqtbl4q_u8(quarters[0], c);
+    c = vsubq_u8(c, step);
+    out = vqtbx4q_u8(out, quarters[1], c);
+    c = vsubq_u8(c, step);
+    out = vqtbx4q_u8(out, quarters[2], c);
+    c = vsubq_u8(c, step);
+    out = vqtbx4q_u8(out, quarters[3], c);
+    vst1q_u8(reinterpret_cast<uint8_t *>(dst + i), out);
+  }
+  LookupScalar(table, src + i, len - i, dst + i);
+}
+
+#endif  // defined(__aarch64__)
+
+}  // namespace internal
+}  // namespace rot13
@@ -0,0 +1,50 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "vmo_mapping.h"
+
+#include <lib/zx/vmar.h>
+#include <zircon/limits.h>
+
+namespace rot13 {
+
+VmoMapping::~VmoMapping() { Unmap(); }
+
+zx_status_t VmoMapping::Map(const zx::vmo &vmo, uint64_t size, zx_vm_option_t options) {
+  Unmap();
+
+  uint64_t vmo_size = 0;
+  zx_status_t status = vmo.get_size(&vmo_size);
+  if (status != ZX_OK) {
+    return status;
+  }
+  if (size > vmo_size) {
+    return ZX_ERR_OUT_OF_RANGE;
+  }
+  if (size == 0) {
+    return ZX_OK;
+  }
+
+  size_t mapped_size = (size + ZX_PAGE_MASK) & ~static_cast<uint64_t>(ZX_PAGE_MASK);
+  zx_vaddr_t start = 0;
+  status = zx::vmar::root_self()->map(options, 0, vmo, 0, mapped_size, &start);
+  if (status != ZX_OK) {
+    return status;
+  }
+  start_ = start;
+  size_ = size;
+  mapped_size_ = mapped_size;
+  return ZX_OK;
+}
+
+void VmoMapping::Unmap() {
+  if (start_ != 0) {
+    zx::vmar::root_self()->unmap(start_, mapped_size_);
+  }
+  start_ = 0;
+  size_ = 0;
+  mapped_size_ = 0;
+}
+
+}  // namespace rot13
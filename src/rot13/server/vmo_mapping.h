@@ -0,0 +1,45 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef EXAMPLES_ROT13_SERVER_VMO_MAPPING_H_
+#define EXAMPLES_ROT13_SERVER_VMO_MAPPING_H_
+
+#include <lib/zx/vmo.h>
+#include <zircon/types.h>
+
+#include <stddef.h>
+
+namespace rot13 {
+
+// Maps the first |size| bytes of a VMO into the root VMAR for the lifetime of
+// this object, so the bulk rot13 methods can transform buffers in place
+// without copying them.
+class VmoMapping {
+ public:
+  VmoMapping() = default;
+  ~VmoMapping();
+
+  // Maps |size| bytes of |vmo| with the given ZX_VM_PERM_* |options|. Fails
+  // with ZX_ERR_OUT_OF_RANGE if |size| is larger than the VMO. A |size| of
+  // zero succeeds without mapping anything.
+  zx_status_t Map(const zx::vmo &vmo, uint64_t size, zx_vm_option_t options);
+
+  // Unmaps the region, if any.
+  void Unmap();
+
+  char *data() const { return reinterpret_cast<char *>(start_); }
+  size_t size() const { return size_; }
+
+ private:
+  VmoMapping(const VmoMapping &) = delete;
+  VmoMapping &operator=(const VmoMapping &) = delete;
+
+  zx_vaddr_t start_ = 0;
+  size_t size_ = 0;
+  size_t mapped_size_ = 0;
+};
+
+}  // namespace rot13
+
+#endif  // EXAMPLES_ROT13_SERVER_VMO_MAPPING_H_
@@ -0,0 +1,63 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "worker_pool.h"
+
+#include <algorithm>
+
+namespace rot13 {
+
+WorkerPool::WorkerPool(size_t num_threads) {
+  num_threads = std::max<size_t>(num_threads, 1);
+  workers_.reserve(num_threads);
+  for (size_t i = 0; i < num_threads; i++) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  // Start the threads only once |workers_| is complete, since running tasks
+  // may post to any worker.
+  for (const std::unique_ptr<Worker> &worker : workers_) {
+    worker->thread = std::thread(&WorkerPool::Run, worker.get());
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  for (const std::unique_ptr<Worker> &worker : workers_) {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    worker->stopping = true;
+    worker->wakeup.notify_one();
+  }
+  for (const std::unique_ptr<Worker> &worker : workers_) {
+    worker->thread.join();
+  }
+}
+
+void WorkerPool::Post(fit::closure task) {
+  Post(next_worker_.fetch_add(1, std::memory_order_relaxed), std::move(task));
+}
+
+void WorkerPool::Post(size_t key, fit::closure task) {
+  Worker *worker = workers_[key % workers_.size()].get();
+  std::lock_guard<std::mutex> lock(worker->mutex);
+  worker->tasks.push_back(std::move(task));
+  worker->wakeup.notify_one();
+}
+
+void WorkerPool::Run(Worker *worker) {
+  std::unique_lock<std::mutex> lock(worker->mutex);
+  for (;;) {
+    worker->wakeup.wait(lock, [worker] { return worker->stopping || !worker->tasks.empty(); });
+    if (worker->tasks.empty()) {
+      // Stopping, and nothing left to run.
+      return;
+    }
+    fit::closure task = std::move(worker->tasks.front());
+    worker->tasks.pop_front();
+    lock.unlock();
+    task();
+    task = nullptr;
+    lock.lock();
+  }
+}
+
+}  // namespace rot13
@@ -0,0 +1,61 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef EXAMPLES_ROT13_SERVER_WORKER_POOL_H_
+#define EXAMPLES_ROT13_SERVER_WORKER_POOL_H_
+
+#include <lib/fit/function.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rot13 {
+
+// A fixed set of threads, each with its own task queue.
+//
+// Tasks posted with a key always run on the same thread, in the order they
+// were posted, so work for one key (for example one connection) stays ordered
+// while different keys run in parallel. Tasks posted without a key are spread
+// round-robin across the threads.
+//
+// This class is thread-safe. Tasks may post further tasks.
+class WorkerPool {
+ public:
+  explicit WorkerPool(size_t num_threads);
+
+  // Runs every task that has already been posted, then joins the threads.
+  // Tasks that running tasks post during destruction may be dropped.
+  ~WorkerPool();
+
+  size_t num_threads() const { return workers_.size(); }
+
+  void Post(fit::closure task);
+  void Post(size_t key, fit::closure task);
+
+ private:
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  struct Worker {
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::deque<fit::closure> tasks;
+    bool stopping = false;
+    std::thread thread;
+  };
+
+  static void Run(Worker *worker);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<size_t> next_worker_{0};
+};
+
+}  // namespace rot13
+
+#endif  // EXAMPLES_ROT13_SERVER_WORKER_POOL_H_
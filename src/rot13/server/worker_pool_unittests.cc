@@ -0,0 +1,83 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "worker_pool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace rot13 {
+namespace testing {
+
+TEST(WorkerPoolTest, RunsAllTasksBeforeDestruction) {
+  std::atomic<int> count{0};
+  {
+    WorkerPool pool(4);
+    for (int i = 0; i < 1000; i++) {
+      pool.Post([&count] { count++; });
+    }
+  }
+  EXPECT_EQ(1000, count.load());
+}
+
+// Tasks with the same key run on one thread, in the order they were posted.
+TEST(WorkerPoolTest, KeyedTasksRunInOrder) {
+  const size_t kKeys = 16;
+  const size_t kTasksPerKey = 500;
+  std::vector<std::vector<size_t>> order(kKeys);
+  std::vector<std::thread::id> threads(kKeys);
+  std::vector<bool> same_thread(kKeys, true);
+  {
+    WorkerPool pool(4);
+    for (size_t i = 0; i < kTasksPerKey; i++) {
+      for (size_t key = 0; key < kKeys; key++) {
+        pool.Post(key, [&, key, i] {
+          if (i == 0) {
+            threads[key] = std::this_thread::get_id();
+          } else if (threads[key] != std::this_thread::get_id()) {
+            same_thread[key] = false;
+          }
+          order[key].push_back(i);
+        });
+      }
+    }
+  }
+  for (size_t key = 0; key < kKeys; key++) {
+    EXPECT_TRUE(same_thread[key]) << "key " << key;
+    ASSERT_EQ(kTasksPerKey, order[key].size());
+    for (size_t i = 0; i < kTasksPerKey; i++) {
+      EXPECT_EQ(i, order[key][i]) << "key " << key;
+    }
+  }
+}
+
+TEST(WorkerPoolTest, TasksCanPostTasks) {
+  std::atomic<int> count{0};
+  std::mutex mutex;
+  std::condition_variable done;
+  {
+    WorkerPool pool(2);
+    pool.Post(0, [&] {
+      for (int i = 0; i < 100; i++) {
+        pool.Post(i, [&] {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (++count == 100) {
+            done.notify_one();
+          }
+        });
+      }
+    });
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return count == 100; });
+  }
+  EXPECT_EQ(100, count.load());
+}
+
+}  // namespace testing
+}  // namespace rot13
@@ -0,0 +1,35 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "src/testing/allocation_counter.h"
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+namespace {
+
+std::atomic<size_t> g_allocations{0};
+
+}  // namespace
+
+namespace testing_support {
+
+size_t AllocationCount() { return g_allocations.load(std::memory_order_relaxed); }
+
+}  // namespace testing_support
+
+void* operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* pointer = malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) {
+    abort();
+  }
+  return pointer;
+}
+
+void operator delete(void* pointer) noexcept { free(pointer); }
+
+void operator delete(void* pointer, size_t) noexcept { free(pointer); }
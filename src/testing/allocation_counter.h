@@ -0,0 +1,22 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SRC_TESTING_ALLOCATION_COUNTER_H_
+#define SRC_TESTING_ALLOCATION_COUNTER_H_
+
+#include <stddef.h>
+
+namespace testing_support {
+
+// Returns the number of heap allocations made through operator new so far, by
+// any thread.
+//
+// Linking in allocation_counter.cc replaces the global operator new and
+// operator delete of the whole executable, so only benchmarks and tests that
+// count allocations should depend on it.
+size_t AllocationCount();
+
+}  // namespace testing_support
+
+#endif  // SRC_TESTING_ALLOCATION_COUNTER_H_
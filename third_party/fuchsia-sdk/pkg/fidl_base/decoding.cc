@@ -334,6 +334,27 @@ zx_status_t fidl_decode_impl(const fidl_type_t* type, void* bytes, uint32_t num_
     return status;
   }
 
+  if (fidl::IsFlatStruct(type)) {
+    // Nothing to walk: the message must be the struct alone, with no handles.
+    if (unlikely(!fidl::CheckFlatStruct(type->coded_struct(), reinterpret_cast<uint8_t*>(bytes),
+                                        "non-zero padding bytes detected during decoding",
+                                        out_error_msg))) {
+      drop_all_handles();
+      return ZX_ERR_INVALID_ARGS;
+    }
+    if (unlikely(next_out_of_line != num_bytes)) {
+      set_error("message did not decode all provided bytes");
+      drop_all_handles();
+      return ZX_ERR_INVALID_ARGS;
+    }
+    if (unlikely(num_handles != 0)) {
+      set_error("message did not decode all provided handles");
+      drop_all_handles();
+      return ZX_ERR_INVALID_ARGS;
+    }
+    return ZX_OK;
+  }
+
   FidlDecoder decoder(bytes, num_bytes, handles, num_handles, next_out_of_line, out_error_msg);
   fidl::Walk(decoder, type, Position{reinterpret_cast<uint8_t*>(bytes)});
 
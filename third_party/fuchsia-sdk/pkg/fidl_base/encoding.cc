@@ -13,6 +13,7 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <limits>
 
 #ifdef __Fuchsia__
@@ -345,6 +346,32 @@ zx_status_t fidl_linearize_and_encode_impl(const fidl_type_t* type, void* value,
   // Copy the primary object
   memcpy(out_bytes, value, primary_size);
 
+  if (fidl::IsFlatStruct(type)) {
+    // The copy was the whole message; only its padding remains to be zeroed.
+    fidl::ZeroFlatStructPadding(type->coded_struct(), out_bytes);
+    if (unlikely(!fidl::CheckFlatStruct(type->coded_struct(), out_bytes, nullptr, out_error_msg))) {
+      if (out_num_actual_handles) {
+        *out_num_actual_handles = 0;
+      }
+      return ZX_ERR_INVALID_ARGS;
+    }
+    if (unlikely(out_num_actual_bytes == nullptr)) {
+      set_error("Cannot encode with null out_actual_bytes");
+      return ZX_ERR_INVALID_ARGS;
+    }
+    if (unlikely(out_num_actual_handles == nullptr)) {
+      set_error("Cannot encode with null out_actual_handles");
+      return ZX_ERR_INVALID_ARGS;
+    }
+    *out_num_actual_bytes = next_out_of_line;
+    *out_num_actual_handles = 0;
+    if (unlikely(out_handles == nullptr && num_handles != 0)) {
+      set_error("Cannot provide non-zero handle count and null handle pointer");
+      return ZX_ERR_INVALID_ARGS;
+    }
+    return ZX_OK;
+  }
+
   FidlEncoder<Mode::LinearizeAndEncode> encoder(out_bytes, num_bytes, out_handles, num_handles,
                                                 next_out_of_line, out_error_msg);
   fidl::Walk(encoder, type, Position{.source_object = value, .dest = out_bytes});
@@ -418,6 +445,35 @@ zx_status_t fidl_encode_impl(const fidl_type_t* type, void* bytes, uint32_t num_
   }
   memset(reinterpret_cast<uint8_t*>(bytes) + primary_size, 0, next_out_of_line - primary_size);
 
+  if (fidl::IsFlatStruct(type)) {
+    // Nothing to walk: the message is the struct alone, with no handles.
+    fidl::ZeroFlatStructPadding(type->coded_struct(), reinterpret_cast<uint8_t*>(bytes));
+    if (unlikely(!fidl::CheckFlatStruct(type->coded_struct(), reinterpret_cast<uint8_t*>(bytes),
+                                        nullptr, out_error_msg))) {
+      if (out_actual_handles) {
+        *out_actual_handles = 0;
+      }
+      return ZX_ERR_INVALID_ARGS;
+    }
+    if (unlikely(next_out_of_line != num_bytes)) {
+      set_error("message did not encode all provided bytes");
+      if (out_actual_handles) {
+        *out_actual_handles = 0;
+      }
+      return ZX_ERR_INVALID_ARGS;
+    }
+    if (unlikely(out_actual_handles == nullptr)) {
+      set_error("Cannot encode with null out_actual_handles");
+      return ZX_ERR_INVALID_ARGS;
+    }
+    *out_actual_handles = 0;
+    if (unlikely(handles == nullptr && max_handles != 0)) {
+      set_error("Cannot provide non-zero handle count and null handle pointer");
+      return ZX_ERR_INVALID_ARGS;
+    }
+    return ZX_OK;
+  }
+
   FidlEncoder<Mode::EncodeOnly> encoder(bytes, num_bytes, handles, max_handles, next_out_of_line,
                                         out_error_msg);
   fidl::Walk(encoder, type,
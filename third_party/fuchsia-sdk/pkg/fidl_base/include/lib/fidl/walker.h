@@ -674,6 +674,22 @@ zx_status_t PrimaryObjectSize(const fidl_type_t* type, size_t* out_size, const c
 zx_status_t StartingOutOfLineOffset(const fidl_type_t* type, uint32_t buffer_size,
                                     uint32_t* out_first_out_of_line, const char** out_error);
 
+// Whether |type| is a struct whose fields are all primitives, enums or bits. A message of such a
+// struct has no out-of-line objects and no handles, so encoding, decoding and validating it need
+// no walk: one pass over the coding table's field list checks the values and the padding. The
+// test itself is a pass over the same list, without recursion.
+bool IsFlatStruct(const fidl_type_t* type);
+
+// Zeroes the padding of a struct at |bytes| for which IsFlatStruct() holds.
+void ZeroFlatStructPadding(const FidlCodedStruct& coded_struct, uint8_t* bytes);
+
+// Checks the bool, enum and bits values, and unless |padding_error| is null the padding, of a
+// struct at |bytes| for which IsFlatStruct() holds. On failure, returns false and sets
+// |out_error| if it is not null, to |padding_error| for non-zero padding so that the message
+// matches the caller's walked path.
+bool CheckFlatStruct(const FidlCodedStruct& coded_struct, const uint8_t* bytes,
+                     const char* padding_error, const char** out_error);
+
 }  // namespace fidl
 
 #endif  // LIB_FIDL_WALKER_H_
@@ -198,6 +198,23 @@ zx_status_t fidl_validate(const fidl_type_t* type, const void* bytes, uint32_t n
     return status;
   }
 
+  if (fidl::IsFlatStruct(type)) {
+    // Nothing to walk: the message must be the struct alone, with no handles.
+    if (!fidl::CheckFlatStruct(type->coded_struct(), reinterpret_cast<const uint8_t*>(bytes),
+                               "non-zero padding bytes detected", out_error_msg)) {
+      return ZX_ERR_INVALID_ARGS;
+    }
+    if (next_out_of_line != num_bytes) {
+      set_error("message did not consume all provided bytes");
+      return ZX_ERR_INVALID_ARGS;
+    }
+    if (num_handles != 0) {
+      set_error("message did not reference all provided handles");
+      return ZX_ERR_INVALID_ARGS;
+    }
+    return ZX_OK;
+  }
+
   FidlValidator validator(bytes, num_bytes, num_handles, next_out_of_line, out_error_msg);
   fidl::Walk(validator, type, Position{reinterpret_cast<const uint8_t*>(bytes)});
 
@@ -5,10 +5,44 @@
 #include <lib/fidl/walker.h>
 
 #include <cstdint>
+#include <cstring>
 #include <limits>
 
 namespace fidl {
 
+namespace {
+
+// Reads an integer of the given subtype, sign extending signed ones, as the walker does.
+uint64_t ReadInteger(FidlCodedPrimitiveSubtype subtype, const uint8_t* bytes) {
+  switch (subtype) {
+    case kFidlCodedPrimitiveSubtype_Uint8:
+      return *bytes;
+    case kFidlCodedPrimitiveSubtype_Uint16:
+      return *reinterpret_cast<const uint16_t*>(bytes);
+    case kFidlCodedPrimitiveSubtype_Uint32:
+      return *reinterpret_cast<const uint32_t*>(bytes);
+    case kFidlCodedPrimitiveSubtype_Uint64:
+      return *reinterpret_cast<const uint64_t*>(bytes);
+    case kFidlCodedPrimitiveSubtype_Int8:
+      return static_cast<uint64_t>(*reinterpret_cast<const int8_t*>(bytes));
+    case kFidlCodedPrimitiveSubtype_Int16:
+      return static_cast<uint64_t>(*reinterpret_cast<const int16_t*>(bytes));
+    case kFidlCodedPrimitiveSubtype_Int32:
+      return static_cast<uint64_t>(*reinterpret_cast<const int32_t*>(bytes));
+    case kFidlCodedPrimitiveSubtype_Int64:
+      return static_cast<uint64_t>(*reinterpret_cast<const int64_t*>(bytes));
+    default:
+      __builtin_unreachable();
+  }
+}
+
+// The offset of the padding a struct field entry describes.
+uint32_t PaddingOffset(const FidlStructField& field) {
+  return field.type ? field.offset + internal::TypeSize(field.type) : field.padding_offset;
+}
+
+}  // namespace
+
 zx_status_t PrimaryObjectSize(const fidl_type_t* type, size_t* out_size, const char** out_error) {
   auto set_error = [&out_error](const char* msg) {
     if (out_error)
@@ -55,4 +89,84 @@ zx_status_t StartingOutOfLineOffset(const fidl_type_t* type, uint32_t buffer_siz
   return ZX_OK;
 }
 
+bool IsFlatStruct(const fidl_type_t* type) {
+  if (type == nullptr || type->type_tag() != kFidlTypeStruct) {
+    return false;
+  }
+  const FidlCodedStruct& coded_struct = type->coded_struct();
+  for (uint32_t i = 0; i < coded_struct.field_count; i++) {
+    const fidl_type_t* field_type = coded_struct.fields[i].type;
+    if (field_type == nullptr) {
+      continue;
+    }
+    switch (field_type->type_tag()) {
+      case kFidlTypePrimitive:
+      case kFidlTypeEnum:
+      case kFidlTypeBits:
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+void ZeroFlatStructPadding(const FidlCodedStruct& coded_struct, uint8_t* bytes) {
+  for (uint32_t i = 0; i < coded_struct.field_count; i++) {
+    const FidlStructField& field = coded_struct.fields[i];
+    if (field.padding > 0) {
+      memset(bytes + PaddingOffset(field), 0, field.padding);
+    }
+  }
+}
+
+bool CheckFlatStruct(const FidlCodedStruct& coded_struct, const uint8_t* bytes,
+                     const char* padding_error, const char** out_error) {
+  auto fail = [out_error](const char* msg) {
+    if (out_error)
+      *out_error = msg;
+    return false;
+  };
+  for (uint32_t i = 0; i < coded_struct.field_count; i++) {
+    const FidlStructField& field = coded_struct.fields[i];
+    if (padding_error != nullptr) {
+      const uint8_t* padding = bytes + PaddingOffset(field);
+      for (uint32_t j = 0; j < field.padding; j++) {
+        if (unlikely(padding[j] != 0)) {
+          return fail(padding_error);
+        }
+      }
+    }
+    if (field.type == nullptr) {
+      continue;
+    }
+    const uint8_t* value = bytes + field.offset;
+    switch (field.type->type_tag()) {
+      case kFidlTypePrimitive:
+        if (unlikely(field.type->coded_primitive().type == kFidlCodedPrimitiveSubtype_Bool &&
+                     *value > 1)) {
+          return fail("not a valid bool value");
+        }
+        break;
+      case kFidlTypeEnum: {
+        const FidlCodedEnum& coded_enum = field.type->coded_enum();
+        if (unlikely(!coded_enum.validate(ReadInteger(coded_enum.underlying_type, value)))) {
+          return fail("not a valid enum member");
+        }
+        break;
+      }
+      case kFidlTypeBits: {
+        const FidlCodedBits& coded_bits = field.type->coded_bits();
+        if (unlikely(ReadInteger(coded_bits.underlying_type, value) & ~coded_bits.mask)) {
+          return fail("not a valid bits member");
+        }
+        break;
+      }
+      default:
+        __builtin_unreachable();
+    }
+  }
+  return true;
+}
+
 }  // namespace fidl
@@ -10,6 +10,8 @@
 #include <lib/fidl/cpp/interface_ptr.h>
 #include <lib/fidl/cpp/interface_request.h>
 #include <lib/fidl/cpp/internal/stub_controller.h>
+#include <lib/fidl/cpp/read_budget.h>
+#include <lib/fidl/cpp/view_handlers.h>
 #include <lib/fit/function.h>
 #include <lib/zx/channel.h>
 #include <zircon/assert.h>
@@ -246,6 +248,22 @@ class Binding final {
   // The |async_dispatcher_t| to which this binding is bound, if any.
   async_dispatcher_t* dispatcher() const { return controller_.reader().dispatcher(); }
 
+  // Limits how many messages this |Binding| reads each time its channel
+  // becomes readable, so a busy client cannot starve the other waits on the
+  // dispatcher. See |ReadBudget|.
+  void set_read_budget(ReadBudget budget) { controller_.reader().set_read_budget(budget); }
+  const ReadBudget& read_budget() const { return controller_.reader().read_budget(); }
+
+  // How many messages this |Binding| has read, and in how many wakeups.
+  const ReadStats& read_stats() const { return controller_.reader().read_stats(); }
+
+  // Handles some methods with views into the received messages rather than
+  // through |impl()|. |view_handlers| must outlive the binding, or be reset
+  // first. See |ViewHandlers|.
+  void set_view_handlers(const ViewHandlers* view_handlers) {
+    controller_.set_view_handlers(view_handlers);
+  }
+
  private:
   const ImplPtr impl_;
   typename Interface::Stub_ stub_;
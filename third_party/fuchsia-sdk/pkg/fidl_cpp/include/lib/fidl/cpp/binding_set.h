@@ -63,6 +63,8 @@ class BindingSet final {
     bindings_.push_back(
         std::make_unique<Binding>(std::forward<ImplPtr>(impl), std::move(request), dispatcher));
     auto* binding = bindings_.back().get();
+    binding->set_read_budget(read_budget_);
+    binding->set_view_handlers(view_handlers_);
     // Set the connection error handler for the newly added Binding to be a
     // function that will erase it from the vector.
     binding->set_error_handler(
@@ -162,6 +164,9 @@ class BindingSet final {
   void CloseAll() {
     auto bindings_local = std::move(bindings_);
     bindings_.clear();
+    for (const auto& binding : bindings_local) {
+      RetireReadStats(*binding);
+    }
   }
 
   // Removes all the bindings from the set using the provided epitaph.
@@ -173,6 +178,7 @@ class BindingSet final {
     auto bindings_local = std::move(bindings_);
     bindings_.clear();
     for (const auto& binding : bindings_local) {
+      RetireReadStats(*binding);
       binding->Close(epitaph_value);
     }
   }
@@ -194,7 +200,53 @@ class BindingSet final {
   // |BindingSet| to remove the |Binding| from the set.
   const StorageType& bindings() const { return bindings_; }
 
+  // Limits how many messages each binding in the set reads each time its
+  // channel becomes readable, so a busy client cannot starve the others.
+  // Applies to the bindings already in the set and to those added later. See
+  // |ReadBudget|.
+  void set_read_budget(ReadBudget budget) {
+    read_budget_ = budget;
+    for (const auto& binding : bindings_) {
+      binding->set_read_budget(budget);
+    }
+  }
+  const ReadBudget& read_budget() const { return read_budget_; }
+
+  // Handles some methods with views into the received messages rather than
+  // through the implementations, for the bindings already in the set and
+  // those added later. |view_handlers| must outlive the set. See
+  // |ViewHandlers|.
+  void set_view_handlers(const ViewHandlers* view_handlers) {
+    view_handlers_ = view_handlers;
+    for (const auto& binding : bindings_) {
+      binding->set_view_handlers(view_handlers);
+    }
+  }
+
+  // How many messages the bindings in this set have read, and in how many
+  // wakeups, including bindings since removed.
+  ReadStats read_stats() const {
+    ReadStats stats = retired_read_stats_;
+    for (const auto& binding : bindings_) {
+      AddReadStats(binding->read_stats(), &stats);
+    }
+    return stats;
+  }
+
  private:
+  static void AddReadStats(const ReadStats& from, ReadStats* to) {
+    to->wakeups += from.wakeups;
+    to->messages += from.messages;
+    to->budget_exhausted += from.budget_exhausted;
+    to->max_messages_per_wakeup =
+        std::max(to->max_messages_per_wakeup, from.max_messages_per_wakeup);
+  }
+
+  // Keeps the counts of a binding leaving the set.
+  void RetireReadStats(const Binding& binding) {
+    AddReadStats(binding.read_stats(), &retired_read_stats_);
+  }
+
   // Resolve smart pointers with get methods (e.g. shared_ptr, unique_ptr, etc).
   template <class T, std::enable_if_t<!std::is_pointer<T>::value>* = nullptr>
   static void* ResolvePtr(T& p) {
@@ -234,6 +286,7 @@ class BindingSet final {
 
     std::unique_ptr<Binding> binding_local = std::move(*it);
     bindings_.erase(it);
+    RetireReadStats(*binding_local);
 
     return binding_local;
   }
@@ -245,6 +298,9 @@ class BindingSet final {
 
   StorageType bindings_;
   fit::closure empty_set_handler_;
+  ReadBudget read_budget_;
+  ReadStats retired_read_stats_;
+  const ViewHandlers* view_handlers_ = nullptr;
 };
 
 }  // namespace fidl
@@ -16,6 +16,7 @@
 #include "lib/fidl/cpp/interface_handle.h"
 #include "lib/fidl/cpp/interface_request.h"
 #include "lib/fidl/cpp/internal/proxy_controller.h"
+#include "lib/fidl/cpp/read_budget.h"
 
 namespace fidl {
 
@@ -246,6 +247,14 @@ class InterfacePtr final {
   // The |async_dispatcher_t| to which this interface is bound, if any.
   async_dispatcher_t* dispatcher() const { return impl_->controller.reader().dispatcher(); }
 
+  // Limits how many replies and events this |InterfacePtr| reads each time
+  // its channel becomes readable. See |ReadBudget|.
+  void set_read_budget(ReadBudget budget) { impl_->controller.reader().set_read_budget(budget); }
+  const ReadBudget& read_budget() const { return impl_->controller.reader().read_budget(); }
+
+  // How many messages this |InterfacePtr| has read, and in how many wakeups.
+  const ReadStats& read_stats() const { return impl_->controller.reader().read_stats(); }
+
  private:
   struct Impl;
 
@@ -8,6 +8,7 @@
 #include <lib/async/wait.h>
 #include <lib/fidl/cpp/message.h>
 #include <lib/fidl/cpp/message_buffer.h>
+#include <lib/fidl/cpp/read_budget.h>
 #include <lib/fit/function.h>
 #include <lib/zx/channel.h>
 
@@ -130,6 +131,18 @@ class MessageReader final {
     error_handler_ = std::move(error_handler);
   }
 
+  // How much the |MessageReader| reads each time the channel becomes
+  // readable before waiting on it again. See |ReadBudget|.
+  //
+  // Takes effect from the next wakeup.
+  void set_read_budget(ReadBudget budget) { budget_ = budget; }
+  const ReadBudget& read_budget() const { return budget_; }
+
+  // What the |MessageReader| has read from its channels while waiting on the
+  // dispatcher. Messages read by |WaitAndDispatchOneMessageUntil| are not
+  // counted.
+  const ReadStats& read_stats() const { return stats_; }
+
  private:
   static void CallHandler(async_dispatcher_t* dispatcher, async_wait_t* wait, zx_status_t status,
                           const zx_packet_signal_t* signal);
@@ -146,6 +159,8 @@ class MessageReader final {
   bool* destroyed_;    // See |Canary| in message_reader.cc.
   MessageHandler* message_handler_;
   fit::function<void(zx_status_t)> error_handler_;
+  ReadBudget budget_;
+  ReadStats stats_;
 };
 
 }  // namespace internal
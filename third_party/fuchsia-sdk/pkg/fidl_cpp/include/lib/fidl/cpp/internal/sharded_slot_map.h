@@ -0,0 +1,162 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_FIDL_CPP_INTERNAL_SHARDED_SLOT_MAP_H_
+#define LIB_FIDL_CPP_INTERNAL_SHARDED_SLOT_MAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace fidl {
+namespace internal {
+
+// Identifies a value in a |ShardedSlotMap|. A default-constructed key
+// identifies no value.
+struct SlotKey {
+  uint32_t shard = 0;
+  uint32_t slot = 0;
+  uint64_t generation = 0;
+
+  // Slot generations start at one, so only a default-constructed key has
+  // generation zero.
+  explicit operator bool() const { return generation != 0; }
+
+  bool operator==(const SlotKey& other) const {
+    return shard == other.shard && slot == other.slot && generation == other.generation;
+  }
+  bool operator!=(const SlotKey& other) const { return !(*this == other); }
+};
+
+// A thread-safe map from generated keys to values of type |T|, split into
+// shards that each have their own lock.
+//
+// Each value lives in a slot of one shard. Inserting reuses a free slot, or
+// appends one, and removing frees the slot, so both take constant time and
+// only lock the one shard. A key records its slot and the slot's generation,
+// which changes each time the slot is freed, so a key stays valid until its
+// value is removed and never refers to a later value.
+//
+// |T| must be default constructible and movable. Removed values are moved
+// out, so the caller decides where, and on which thread, they are destroyed.
+template <typename T>
+class ShardedSlotMap final {
+ public:
+  using Key = SlotKey;
+
+  explicit ShardedSlotMap(size_t shard_count)
+      : shard_count_(shard_count > 0 ? shard_count : 1),
+        shards_(std::make_unique<Shard[]>(shard_count_)) {}
+
+  ShardedSlotMap(const ShardedSlotMap&) = delete;
+  ShardedSlotMap& operator=(const ShardedSlotMap&) = delete;
+
+  size_t shard_count() const { return shard_count_; }
+
+  // The number of values in the map.
+  size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+  // Inserts |value| into |shard| and returns its key.
+  //
+  // Calls |on_insert(key, &value)| with the shard still locked, so nothing
+  // can remove the value before |on_insert| returns.
+  template <typename Callback>
+  Key Insert(size_t shard_index, T value, Callback on_insert) {
+    Shard& shard = shards_[shard_index % shard_count_];
+    std::lock_guard<std::mutex> guard(shard.lock);
+    uint32_t slot_index;
+    if (shard.free.empty()) {
+      slot_index = static_cast<uint32_t>(shard.slots.size());
+      shard.slots.emplace_back();
+    } else {
+      slot_index = shard.free.back();
+      shard.free.pop_back();
+    }
+    Slot& slot = shard.slots[slot_index];
+    slot.value = std::move(value);
+    slot.occupied = true;
+    size_.fetch_add(1, std::memory_order_relaxed);
+    Key key;
+    key.shard = static_cast<uint32_t>(shard_index % shard_count_);
+    key.slot = slot_index;
+    key.generation = slot.generation;
+    on_insert(key, &slot.value);
+    return key;
+  }
+
+  Key Insert(size_t shard_index, T value) {
+    return Insert(shard_index, std::move(value), [](const Key&, T*) {});
+  }
+
+  // Removes the value for |key| into |*value|.
+  //
+  // Returns false, and leaves |*value| alone, if |key| was already removed.
+  bool Remove(const Key& key, T* value) {
+    if (key.shard >= shard_count_)
+      return false;
+    Shard& shard = shards_[key.shard];
+    std::lock_guard<std::mutex> guard(shard.lock);
+    if (key.slot >= shard.slots.size())
+      return false;
+    Slot& slot = shard.slots[key.slot];
+    if (!slot.occupied || slot.generation != key.generation)
+      return false;
+    *value = std::move(slot.value);
+    slot.value = T();
+    slot.occupied = false;
+    slot.generation++;
+    shard.free.push_back(key.slot);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Removes every value in |shard| and returns them.
+  std::vector<T> TakeShard(size_t shard_index) {
+    Shard& shard = shards_[shard_index % shard_count_];
+    std::vector<T> values;
+    std::lock_guard<std::mutex> guard(shard.lock);
+    for (uint32_t i = 0; i < shard.slots.size(); i++) {
+      Slot& slot = shard.slots[i];
+      if (!slot.occupied)
+        continue;
+      values.push_back(std::move(slot.value));
+      slot.value = T();
+      slot.occupied = false;
+      slot.generation++;
+      shard.free.push_back(i);
+    }
+    size_.fetch_sub(values.size(), std::memory_order_relaxed);
+    return values;
+  }
+
+ private:
+  struct Slot {
+    T value;
+    uint64_t generation = 1;
+    bool occupied = false;
+  };
+
+  struct Shard {
+    std::mutex lock;
+    std::vector<Slot> slots;
+    std::vector<uint32_t> free;
+
+    // Puts the lock of the next shard in |shards_| on another cache line.
+    char padding[64];
+  };
+
+  const size_t shard_count_;
+  const std::unique_ptr<Shard[]> shards_;
+  std::atomic<size_t> size_{0};
+};
+
+}  // namespace internal
+}  // namespace fidl
+
+#endif  // LIB_FIDL_CPP_INTERNAL_SHARDED_SLOT_MAP_H_
@@ -10,6 +10,7 @@
 #include <lib/fidl/cpp/internal/message_sender.h>
 #include <lib/fidl/cpp/internal/stub.h>
 #include <lib/fidl/cpp/message.h>
+#include <lib/fidl/cpp/view_handlers.h>
 #include <lib/zx/channel.h>
 
 #include <memory>
@@ -45,6 +46,11 @@ class StubController final : public MessageHandler, public MessageSender {
   Stub* stub() const { return stub_; }
   void set_stub(Stub* stub) { stub_ = stub; }
 
+  // Handlers that take some methods' requests in place, before the |stub()|.
+  // May be null. See |ViewHandlers|.
+  const ViewHandlers* view_handlers() const { return view_handlers_; }
+  void set_view_handlers(const ViewHandlers* view_handlers) { view_handlers_ = view_handlers; }
+
   // Send a message over the channel.
   //
   // Returns an error if the message fails to encode properly or if the message
@@ -72,6 +78,7 @@ class StubController final : public MessageHandler, public MessageSender {
   WeakStubController* weak_;
   MessageReader reader_;
   Stub* stub_;
+  const ViewHandlers* view_handlers_;
 };
 
 }  // namespace internal
@@ -0,0 +1,49 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_FIDL_CPP_READ_BUDGET_H_
+#define LIB_FIDL_CPP_READ_BUDGET_H_
+
+#include <lib/zx/time.h>
+#include <stdint.h>
+
+namespace fidl {
+
+// Limits how much a |Binding|, |BindingSet| or |InterfacePtr| reads from its
+// channel each time the dispatcher reports the channel readable.
+//
+// The reader keeps reading and dispatching messages until the channel is
+// empty or the budget is spent, then waits on the channel again. Waiting
+// again puts the channel behind the other waits and tasks already queued on
+// the dispatcher, so a busy channel cannot starve the others sharing it.
+struct ReadBudget {
+  // The most messages read per wakeup. Zero is treated as one.
+  uint32_t max_messages = 64;
+
+  // The longest the reader keeps reading per wakeup, checked after each
+  // message. A message is always read once the reader is woken, however long
+  // the previous one took.
+  zx::duration max_duration = zx::duration::infinite();
+};
+
+// Counts the messages a |Binding|, |BindingSet| or |InterfacePtr| has read
+// from its channel, and the wakeups it took to read them.
+struct ReadStats {
+  // Times the dispatcher reported the channel readable.
+  uint64_t wakeups = 0;
+
+  // Messages read and dispatched.
+  uint64_t messages = 0;
+
+  // Wakeups that stopped reading because the |ReadBudget| was spent. The
+  // channel may have held more messages, which wait for the next wakeup.
+  uint64_t budget_exhausted = 0;
+
+  // The most messages read in a single wakeup.
+  uint64_t max_messages_per_wakeup = 0;
+};
+
+}  // namespace fidl
+
+#endif  // LIB_FIDL_CPP_READ_BUDGET_H_
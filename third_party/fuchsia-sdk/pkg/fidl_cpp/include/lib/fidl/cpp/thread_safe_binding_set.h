@@ -6,15 +6,19 @@
 #define LIB_FIDL_CPP_THREAD_SAFE_BINDING_SET_H_
 
 #include <lib/async/dispatcher.h>
+#include <lib/async/task.h>
 #include <zircon/compiler.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <memory>
 #include <mutex>
 #include <utility>
 #include <vector>
 
 #include "lib/fidl/cpp/binding.h"
+#include "lib/fidl/cpp/internal/sharded_slot_map.h"
 
 namespace fidl {
 
@@ -28,6 +32,8 @@ namespace fidl {
 //
 // See also:
 //
+//  * |ThreadSafeBindingSet|, which scales to many threads and destroys each
+//    binding on its own dispatcher.
 //  * |BindingSet|, which is the thread-hostile analog that offers more
 //    functionality.
 //  * |InterfacePtrSet|, which is the client analog of |BindingSet|.
@@ -120,6 +126,171 @@ class DeprecatedBrokenBindingSet final {
   StorageType bindings_ __TA_GUARDED(lock_);
 };
 
+// Manages a set of bindings, spread over several dispatchers, that may be
+// added and removed from any thread.
+//
+// The bindings are kept in shards, one per dispatcher, each with its own
+// lock, so adding and removing bindings on different dispatchers does not
+// contend. Adding and removing a binding takes constant time, and each added
+// binding is identified by an |Id| that stays valid until the binding is
+// removed.
+//
+// A |Binding| may only be used on the thread of its dispatcher. This set
+// therefore only touches a binding from the thread adding it, before it is
+// bound, and from its dispatcher: bindings removed from other threads are
+// destroyed by a task posted to their dispatcher, and may dispatch messages
+// that are already being read until that task runs.
+//
+// The set must outlive its dispatchers' loops, or at least their dispatching
+// of its bindings: destroy it after shutting the loops down.
+//
+// See also:
+//
+//  * |BindingSet|, which is the thread-hostile analog that offers more
+//    functionality.
+template <typename Interface, typename ImplPtr = Interface*>
+class ThreadSafeBindingSet final {
+ public:
+  using Binding = ::fidl::Binding<Interface, ImplPtr>;
+
+  // The shards used when the set is not given dispatchers.
+  static constexpr size_t kDefaultShardCount = 16;
+
+  // Identifies a binding in the set. A default-constructed |Id|, which
+  // converts to false, identifies none.
+  using Id = internal::SlotKey;
+
+  // Creates a set whose bindings are each given a dispatcher when added.
+  ThreadSafeBindingSet() : bindings_(kDefaultShardCount) {}
+
+  // Creates a set that spreads the bindings added without a dispatcher over
+  // |dispatchers|, in turn.
+  explicit ThreadSafeBindingSet(std::vector<async_dispatcher_t*> dispatchers)
+      : dispatchers_(std::move(dispatchers)),
+        bindings_(dispatchers_.empty() ? kDefaultShardCount : dispatchers_.size()) {}
+
+  ThreadSafeBindingSet(const ThreadSafeBindingSet&) = delete;
+  ThreadSafeBindingSet& operator=(const ThreadSafeBindingSet&) = delete;
+
+  // Adds a binding of |impl| to the channel in |request|, served on the next
+  // of the dispatchers the set was created with.
+  //
+  // The binding is removed, and |~ImplPtr| called, when the binding has an
+  // error. Whether this takes ownership of |impl| depends on |ImplPtr|, as
+  // for |BindingSet|.
+  //
+  // Returns an invalid |Id|, and destroys the binding, if it cannot be bound,
+  // such as when the dispatcher is shutting down.
+  Id AddBinding(ImplPtr impl, InterfaceRequest<Interface> request) {
+    ZX_ASSERT_MSG(!dispatchers_.empty(), "the set was created without dispatchers");
+    size_t index = next_.fetch_add(1, std::memory_order_relaxed) % dispatchers_.size();
+    return Add(index, std::forward<ImplPtr>(impl), std::move(request), dispatchers_[index]);
+  }
+
+  // Adds a binding of |impl| to the channel in |request|, served on
+  // |dispatcher|. Returns an invalid |Id| if it cannot be bound.
+  Id AddBinding(ImplPtr impl, InterfaceRequest<Interface> request,
+                async_dispatcher_t* dispatcher) {
+    return Add(ShardFor(dispatcher), std::forward<ImplPtr>(impl), std::move(request), dispatcher);
+  }
+
+  // Removes the binding identified by |id| and closes its channel, without
+  // sending an epitaph. The binding is destroyed on its dispatcher.
+  //
+  // Returns false if the binding was already removed.
+  bool RemoveBinding(Id id) {
+    Entry entry;
+    if (!bindings_.Remove(id, &entry))
+      return false;
+    DestroyOnDispatcher(std::move(entry));
+    return true;
+  }
+
+  // Removes all the bindings from the set and closes their channels. Each
+  // binding is destroyed on its dispatcher.
+  void CloseAll() {
+    for (size_t i = 0; i < bindings_.shard_count(); i++) {
+      for (Entry& entry : bindings_.TakeShard(i)) {
+        DestroyOnDispatcher(std::move(entry));
+      }
+    }
+  }
+
+  // The number of bindings in the set.
+  size_t size() const { return bindings_.size(); }
+
+ private:
+  struct Entry {
+    std::unique_ptr<Binding> binding;
+    async_dispatcher_t* dispatcher = nullptr;
+  };
+
+  // Destroys a binding when its dispatcher runs it, or when the dispatcher
+  // shuts down.
+  struct DestroyTask {
+    async_task_t task;  // Must be first.
+    std::unique_ptr<Binding> binding;
+
+    static void Handler(async_dispatcher_t*, async_task_t* task, zx_status_t) {
+      delete reinterpret_cast<DestroyTask*>(task);
+    }
+  };
+
+  Id Add(size_t shard, ImplPtr impl, InterfaceRequest<Interface> request,
+         async_dispatcher_t* dispatcher) {
+    Entry entry;
+    entry.binding = std::make_unique<Binding>(std::forward<ImplPtr>(impl));
+    entry.dispatcher = dispatcher;
+    // Binds with the shard locked, once the error handler knows the binding's
+    // id, so neither a removal nor an error can get to the binding first.
+    zx_status_t status = ZX_OK;
+    Id id = bindings_.Insert(shard, std::move(entry), [&](const Id& key, Entry* inserted) {
+      inserted->binding->set_error_handler([this, key](zx_status_t) { RemoveOnError(key); });
+      status = inserted->binding->Bind(request.TakeChannel(), inserted->dispatcher);
+    });
+    if (status != ZX_OK) {
+      // Never bound, so it can be destroyed here.
+      Entry unbound;
+      bindings_.Remove(id, &unbound);
+      return Id();
+    }
+    return id;
+  }
+
+  // Called on the binding's dispatcher when it has an error.
+  void RemoveOnError(Id id) {
+    // Destroyed after the lock is released, since the implementation may use
+    // the set from its destructor. A binding that was already removed is being
+    // destroyed by a task on this dispatcher instead.
+    Entry entry;
+    bindings_.Remove(id, &entry);
+  }
+
+  size_t ShardFor(async_dispatcher_t* dispatcher) {
+    auto it = std::find(dispatchers_.begin(), dispatchers_.end(), dispatcher);
+    if (it != dispatchers_.end())
+      return static_cast<size_t>(it - dispatchers_.begin());
+    return next_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static void DestroyOnDispatcher(Entry entry) {
+    static_assert(offsetof(DestroyTask, task) == 0,
+                  "The task must be the first member for the cast in Handler to be valid.");
+    auto* task = new DestroyTask{
+        {{ASYNC_STATE_INIT}, &DestroyTask::Handler, async_now(entry.dispatcher)},
+        std::move(entry.binding)};
+    if (async_post_task(entry.dispatcher, &task->task) != ZX_OK) {
+      // The dispatcher is shutting down and no longer dispatches the binding.
+      delete task;
+    }
+  }
+
+  // Dispatchers for |AddBinding| without one, and their shards.
+  const std::vector<async_dispatcher_t*> dispatchers_;
+  std::atomic<size_t> next_{0};
+  internal::ShardedSlotMap<Entry> bindings_;
+};
+
 }  // namespace fidl
 
 #endif  // LIB_FIDL_CPP_THREAD_SAFE_BINDING_SET_H_
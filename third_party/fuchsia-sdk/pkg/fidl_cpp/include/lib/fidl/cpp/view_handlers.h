@@ -0,0 +1,101 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_FIDL_CPP_VIEW_HANDLERS_H_
+#define LIB_FIDL_CPP_VIEW_HANDLERS_H_
+
+#include <lib/fidl/cpp/decoder.h>
+#include <lib/fidl/cpp/internal/pending_response.h>
+#include <lib/fidl/cpp/message.h>
+#include <lib/fidl/cpp/wire_view.h>
+#include <lib/fit/function.h>
+
+#include <utility>
+#include <vector>
+
+namespace fidl {
+
+// Sends the reply to a request handled by a |ViewHandlers| handler.
+class ViewResponder final {
+ public:
+  explicit ViewResponder(internal::PendingResponse response) : response_(std::move(response)) {}
+
+  // Whether the request expects a reply.
+  bool needs_response() const { return response_.needs_response(); }
+
+  // Sends |message|, which must have been encoded with the request's
+  // ordinal, and validates it as |type|.
+  zx_status_t Send(const fidl_type_t* type, Message message) {
+    return response_.Send(type, std::move(message));
+  }
+
+ private:
+  internal::PendingResponse response_;
+};
+
+// Handles chosen methods of a protocol with the message's own bytes, rather
+// than through the generated stub, which copies every string and vector into
+// a newly allocated |std::string| or |std::vector|.
+//
+// A handler is given the request decoded in place. It reads its arguments
+// with |DecodeAs<StringView>|, |DecodeAs<VectorView<T>>| and the usual
+// |DecodeAs|, at the offsets the generated stub uses. The views are valid
+// until the handler returns, and copied only if the handler copies them.
+//
+// Requests for other methods go to the generated stub as before.
+//
+// Example:
+//
+//   handlers.Add(internal::kEcho_EchoString_Ordinal,
+//                &fidl_test_EchoEchoStringRequestTable,
+//                [](fidl::Decoder* request, fidl::ViewResponder responder) {
+//                  auto value = fidl::DecodeAs<fidl::StringView>(request, 16);
+//                  fidl::Encoder encoder(internal::kEcho_EchoString_Ordinal);
+//                  encoder.Alloc(32 - sizeof(fidl_message_header_t));
+//                  fidl::Encode(&encoder, &value, 16);
+//                  responder.Send(&fidl_test_EchoEchoStringResponseTable,
+//                                 encoder.GetMessage());
+//                });
+//   binding.set_view_handlers(&handlers);
+//
+// A |ViewHandlers| is not thread-safe. Add every handler before giving it to
+// a binding, and keep it alive as long as any binding using it.
+class ViewHandlers final {
+ public:
+  using Handler = fit::function<void(Decoder* request, ViewResponder responder)>;
+
+  struct Entry {
+    uint64_t ordinal;
+    const fidl_type_t* request_type;
+    Handler handler;
+  };
+
+  ViewHandlers() = default;
+
+  ViewHandlers(const ViewHandlers&) = delete;
+  ViewHandlers& operator=(const ViewHandlers&) = delete;
+
+  // Handles requests with |ordinal|, decoded as |request_type|, with
+  // |handler|.
+  void Add(uint64_t ordinal, const fidl_type_t* request_type, Handler handler) {
+    entries_.push_back(Entry{ordinal, request_type, std::move(handler)});
+  }
+
+  // The handler for |ordinal|, if any.
+  const Entry* Find(uint64_t ordinal) const {
+    for (const Entry& entry : entries_) {
+      if (entry.ordinal == ordinal)
+        return &entry;
+    }
+    return nullptr;
+  }
+
+ private:
+  // Few enough that a linear search beats hashing.
+  std::vector<Entry> entries_;
+};
+
+}  // namespace fidl
+
+#endif  // LIB_FIDL_CPP_VIEW_HANDLERS_H_
@@ -7,10 +7,14 @@
 #include <lib/async/default.h>
 #include <lib/fidl/cpp/message_buffer.h>
 #include <lib/fidl/epitaph.h>
+#include <lib/zx/clock.h>
 #include <zircon/assert.h>
 #include <zircon/errors.h>
 #include <zircon/fidl.h>
 
+#include <algorithm>
+#include <memory>
+
 namespace fidl {
 namespace internal {
 namespace {
@@ -67,6 +71,49 @@ class Canary {
   bool should_stop_;
 };
 
+// Lends the message buffers of a thread's readers. A buffer is
+// |ZX_CHANNEL_MAX_MSG_BYTES| plus room for the handles, too much to allocate
+// for every read, so buffers go back to the pool when the read is done and the
+// next read on the thread reuses them. A read that starts while another is
+// being dispatched, as in |WaitAndDispatchOneMessageUntil| called from a
+// handler, borrows a buffer of its own.
+class PooledMessageBuffer {
+ public:
+  PooledMessageBuffer() {
+    Pool& pool = GetPool();
+    if (pool.count > 0) {
+      buffer_ = std::move(pool.buffers[--pool.count]);
+    } else {
+      buffer_ = std::make_unique<MessageBuffer>();
+    }
+  }
+
+  ~PooledMessageBuffer() {
+    Pool& pool = GetPool();
+    if (pool.count < kMaxPooledBuffers) {
+      pool.buffers[pool.count++] = std::move(buffer_);
+    }
+  }
+
+  MessageBuffer* get() const { return buffer_.get(); }
+
+ private:
+  // The most buffers a thread keeps. Deeper nesting allocates.
+  static constexpr size_t kMaxPooledBuffers = 4;
+
+  struct Pool {
+    std::unique_ptr<MessageBuffer> buffers[kMaxPooledBuffers];
+    size_t count = 0;
+  };
+
+  static Pool& GetPool() {
+    thread_local Pool pool;
+    return pool;
+  }
+
+  std::unique_ptr<MessageBuffer> buffer_;
+};
+
 }  // namespace
 
 static_assert(std::is_standard_layout<MessageReader>::value, "We need offsetof to work");
@@ -150,8 +197,8 @@ zx_status_t MessageReader::WaitAndDispatchOneMessageUntil(zx::time deadline) {
   }
 
   if (pending & ZX_CHANNEL_READABLE) {
-    MessageBuffer buffer;
-    return ReadAndDispatchMessage(&buffer);
+    PooledMessageBuffer buffer;
+    return ReadAndDispatchMessage(buffer.get());
   }
 
   ZX_DEBUG_ASSERT(pending & ZX_CHANNEL_PEER_CLOSED);
@@ -174,9 +221,18 @@ void MessageReader::OnHandleReady(async_dispatcher_t* dispatcher, zx_status_t st
   }
 
   if (signal->observed & ZX_CHANNEL_READABLE) {
-    MessageBuffer buffer;
-    for (uint64_t i = 0; i < signal->count; i++) {
-      status = ReadAndDispatchMessage(&buffer);
+    // Keep reading past |signal->count| while messages arrive, up to the
+    // budget, so a busy channel costs one wakeup per batch rather than per
+    // message. Copy the budget: a handler may change it.
+    const uint64_t max_messages = std::max<uint32_t>(budget_.max_messages, 1);
+    const bool timed = budget_.max_duration != zx::duration::infinite();
+    const zx::time deadline =
+        timed ? zx::deadline_after(budget_.max_duration) : zx::time::infinite();
+    stats_.wakeups++;
+    PooledMessageBuffer buffer;
+    uint64_t count = 0;
+    for (;;) {
+      status = ReadAndDispatchMessage(buffer.get());
       // If ReadAndDispatchMessage returns ZX_ERR_STOP, that means the message
       // handler has destroyed this object and we need to unwind without
       // touching |this|.
@@ -184,6 +240,12 @@ void MessageReader::OnHandleReady(async_dispatcher_t* dispatcher, zx_status_t st
         break;
       if (status != ZX_OK)
         return;
+      stats_.messages++;
+      stats_.max_messages_per_wakeup = std::max(stats_.max_messages_per_wakeup, ++count);
+      if (count >= max_messages || (timed && zx::clock::get_monotonic() >= deadline)) {
+        stats_.budget_exhausted++;
+        break;
+      }
     }
     status = async_begin_wait(dispatcher, &wait_);
     if (status != ZX_OK) {
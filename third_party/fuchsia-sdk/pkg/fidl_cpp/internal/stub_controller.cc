@@ -11,7 +11,8 @@
 namespace fidl {
 namespace internal {
 
-StubController::StubController() : weak_(nullptr), reader_(this) {}
+StubController::StubController()
+    : weak_(nullptr), reader_(this), stub_(nullptr), view_handlers_(nullptr) {}
 
 StubController::~StubController() { InvalidateWeakIfNeeded(); }
 
@@ -27,6 +28,22 @@ zx_status_t StubController::OnMessage(Message message) {
       weak_ = new WeakStubController(this);
     weak = weak_;
   }
+  if (view_handlers_) {
+    const ViewHandlers::Entry* entry = view_handlers_->Find(message.ordinal());
+    if (entry) {
+      const char* error_msg = nullptr;
+      zx_status_t status = message.Decode(entry->request_type, &error_msg);
+      if (status != ZX_OK) {
+        FIDL_REPORT_DECODING_ERROR(message, entry->request_type, error_msg);
+        return status;
+      }
+      // The views the handler reads point into |decoder|'s message, which is
+      // the reader's buffer, so they are valid until the handler returns.
+      Decoder decoder(std::move(message));
+      entry->handler(&decoder, ViewResponder(PendingResponse(txid, weak)));
+      return ZX_OK;
+    }
+  }
   return stub_->Dispatch_(std::move(message), PendingResponse(txid, weak));
 }
 
@@ -16,11 +16,55 @@ size_t Align(size_t size) {
   return (size + alignment_mask) & ~alignment_mask;
 }
 
+// The buffers of destroyed encoders, kept for the next encoders on the same
+// thread. Encoders nest, as when a message is sent while another is being
+// built, so a few of each are kept. Larger buffers than a channel message are
+// only needed for object coding, and are freed.
+constexpr size_t kMaxRecycledBuffers = 4;
+
+template <typename T>
+class RecycledBuffers {
+ public:
+  std::vector<T> Take() {
+    if (buffers_.empty()) {
+      return std::vector<T>();
+    }
+    std::vector<T> buffer = std::move(buffers_.back());
+    buffers_.pop_back();
+    return buffer;
+  }
+
+  void Give(std::vector<T>* buffer) {
+    if (buffer->capacity() == 0 || buffer->capacity() * sizeof(T) > ZX_CHANNEL_MAX_MSG_BYTES) {
+      return;
+    }
+    if (buffers_.capacity() == 0) {
+      buffers_.reserve(kMaxRecycledBuffers);
+    }
+    if (buffers_.size() < kMaxRecycledBuffers) {
+      buffer->clear();
+      buffers_.push_back(std::move(*buffer));
+    }
+  }
+
+ private:
+  std::vector<std::vector<T>> buffers_;
+};
+
+thread_local RecycledBuffers<uint8_t> recycled_bytes;
+thread_local RecycledBuffers<zx_handle_t> recycled_handles;
+
 }  // namespace
 
-Encoder::Encoder(uint64_t ordinal) { EncodeMessageHeader(ordinal); }
+Encoder::Encoder(uint64_t ordinal) : Encoder(NO_HEADER) { EncodeMessageHeader(ordinal); }
 
-Encoder::~Encoder() = default;
+Encoder::Encoder(NoHeader marker)
+    : bytes_(recycled_bytes.Take()), handles_(recycled_handles.Take()) {}
+
+Encoder::~Encoder() {
+  recycled_bytes.Give(&bytes_);
+  recycled_handles.Give(&handles_);
+}
 
 const size_t Encoder::kMinAllocSize = 512;
 
@@ -28,7 +72,11 @@ size_t Encoder::Alloc(size_t size) {
   size_t offset = bytes_.size();
   size_t new_size = bytes_.size() + Align(size);
   ZX_ASSERT(new_size >= offset);
-  bytes_.reserve(std::max(kMinAllocSize, new_size));
+  if (new_size > bytes_.capacity()) {
+    // Grow geometrically, so a message built from many small allocations is
+    // copied a logarithmic number of times.
+    bytes_.reserve(std::max(std::max(kMinAllocSize, new_size), 2 * bytes_.capacity()));
+  }
   bytes_.resize(new_size);
   return offset;
 }
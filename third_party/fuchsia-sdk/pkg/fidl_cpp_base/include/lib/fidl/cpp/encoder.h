@@ -17,12 +17,17 @@
 
 namespace fidl {
 
+// Encodes a message into buffers it owns.
+//
+// An encoder takes its buffers from those of encoders destroyed earlier on the
+// same thread, and gives them back when destroyed, so a thread that keeps
+// sending messages reuses the same memory rather than allocating for each one.
 class Encoder final {
  public:
   enum NoHeader { NO_HEADER };
 
   explicit Encoder(uint64_t ordinal);
-  explicit Encoder(NoHeader marker) {}
+  explicit Encoder(NoHeader marker);
 
   ~Encoder();
 
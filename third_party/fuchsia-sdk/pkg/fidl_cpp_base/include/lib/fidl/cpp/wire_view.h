@@ -0,0 +1,148 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_FIDL_CPP_WIRE_VIEW_H_
+#define LIB_FIDL_CPP_WIRE_VIEW_H_
+
+#include <string.h>
+#include <zircon/fidl.h>
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "lib/fidl/cpp/coding_traits.h"
+#include "lib/fidl/cpp/string.h"
+#include "lib/fidl/cpp/traits.h"
+#include "lib/fidl/cpp/vector.h"
+
+namespace fidl {
+
+// A string in a decoded message, read where it lies rather than copied out.
+//
+// Decoding a |StringView| neither allocates nor copies: it points into the
+// message, and is valid only as long as the message's buffer, usually until
+// the handler it was passed to returns. Copy it out with |ToString| or
+// |ToStringPtr| to keep it longer.
+//
+// Encoding a |StringView| copies the bytes it points to into the message, as
+// for |std::string|.
+class StringView final {
+ public:
+  // A null string.
+  StringView() = default;
+
+  StringView(char* data, size_t size) : data_(data), size_(size) {}
+
+  bool is_null() const { return data_ == nullptr; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const char* data() const { return data_; }
+
+  // The message's own bytes, for handlers that transform them in place.
+  char* mutable_data() { return data_; }
+
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+
+  // Copies the string, or an empty string if null.
+  std::string ToString() const { return is_null() ? std::string() : std::string(data_, size_); }
+
+  // Copies the string, preserving null.
+  StringPtr ToStringPtr() const {
+    if (is_null())
+      return StringPtr();
+    return StringPtr(ToString());
+  }
+
+ private:
+  char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// A vector in a decoded message, read where it lies rather than copied out.
+//
+// Only vectors of primitives are supported, whose elements need no decoding.
+// As for |StringView|, a |VectorView| is valid only as long as the message's
+// buffer; copy it out with |ToVector| to keep it longer.
+template <typename T>
+class VectorView final {
+  static_assert(IsMemcpyCompatible<T>::value,
+                "VectorView only supports vectors of primitive types");
+
+ public:
+  // A null vector.
+  VectorView() = default;
+
+  VectorView(T* data, size_t count) : data_(data), count_(count) {}
+
+  bool is_null() const { return data_ == nullptr; }
+  size_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+
+  const T* data() const { return data_; }
+  T* mutable_data() { return data_; }
+
+  const T* begin() const { return data_; }
+  const T* end() const { return data_ + count_; }
+
+  const T& operator[](size_t index) const { return data_[index]; }
+
+  // Copies the vector, or an empty vector if null.
+  std::vector<T> ToVector() const { return std::vector<T>(begin(), end()); }
+
+ private:
+  T* data_ = nullptr;
+  size_t count_ = 0;
+};
+
+template <>
+struct CodingTraits<StringView> {
+  static constexpr size_t inline_size_old = sizeof(fidl_string_t);
+  static constexpr size_t inline_size_v1_no_ee = sizeof(fidl_string_t);
+  template <class EncoderImpl>
+  static void Encode(EncoderImpl* encoder, StringView* value, size_t offset) {
+    fidl_string_t* string = encoder->template GetPtr<fidl_string_t>(offset);
+    if (value->is_null()) {
+      string->size = 0u;
+      string->data = reinterpret_cast<char*>(FIDL_ALLOC_ABSENT);
+      return;
+    }
+    const size_t size = value->size();
+    string->size = size;
+    string->data = reinterpret_cast<char*>(FIDL_ALLOC_PRESENT);
+    size_t base = encoder->Alloc(size);
+    memcpy(encoder->template GetPtr<char>(base), value->data(), size);
+  }
+  template <class DecoderImpl>
+  static void Decode(DecoderImpl* decoder, StringView* value, size_t offset) {
+    fidl_string_t* string = decoder->template GetPtr<fidl_string_t>(offset);
+    *value = StringView(string->data, string->data ? string->size : 0u);
+  }
+};
+
+template <typename T>
+struct CodingTraits<VectorView<T>> {
+  static constexpr size_t inline_size_old = sizeof(fidl_vector_t);
+  static constexpr size_t inline_size_v1_no_ee = sizeof(fidl_vector_t);
+  template <class EncoderImpl>
+  static void Encode(EncoderImpl* encoder, VectorView<T>* value, size_t offset) {
+    if (value->is_null())
+      return EncodeNullVector(encoder, offset);
+    const size_t count = value->size();
+    EncodeVectorPointer(encoder, count, offset);
+    size_t base = encoder->Alloc(count * sizeof(T));
+    memcpy(encoder->template GetPtr<T>(base), value->data(), count * sizeof(T));
+  }
+  template <class DecoderImpl>
+  static void Decode(DecoderImpl* decoder, VectorView<T>* value, size_t offset) {
+    fidl_vector_t* encoded = decoder->template GetPtr<fidl_vector_t>(offset);
+    *value = VectorView<T>(static_cast<T*>(encoded->data), encoded->data ? encoded->count : 0u);
+  }
+};
+
+}  // namespace fidl
+
+#endif  // LIB_FIDL_CPP_WIRE_VIEW_H_
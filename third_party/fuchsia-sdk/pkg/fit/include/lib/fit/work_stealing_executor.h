@@ -0,0 +1,85 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_FIT_WORK_STEALING_EXECUTOR_H_
+#define LIB_FIT_WORK_STEALING_EXECUTOR_H_
+
+#include <stddef.h>
+
+#include <utility>
+
+#include "promise.h"
+
+namespace fit {
+
+// A platform-independent asynchronous task executor that runs tasks on
+// several threads at once.
+//
+// Each worker thread has its own deque of runnable tasks. A worker pushes the
+// tasks it schedules or resumes onto its own deque and runs them in order;
+// when its deque is empty it takes tasks scheduled from other threads, then
+// steals the older half of another worker's tasks. Each task keeps its own
+// suspension state, so suspending and resuming a task only locks that task,
+// and tasks may be resumed from any thread.
+//
+// A task runs on one thread at a time, but successive runs of a task may be
+// on different threads, so tasks must not rely on thread-local state.
+//
+// See documentation of |fit::promise| for more information.
+class work_stealing_executor final : public executor {
+ public:
+  // Creates an executor that runs tasks on |thread_count| threads, counting
+  // the thread that calls |run()|. A count of zero is taken as one.
+  explicit work_stealing_executor(size_t thread_count);
+
+  // Destroys the executor along with all of its remaining scheduled tasks
+  // that have yet to complete.
+  ~work_stealing_executor() override;
+
+  // Schedules a task for eventual execution by the executor.
+  //
+  // This method is thread-safe.
+  void schedule_task(pending_task task) override;
+
+  // Runs all scheduled tasks (including additional tasks scheduled while
+  // they run) until none remain, on the calling thread and on
+  // |thread_count() - 1| threads that it starts and joins.
+  //
+  // This method is thread-safe but must only be called on at most one
+  // thread at a time.
+  void run();
+
+  // The number of threads |run()| runs tasks on.
+  size_t thread_count() const;
+
+  work_stealing_executor(const work_stealing_executor&) = delete;
+  work_stealing_executor(work_stealing_executor&&) = delete;
+  work_stealing_executor& operator=(const work_stealing_executor&) = delete;
+  work_stealing_executor& operator=(work_stealing_executor&&) = delete;
+
+ private:
+  class dispatcher_impl;
+  class context_impl;
+
+  dispatcher_impl* const dispatcher_;
+};
+
+// Creates a new |fit::work_stealing_executor| with |thread_count| threads,
+// schedules a promise as a task, runs all of the executor's scheduled tasks
+// until none remain, then returns the promise's result.
+template <typename Continuation>
+static typename promise_impl<Continuation>::result_type run_work_stealing(
+    promise_impl<Continuation> promise, size_t thread_count) {
+  using result_type = typename promise_impl<Continuation>::result_type;
+  work_stealing_executor exec(thread_count);
+  result_type saved_result;
+  exec.schedule_task(
+      promise.then([&saved_result](result_type& result) { saved_result = std::move(result); }));
+  exec.run();
+  return saved_result;
+}
+
+}  // namespace fit
+
+#endif  // LIB_FIT_WORK_STEALING_EXECUTOR_H_
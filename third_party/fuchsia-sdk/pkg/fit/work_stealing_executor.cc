@@ -0,0 +1,454 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <lib/fit/thread_safety.h>
+#include <lib/fit/work_stealing_executor.h>
+
+namespace fit {
+namespace {
+
+// A scheduled task along with its suspension state.
+//
+// The ticket of a suspended task is the address of its record. The task
+// stops counting towards |run()| once it has completed or been abandoned,
+// but the record counts its outstanding tickets and is only deleted once
+// none remain.
+struct task_record {
+  enum class state_t {
+    kQueued,     // in a deque, waiting to run
+    kRunning,    // being run by a worker
+    kSuspended,  // waiting for one of its tickets to resume it
+    kDone,       // completed or abandoned, waiting for its tickets to go
+  };
+
+  explicit task_record(pending_task task) : task(std::move(task)) {}
+
+  // Only touched by the worker running the task, or with the mutex held
+  // while the task is not running.
+  pending_task task;
+
+  std::mutex mutex;
+  state_t state FIT_GUARDED(mutex) = state_t::kQueued;
+
+  // Set if the task was resumed while running, to run it again.
+  bool resume_pending FIT_GUARDED(mutex) = false;
+
+  uint64_t tickets FIT_GUARDED(mutex) = 0;
+};
+
+// A worker's deque. The owner pushes at the back and runs tasks from the
+// front, in the order they were queued, like |single_threaded_executor|; a
+// task resumed many times over, such as one joining many promises, then runs
+// once the tasks ahead of it have. Thieves take from the front as well.
+struct worker_queue {
+  std::mutex mutex;
+  std::deque<task_record*> tasks FIT_GUARDED(mutex);
+
+  // Thieves lock other workers' queues; spacing the queues apart keeps that
+  // from slowing the owner of the next one.
+  char padding[64];
+};
+
+}  // namespace
+
+// The dispatcher runs tasks and provides the suspended task resolver.
+//
+// Like the dispatcher of |single_threaded_executor|, it may outlive the
+// executor: |suspended_task| holds a pointer to it as its resolver. It holds
+// one reference for the executor and one for each task record, and deletes
+// itself once all are released.
+class work_stealing_executor::dispatcher_impl final : public suspended_task::resolver {
+ public:
+  dispatcher_impl(work_stealing_executor* executor, size_t thread_count);
+
+  size_t thread_count() const { return thread_count_; }
+
+  void shutdown();
+  void schedule_task(pending_task task);
+  void run();
+  suspended_task suspend_task(task_record* record);
+
+  suspended_task::ticket duplicate_ticket(suspended_task::ticket ticket) override;
+  void resolve_ticket(suspended_task::ticket ticket, bool resume_task) override;
+
+ private:
+  ~dispatcher_impl() override;
+
+  void run_worker(size_t index);
+  void run_task(task_record* record, context_impl& context);
+  task_record* take_task(size_t index);
+  bool wait_for_tasks();
+  void enqueue(task_record* record);
+  void finish_task();
+  void release_record(task_record* record);
+  void release();
+
+  work_stealing_executor* const executor_;
+  const size_t thread_count_;
+  const std::unique_ptr<worker_queue[]> workers_;
+
+  // Tasks scheduled or resumed from threads other than the workers.
+  worker_queue injected_;
+
+  // The number of tasks in the deques, and of tasks not yet completed or
+  // abandoned. Workers sleep while the first is zero and exit once the
+  // second is.
+  std::atomic<size_t> queued_{0};
+  std::atomic<size_t> live_{0};
+
+  // Workers sleep on |wake_|. Whoever queues a task wakes one of them if
+  // |sleepers_| is non-zero.
+  std::mutex idle_mutex_;
+  std::condition_variable wake_;
+  std::atomic<size_t> sleepers_{0};
+
+  std::atomic<bool> was_shutdown_{false};
+  std::atomic<size_t> refs_{1};
+};
+
+// The task context for tasks run by a worker.
+class work_stealing_executor::context_impl final : public context {
+ public:
+  context_impl(work_stealing_executor* executor, dispatcher_impl* dispatcher)
+      : executor_(executor), dispatcher_(dispatcher) {}
+  ~context_impl() override = default;
+
+  work_stealing_executor* executor() const override { return executor_; }
+  suspended_task suspend_task() override {
+    assert(current_ != nullptr);
+    return dispatcher_->suspend_task(current_);
+  }
+
+  // The record of the task being run.
+  task_record* current_ = nullptr;
+
+ private:
+  work_stealing_executor* const executor_;
+  dispatcher_impl* const dispatcher_;
+};
+
+namespace {
+
+// The dispatcher and the index of the worker running on this thread, if any.
+thread_local const void* current_dispatcher = nullptr;
+thread_local size_t current_worker = 0;
+
+}  // namespace
+
+work_stealing_executor::work_stealing_executor(size_t thread_count)
+    : dispatcher_(new dispatcher_impl(this, thread_count)) {}
+
+work_stealing_executor::~work_stealing_executor() { dispatcher_->shutdown(); }
+
+void work_stealing_executor::schedule_task(pending_task task) {
+  assert(task);
+  dispatcher_->schedule_task(std::move(task));
+}
+
+void work_stealing_executor::run() { dispatcher_->run(); }
+
+size_t work_stealing_executor::thread_count() const { return dispatcher_->thread_count(); }
+
+work_stealing_executor::dispatcher_impl::dispatcher_impl(work_stealing_executor* executor,
+                                                         size_t thread_count)
+    : executor_(executor),
+      thread_count_(thread_count == 0 ? 1 : thread_count),
+      workers_(new worker_queue[thread_count_]) {}
+
+work_stealing_executor::dispatcher_impl::~dispatcher_impl() {
+  assert(was_shutdown_.load());
+  assert(live_.load() == 0);
+}
+
+void work_stealing_executor::dispatcher_impl::shutdown() {
+  assert(!was_shutdown_.load());
+  was_shutdown_.store(true);
+
+  // Abandon the tasks still queued. Those still suspended are abandoned
+  // as their tickets are resolved.
+  std::vector<task_record*> records;
+  for (size_t i = 0; i <= thread_count_; i++) {
+    worker_queue& queue = i < thread_count_ ? workers_[i] : injected_;
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    records.insert(records.end(), queue.tasks.begin(), queue.tasks.end());
+    queue.tasks.clear();
+  }
+  queued_.store(0);
+  for (task_record* record : records) {
+    pending_task abandoned_task;  // drop outside of the lock
+    bool release_now;
+    {
+      std::lock_guard<std::mutex> lock(record->mutex);
+      abandoned_task = std::move(record->task);
+      record->state = task_record::state_t::kDone;
+      release_now = record->tickets == 0;
+    }
+    abandoned_task = pending_task();
+    finish_task();
+    if (release_now) {
+      release_record(record);
+    }
+  }
+
+  release();
+}
+
+void work_stealing_executor::dispatcher_impl::schedule_task(pending_task task) {
+  assert(!was_shutdown_.load());
+  auto* record = new task_record(std::move(task));
+  refs_.fetch_add(1);
+  live_.fetch_add(1);
+  enqueue(record);
+}
+
+void work_stealing_executor::dispatcher_impl::run() {
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count_ - 1);
+  for (size_t i = 1; i < thread_count_; i++) {
+    threads.emplace_back([this, i] { run_worker(i); });
+  }
+  run_worker(0);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+void work_stealing_executor::dispatcher_impl::run_worker(size_t index) {
+  current_dispatcher = this;
+  current_worker = index;
+  context_impl context(executor_, this);
+  for (;;) {
+    task_record* record = take_task(index);
+    if (record != nullptr) {
+      run_task(record, context);
+    } else if (!wait_for_tasks()) {
+      break;  // all done!
+    }
+  }
+  current_dispatcher = nullptr;
+}
+
+void work_stealing_executor::dispatcher_impl::run_task(task_record* record,
+                                                       context_impl& context) {
+  {
+    std::lock_guard<std::mutex> lock(record->mutex);
+    assert(record->state == task_record::state_t::kQueued);
+    record->state = task_record::state_t::kRunning;
+  }
+
+  context.current_ = record;
+  const bool finished = record->task(context);
+  assert(!record->task == finished);
+  context.current_ = nullptr;
+
+  pending_task abandoned_task;  // drop outside of the lock
+  bool requeue = false;
+  bool done = false;
+  bool release_now = false;
+  {
+    std::lock_guard<std::mutex> lock(record->mutex);
+    if (finished) {
+      record->state = task_record::state_t::kDone;
+      done = true;
+      release_now = record->tickets == 0;
+    } else if (record->resume_pending) {
+      record->resume_pending = false;
+      record->state = task_record::state_t::kQueued;
+      requeue = true;
+    } else if (record->tickets == 0) {
+      // The task suspended itself without keeping a ticket, so nothing can
+      // resume it.
+      abandoned_task = std::move(record->task);
+      record->state = task_record::state_t::kDone;
+      done = true;
+      release_now = true;
+    } else {
+      record->state = task_record::state_t::kSuspended;
+    }
+  }
+
+  if (requeue) {
+    enqueue(record);
+  }
+  abandoned_task = pending_task();
+  if (done) {
+    finish_task();
+  }
+  if (release_now) {
+    release_record(record);
+  }
+}
+
+task_record* work_stealing_executor::dispatcher_impl::take_task(size_t index) {
+  worker_queue& own = workers_[index];
+  {
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task_record* record = own.tasks.front();
+      own.tasks.pop_front();
+      queued_.fetch_sub(1);
+      return record;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(injected_.mutex);
+    if (!injected_.tasks.empty()) {
+      task_record* record = injected_.tasks.front();
+      injected_.tasks.pop_front();
+      queued_.fetch_sub(1);
+      return record;
+    }
+  }
+
+  // Steal the older half of another worker's tasks, run the first and keep
+  // the rest, so that a worker fanning out many tasks is not robbed of them
+  // one lock at a time.
+  for (size_t i = 1; i < thread_count_; i++) {
+    worker_queue& victim = workers_[(index + i) % thread_count_];
+    std::vector<task_record*> stolen;
+    {
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      const size_t count = (victim.tasks.size() + 1) / 2;
+      stolen.assign(victim.tasks.begin(), victim.tasks.begin() + count);
+      victim.tasks.erase(victim.tasks.begin(), victim.tasks.begin() + count);
+    }
+    if (stolen.empty()) {
+      continue;
+    }
+    if (stolen.size() > 1) {
+      std::lock_guard<std::mutex> lock(own.mutex);
+      own.tasks.insert(own.tasks.end(), stolen.begin() + 1, stolen.end());
+    }
+    queued_.fetch_sub(1);
+    return stolen.front();
+  }
+  return nullptr;
+}
+
+// Unfortunately std::unique_lock does not support thread-safety annotations
+bool work_stealing_executor::dispatcher_impl::wait_for_tasks() FIT_NO_THREAD_SAFETY_ANALYSIS {
+  std::unique_lock<std::mutex> lock(idle_mutex_);
+  for (;;) {
+    // Count this worker as sleeping before checking for tasks, so that
+    // whoever queues a task after the check sees it and wakes it.
+    sleepers_.fetch_add(1);
+    if (queued_.load() != 0) {
+      sleepers_.fetch_sub(1);
+      return true;  // got some tasks
+    }
+    if (live_.load() == 0) {
+      sleepers_.fetch_sub(1);
+      return false;  // all done!
+    }
+    wake_.wait(lock);
+    sleepers_.fetch_sub(1);
+  }
+}
+
+void work_stealing_executor::dispatcher_impl::enqueue(task_record* record) {
+  worker_queue& queue = current_dispatcher == this ? workers_[current_worker] : injected_;
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(record);
+  }
+  queued_.fetch_add(1);
+  if (sleepers_.load() != 0) {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    wake_.notify_one();
+  }
+}
+
+// Must be called once for each task, after it has completed or been
+// abandoned, whether or not tickets for it remain.
+void work_stealing_executor::dispatcher_impl::finish_task() {
+  if (live_.fetch_sub(1) == 1) {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    wake_.notify_all();
+  }
+}
+
+// Must only be called once the task is done and no tickets remain.
+void work_stealing_executor::dispatcher_impl::release_record(task_record* record) {
+  delete record;
+  release();
+}
+
+void work_stealing_executor::dispatcher_impl::release() {
+  if (refs_.fetch_sub(1) == 1) {
+    delete this;
+  }
+}
+
+suspended_task work_stealing_executor::dispatcher_impl::suspend_task(task_record* record) {
+  std::lock_guard<std::mutex> lock(record->mutex);
+  assert(record->state == task_record::state_t::kRunning);
+  record->tickets++;
+  return suspended_task(this, reinterpret_cast<suspended_task::ticket>(record));
+}
+
+suspended_task::ticket work_stealing_executor::dispatcher_impl::duplicate_ticket(
+    suspended_task::ticket ticket) {
+  auto* record = reinterpret_cast<task_record*>(ticket);
+  std::lock_guard<std::mutex> lock(record->mutex);
+  assert(record->tickets > 0);
+  record->tickets++;
+  return ticket;
+}
+
+void work_stealing_executor::dispatcher_impl::resolve_ticket(suspended_task::ticket ticket,
+                                                             bool resume_task) {
+  auto* record = reinterpret_cast<task_record*>(ticket);
+  pending_task abandoned_task;  // drop outside of the lock
+  bool requeue = false;
+  bool done = false;
+  bool release_now = false;
+  {
+    std::lock_guard<std::mutex> lock(record->mutex);
+    assert(record->tickets > 0);
+    record->tickets--;
+    if (resume_task) {
+      if (record->state == task_record::state_t::kRunning) {
+        record->resume_pending = true;
+      } else if (record->state == task_record::state_t::kSuspended) {
+        if (was_shutdown_.load()) {
+          abandoned_task = std::move(record->task);
+          record->state = task_record::state_t::kDone;
+          done = true;
+        } else {
+          record->state = task_record::state_t::kQueued;
+          requeue = true;
+        }
+      }
+    }
+    if (record->tickets == 0 && !requeue) {
+      if (record->state == task_record::state_t::kSuspended) {
+        abandoned_task = std::move(record->task);
+        record->state = task_record::state_t::kDone;
+        done = true;
+      }
+      release_now = record->state == task_record::state_t::kDone;
+    }
+  }
+
+  if (requeue) {
+    enqueue(record);
+  }
+  abandoned_task = pending_task();
+  if (done) {
+    finish_task();
+  }
+  if (release_now) {
+    release_record(record);
+  }
+}
+
+}  // namespace fit
@@ -0,0 +1,316 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <lib/inspect/cpp/delta_snapshot.h>
+#include <lib/inspect/cpp/vmo/limits.h>
+#include <lib/inspect/cpp/vmo/scanner.h>
+#include <string.h>
+
+#include <algorithm>
+
+using inspect::internal::Block;
+using inspect::internal::BlockIndex;
+using inspect::internal::BlockType;
+
+namespace inspect {
+
+namespace {
+
+// Pages are compared and copied as a whole. Blocks never straddle two pages:
+// each is aligned to its size, and the largest is smaller than a page.
+constexpr size_t kPageSize = 4096;
+static_assert(kPageSize % internal::kMaxOrderSize == 0, "Blocks must not straddle pages");
+
+// The VMO is read this many bytes at a time.
+constexpr size_t kChunkSize = 16 * kPageSize;
+
+bool IsProperty(BlockType type) {
+  switch (type) {
+    case BlockType::kIntValue:
+    case BlockType::kUintValue:
+    case BlockType::kDoubleValue:
+    case BlockType::kBoolValue:
+    case BlockType::kArrayValue:
+    case BlockType::kBufferValue:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Calls |callback| with the offset and type of each block laid out in
+// |page|, of |size| bytes, that differs from |other|.
+template <typename Callback>
+void ForEachChangedBlock(const uint8_t* page, const uint8_t* other, size_t size,
+                         Callback callback) {
+  size_t offset = 0;
+  while (offset + sizeof(Block) <= size) {
+    const auto* block = reinterpret_cast<const Block*>(page + offset);
+    const size_t order = internal::GetOrder(block);
+    if (order >= internal::kNumOrders) {
+      return;
+    }
+    const size_t block_size = internal::OrderToSize(order);
+    if (offset + block_size > size) {
+      return;
+    }
+    if (memcmp(page + offset, other + offset, block_size) != 0) {
+      callback(offset, internal::GetType(block));
+    }
+    offset += block_size;
+  }
+}
+
+}  // namespace
+
+zx_status_t DeltaSnapshot::Update(const zx::vmo& vmo, std::vector<PropertyChange>* changes) {
+  changes->clear();
+  stats_.scrapes++;
+
+  // The first scrape has nothing to compare with.
+  const bool diff = static_cast<bool>(snapshot_);
+
+  for (int tries_left = options_.read_attempts; tries_left > 0; tries_left--) {
+    size_t size;
+    zx_status_t status = vmo.get_size(&size);
+    if (status != ZX_OK) {
+      return status;
+    }
+    if (size < sizeof(Block)) {
+      return ZX_ERR_OUT_OF_RANGE;
+    }
+
+    uint64_t generation;
+    status = ReadGeneration(vmo, &generation);
+    if (status != ZX_OK) {
+      return status;
+    }
+    if (generation % 2 != 0) {
+      continue;
+    }
+    if (diff && generation == generation_ && size == snapshot_.size()) {
+      // Every write bumps the generation count, so nothing was written.
+      stats_.unchanged_scrapes++;
+      return ZX_OK;
+    }
+
+    status = ReadChangedPages(vmo, size, diff);
+    if (status != ZX_OK) {
+      return status;
+    }
+
+    uint64_t new_generation;
+    status = ReadGeneration(vmo, &new_generation);
+    if (status != ZX_OK) {
+      return status;
+    }
+    size_t new_size;
+    if (vmo.get_size(&new_size) != ZX_OK) {
+      return ZX_ERR_INTERNAL;
+    }
+    if (new_generation != generation || new_size != size) {
+      // Drop the staged pages; the next attempt compares against the
+      // snapshot again.
+      continue;
+    }
+
+    CommitPages(size);
+    generation_ = generation;
+    if (diff) {
+      ListChanges(changes);
+    }
+    return ZX_OK;
+  }
+
+  return ZX_ERR_INTERNAL;
+}
+
+fit::string_view DeltaSnapshot::ReadBuffer(const FlatHierarchy::Property& property,
+                                           std::string* scratch) const {
+  return internal::ReadPropertyBuffer(&snapshot_, property.block, scratch);
+}
+
+zx_status_t DeltaSnapshot::ReadGeneration(const zx::vmo& vmo, uint64_t* generation) {
+  Block header;
+  zx_status_t status = vmo.read(&header, 0, sizeof(header));
+  if (status != ZX_OK) {
+    return status;
+  }
+  stats_.bytes_read += sizeof(header);
+  return Snapshot::ParseHeader(reinterpret_cast<uint8_t*>(&header), generation);
+}
+
+zx_status_t DeltaSnapshot::ReadChangedPages(const zx::vmo& vmo, size_t size, bool diff) {
+  staged_offsets_.clear();
+  staged_pages_.clear();
+  changed_blocks_.clear();
+  changed_extents_.clear();
+  chunk_.resize(std::min(size, kChunkSize));
+
+  // Pages past the previous size compare against zeroes, which read as free
+  // blocks, so the blocks in them are recorded as new.
+  const uint8_t* previous = snapshot_.data();
+  const size_t previous_size = snapshot_.size();
+  uint8_t padded[kPageSize];
+
+  for (size_t chunk_offset = 0; chunk_offset < size; chunk_offset += kChunkSize) {
+    const size_t chunk_size = std::min(kChunkSize, size - chunk_offset);
+    zx_status_t status = vmo.read(chunk_.data(), chunk_offset, chunk_size);
+    if (status != ZX_OK) {
+      return status;
+    }
+    stats_.bytes_read += chunk_size;
+
+    for (size_t page_offset = 0; page_offset < chunk_size; page_offset += kPageSize) {
+      const size_t offset = chunk_offset + page_offset;
+      const size_t page_size = std::min(kPageSize, chunk_size - page_offset);
+      const uint8_t* current = padded;
+      if (offset + page_size <= previous_size) {
+        current = previous + offset;
+      } else {
+        const size_t kept = offset < previous_size ? previous_size - offset : 0;
+        if (kept > 0) {
+          memcpy(padded, previous + offset, kept);
+        }
+        memset(padded + kept, 0, page_size - kept);
+      }
+      const uint8_t* next = chunk_.data() + page_offset;
+      if (memcmp(current, next, page_size) == 0) {
+        continue;
+      }
+      if (diff) {
+        DiffPage(offset, current, next, page_size);
+      }
+      staged_offsets_.push_back(offset);
+      staged_pages_.insert(staged_pages_.end(), next, next + page_size);
+    }
+  }
+  return ZX_OK;
+}
+
+void DeltaSnapshot::CommitPages(size_t size) {
+  if (!snapshot_.buffer_) {
+    snapshot_.buffer_ = std::make_shared<std::vector<uint8_t>>();
+  } else if (snapshot_.buffer_.use_count() > 1) {
+    // A copy of the previous snapshot is still held; leave it be.
+    snapshot_.buffer_ = std::make_shared<std::vector<uint8_t>>(*snapshot_.buffer_);
+  }
+  std::vector<uint8_t>& buffer = *snapshot_.buffer_;
+  buffer.resize(size);
+
+  const uint8_t* page = staged_pages_.data();
+  for (size_t offset : staged_offsets_) {
+    const size_t page_size = std::min(kPageSize, size - offset);
+    memcpy(buffer.data() + offset, page, page_size);
+    page += page_size;
+  }
+  stats_.bytes_copied += staged_pages_.size();
+  stats_.pages_changed += staged_offsets_.size();
+}
+
+void DeltaSnapshot::DiffPage(size_t offset, const uint8_t* previous, const uint8_t* next,
+                             size_t size) {
+  // The blocks may have been split or merged, so walk the page as laid out
+  // both before and after.
+  ForEachChangedBlock(previous, next, size, [&](size_t block_offset, BlockType type) {
+    if (IsProperty(type)) {
+      changed_blocks_.push_back({internal::IndexForOffset(offset + block_offset), true, false});
+    }
+  });
+  ForEachChangedBlock(next, previous, size, [&](size_t block_offset, BlockType type) {
+    const BlockIndex index = internal::IndexForOffset(offset + block_offset);
+    if (IsProperty(type)) {
+      changed_blocks_.push_back({index, false, true});
+    } else if (type == BlockType::kExtent) {
+      changed_extents_.push_back(index);
+    }
+  });
+}
+
+void DeltaSnapshot::AddExtentOwners() {
+  std::sort(changed_extents_.begin(), changed_extents_.end());
+  const size_t changed_count = changed_blocks_.size();
+  auto is_changed = [this, changed_count](BlockIndex index) {
+    auto end = changed_blocks_.begin() + changed_count;
+    auto it = std::lower_bound(
+        changed_blocks_.begin(), end, index,
+        [](const ChangedBlock& block, BlockIndex index) { return block.index < index; });
+    return it != end && it->index == index;
+  };
+
+  // Extents do not name their owner, so find it by following the extents of
+  // each buffer property.
+  const size_t max_extents = internal::IndexForOffset(snapshot_.size());
+  internal::ScanBlocks(
+      snapshot_.data(), snapshot_.size(), [&](BlockIndex index, const Block* block) {
+        if (internal::GetType(block) != BlockType::kBufferValue || is_changed(index)) {
+          return true;
+        }
+        BlockIndex extent_index =
+            internal::PropertyBlockPayload::ExtentIndex::Get<BlockIndex>(block->payload.u64);
+        for (size_t i = 0; i < max_extents; i++) {
+          const Block* extent = internal::GetBlock(&snapshot_, extent_index);
+          if (!extent || internal::GetType(extent) != BlockType::kExtent) {
+            break;
+          }
+          if (std::binary_search(changed_extents_.begin(), changed_extents_.end(), extent_index)) {
+            changed_blocks_.push_back({index, true, true});
+            break;
+          }
+          extent_index =
+              internal::ExtentBlockFields::NextExtentIndex::Get<BlockIndex>(extent->header);
+        }
+        return true;
+      });
+}
+
+void DeltaSnapshot::ListChanges(std::vector<PropertyChange>* changes) {
+  auto by_index = [](const ChangedBlock& a, const ChangedBlock& b) { return a.index < b.index; };
+
+  // Merge the records of each block, which the two walks of a page may
+  // repeat.
+  auto merge = [this, &by_index] {
+    std::sort(changed_blocks_.begin(), changed_blocks_.end(), by_index);
+    auto out = changed_blocks_.begin();
+    for (auto it = changed_blocks_.begin(); it != changed_blocks_.end(); ++it) {
+      if (out != changed_blocks_.begin() && (out - 1)->index == it->index) {
+        (out - 1)->was_property |= it->was_property;
+        (out - 1)->is_property |= it->is_property;
+      } else {
+        *out++ = *it;
+      }
+    }
+    changed_blocks_.erase(out, changed_blocks_.end());
+  };
+
+  merge();
+  if (!changed_extents_.empty()) {
+    const size_t changed_count = changed_blocks_.size();
+    AddExtentOwners();
+    if (changed_blocks_.size() != changed_count) {
+      merge();
+    }
+  }
+
+  changes->reserve(changed_blocks_.size());
+  for (const ChangedBlock& changed : changed_blocks_) {
+    PropertyChange change;
+    change.index = changed.index;
+    const Block* block = changed.is_property ? internal::GetBlock(&snapshot_, changed.index)
+                                             : nullptr;
+    if (block && internal::ReadProperty(&snapshot_, block, &change.property)) {
+      change.kind = changed.was_property ? PropertyChange::Kind::kUpdated
+                                         : PropertyChange::Kind::kAdded;
+      change.parent = internal::ValueBlockFields::ParentIndex::Get<BlockIndex>(block->header);
+    } else if (changed.was_property) {
+      change.kind = PropertyChange::Kind::kRemoved;
+      change.property = FlatHierarchy::Property();
+    } else {
+      continue;
+    }
+    changes->push_back(change);
+  }
+}
+
+}  // namespace inspect
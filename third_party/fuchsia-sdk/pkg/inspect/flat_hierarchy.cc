@@ -0,0 +1,475 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <lib/inspect/cpp/flat_hierarchy.h>
+#include <lib/inspect/cpp/vmo/scanner.h>
+
+#include <algorithm>
+#include <limits>
+
+using inspect::internal::Block;
+using inspect::internal::BlockIndex;
+using inspect::internal::BlockType;
+
+namespace inspect {
+
+namespace internal {
+// Defined in reader.cc.
+ArrayDisplayFormat ArrayBlockFormatToDisplay(ArrayBlockFormat format);
+}  // namespace internal
+
+namespace {
+
+using Index = FlatHierarchy::Index;
+
+constexpr Index kUnreached = std::numeric_limits<Index>::max();
+
+// Scans a snapshot into the arrays of a FlatHierarchy.
+//
+// Scanning records each node, property and link with the block index of its
+// parent. The nodes are then numbered breadth first from the root, and the
+// properties and links grouped by the number of the node they belong to.
+class FlatReader {
+ public:
+  explicit FlatReader(const Snapshot* snapshot) : snapshot_(snapshot) {}
+
+  void Read(std::vector<FlatHierarchy::Node>* nodes,
+            std::vector<FlatHierarchy::Property>* properties,
+            std::vector<FlatHierarchy::Link>* links);
+
+ private:
+  bool ScanBlock(BlockIndex index, const Block* block);
+
+  // Returns the scanned position of the node at block |index|, or
+  // kUnreached if there is none.
+  Index FindScanned(BlockIndex index) const;
+
+  // Numbers the nodes breadth first, into |nodes|.
+  void NumberNodes(std::vector<FlatHierarchy::Node>* nodes);
+
+  // Moves |values| into |out| grouped by node, in the order they were
+  // scanned, and sets |range| of each node to its group.
+  template <typename T>
+  void GroupByNode(const std::vector<BlockIndex>& parents, std::vector<T>* values,
+                   FlatHierarchy::Range FlatHierarchy::Node::*range,
+                   std::vector<FlatHierarchy::Node>* nodes, std::vector<T>* out) const;
+
+  const Snapshot* snapshot_;
+
+  // The scanned position of the node at each block index, or kUnreached.
+  // One entry per block looks up parents faster than searching the nodes.
+  std::vector<Index> block_nodes_;
+
+  // The scanned nodes, in block order, with the block index of each node's
+  // parent. The root comes first.
+  std::vector<BlockIndex> node_parents_;
+  std::vector<fit::string_view> node_names_;
+
+  // The number each scanned node was given, or kUnreached.
+  std::vector<Index> numbers_;
+
+  // The scanned properties and links, with the block index of their parent.
+  std::vector<BlockIndex> property_parents_;
+  std::vector<FlatHierarchy::Property> properties_;
+  std::vector<BlockIndex> link_parents_;
+  std::vector<FlatHierarchy::Link> links_;
+};
+
+// Views the name in the NAME block at |index|.
+bool GetName(const Snapshot* snapshot, BlockIndex index, fit::string_view* name) {
+  const Block* block = internal::GetBlock(snapshot, index);
+  if (!block) {
+    return false;
+  }
+  auto len = internal::NameBlockFields::Length::Get<size_t>(block->header);
+  // Do not parse the name if the declared length is greater than what the block can hold.
+  if (len > internal::PayloadCapacity(internal::GetOrder(block))) {
+    return false;
+  }
+  *name = fit::string_view(block->payload_ptr(), len);
+  return true;
+}
+
+bool FlatReader::ScanBlock(BlockIndex index, const Block* block) {
+  BlockType type = internal::GetType(block);
+  if (index == 0) {
+    return type == BlockType::kHeader;
+  }
+
+  fit::string_view name;
+  auto parent = internal::ValueBlockFields::ParentIndex::Get<BlockIndex>(block->header);
+  switch (type) {
+    case BlockType::kNodeValue:
+      if (GetName(snapshot_, internal::ValueBlockFields::NameIndex::Get<BlockIndex>(block->header),
+                  &name)) {
+        block_nodes_[index] = static_cast<Index>(node_parents_.size());
+        node_parents_.push_back(parent);
+        node_names_.push_back(name);
+      }
+      return true;
+    case BlockType::kIntValue:
+    case BlockType::kUintValue:
+    case BlockType::kDoubleValue:
+    case BlockType::kBoolValue:
+    case BlockType::kArrayValue:
+    case BlockType::kBufferValue: {
+      FlatHierarchy::Property property;
+      if (internal::ReadProperty(snapshot_, block, &property)) {
+        property_parents_.push_back(parent);
+        properties_.push_back(property);
+      }
+      return true;
+    }
+    case BlockType::kLinkValue: {
+      FlatHierarchy::Link link;
+      if (!GetName(snapshot_,
+                   internal::ValueBlockFields::NameIndex::Get<BlockIndex>(block->header),
+                   &link.name) ||
+          link.name.empty() ||
+          !GetName(snapshot_,
+                   internal::LinkBlockPayload::ContentIndex::Get<BlockIndex>(block->payload.u64),
+                   &link.content) ||
+          link.content.empty()) {
+        return true;
+      }
+      switch (internal::LinkBlockPayload::Flags::Get<internal::LinkBlockDisposition>(
+          block->payload.u64)) {
+        case internal::LinkBlockDisposition::kChild:
+          link.disposition = LinkDisposition::kChild;
+          break;
+        case internal::LinkBlockDisposition::kInline:
+          link.disposition = LinkDisposition::kInline;
+          break;
+      }
+      link_parents_.push_back(parent);
+      links_.push_back(link);
+      return true;
+    }
+    default:
+      return true;
+  }
+}
+
+Index FlatReader::FindScanned(BlockIndex index) const {
+  return index < block_nodes_.size() ? block_nodes_[index] : kUnreached;
+}
+
+void FlatReader::NumberNodes(std::vector<FlatHierarchy::Node>* nodes) {
+  const size_t count = node_parents_.size();
+
+  // List the children of each scanned node, by scanned position: those of
+  // node i are children[child_start[i]] to children[child_start[i + 1] - 1].
+  std::vector<Index> parents(count, kUnreached);
+  std::vector<Index> child_start(count + 1, 0);
+  for (size_t i = 1; i < count; i++) {
+    Index parent = FindScanned(node_parents_[i]);
+    if (parent != kUnreached && parent != i) {
+      parents[i] = parent;
+      child_start[parent + 1]++;
+    }
+  }
+  for (size_t i = 0; i < count; i++) {
+    child_start[i + 1] += child_start[i];
+  }
+  std::vector<Index> children(child_start[count]);
+  std::vector<Index> next_child(child_start.begin(), child_start.end() - 1);
+  for (size_t i = 1; i < count; i++) {
+    if (parents[i] != kUnreached) {
+      children[next_child[parents[i]]++] = static_cast<Index>(i);
+    }
+  }
+
+  // Number the nodes breadth first from the root. |order| lists the scanned
+  // position of each numbered node, and doubles as the queue.
+  numbers_.assign(count, kUnreached);
+  std::vector<Index> order;
+  order.reserve(count);
+  order.push_back(0);
+  numbers_[0] = FlatHierarchy::kRoot;
+  nodes->reserve(count);
+  for (size_t n = 0; n < order.size(); n++) {
+    Index scanned = order[n];
+    FlatHierarchy::Node node;
+    node.name = node_names_[scanned];
+    if (n > 0) {
+      node.parent = numbers_[parents[scanned]];
+    }
+    node.children.begin = static_cast<Index>(order.size());
+    for (Index c = child_start[scanned]; c < child_start[scanned + 1]; c++) {
+      Index child = children[c];
+      if (numbers_[child] == kUnreached) {
+        numbers_[child] = static_cast<Index>(order.size());
+        order.push_back(child);
+      }
+    }
+    node.children.end = static_cast<Index>(order.size());
+    nodes->push_back(node);
+  }
+}
+
+template <typename T>
+void FlatReader::GroupByNode(const std::vector<BlockIndex>& parents, std::vector<T>* values,
+                             FlatHierarchy::Range FlatHierarchy::Node::*range,
+                             std::vector<FlatHierarchy::Node>* nodes, std::vector<T>* out) const {
+  // Count the values of each node, then place them with a counting sort,
+  // which keeps the scanned order within each node.
+  std::vector<Index> owners(values->size());
+  std::vector<Index> start(nodes->size() + 1, 0);
+  for (size_t i = 0; i < values->size(); i++) {
+    Index scanned = FindScanned(parents[i]);
+    owners[i] = scanned == kUnreached ? kUnreached : numbers_[scanned];
+    if (owners[i] != kUnreached) {
+      start[owners[i] + 1]++;
+    }
+  }
+  for (size_t n = 0; n < nodes->size(); n++) {
+    start[n + 1] += start[n];
+    ((*nodes)[n].*range).begin = start[n];
+    ((*nodes)[n].*range).end = start[n];
+  }
+  out->resize(start[nodes->size()]);
+  for (size_t i = 0; i < values->size(); i++) {
+    if (owners[i] != kUnreached) {
+      (*out)[((*nodes)[owners[i]].*range).end++] = std::move((*values)[i]);
+    }
+  }
+}
+
+void FlatReader::Read(std::vector<FlatHierarchy::Node>* nodes,
+                      std::vector<FlatHierarchy::Property>* properties,
+                      std::vector<FlatHierarchy::Link>* links) {
+  // The implicit root node, which uses index 0.
+  block_nodes_.assign(snapshot_->size() / sizeof(Block), kUnreached);
+  block_nodes_[0] = 0;
+  node_parents_.push_back(0);
+  node_names_.push_back("root");
+
+  internal::ScanBlocks(snapshot_->data(), snapshot_->size(),
+                       [this](BlockIndex index, const Block* block) {
+                         return ScanBlock(index, block);
+                       });
+
+  NumberNodes(nodes);
+  GroupByNode(property_parents_, &properties_, &FlatHierarchy::Node::properties, nodes,
+              properties);
+  GroupByNode(link_parents_, &links_, &FlatHierarchy::Node::links, nodes, links);
+}
+
+}  // namespace
+
+namespace internal {
+
+bool ReadProperty(const Snapshot* snapshot, const Block* block, FlatHierarchy::Property* property) {
+  if (!GetName(snapshot, ValueBlockFields::NameIndex::Get<BlockIndex>(block->header),
+               &property->name)) {
+    return false;
+  }
+  property->block = block;
+  switch (GetType(block)) {
+    case BlockType::kIntValue:
+      property->format = PropertyFormat::kInt;
+      return true;
+    case BlockType::kUintValue:
+      property->format = PropertyFormat::kUint;
+      return true;
+    case BlockType::kDoubleValue:
+      property->format = PropertyFormat::kDouble;
+      return true;
+    case BlockType::kBoolValue:
+      property->format = PropertyFormat::kBool;
+      return true;
+    case BlockType::kBufferValue:
+      property->format = PropertyBlockPayload::Flags::Get<uint8_t>(block->payload.u64) &
+                                 static_cast<uint8_t>(PropertyBlockFormat::kBinary)
+                             ? PropertyFormat::kBytes
+                             : PropertyFormat::kString;
+      return true;
+    case BlockType::kArrayValue: {
+      auto count = ArrayBlockPayload::Count::Get<uint8_t>(block->payload.u64);
+      if (GetArraySlot<const int64_t>(block, count - 1) == nullptr) {
+        // Block does not store the entire array.
+        return false;
+      }
+      switch (ArrayBlockPayload::EntryType::Get<BlockType>(block->payload.u64)) {
+        case BlockType::kIntValue:
+          property->format = PropertyFormat::kIntArray;
+          return true;
+        case BlockType::kUintValue:
+          property->format = PropertyFormat::kUintArray;
+          return true;
+        case BlockType::kDoubleValue:
+          property->format = PropertyFormat::kDoubleArray;
+          return true;
+        default:
+          return false;
+      }
+    }
+    default:
+      return false;
+  }
+}
+
+fit::string_view ReadPropertyBuffer(const Snapshot* snapshot, const Block* block,
+                                    std::string* scratch) {
+  // Do not allow reading more bytes than exist in the buffer for any property. This safeguards
+  // against cycles and excessive memory usage.
+  const uint64_t payload = block->payload.u64;
+  size_t remaining_length = std::min(
+      snapshot->size(), PropertyBlockPayload::TotalLength::Get<size_t>(payload));
+  const Block* extent = GetBlock(
+      snapshot, PropertyBlockPayload::ExtentIndex::Get<BlockIndex>(payload));
+  if (!extent || GetType(extent) != BlockType::kExtent) {
+    return fit::string_view();
+  }
+  if (remaining_length <= PayloadCapacity(GetOrder(extent))) {
+    return fit::string_view(extent->payload_ptr(), remaining_length);
+  }
+
+  scratch->clear();
+  while (remaining_length > 0) {
+    if (!extent || GetType(extent) != BlockType::kExtent) {
+      break;
+    }
+    size_t len = std::min(remaining_length, PayloadCapacity(GetOrder(extent)));
+    scratch->append(extent->payload_ptr(), len);
+    remaining_length -= len;
+
+    extent = GetBlock(
+        snapshot, ExtentBlockFields::NextExtentIndex::Get<BlockIndex>(extent->header));
+  }
+  return fit::string_view(scratch->data(), scratch->size());
+}
+
+}  // namespace internal
+
+constexpr FlatHierarchy::Index FlatHierarchy::kRoot;
+
+ArrayDisplayFormat FlatHierarchy::Property::array_format() const {
+  return internal::ArrayBlockFormatToDisplay(
+      internal::ArrayBlockPayload::Flags::Get<internal::ArrayBlockFormat>(block->payload.u64));
+}
+
+FlatHierarchy::Index FlatHierarchy::FindChild(Index parent, fit::string_view name) const {
+  const Range& children = nodes_[parent].children;
+  for (Index i = children.begin; i < children.end; i++) {
+    if (nodes_[i].name == name) {
+      return i;
+    }
+  }
+  return static_cast<Index>(nodes_.size());
+}
+
+fit::string_view FlatHierarchy::ReadBuffer(const Property& property, std::string* scratch) const {
+  return internal::ReadPropertyBuffer(&snapshot_, property.block, scratch);
+}
+
+PropertyValue FlatHierarchy::ToPropertyValue(const Property& property) const {
+  std::string name(property.name.data(), property.name.size());
+  switch (property.format) {
+    case PropertyFormat::kInt:
+      return PropertyValue(std::move(name), IntPropertyValue(property.int_value()));
+    case PropertyFormat::kUint:
+      return PropertyValue(std::move(name), UintPropertyValue(property.uint_value()));
+    case PropertyFormat::kDouble:
+      return PropertyValue(std::move(name), DoublePropertyValue(property.double_value()));
+    case PropertyFormat::kBool:
+      return PropertyValue(std::move(name), BoolPropertyValue(property.bool_value()));
+    case PropertyFormat::kIntArray: {
+      const int64_t* data = property.array_data<int64_t>();
+      return PropertyValue(
+          std::move(name),
+          IntArrayValue(std::vector<int64_t>(data, data + property.array_size()),
+                        property.array_format()));
+    }
+    case PropertyFormat::kUintArray: {
+      const uint64_t* data = property.array_data<uint64_t>();
+      return PropertyValue(
+          std::move(name),
+          UintArrayValue(std::vector<uint64_t>(data, data + property.array_size()),
+                         property.array_format()));
+    }
+    case PropertyFormat::kDoubleArray: {
+      const double* data = property.array_data<double>();
+      return PropertyValue(
+          std::move(name),
+          DoubleArrayValue(std::vector<double>(data, data + property.array_size()),
+                           property.array_format()));
+    }
+    case PropertyFormat::kString: {
+      std::string scratch;
+      fit::string_view value = ReadBuffer(property, &scratch);
+      return PropertyValue(std::move(name),
+                           StringPropertyValue(std::string(value.data(), value.size())));
+    }
+    default:
+      break;
+  }
+  // Scanning gives every other property kBytes.
+  std::string scratch;
+  fit::string_view value = ReadBuffer(property, &scratch);
+  return PropertyValue(std::move(name),
+                       ByteVectorPropertyValue(
+                           std::vector<uint8_t>(value.data(), value.data() + value.size())));
+}
+
+Hierarchy FlatHierarchy::ToHierarchy(Index index) const {
+  // List the subtree breadth first. As in |nodes_|, the children of each
+  // listed node are then consecutive, from |first_child| of its position.
+  std::vector<Index> order = {index};
+  std::vector<size_t> first_child;
+  for (size_t i = 0; i < order.size(); i++) {
+    const Range& children = nodes_[order[i]].children;
+    first_child.push_back(order.size());
+    for (Index child = children.begin; child < children.end; child++) {
+      order.push_back(child);
+    }
+  }
+
+  // Build the Hierarchies bottom up, so each node's children are ready.
+  std::vector<Hierarchy> built(order.size());
+  for (size_t i = order.size(); i-- > 0;) {
+    const Node& node = nodes_[order[i]];
+    std::vector<PropertyValue> properties;
+    properties.reserve(node.properties.size());
+    for (Index p = node.properties.begin; p < node.properties.end; p++) {
+      properties.push_back(ToPropertyValue(properties_[p]));
+    }
+    std::vector<Hierarchy> children;
+    children.reserve(node.children.size());
+    for (size_t c = 0; c < node.children.size(); c++) {
+      children.push_back(std::move(built[first_child[i] + c]));
+    }
+    built[i] = Hierarchy(NodeValue(std::string(node.name.data(), node.name.size()),
+                                   std::move(properties)),
+                         std::move(children));
+    for (Index l = node.links.begin; l < node.links.end; l++) {
+      const Link& link = links_[l];
+      built[i].node_ptr()->add_link(LinkValue(std::string(link.name.data(), link.name.size()),
+                                              std::string(link.content.data(), link.content.size()),
+                                              link.disposition));
+    }
+  }
+  return std::move(built[0]);
+}
+
+fit::result<FlatHierarchy> ReadFlatFromSnapshot(Snapshot snapshot) {
+  if (!snapshot) {
+    // Snapshot is invalid, return an error.
+    return fit::error();
+  }
+  FlatHierarchy hierarchy(std::move(snapshot));
+  FlatReader(&hierarchy.snapshot_)
+      .Read(&hierarchy.nodes_, &hierarchy.properties_, &hierarchy.links_);
+  return fit::ok(std::move(hierarchy));
+}
+
+fit::result<FlatHierarchy> ReadFlatFromBuffer(std::vector<uint8_t> buffer) {
+  inspect::Snapshot snapshot;
+  if (inspect::Snapshot::Create(std::move(buffer), &snapshot) != ZX_OK) {
+    return fit::error();
+  }
+  return ReadFlatFromSnapshot(std::move(snapshot));
+}
+
+}  // namespace inspect
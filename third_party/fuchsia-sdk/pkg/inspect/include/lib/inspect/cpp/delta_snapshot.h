@@ -0,0 +1,176 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_INSPECT_CPP_DELTA_SNAPSHOT_H_
+#define LIB_INSPECT_CPP_DELTA_SNAPSHOT_H_
+
+#include <lib/fit/string_view.h>
+#include <lib/inspect/cpp/flat_hierarchy.h>
+#include <lib/inspect/cpp/vmo/block.h>
+#include <lib/inspect/cpp/vmo/snapshot.h>
+#include <lib/zx/vmo.h>
+#include <zircon/types.h>
+
+#include <string>
+#include <vector>
+
+namespace inspect {
+
+// A property that changed between two scrapes of a VMO.
+struct PropertyChange final {
+  enum class Kind : uint8_t {
+    kAdded,
+    kUpdated,
+    kRemoved,
+  };
+
+  Kind kind = Kind::kUpdated;
+
+  // The index of the property's value block.
+  internal::BlockIndex index = 0;
+
+  // The index of the property's parent node, unless the property was removed.
+  internal::BlockIndex parent = 0;
+
+  // The property as of the latest scrape, unless it was removed. Its views
+  // point into the |DeltaSnapshot| and are valid until its next |Update|.
+  FlatHierarchy::Property property;
+};
+
+// |DeltaSnapshot| scrapes the same Inspect VMO over and over, keeping its
+// previous snapshot and reporting which properties changed since.
+//
+// Each |Snapshot::Create| allocates a buffer for the whole VMO and copies the
+// VMO into it. A |DeltaSnapshot| instead:
+//
+// - reads only the header if the generation count has not moved since the
+//   last scrape, as is the case for an idle VMO;
+// - otherwise reads the VMO a chunk at a time into a small scratch buffer,
+//   compares it page by page with the previous snapshot, and stages only
+//   the pages that changed, copying them into the snapshot in place once
+//   the read is known to be consistent;
+// - compares the blocks of each changed page to list the properties added,
+//   updated and removed.
+//
+// A reader cannot tell which pages of a VMO were written without reading
+// them, so when anything changed every page is still read once. What is
+// saved is the allocation, the zero-filling and the copy of the unchanged
+// pages, and the parse of the unchanged blocks.
+//
+// Example:
+//
+//   inspect::DeltaSnapshot scraper;
+//   std::vector<inspect::PropertyChange> changes;
+//   while (true) {
+//     if (scraper.Update(vmo, &changes) != ZX_OK) { ... }
+//     for (const auto& change : changes) { ... }
+//   }
+//
+// This class is not thread safe.
+class DeltaSnapshot final {
+ public:
+  struct Options final {
+    // The number of attempts to read a consistent snapshot.
+    // Reading fails if the number of attempts exceeds this number.
+    int read_attempts = 1024;
+  };
+
+  // Counters over all scrapes, for measuring the savings.
+  struct Stats final {
+    // The number of calls to |Update|, and of those that found the
+    // generation count unchanged.
+    uint64_t scrapes = 0;
+    uint64_t unchanged_scrapes = 0;
+
+    // The bytes read from the VMO, and the bytes of those that differed from
+    // the previous snapshot and were copied into it by a scrape that
+    // succeeded.
+    uint64_t bytes_read = 0;
+    uint64_t bytes_copied = 0;
+
+    // The pages copied into the snapshot.
+    uint64_t pages_changed = 0;
+  };
+
+  DeltaSnapshot() = default;
+  explicit DeltaSnapshot(Options options) : options_(options) {}
+
+  DeltaSnapshot(const DeltaSnapshot&) = delete;
+  DeltaSnapshot& operator=(const DeltaSnapshot&) = delete;
+
+  // Scrapes |vmo| and replaces |changes| with the properties that changed
+  // since the last scrape.
+  //
+  // The first scrape reads the whole VMO and reports no changes; read
+  // |snapshot()| for the baseline. If a concurrent write is seen while
+  // reading, the scrape is retried.
+  //
+  // If a scrape fails, |changes| is left empty and the snapshot is left as
+  // of the last scrape that succeeded, so the next scrape reports every
+  // change since then.
+  zx_status_t Update(const zx::vmo& vmo, std::vector<PropertyChange>* changes);
+
+  // The snapshot as of the latest scrape that succeeded.
+  //
+  // |Update| changes the snapshot in place, unless a copy of it is still
+  // held, in which case it copies the snapshot first, leaving the held copy
+  // as it was.
+  const Snapshot& snapshot() const { return snapshot_; }
+
+  // Returns the contents of a kString or kBytes property, as
+  // |FlatHierarchy::ReadBuffer| does.
+  fit::string_view ReadBuffer(const FlatHierarchy::Property& property, std::string* scratch) const;
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  // A block that differs from the previous snapshot, and whether it held a
+  // property before and after.
+  struct ChangedBlock {
+    internal::BlockIndex index;
+    bool was_property;
+    bool is_property;
+  };
+
+  // Reads the generation count from the header of |vmo|.
+  zx_status_t ReadGeneration(const zx::vmo& vmo, uint64_t* generation);
+
+  // Reads |vmo|, of |size| bytes, staging the pages that differ from the
+  // snapshot. Records the changed blocks if |diff| is set.
+  zx_status_t ReadChangedPages(const zx::vmo& vmo, size_t size, bool diff);
+
+  // Copies the staged pages into the snapshot, resized to |size| bytes.
+  void CommitPages(size_t size);
+
+  // Records the blocks that differ between |previous| and |next|, the page
+  // at |offset|, of |size| bytes.
+  void DiffPage(size_t offset, const uint8_t* previous, const uint8_t* next, size_t size);
+
+  // Records the buffer properties whose changed extents are in
+  // |changed_extents_|.
+  void AddExtentOwners();
+
+  // Turns |changed_blocks_| into |changes|.
+  void ListChanges(std::vector<PropertyChange>* changes);
+
+  Options options_;
+  Stats stats_;
+
+  Snapshot snapshot_;
+  uint64_t generation_ = 0;
+
+  // Reused across scrapes so that they do not allocate.
+  std::vector<uint8_t> chunk_;
+  std::vector<ChangedBlock> changed_blocks_;
+  std::vector<internal::BlockIndex> changed_extents_;
+
+  // The pages read by the current attempt that differ from the snapshot:
+  // their offsets, and their contents back to back.
+  std::vector<size_t> staged_offsets_;
+  std::vector<uint8_t> staged_pages_;
+};
+
+}  // namespace inspect
+
+#endif  // LIB_INSPECT_CPP_DELTA_SNAPSHOT_H_
@@ -0,0 +1,159 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_INSPECT_CPP_FLAT_HIERARCHY_H_
+#define LIB_INSPECT_CPP_FLAT_HIERARCHY_H_
+
+#include <lib/fit/result.h>
+#include <lib/fit/string_view.h>
+#include <lib/inspect/cpp/hierarchy.h>
+#include <lib/inspect/cpp/vmo/block.h>
+#include <lib/inspect/cpp/vmo/snapshot.h>
+
+#include <string>
+#include <vector>
+
+namespace inspect {
+
+class FlatHierarchy;
+
+// Construct a new FlatHierarchy by reading nodes out of the given Snapshot.
+fit::result<FlatHierarchy> ReadFlatFromSnapshot(Snapshot snapshot);
+
+// Construct a new FlatHierarchy by reading nodes out of the contents of the
+// given buffer.
+fit::result<FlatHierarchy> ReadFlatFromBuffer(std::vector<uint8_t> buffer);
+
+// A read-only view of the hierarchy stored in a snapshot.
+//
+// Reading a |Hierarchy| copies every name and value out of the snapshot into
+// its own allocation. A |FlatHierarchy| copies nothing: names and values are
+// read from the snapshot's bytes, and the nodes, properties and links are
+// kept in three arrays, each node naming its children, properties and links
+// by a range of indices. Reading one takes a handful of allocations however
+// large the snapshot.
+//
+// Nodes are numbered breadth first from the root, which is node 0, so the
+// children of a node are consecutive. As for |ReadFromSnapshot|, nodes that
+// are not reachable from the root are left out.
+//
+// A |FlatHierarchy| shares the snapshot's buffer, so its views are valid as
+// long as it is. Use |ToHierarchy| to build a |Hierarchy| when one is needed.
+class FlatHierarchy final {
+ public:
+  using Index = uint32_t;
+
+  // The indices [begin, end).
+  struct Range {
+    Index begin = 0;
+    Index end = 0;
+
+    Index size() const { return end - begin; }
+    bool empty() const { return begin == end; }
+  };
+
+  struct Node {
+    fit::string_view name;
+
+    // The index of the parent. The root is its own parent.
+    Index parent = 0;
+
+    Range children;
+    Range properties;
+    Range links;
+  };
+
+  struct Property {
+    fit::string_view name;
+    PropertyFormat format = PropertyFormat::kInvalid;
+
+    // The value block in the snapshot.
+    const internal::Block* block = nullptr;
+
+    // The value of a kInt, kUint, kDouble or kBool property.
+    int64_t int_value() const { return block->payload.i64; }
+    uint64_t uint_value() const { return block->payload.u64; }
+    double double_value() const { return block->payload.f64; }
+    bool bool_value() const { return block->payload.u64; }
+
+    // The entries of a kIntArray, kUintArray or kDoubleArray property, as
+    // int64_t, uint64_t or double.
+    size_t array_size() const {
+      return internal::ArrayBlockPayload::Count::Get<size_t>(block->payload.u64);
+    }
+    template <typename T>
+    const T* array_data() const {
+      return internal::GetArraySlot<const T>(block, 0);
+    }
+    ArrayDisplayFormat array_format() const;
+  };
+
+  struct Link {
+    fit::string_view name;
+    fit::string_view content;
+    LinkDisposition disposition = LinkDisposition::kChild;
+  };
+
+  FlatHierarchy(FlatHierarchy&&) = default;
+  FlatHierarchy& operator=(FlatHierarchy&&) = default;
+  FlatHierarchy(const FlatHierarchy&) = delete;
+  FlatHierarchy& operator=(const FlatHierarchy&) = delete;
+
+  // The root, which is always present.
+  static constexpr Index kRoot = 0;
+
+  size_t node_count() const { return nodes_.size(); }
+  size_t property_count() const { return properties_.size(); }
+  size_t link_count() const { return links_.size(); }
+
+  const Node& node(Index index) const { return nodes_[index]; }
+  const Property& property(Index index) const { return properties_[index]; }
+  const Link& link(Index index) const { return links_[index]; }
+
+  // Returns the index of the first child of |parent| named |name|, or
+  // |node_count()| if there is none.
+  Index FindChild(Index parent, fit::string_view name) const;
+
+  // Returns the contents of a kString or kBytes property.
+  //
+  // A value held in a single extent is returned in place. Otherwise its
+  // extents are copied into |scratch|, which backs the result.
+  fit::string_view ReadBuffer(const Property& property, std::string* scratch) const;
+
+  // Copies the subtree under |index|, by default the whole hierarchy, into a
+  // |Hierarchy|, as |ReadFromSnapshot| would have read it.
+  Hierarchy ToHierarchy(Index index = kRoot) const;
+
+ private:
+  friend fit::result<FlatHierarchy> ReadFlatFromSnapshot(Snapshot snapshot);
+
+  explicit FlatHierarchy(Snapshot snapshot) : snapshot_(std::move(snapshot)) {}
+
+  PropertyValue ToPropertyValue(const Property& property) const;
+
+  // Holds the bytes all of the views point into.
+  Snapshot snapshot_;
+
+  std::vector<Node> nodes_;
+  std::vector<Property> properties_;
+  std::vector<Link> links_;
+};
+
+namespace internal {
+
+// Reads the value block |block| of |snapshot| into |property|.
+//
+// Returns false if |block| does not hold a readable property.
+bool ReadProperty(const Snapshot* snapshot, const Block* block, FlatHierarchy::Property* property);
+
+// Returns the contents of the kBufferValue block |block| of |snapshot|, as
+// |FlatHierarchy::ReadBuffer| does.
+fit::string_view ReadPropertyBuffer(const Snapshot* snapshot, const Block* block,
+                                    std::string* scratch);
+
+}  // namespace internal
+
+}  // namespace inspect
+
+#endif  // LIB_INSPECT_CPP_FLAT_HIERARCHY_H_
@@ -81,6 +81,8 @@ class Snapshot final {
   size_t size() const { return buffer_ ? buffer_->size() : 0; }
 
  private:
+  friend class DeltaSnapshot;
+
   // Read from the VMO into a buffer.
   static zx_status_t Read(const zx::vmo& vmo, size_t size, uint8_t* buffer);
 
@@ -18,6 +18,7 @@
 #include <iterator>
 #include <map>
 #include <mutex>
+#include <unordered_map>
 
 namespace inspect {
 
@@ -263,9 +264,16 @@ class State final {
   // This leaves the string value allocated and empty.
   void InnerFreeStringExtents(BlockIndex string_index) __TA_REQUIRES(mutex_);
 
-  // Helper to create a new name block with the given name.
+  // Helper to get a name block holding the given name.
+  //
+  // Names are interned: a name already stored in the buffer is shared, and its reference count
+  // bumped, rather than stored again. Every name obtained here must be released with
+  // |ReleaseName|.
   zx_status_t CreateName(const std::string& name, BlockIndex* out) __TA_REQUIRES(mutex_);
 
+  // Helper to drop a reference to a name block, freeing it with the last reference.
+  void ReleaseName(BlockIndex name_index) __TA_REQUIRES(mutex_);
+
   // Helper function to create an array with the given name, number of slots, and format.
   template <typename NumericType, typename WrapperType, BlockType BlockTypeValue>
   WrapperType InnerCreateArray(const std::string& name, BlockIndex parent, size_t slots,
@@ -320,6 +328,23 @@ class State final {
   // to increment
   BlockIndex header_ FIT_GUARDED(mutex_);
 
+  // A name block shared by every value with that name, and the number of references to it.
+  struct InternedName {
+    BlockIndex index;
+    size_t refcount;
+  };
+
+  // Map from a name to the block storing it.
+  //
+  // Readers need no changes for sharing: values refer to their name block by index, and nothing
+  // in the format requires that index to be unique to one value.
+  std::unordered_map<std::string, InternedName> names_ FIT_GUARDED(mutex_);
+
+  // Map from the index of a name block to its entry in |names_|. Elements of an unordered_map
+  // are not moved by rehashing, so the pointers stay valid until their entry is erased.
+  std::unordered_map<BlockIndex, std::pair<const std::string, InternedName>*> names_by_index_
+      FIT_GUARDED(mutex_);
+
   // The next unique ID to give out from UniqueName.
   //
   // Uses the fastest available atomic uint64 type for fetch_and_add.
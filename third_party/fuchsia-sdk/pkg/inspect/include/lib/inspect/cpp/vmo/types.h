@@ -12,6 +12,7 @@
 #include <zircon/compiler.h>
 #include <zircon/types.h>
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -366,6 +367,108 @@ class LazyNode final {
   Link link_;
 };
 
+namespace internal {
+
+// The number of cells a sharded property spreads its writes over.
+constexpr size_t kShardCount = 16;
+
+// Returns the cell of a sharded property the calling thread writes to.
+// Threads are given cells round robin on their first write.
+inline size_t ThisThreadShard() {
+  static std::atomic<size_t> next_shard{0};
+  thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+  return shard;
+}
+
+// The cells of a sharded property, each padded to 64 bytes so that threads
+// writing to different cells do not contend. They are allocated with
+// make_shared, which in C++14 ignores an alignas above that of
+// std::max_align_t, hence the padding.
+template <typename T>
+struct ShardedCells final {
+  struct Cell {
+    std::atomic<T> value{0};
+    char padding[64 - sizeof(std::atomic<T>)];
+  };
+
+  void Add(T value) { cells[ThisThreadShard()].value.fetch_add(value, std::memory_order_relaxed); }
+  void Subtract(T value) {
+    cells[ThisThreadShard()].value.fetch_sub(value, std::memory_order_relaxed);
+  }
+
+  // Returns the sum of the cells. Writes made concurrently may be missed.
+  T Sum() const {
+    T sum = 0;
+    for (const Cell& cell : cells) {
+      sum += cell.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  Cell cells[kShardCount];
+};
+
+// A numeric property for values written from many threads at once, such as
+// request counters. Concrete implementations are available only for int64_t
+// and uint64_t.
+//
+// Writes to a |NumericProperty| take the lock of the |State| and bump the
+// generation count of the buffer. Writes to a |ShardedNumericProperty| are
+// a relaxed atomic add to a cell picked by the writing thread, and do not
+// touch the buffer. The cells are summed only when the value is read: the
+// property is stored in the buffer as a lazy node whose callback publishes
+// the sum. Readers that do not open lazy nodes, such as |ReadFromVmo|, do
+// not see it.
+template <typename T>
+class ShardedNumericProperty final {
+ public:
+  // Construct a default sharded property. Operations on this property are
+  // no-ops.
+  ShardedNumericProperty() = default;
+
+  // Allow moving, disallow copying.
+  ShardedNumericProperty(const ShardedNumericProperty& other) = delete;
+  ShardedNumericProperty(ShardedNumericProperty&& other) = default;
+  ShardedNumericProperty& operator=(const ShardedNumericProperty& other) = delete;
+  ShardedNumericProperty& operator=(ShardedNumericProperty&& other) = default;
+
+  // Add the given value to the value of this property.
+  void Add(T value) {
+    if (cells_) {
+      cells_->Add(value);
+    }
+  }
+
+  // Subtract the given value from the value of this property.
+  void Subtract(T value) {
+    if (cells_) {
+      cells_->Subtract(value);
+    }
+  }
+
+  // Return the value of this property, as a reader would see it.
+  T Get() const { return cells_ ? cells_->Sum() : 0; }
+
+  // Return true if this property is stored in a buffer. False otherwise.
+  explicit operator bool() { return cells_ != nullptr; }
+
+ private:
+  friend class ::inspect::Node;
+  ShardedNumericProperty(std::shared_ptr<ShardedCells<T>> cells, LazyNode lazy)
+      : cells_(std::move(cells)), lazy_(std::move(lazy)) {}
+
+  // The cells, shared with the callback of |lazy_|.
+  std::shared_ptr<ShardedCells<T>> cells_;
+
+  // The lazy node publishing the sum of the cells.
+  LazyNode lazy_;
+};
+
+}  // namespace internal
+
+using ShardedIntProperty = internal::ShardedNumericProperty<int64_t>;
+using ShardedUintProperty = internal::ShardedNumericProperty<uint64_t>;
+
 // A node under which properties, metrics, and other nodes may be nested.
 // All methods wrap the corresponding functionality on |State|.
 class Node final {
@@ -481,6 +584,42 @@ class Node final {
     list->emplace(CreateByteVector(name, value));
   }
 
+  // Create a new |ShardedIntProperty| with the given name that is a child of this node, for
+  // counters written from many threads at once. Its value starts at zero.
+  // If this node is not stored in a buffer, the created property will
+  // also not be stored in a buffer.
+  //
+  // WARNING: The property is published through a lazy node, so it is the caller's
+  // responsibility to avoid name collisions with other properties on this node.
+  ShardedIntProperty CreateShardedInt(const std::string& name) __WARN_UNUSED_RESULT;
+
+  // Same as CreateShardedInt, but emplaces the value in the given container.
+  //
+  // The type of |list| must have method emplace(ShardedIntProperty).
+  // inspect::ValueList is recommended for most use cases.
+  template <typename T>
+  void CreateShardedInt(const std::string& name, T* list) {
+    list->emplace(CreateShardedInt(name));
+  }
+
+  // Create a new |ShardedUintProperty| with the given name that is a child of this node, for
+  // counters written from many threads at once. Its value starts at zero.
+  // If this node is not stored in a buffer, the created property will
+  // also not be stored in a buffer.
+  //
+  // WARNING: The property is published through a lazy node, so it is the caller's
+  // responsibility to avoid name collisions with other properties on this node.
+  ShardedUintProperty CreateShardedUint(const std::string& name) __WARN_UNUSED_RESULT;
+
+  // Same as CreateShardedUint, but emplaces the value in the given container.
+  //
+  // The type of |list| must have method emplace(ShardedUintProperty).
+  // inspect::ValueList is recommended for most use cases.
+  template <typename T>
+  void CreateShardedUint(const std::string& name, T* list) {
+    list->emplace(CreateShardedUint(name));
+  }
+
   // Create a new |IntArray| with the given name and slots that is a child of this node.
   // If this node is not stored in a buffer, the created value will
   // also not be stored in a buffer.
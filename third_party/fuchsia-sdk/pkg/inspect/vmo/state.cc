@@ -135,7 +135,7 @@ void State::InnerFreeArray(WrapperType* value) {
 
   DecrementParentRefcount(value->value_index_);
 
-  heap_->Free(value->name_index_);
+  ReleaseName(value->name_index_);
   heap_->Free(value->value_index_);
   value->state_ = nullptr;
 }
@@ -313,7 +313,7 @@ WrapperType State::InnerCreateProperty(const std::string& name, BlockIndex paren
   block->payload.u64 = PropertyBlockPayload::Flags::Make(format);
   status = InnerSetStringExtents(value_index, value, length);
   if (status != ZX_OK) {
-    heap_->Free(name_index);
+    ReleaseName(name_index);
     heap_->Free(value_index);
     return WrapperType();
   }
@@ -349,7 +349,7 @@ Link State::CreateLink(const std::string& name, BlockIndex parent, const std::st
   status = CreateName(content, &content_index);
   if (status != ZX_OK) {
     DecrementParentRefcount(value_index);
-    heap_->Free(name_index);
+    ReleaseName(name_index);
     heap_->Free(value_index);
     return Link();
   }
@@ -606,7 +606,7 @@ void State::DecrementParentRefcount(BlockIndex value_index) {
           // Continue decrementing refcounts.
           BlockIndex next_parent_index =
               ValueBlockFields::ParentIndex::Get<BlockIndex>(parent->header);
-          heap_->Free(ValueBlockFields::NameIndex::Get<BlockIndex>(parent->header));
+          ReleaseName(ValueBlockFields::NameIndex::Get<BlockIndex>(parent->header));
           heap_->Free(parent_index);
           parent_index = next_parent_index;
           break;
@@ -632,7 +632,7 @@ void State::FreeIntProperty(IntProperty* metric) {
 
   DecrementParentRefcount(metric->value_index_);
 
-  heap_->Free(metric->name_index_);
+  ReleaseName(metric->name_index_);
   heap_->Free(metric->value_index_);
   metric->state_ = nullptr;
 }
@@ -648,7 +648,7 @@ void State::FreeUintProperty(UintProperty* metric) {
 
   DecrementParentRefcount(metric->value_index_);
 
-  heap_->Free(metric->name_index_);
+  ReleaseName(metric->name_index_);
   heap_->Free(metric->value_index_);
   metric->state_ = nullptr;
 }
@@ -664,7 +664,7 @@ void State::FreeDoubleProperty(DoubleProperty* metric) {
 
   DecrementParentRefcount(metric->value_index_);
 
-  heap_->Free(metric->name_index_);
+  ReleaseName(metric->name_index_);
   heap_->Free(metric->value_index_);
   metric->state_ = nullptr;
 }
@@ -680,7 +680,7 @@ void State::FreeBoolProperty(BoolProperty* metric) {
 
   DecrementParentRefcount(metric->value_index_);
 
-  heap_->Free(metric->name_index_);
+  ReleaseName(metric->name_index_);
   heap_->Free(metric->value_index_);
   metric->state_ = nullptr;
 }
@@ -705,7 +705,7 @@ void State::InnerFreePropertyWithExtents(WrapperType* property) {
 
   InnerFreeStringExtents(property->value_index_);
 
-  heap_->Free(property->name_index_);
+  ReleaseName(property->name_index_);
   heap_->Free(property->value_index_);
   property->state_ = nullptr;
 }
@@ -727,9 +727,9 @@ void State::FreeLink(Link* link) {
 
   DecrementParentRefcount(link->value_index_);
 
-  heap_->Free(link->name_index_);
+  ReleaseName(link->name_index_);
   heap_->Free(link->value_index_);
-  heap_->Free(link->content_index_);
+  ReleaseName(link->content_index_);
   link->state_ = nullptr;
 }
 
@@ -753,7 +753,7 @@ void State::FreeNode(Node* object) {
       // Actually free the block, decrementing parent refcounts.
       DecrementParentRefcount(object->value_index_);
       // Node has no refs, free it.
-      heap_->Free(object->name_index_);
+      ReleaseName(object->name_index_);
       heap_->Free(object->value_index_);
     } else {
       // Node has refs, change type to tombstone so it can be removed
@@ -864,7 +864,7 @@ zx_status_t State::InnerCreateValue(const std::string& name, BlockType type,
     default:
       ZX_DEBUG_ASSERT_MSG(false, "Invalid parent block type %u for 0x%lx",
                           static_cast<uint32_t>(GetType(parent)), parent_index);
-      heap_->Free(name_index);
+      ReleaseName(name_index);
       heap_->Free(value_index);
       return ZX_ERR_INVALID_ARGS;
   }
@@ -961,6 +961,13 @@ zx_status_t State::CreateName(const std::string& name, BlockIndex* out) {
     return ZX_ERR_INVALID_ARGS;
   }
 
+  auto it = names_.find(name);
+  if (it != names_.end()) {
+    it->second.refcount++;
+    *out = it->second.index;
+    return ZX_OK;
+  }
+
   zx_status_t status;
   status = heap_->Allocate(BlockSizeForPayload(name.size()), out);
   if (status != ZX_OK) {
@@ -973,9 +980,29 @@ zx_status_t State::CreateName(const std::string& name, BlockIndex* out) {
                   NameBlockFields::Length::Make(name.size());
   memset(block->payload.data, 0, PayloadCapacity(GetOrder(block)));
   memcpy(block->payload.data, name.data(), name.size());
+
+  it = names_.emplace(name, InternedName{*out, 1}).first;
+  names_by_index_.emplace(*out, &*it);
   return ZX_OK;
 }
 
+void State::ReleaseName(BlockIndex name_index) {
+  auto it = names_by_index_.find(name_index);
+  ZX_DEBUG_ASSERT_MSG(it != names_by_index_.end(), "Name %lu is not interned", name_index);
+  if (it == names_by_index_.end()) {
+    heap_->Free(name_index);
+    return;
+  }
+
+  auto* entry = it->second;
+  if (--entry->second.refcount > 0) {
+    return;
+  }
+  names_by_index_.erase(it);
+  names_.erase(names_.find(entry->first));
+  heap_->Free(name_index);
+}
+
 std::string State::UniqueName(const std::string& prefix) {
   std::ostringstream out;
   uint64_t value = next_unique_id_.fetch_add(1, std::memory_order_relaxed);
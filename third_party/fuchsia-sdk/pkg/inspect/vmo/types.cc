@@ -459,6 +459,45 @@ LazyNode Node::CreateLazyValues(const std::string& name, LazyNodeCallbackFn call
   return LazyNode();
 }
 
+namespace {
+// Creates the lazy node publishing the sum of |cells| as a property named
+// |name|, made by |create|.
+template <typename T, typename Create>
+LazyNode CreateShardedLazyValues(Node* node, const std::string& name,
+                                 std::shared_ptr<internal::ShardedCells<T>> cells,
+                                 Create create) {
+  return node->CreateLazyValues(name, [name, cells = std::move(cells), create] {
+    Inspector inspector(InspectSettings{.maximum_size = 4096});
+    inspector.emplace(create(&inspector.GetRoot(), name, cells->Sum()));
+    return fit::make_ok_promise(std::move(inspector));
+  });
+}
+}  // namespace
+
+ShardedIntProperty Node::CreateShardedInt(const std::string& name) {
+  if (state_) {
+    auto cells = std::make_shared<internal::ShardedCells<int64_t>>();
+    auto lazy = CreateShardedLazyValues(
+        this, name, cells, [](Node* root, const std::string& name, int64_t value) {
+          return root->CreateInt(name, value);
+        });
+    return ShardedIntProperty(std::move(cells), std::move(lazy));
+  }
+  return ShardedIntProperty();
+}
+
+ShardedUintProperty Node::CreateShardedUint(const std::string& name) {
+  if (state_) {
+    auto cells = std::make_shared<internal::ShardedCells<uint64_t>>();
+    auto lazy = CreateShardedLazyValues(
+        this, name, cells, [](Node* root, const std::string& name, uint64_t value) {
+          return root->CreateUint(name, value);
+        });
+    return ShardedUintProperty(std::move(cells), std::move(lazy));
+  }
+  return ShardedUintProperty();
+}
+
 Link::~Link() {
   if (state_) {
     state_->FreeLink(this);